@@ -0,0 +1,201 @@
+// Runs the same load through the fetch engine once per event loop (epoll, and
+// io_uring when the build has it) against an in-process keep-alive HTTP server
+// on 127.0.0.1, and reports throughput, latency and the CPU time the engine's
+// thread spent per request (user + system, so syscall overhead shows up).
+//
+// Usage: bench_fetch [requests] [concurrency] [body_bytes]
+
+#include "../include/FetchEngine.h"
+#include "../include/IoUring.h"
+#include "../include/config.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+// Answers every request on one connection with the same page until the client hangs up
+static void serve_connection(SOCKET client, const std::string* response) {
+    std::string pending;
+    char chunk[4096];
+    while (true) {
+        ssize_t received = recv(client, chunk, sizeof(chunk), 0);
+        if (received <= 0) {
+            break;
+        }
+        pending.append(chunk, (size_t)received);
+        size_t end;
+        bool failed = false;
+        while ((end = pending.find("\r\n\r\n")) != std::string::npos) {
+            pending.erase(0, end + 4);
+            size_t offset = 0;
+            while (offset < response->length()) {
+                ssize_t sent = send(client, response->data() + offset, response->length() - offset, MSG_NOSIGNAL);
+                if (sent <= 0) {
+                    failed = true;
+                    break;
+                }
+                offset += (size_t)sent;
+            }
+            if (failed) {
+                break;
+            }
+        }
+        if (failed) {
+            break;
+        }
+    }
+    CLOSE_SOCKET(client);
+}
+
+static void run_server(SOCKET listener, const std::string* response, std::atomic<bool>& stop) {
+    while (!stop.load()) {
+        SOCKET client = accept(listener, nullptr, nullptr);
+        if (client == INVALID_SOCKET) {
+            continue;
+        }
+        std::thread(serve_connection, client, response).detach();
+    }
+}
+
+static double thread_cpu_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+struct RunResult {
+    size_t ok = 0;
+    size_t failed = 0;
+    double wall_ms = 0;
+    double cpu_ms = 0;
+    std::vector<double> latency_ms;
+    FetchEngineStats stats;
+    std::string backend;
+};
+
+// Fetch requests pages with up to concurrency in flight over as many sockets
+static RunResult run_client(const std::string& host, bool use_io_uring, int requests, int concurrency) {
+    FetchEngineConfig config;
+    config.use_io_uring = use_io_uring;
+    config.max_in_flight = (size_t)concurrency;
+    config.max_connections_per_host = (size_t)concurrency;
+    FetchEngine engine(config);
+
+    RunResult run;
+    run.backend = engine.backend();
+
+    // Open the sockets before timing, so both loops are measured on kept-alive connections
+    for (int i = 0; i < concurrency; ++i) {
+        engine.submit(host, "/warmup");
+    }
+    engine.run_until_idle();
+    std::vector<FetchResult> results;
+    engine.take_completed(results);
+    results.clear();
+    FetchEngineStats before = engine.get_stats();
+
+    // Closed loop: a new request goes out as each one finishes, so the latency
+    // is the engine's and the server's rather than time spent queued
+    auto start = std::chrono::steady_clock::now();
+    double cpu_start = thread_cpu_ms();
+    int submitted = 0;
+    while (submitted < requests || engine.outstanding() > 0) {
+        while (submitted < requests && engine.outstanding() < (size_t)concurrency) {
+            engine.submit(host, "/catalogue/page-" + std::to_string(submitted++) + ".html");
+        }
+        engine.poll(100);
+        engine.take_completed(results);
+    }
+    run.cpu_ms = thread_cpu_ms() - cpu_start;
+    run.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    for (FetchResult& result : results) {
+        if (result.ok) {
+            run.ok++;
+            run.latency_ms.push_back(result.elapsed_ms);
+        } else {
+            run.failed++;
+        }
+    }
+    run.stats = engine.get_stats();
+    run.stats.ring_operations -= before.ring_operations;
+    run.stats.ring_enters -= before.ring_enters;
+    run.stats.connections_opened -= before.connections_opened;
+    return run;
+}
+
+static void report(RunResult& run, size_t body_bytes) {
+    std::vector<double>& samples = run.latency_ms;
+    std::sort(samples.begin(), samples.end());
+    double p50 = samples.empty() ? 0 : samples[samples.size() / 2];
+    double p99 = samples.empty() ? 0 : samples[samples.size() * 99 / 100];
+    double seconds = run.wall_ms / 1000.0;
+    size_t total = run.ok + run.failed;
+    printf("%-9s %8zu %6zu %10.0f %9.1f %8.3f %8.3f %10.2f", run.backend.c_str(), run.ok, run.failed,
+           run.ok / seconds, run.ok * body_bytes / seconds / 1e6, p50, p99,
+           total > 0 ? run.cpu_ms * 1000.0 / total : 0.0);
+    if (run.backend == "io_uring") {
+        printf("  %llu ops in %llu enters", run.stats.ring_operations, run.stats.ring_enters);
+    }
+    printf("\n");
+}
+
+int main(int argc, char* argv[]) {
+    int requests = argc > 1 ? std::max(1, atoi(argv[1])) : 50000;
+    int concurrency = argc > 2 ? std::max(1, atoi(argv[2])) : 64;
+    size_t body_bytes = argc > 3 ? (size_t)std::max(0, atoi(argv[3])) : 16384;
+
+    std::string body(body_bytes, 'x');
+    std::string response = "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: " +
+                           std::to_string(body.length()) + "\r\nConnection: keep-alive\r\n\r\n" + body;
+
+    SOCKET listener = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 1024) != 0 ||
+        getsockname(listener, (sockaddr*)&address, &length) != 0) {
+        std::cerr << "Cannot listen on 127.0.0.1" << std::endl;
+        return 1;
+    }
+    int port = ntohs(address.sin_port);
+    std::string host = "127.0.0.1:" + std::to_string(port);
+
+    std::atomic<bool> stop(false);
+    std::thread server(run_server, listener, &response, std::ref(stop));
+
+    printf("%d GETs of %zu-byte pages, %d in flight, against %s\n", requests, body_bytes, concurrency,
+           host.c_str());
+    printf("%-9s %8s %6s %10s %9s %8s %8s %10s\n", "backend", "ok", "failed", "req/s", "MB/s", "p50 ms",
+           "p99 ms", "cpu us/req");
+    bool all_ok = true;
+    RunResult epoll_run = run_client(host, false, requests, concurrency);
+    report(epoll_run, body_bytes);
+    all_ok = all_ok && epoll_run.failed == 0;
+    if (IoUring::available()) {
+        RunResult ring_run = run_client(host, true, requests, concurrency);
+        report(ring_run, body_bytes);
+        all_ok = all_ok && ring_run.failed == 0;
+    } else {
+        printf("io_uring  not built (configure with -DWEBSCRAPER_IO_URING=ON)\n");
+    }
+
+    // Unblock accept() with one last connection
+    stop.store(true);
+    SOCKET wake = socket(AF_INET, SOCK_STREAM, 0);
+    connect(wake, (sockaddr*)&address, sizeof(address));
+    CLOSE_SOCKET(wake);
+    server.join();
+    CLOSE_SOCKET(listener);
+    return all_ok ? 0 : 1;
+}
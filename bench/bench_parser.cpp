@@ -0,0 +1,797 @@
+// Parser microbenchmarks, run in this order:
+//   - the suite: each hot parsing function on its own over each input, in
+//     ns/op, bytes/s and allocations/op. parse_books, parse_book_page,
+//     extract_all_links, find_next_link, normalize_url and canonicalize_url
+//     run with both the copying and the buffer-reusing API; simhash_page too
+//   - parse_books against the multi-scan implementation it replaced, checking
+//     both find the same books
+//   - locating hrefs, parse_books and extract_all_links at each scanning
+//     kernel level (HtmlScan.h), checking every level gives the same results
+//   - one crawler page step (books and links parsed and checked against what
+//     was already seen) with the copying API and the buffer-reusing one
+//   - checking every link against the URL rules (UrlRules.h), one find per
+//     pattern against the compiled automaton
+//   - resolving every href and making its dedup key, the first substr-based
+//     functions against UrlBase (UrlNormalize.h)
+// Each comparison reports throughput, time and heap allocations per page.
+//
+// Pages come from the checked-in corpus (bench/corpus/pages.txt: captured
+// pages of several sizes, each its own suite input) when no archive is given,
+// from response archives recorded with --record (e.g. a crawl of
+// catalog_server, each archive one suite input), or, with --generated, from
+// every listing page of a generated catalog.
+//
+// Usage: bench_parser [--suite] [--filter NAME] [--generated] [archive.wsr ...]
+//   --suite        Run the suite only, no comparisons
+//   --filter NAME  Run only the suite functions whose name contains NAME (implies --suite)
+
+#include "../include/HtmlParser.h"
+#include "../include/HtmlScan.h"
+#include "../include/NearDuplicate.h"
+#include "../include/SyntheticCatalog.h"
+#include "../include/UrlRules.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Every heap allocation in the process goes through here
+static unsigned long long allocations = 0;
+
+void* operator new(size_t size) {
+    allocations++;
+    void* p = malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// parse_books before the single-pass scanner: copy each article, then one
+// find + substr per field
+static std::vector<Book> parse_books_reference(std::string_view html, const std::string& base_url) {
+    static const std::string book_start = "<article class=\"product_pod\">";
+    static const std::string book_end = "</article>";
+    std::vector<Book> books;
+    size_t pos = 0;
+    while ((pos = html.find(book_start, pos)) != std::string::npos) {
+        size_t book_end_pos = html.find(book_end, pos);
+        if (book_end_pos == std::string::npos) {
+            break;
+        }
+        std::string_view book_html = html.substr(pos, book_end_pos - pos + book_end.length());
+        Book book;
+        std::string title_tag = extract_between(book_html, "<h3>", "</h3>");
+        book.title = extract_between(title_tag, "title=\"", "\"");
+        if (book.title.empty()) {
+            book.title = extract_between(title_tag, "\">", "</a>");
+        }
+        book.url = normalize_url(extract_between(title_tag, "href=\"", "\""), base_url);
+        parse_price(extract_between(book_html, "<p class=\"price_color\">", "</p>"), book.price);
+        book.rating = parse_rating(extract_between(book_html, "<p class=\"star-rating ", "\""));
+        if (!book.url.empty()) {
+            books.push_back(book);
+        }
+        pos = book_end_pos + book_end.length();
+    }
+    return books;
+}
+
+struct Page {
+    std::string url;
+    std::string body;
+};
+
+// Bodies of every response in a segment written by ResponseArchive:
+//   WSR1 <url-length> <response-length>\n<url>\n<response>\n
+static bool load_archive(const std::string& path, std::vector<Page>& pages) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "Cannot open " << path << std::endl;
+        return false;
+    }
+    std::stringstream contents;
+    contents << in.rdbuf();
+    std::string data = contents.str();
+    size_t pos = 0;
+    while (pos < data.size()) {
+        size_t line_end = data.find('\n', pos);
+        unsigned long url_length = 0;
+        unsigned long response_length = 0;
+        if (line_end == std::string::npos ||
+            sscanf(data.c_str() + pos, "WSR1 %lu %lu", &url_length, &response_length) != 2 ||
+            line_end + 1 + url_length + 1 + response_length > data.size()) {
+            std::cerr << path << ": corrupt record at offset " << pos << std::endl;
+            return false;
+        }
+        Page page;
+        page.url = data.substr(line_end + 1, url_length);
+        std::string response = data.substr(line_end + 1 + url_length + 1, response_length);
+        size_t head_end = response.find("\r\n\r\n");
+        if (head_end != std::string::npos && response.compare(0, 12, "HTTP/1.1 200") == 0) {
+            page.body = response.substr(head_end + 4);
+            pages.push_back(page);
+        }
+        pos = line_end + 1 + url_length + 1 + response_length + 1;
+    }
+    return true;
+}
+
+// The pages listed in a corpus manifest: "<file> <url>" per line, files
+// relative to the manifest, '#' comments
+static bool load_corpus(const std::string& manifest_path, std::vector<std::string>& names, std::vector<Page>& pages) {
+    std::ifstream manifest(manifest_path);
+    if (!manifest) {
+        std::cerr << "Cannot open corpus manifest " << manifest_path << std::endl;
+        return false;
+    }
+    std::string dir = manifest_path.substr(0, manifest_path.find_last_of("/\\") + 1);
+    std::string line;
+    while (std::getline(manifest, line)) {
+        std::istringstream fields(line);
+        std::string file;
+        Page page;
+        if (!(fields >> file) || file[0] == '#') {
+            continue;
+        }
+        if (!(fields >> page.url)) {
+            std::cerr << manifest_path << ": no URL for " << file << std::endl;
+            return false;
+        }
+        std::ifstream in(dir + file, std::ios::binary);
+        if (!in) {
+            std::cerr << "Cannot open corpus page " << dir + file << std::endl;
+            return false;
+        }
+        std::stringstream body;
+        body << in.rdbuf();
+        page.body = body.str();
+        names.push_back(file);
+        pages.push_back(page);
+    }
+    return true;
+}
+
+// The built-in URL rules as they were written before UrlRules: one find per
+// pattern, for should_ignore_url and then is_category_page / is_book_page
+static PageClass classify_reference(std::string_view url, bool& accepted) {
+    static const char* const EXCLUDED[] = {".css", ".js", ".ico", ".jpg", ".png", "/static/", "/accounts/",
+                                           "/login", "/logout", "/admin", "http://books.toscrape.comhttp", "mhttp"};
+    accepted = url.find("books.toscrape.com") != std::string_view::npos;
+    for (const char* pattern : EXCLUDED) {
+        if (url.find(pattern) != std::string_view::npos) {
+            accepted = false;
+        }
+    }
+    if (url.find("/category/") != std::string_view::npos || url.find("index.html") != std::string_view::npos ||
+        url.find("page-") != std::string_view::npos) {
+        return PageClass::Listing;
+    }
+    if (url.find("/catalogue/") != std::string_view::npos && url.rfind(".html") == std::string_view::npos &&
+        !url.empty() && url.back() != '/') {
+        return PageClass::Book;
+    }
+    return PageClass::Other;
+}
+
+// normalize_url and canonicalize_url as first written: a substr copy per
+// step, a std::transform over the whole URL, and no RFC 3986 normalization
+static std::string normalize_url_reference(const std::string& url, const std::string& base_url) {
+    if (url.find("http://") == 0 || url.find("https://") == 0) {
+        return url;
+    }
+    if (url.empty()) {
+        return "";
+    }
+    if (url.substr(0, 2) == "//") {
+        return "http:" + url;
+    }
+    std::string domain = "";
+    size_t domain_start = base_url.find("://");
+    if (domain_start != std::string::npos) {
+        domain_start += 3;
+        size_t domain_end = base_url.find('/', domain_start);
+        if (domain_end != std::string::npos) {
+            domain = base_url.substr(0, domain_end);
+        } else {
+            domain = base_url;
+        }
+    } else {
+        domain = "http://" + base_url.substr(0, base_url.find('/'));
+    }
+    if (url[0] == '/') {
+        return domain + url;
+    }
+    size_t last_slash = base_url.find_last_of('/');
+    if (last_slash != std::string::npos && last_slash > 8) {
+        return base_url.substr(0, last_slash + 1) + url;
+    }
+    return domain + "/" + url;
+}
+
+static std::string canonicalize_url_reference(const std::string& url) {
+    std::string result = url;
+    std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) { return std::tolower(c); });
+    size_t protocol_pos = result.find("://");
+    if (protocol_pos != std::string::npos) {
+        result.erase(0, protocol_pos + 3);
+    }
+    if (result.compare(0, 4, "www.") == 0) {
+        result.erase(0, 4);
+    }
+    if (!result.empty() && result.back() == '/') {
+        result.pop_back();
+    }
+    size_t anchor_pos = result.find('#');
+    if (anchor_pos != std::string::npos) {
+        result.resize(anchor_pos);
+    }
+    size_t query_pos = result.find('?');
+    if (query_pos != std::string::npos && result.find("search") == std::string::npos &&
+        result.find("filter") == std::string::npos) {
+        result.resize(query_pos);
+    }
+    return result;
+}
+
+static bool same_books(const std::vector<Book>& a, const std::vector<Book>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].title != b[i].title || a[i].url != b[i].url || a[i].price != b[i].price ||
+            a[i].rating != b[i].rating) {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct Timing {
+    double ns_per_page = 0;
+    double mb_per_second = 0;
+    double allocs_per_page = 0;
+    size_t found = 0;   // Books, links or hrefs per round
+};
+
+// One suite input: its pages, with the href values on them as written and
+// the links extract_all_links keeps, for the URL functions
+struct SuiteInput {
+    std::string name;
+    std::vector<const Page*> pages;
+    std::vector<std::vector<std::string>> hrefs;
+    std::vector<std::vector<std::string>> links;
+};
+
+// One suite function: call it on a page (on each href or link of the page for
+// the URL functions), add the bytes it read to bytes, and return the calls made
+struct SuiteFunction {
+    const char* name;
+    std::function<size_t(const SuiteInput&, size_t page, size_t& bytes)> run;
+};
+
+// Results go here so the calls are not optimized away
+static size_t sink = 0;
+
+// Time one suite function over every page of input until a quarter of a
+// second has passed
+static void run_suite_function(const SuiteFunction& function, const SuiteInput& input) {
+    size_t ops = 0;
+    size_t bytes = 0;
+    unsigned long long allocs_before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    do {
+        for (size_t i = 0; i < input.pages.size(); ++i) {
+            ops += function.run(input, i, bytes);
+        }
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < 0.25);
+    if (ops == 0) {
+        printf("%-30s %-18s %10s\n", function.name, input.name.c_str(), "no calls");
+        return;
+    }
+    printf("%-30s %-18s %10.0f %12.1f %10.1f %10.2f\n", function.name, input.name.c_str(), (double)bytes / ops,
+           elapsed * 1e9 / ops, bytes / elapsed / 1e6, (allocations - allocs_before) / (double)ops);
+}
+
+static void run_suite(std::vector<SuiteInput>& inputs, const std::string& filter) {
+    for (SuiteInput& input : inputs) {
+        for (const Page* page : input.pages) {
+            std::vector<std::string> hrefs;
+            size_t pos = 0;
+            while ((pos = page->body.find("href=\"", pos)) != std::string::npos) {
+                size_t end = page->body.find('"', pos + 6);
+                if (end == std::string::npos) {
+                    break;
+                }
+                hrefs.push_back(page->body.substr(pos + 6, end - pos - 6));
+                pos = end;
+            }
+            input.hrefs.push_back(hrefs);
+            std::set<std::string> links = extract_all_links(page->body, page->url);
+            input.links.emplace_back(links.begin(), links.end());
+        }
+    }
+
+    // Scratch the buffer-reusing functions keep between calls, as the crawl loops do
+    UrlBase base;
+    std::vector<BookView> book_views;
+    LinkBuffer link_buffer;
+    std::string url;
+    std::string key;
+    const SuiteFunction functions[] = {
+        {"parse_books", [](const SuiteInput& in, size_t i, size_t& bytes) {
+            bytes += in.pages[i]->body.size();
+            sink += parse_books(in.pages[i]->body, in.pages[i]->url).size();
+            return (size_t)1;
+        }},
+        {"parse_books (views)", [&](const SuiteInput& in, size_t i, size_t& bytes) {
+            bytes += in.pages[i]->body.size();
+            parse_books(in.pages[i]->body, book_views);
+            sink += book_views.size();
+            return (size_t)1;
+        }},
+        {"parse_book_page", [](const SuiteInput& in, size_t i, size_t& bytes) {
+            bytes += in.pages[i]->body.size();
+            sink += parse_book_page(in.pages[i]->body, "books.toscrape.com", in.pages[i]->url).title.size();
+            return (size_t)1;
+        }},
+        {"extract_all_links", [](const SuiteInput& in, size_t i, size_t& bytes) {
+            bytes += in.pages[i]->body.size();
+            sink += extract_all_links(in.pages[i]->body, in.pages[i]->url).size();
+            return (size_t)1;
+        }},
+        {"extract_all_links (LinkBuffer)", [&](const SuiteInput& in, size_t i, size_t& bytes) {
+            bytes += in.pages[i]->body.size();
+            base.assign(in.pages[i]->url);
+            link_buffer.clear();
+            extract_all_links(in.pages[i]->body, base, link_buffer);
+            sink += link_buffer.size();
+            return (size_t)1;
+        }},
+        {"find_next_link", [](const SuiteInput& in, size_t i, size_t& bytes) {
+            bytes += in.pages[i]->body.size();
+            sink += find_next_link(in.pages[i]->body).size();
+            return (size_t)1;
+        }},
+        {"normalize_url", [](const SuiteInput& in, size_t i, size_t& bytes) {
+            for (const std::string& href : in.hrefs[i]) {
+                bytes += href.size();
+                sink += normalize_url(href, in.pages[i]->url).size();
+            }
+            return in.hrefs[i].size();
+        }},
+        {"normalize_url (UrlBase)", [&](const SuiteInput& in, size_t i, size_t& bytes) {
+            base.assign(in.pages[i]->url);
+            for (const std::string& href : in.hrefs[i]) {
+                bytes += href.size();
+                base.resolve(href, url);
+                sink += url.size();
+            }
+            return in.hrefs[i].size();
+        }},
+        {"canonicalize_url", [](const SuiteInput& in, size_t i, size_t& bytes) {
+            for (const std::string& link : in.links[i]) {
+                bytes += link.size();
+                sink += canonicalize_url(link).size();
+            }
+            return in.links[i].size();
+        }},
+        {"canonicalize_url (buffer)", [&](const SuiteInput& in, size_t i, size_t& bytes) {
+            for (const std::string& link : in.links[i]) {
+                bytes += link.size();
+                canonicalize_url(link, key);
+                sink += key.size();
+            }
+            return in.links[i].size();
+        }},
+        {"simhash_page", [](const SuiteInput& in, size_t i, size_t& bytes) {
+            bytes += in.pages[i]->body.size();
+            sink += (size_t)simhash_page(in.pages[i]->body);
+            return (size_t)1;
+        }},
+    };
+
+    printf("%-30s %-18s %10s %12s %10s %10s\n", "function", "input", "bytes/op", "ns/op", "MB/s", "allocs/op");
+    for (const SuiteFunction& function : functions) {
+        if (std::string(function.name).find(filter) == std::string::npos) {
+            continue;
+        }
+        for (const SuiteInput& input : inputs) {
+            run_suite_function(function, input);
+        }
+    }
+}
+
+// Run parse over every page until at least half a second has passed; parse
+// returns how many things it found on the page
+template <typename Parse>
+static Timing measure(const std::vector<Page>& pages, size_t total_bytes, Parse parse) {
+    Timing timing;
+    size_t rounds = 0;
+    unsigned long long allocs_before = allocations;
+    auto start = std::chrono::steady_clock::now();
+    double elapsed = 0;
+    do {
+        for (const Page& page : pages) {
+            timing.found += parse(page);
+        }
+        rounds++;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < 0.5);
+    double parsed_pages = (double)rounds * pages.size();
+    timing.ns_per_page = elapsed * 1e9 / parsed_pages;
+    timing.mb_per_second = rounds * (double)total_bytes / elapsed / 1e6;
+    timing.allocs_per_page = (allocations - allocs_before) / parsed_pages;
+    timing.found /= rounds;
+    return timing;
+}
+
+int main(int argc, char* argv[]) {
+    bool suite_only = false;
+    bool generated = false;
+    std::string filter;
+    std::vector<std::string> archives;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--suite") {
+            suite_only = true;
+        } else if (arg == "--filter" && i + 1 < argc) {
+            filter = argv[++i];
+            suite_only = true;
+        } else if (arg == "--generated") {
+            generated = true;
+        } else {
+            archives.push_back(arg);
+        }
+    }
+
+    // Each archive, corpus page or the generated catalog is one suite input
+    std::vector<Page> pages;
+    std::vector<std::string> input_names;
+    std::vector<size_t> input_ends;   // Pages of input i end at pages[input_ends[i]]
+    for (const std::string& archive : archives) {
+        if (!load_archive(archive, pages)) {
+            return 1;
+        }
+        input_names.push_back(archive.substr(archive.find_last_of("/\\") + 1));
+        input_ends.push_back(pages.size());
+    }
+    if (generated) {
+        // Listing pages of a generated catalog, 20 books each
+        SyntheticCatalog catalog;
+        for (size_t n = 1; n <= catalog.listing_pages(); ++n) {
+            Page page;
+            page.url = "http://books.toscrape.com" + catalog.listing_path(n);
+            catalog.render(page.url.substr(25), page.body);
+            pages.push_back(page);
+        }
+        input_names.push_back("generated");
+        input_ends.push_back(pages.size());
+    }
+    if (archives.empty() && !generated) {
+        if (!load_corpus(BENCH_CORPUS_DIR "/pages.txt", input_names, pages)) {
+            return 1;
+        }
+        for (size_t i = 1; i <= pages.size(); ++i) {
+            input_ends.push_back(i);
+        }
+    }
+    if (pages.empty()) {
+        std::cerr << "No pages to parse" << std::endl;
+        return 1;
+    }
+
+    std::vector<SuiteInput> inputs(input_names.size());
+    for (size_t i = 0, page = 0; i < inputs.size(); ++i) {
+        inputs[i].name = input_names[i];
+        for (; page < input_ends[i]; ++page) {
+            inputs[i].pages.push_back(&pages[page]);
+        }
+    }
+    run_suite(inputs, filter);
+    if (suite_only) {
+        return 0;
+    }
+    printf("\n");
+
+    size_t total_bytes = 0;
+    bool identical = true;
+    for (const Page& page : pages) {
+        total_bytes += page.body.size();
+        if (!same_books(parse_books(page.body, page.url), parse_books_reference(page.body, page.url))) {
+            std::cerr << "Books differ on " << page.url << std::endl;
+            identical = false;
+        }
+    }
+
+    printf("parse_books over %zu pages (%.1f KB average)\n", pages.size(), total_bytes / 1024.0 / pages.size());
+    printf("%-12s %10s %10s %12s %8s\n", "parser", "MB/s", "us/page", "allocs/page", "books");
+    Timing reference = measure(pages, total_bytes, [](const Page& page) {
+        return parse_books_reference(page.body, page.url).size();
+    });
+    printf("%-12s %10.1f %10.2f %12.1f %8zu\n", "multi-scan", reference.mb_per_second, reference.ns_per_page / 1000,
+           reference.allocs_per_page, reference.found);
+    Timing single = measure(pages, total_bytes, [](const Page& page) {
+        return parse_books(page.body, page.url).size();
+    });
+    printf("%-12s %10.1f %10.2f %12.1f %8zu\n", "single-pass", single.mb_per_second, single.ns_per_page / 1000,
+           single.allocs_per_page, single.found);
+    printf("speedup %.2fx\n", reference.ns_per_page / single.ns_per_page);
+
+    // The same work at each kernel level, checked against the portable fallback
+    const ScanLevel supported = scan_level_supported();
+    std::vector<ScanLevel> levels;
+    for (ScanLevel level : {ScanLevel::Scalar, ScanLevel::SSE2, ScanLevel::AVX2}) {
+        if (level <= supported) {
+            levels.push_back(level);
+        }
+    }
+    set_scan_level(ScanLevel::Scalar);
+    std::vector<std::vector<Book>> expected_books;
+    std::vector<std::set<std::string>> expected_links;
+    for (const Page& page : pages) {
+        expected_books.push_back(parse_books(page.body, page.url));
+        expected_links.push_back(extract_all_links(page.body, page.url));
+    }
+    for (ScanLevel level : levels) {
+        set_scan_level(level);
+        for (size_t i = 0; i < pages.size(); ++i) {
+            if (!same_books(parse_books(pages[i].body, pages[i].url), expected_books[i]) ||
+                extract_all_links(pages[i].body, pages[i].url) != expected_links[i]) {
+                std::cerr << scan_level_name(level) << " results differ on " << pages[i].url << std::endl;
+                identical = false;
+            }
+        }
+    }
+
+    auto locate_hrefs = [](const Page& page) {
+        size_t hrefs = 0;
+        for (size_t pos = 0; (pos = scan_find(page.body, "href=\"", pos)) != std::string::npos; pos++) {
+            hrefs++;
+        }
+        return hrefs;
+    };
+    auto books = [](const Page& page) { return parse_books(page.body, page.url).size(); };
+    auto links = [](const Page& page) { return extract_all_links(page.body, page.url).size(); };
+    printf("\nscanning kernels (widest supported: %s)\n", scan_level_name(supported));
+    printf("%-18s %-7s %10s %10s %12s %8s\n", "task", "level", "MB/s", "us/page", "allocs/page", "found");
+    for (int task = 0; task < 3; ++task) {
+        const char* name = task == 0 ? "locate hrefs" : task == 1 ? "parse_books" : "extract_all_links";
+        double scalar_ns = 0;
+        for (ScanLevel level : levels) {
+            set_scan_level(level);
+            Timing timing = task == 0 ? measure(pages, total_bytes, locate_hrefs)
+                          : task == 1 ? measure(pages, total_bytes, books)
+                                      : measure(pages, total_bytes, links);
+            if (level == ScanLevel::Scalar) {
+                scalar_ns = timing.ns_per_page;
+            }
+            printf("%-18s %-7s %10.1f %10.2f %12.1f %8zu  %.2fx\n", name, scan_level_name(level),
+                   timing.mb_per_second, timing.ns_per_page / 1000, timing.allocs_per_page, timing.found,
+                   scalar_ns / timing.ns_per_page);
+        }
+    }
+    set_scan_level(supported);
+
+    // A crawler page step on pages already crawled once: every book and link
+    // is parsed, canonicalized and found in the seen sets, as in Crawler.cpp
+    std::set<std::string> seen_copying;
+    auto copying_step = [&seen_copying](const Page& page) {
+        size_t known = 0;
+        for (const Book& book : parse_books(page.body, page.url)) {
+            known += !seen_copying.insert(canonicalize_url(book.url)).second;
+        }
+        for (const std::string& link : extract_all_links(page.body, page.url)) {
+            if (!should_ignore_url(link)) {
+                known += !seen_copying.insert(canonicalize_url(link)).second;
+            }
+        }
+        return known;
+    };
+    std::set<std::string, std::less<>> seen_buffered;
+    UrlBase base;
+    std::vector<BookView> book_views;
+    LinkBuffer links_buffer;
+    std::string book_url;
+    std::string canonical;
+    auto buffered_step = [&](const Page& page) {
+        size_t known = 0;
+        base.assign(page.url);
+        parse_books(page.body, book_views);
+        for (const BookView& book : book_views) {
+            base.resolve(book.href, book_url);
+            canonicalize_url(book_url, canonical);
+            if (seen_buffered.find(canonical) != seen_buffered.end()) {
+                known++;
+            } else {
+                seen_buffered.insert(canonical);
+            }
+        }
+        links_buffer.clear();
+        extract_all_links(page.body, base, links_buffer);
+        links_buffer.sort();
+        for (size_t i = 0; i < links_buffer.size(); ++i) {
+            if (!should_ignore_url(links_buffer[i])) {
+                canonicalize_url(links_buffer[i], canonical);
+                if (seen_buffered.find(canonical) != seen_buffered.end()) {
+                    known++;
+                } else {
+                    seen_buffered.insert(canonical);
+                }
+            }
+        }
+        return known;
+    };
+    // The first round fills the seen sets and the buffers
+    for (const Page& page : pages) {
+        copying_step(page);
+        buffered_step(page);
+    }
+    printf("\ncrawler page step on pages seen before (parse, canonicalize, dedupe)\n");
+    printf("%-18s %10s %10s %12s %8s\n", "api", "MB/s", "us/page", "allocs/page", "known");
+    Timing copying = measure(pages, total_bytes, copying_step);
+    printf("%-18s %10.1f %10.2f %12.1f %8zu\n", "copying", copying.mb_per_second, copying.ns_per_page / 1000,
+           copying.allocs_per_page, copying.found);
+    Timing buffered = measure(pages, total_bytes, buffered_step);
+    printf("%-18s %10.1f %10.2f %12.1f %8zu\n", "reused buffers", buffered.mb_per_second,
+           buffered.ns_per_page / 1000, buffered.allocs_per_page, buffered.found);
+
+    // Every href on the pages, resolved but not filtered, as a rule set sees
+    // them when a crawl has a rules file that is mostly excludes
+    std::vector<Page> link_pages;
+    size_t link_bytes = 0;
+    for (const Page& page : pages) {
+        UrlBase page_base(page.url);
+        Page links;
+        links.url = page.url;
+        std::string href;
+        std::string url;
+        size_t pos = 0;
+        while ((pos = page.body.find("href=\"", pos)) != std::string::npos) {
+            size_t end = page.body.find('"', pos + 6);
+            if (end == std::string::npos) {
+                break;
+            }
+            href.assign(page.body, pos + 6, end - pos - 6);
+            page_base.resolve(href, url);
+            links.body += url;
+            links.body += '\n';
+            pos = end;
+        }
+        link_bytes += links.body.size();
+        link_pages.push_back(links);
+    }
+    // Both sides see the same URLs, so any difference is a rule that changed
+    auto for_each_url = [](const Page& page, auto check) {
+        std::string_view text = page.body;
+        while (!text.empty()) {
+            size_t end = text.find('\n');
+            check(text.substr(0, end));
+            text.remove_prefix(end + 1);
+        }
+    };
+    bool same_verdicts = true;
+    for (const Page& page : link_pages) {
+        for_each_url(page, [&](std::string_view url) {
+            bool accepted;
+            PageClass page_class = classify_reference(url, accepted);
+            UrlMatch match = url_rules().match(url);
+            if (match.accepted != accepted || match.page_class != page_class) {
+                std::cerr << "URL rules differ on " << url << std::endl;
+                same_verdicts = false;
+            }
+        });
+    }
+    printf("\nURL rules on every resolved href (%u rules)\n", (unsigned)url_rules().rule_count());
+    printf("%-18s %10s %10s %12s %8s\n", "matcher", "MB/s", "us/page", "allocs/page", "accepted");
+    Timing chained = measure(link_pages, link_bytes, [&](const Page& page) {
+        size_t accepted_count = 0;
+        for_each_url(page, [&](std::string_view url) {
+            bool accepted;
+            classify_reference(url, accepted);
+            accepted_count += accepted;
+        });
+        return accepted_count;
+    });
+    printf("%-18s %10.1f %10.2f %12.1f %8zu\n", "find per pattern", chained.mb_per_second,
+           chained.ns_per_page / 1000, chained.allocs_per_page, chained.found);
+    Timing automaton = measure(link_pages, link_bytes, [&](const Page& page) {
+        size_t accepted_count = 0;
+        for_each_url(page, [&](std::string_view url) {
+            accepted_count += url_rules().match(url).accepted;
+        });
+        return accepted_count;
+    });
+    printf("%-18s %10.1f %10.2f %12.1f %8zu  %.2fx\n", "automaton", automaton.mb_per_second,
+           automaton.ns_per_page / 1000, automaton.allocs_per_page, automaton.found,
+           chained.ns_per_page / automaton.ns_per_page);
+    if (!same_verdicts) {
+        std::cerr << "URL rules give different verdicts than the chained finds" << std::endl;
+    }
+
+    // Every href of the pages as written, and, for each root-relative one,
+    // the "../../" spelling books.toscrape.com itself uses for it from the
+    // page's directory, so dot segments get resolved too
+    std::vector<Page> href_pages;
+    size_t href_bytes = 0;
+    size_t href_count = 0;
+    for (const Page& page : pages) {
+        Page hrefs;
+        hrefs.url = page.url;
+        size_t depth = 0;
+        for (size_t i = page.url.find('/', page.url.find("://") + 3); i != std::string::npos;
+             i = page.url.find('/', i + 1)) {
+            depth++;
+        }
+        size_t pos = 0;
+        while ((pos = page.body.find("href=\"", pos)) != std::string::npos) {
+            size_t end = page.body.find('"', pos + 6);
+            if (end == std::string::npos) {
+                break;
+            }
+            std::string href = page.body.substr(pos + 6, end - pos - 6);
+            hrefs.body += href;
+            hrefs.body += '\n';
+            href_count++;
+            if (!href.empty() && href[0] == '/' && depth > 1) {
+                for (size_t up = 1; up < depth; ++up) {
+                    hrefs.body += "../";
+                }
+                hrefs.body.append(href, 1, std::string::npos);
+                hrefs.body += '\n';
+                href_count++;
+            }
+            pos = end;
+        }
+        href_bytes += hrefs.body.size();
+        href_pages.push_back(hrefs);
+    }
+    printf("\nresolving hrefs and making their dedup keys (%zu hrefs per round)\n", href_count);
+    printf("%-18s %10s %10s %12s %8s\n", "normalizer", "MB/s", "ns/href", "allocs/href", "keys");
+    std::string href;
+    Timing substr_copies = measure(href_pages, href_bytes, [&](const Page& page) {
+        size_t keys = 0;
+        for_each_url(page, [&](std::string_view text) {
+            href.assign(text.data(), text.size());
+            keys += !canonicalize_url_reference(normalize_url_reference(href, page.url)).empty();
+        });
+        return keys;
+    });
+    double per_href = (double)href_pages.size() / href_count;
+    printf("%-18s %10.1f %10.1f %12.2f %8zu\n", "substr copies", substr_copies.mb_per_second,
+           substr_copies.ns_per_page * per_href, substr_copies.allocs_per_page * per_href, substr_copies.found);
+    UrlBase href_base;
+    std::string resolved;
+    std::string key;
+    Timing one_pass = measure(href_pages, href_bytes, [&](const Page& page) {
+        size_t keys = 0;
+        href_base.assign(page.url);
+        for_each_url(page, [&](std::string_view text) {
+            href_base.resolve(text, resolved, key);
+            keys += !key.empty();
+        });
+        return keys;
+    });
+    printf("%-18s %10.1f %10.1f %12.2f %8zu  %.2fx\n", "UrlBase, buffers", one_pass.mb_per_second,
+           one_pass.ns_per_page * per_href, one_pass.allocs_per_page * per_href, one_pass.found,
+           substr_copies.ns_per_page / one_pass.ns_per_page);
+    return identical && same_verdicts ? 0 : 1;
+}
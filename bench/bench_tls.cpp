@@ -0,0 +1,222 @@
+// Measures what a TLS handshake costs the client with and without session
+// resumption. An in-process server with a throwaway self-signed certificate
+// listens on 127.0.0.1; the client opens a fresh TCP connection per iteration
+// through TlsContext (certificate verification on) and times the handshake alone.
+//
+// Usage: bench_tls [iterations]
+
+#include "../include/TlsClient.h"
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/pem.h>
+#include <openssl/rsa.h>
+#include <openssl/x509v3.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+// Self-signed certificate for 127.0.0.1/localhost, valid for a day
+static bool make_certificate(EVP_PKEY*& key, X509*& cert) {
+    EVP_PKEY_CTX* keygen = EVP_PKEY_CTX_new_id(EVP_PKEY_RSA, nullptr);
+    key = nullptr;
+    if (keygen == nullptr || EVP_PKEY_keygen_init(keygen) != 1 ||
+        EVP_PKEY_CTX_set_rsa_keygen_bits(keygen, 2048) != 1 || EVP_PKEY_keygen(keygen, &key) != 1) {
+        EVP_PKEY_CTX_free(keygen);
+        return false;
+    }
+    EVP_PKEY_CTX_free(keygen);
+
+    cert = X509_new();
+    X509_set_version(cert, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 60 * 60);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"127.0.0.1", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+
+    X509V3_CTX ext_ctx;
+    X509V3_set_ctx(&ext_ctx, cert, cert, nullptr, nullptr, 0);
+    X509_EXTENSION* san = X509V3_EXT_conf_nid(nullptr, &ext_ctx, NID_subject_alt_name,
+                                              (char*)"IP:127.0.0.1,DNS:localhost");
+    X509_add_ext(cert, san, -1);
+    X509_EXTENSION_free(san);
+    return X509_sign(cert, key, EVP_sha256()) > 0;
+}
+
+// Accepts connections one at a time: handshake, send one byte (which flushes
+// the TLS 1.3 session tickets ahead of it), wait for the client to close
+static void run_server(SSL_CTX* ctx, SOCKET listener, std::atomic<bool>& stop) {
+    while (!stop.load()) {
+        SOCKET client = accept(listener, nullptr, nullptr);
+        if (client == INVALID_SOCKET) {
+            continue;
+        }
+        SSL* ssl = SSL_new(ctx);
+        SSL_set_fd(ssl, (int)client);
+        if (SSL_accept(ssl) == 1) {
+            char byte = 'x';
+            SSL_write(ssl, &byte, 1);
+            SSL_read(ssl, &byte, 1);
+        }
+        ERR_clear_error();
+        SSL_free(ssl);
+        CLOSE_SOCKET(client);
+    }
+}
+
+static SOCKET connect_local(int port) {
+    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((unsigned short)port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(sock, (sockaddr*)&address, sizeof(address)) != 0) {
+        CLOSE_SOCKET(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+struct RunResult {
+    std::vector<double> handshake_us;
+    TlsStats stats;
+    bool ok = true;
+};
+
+// Handshake iterations times with a fresh context configured as given
+static RunResult run_client(int port, const std::string& ca_file, bool resumption, int iterations) {
+    TlsConfig config;
+    config.ca_file = ca_file;
+    config.session_resumption = resumption;
+    TlsContext context(config);
+
+    RunResult run;
+    for (int i = 0; i < iterations; ++i) {
+        SOCKET sock = connect_local(port);
+        if (sock == INVALID_SOCKET) {
+            std::cerr << "connect failed" << std::endl;
+            run.ok = false;
+            break;
+        }
+        std::string error;
+        auto start = std::chrono::steady_clock::now();
+        std::unique_ptr<TlsConnection> conn = context.connect(sock, "127.0.0.1", port, &error);
+        auto end = std::chrono::steady_clock::now();
+        if (!conn) {
+            std::cerr << error << std::endl;
+            CLOSE_SOCKET(sock);
+            run.ok = false;
+            break;
+        }
+        run.handshake_us.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+
+        // Reading the server's byte also takes in its session tickets
+        char byte;
+        size_t received = 0;
+        conn->read(&byte, 1, received);
+        conn->shutdown();
+        conn.reset();
+        CLOSE_SOCKET(sock);
+    }
+    run.stats = context.get_stats();
+    return run;
+}
+
+static void report(const char* label, RunResult& run) {
+    std::vector<double>& samples = run.handshake_us;
+    if (samples.empty()) {
+        return;
+    }
+    double total = 0;
+    for (double sample : samples) {
+        total += sample;
+    }
+    std::sort(samples.begin(), samples.end());
+    printf("%-22s %8zu %12.1f %12.1f %12.1f %10llu\n", label, samples.size(), total / samples.size(),
+           samples[samples.size() / 2], samples[samples.size() * 99 / 100], run.stats.resumed);
+}
+
+int main(int argc, char* argv[]) {
+    int iterations = argc > 1 ? std::max(1, atoi(argv[1])) : 200;
+
+    EVP_PKEY* key = nullptr;
+    X509* cert = nullptr;
+    if (!make_certificate(key, cert)) {
+        std::cerr << "Cannot create the test certificate" << std::endl;
+        return 1;
+    }
+
+    // The client trusts the certificate through its CA file, as it would a private CA
+    char ca_path[] = "/tmp/bench_tls_XXXXXX";
+    int ca_fd = mkstemp(ca_path);
+    FILE* ca_out = ca_fd >= 0 ? fdopen(ca_fd, "w") : nullptr;
+    if (ca_out == nullptr) {
+        std::cerr << "Cannot write the test certificate" << std::endl;
+        return 1;
+    }
+    PEM_write_X509(ca_out, cert);
+    fclose(ca_out);
+
+    SSL_CTX* server_ctx = SSL_CTX_new(TLS_server_method());
+    SSL_CTX_use_certificate(server_ctx, cert);
+    SSL_CTX_use_PrivateKey(server_ctx, key);
+
+    SOCKET listener = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+    sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 16) != 0 ||
+        getsockname(listener, (sockaddr*)&address, &length) != 0) {
+        std::cerr << "Cannot listen on 127.0.0.1" << std::endl;
+        return 1;
+    }
+    int port = ntohs(address.sin_port);
+
+    std::atomic<bool> stop(false);
+    std::thread server(run_server, server_ctx, listener, std::ref(stop));
+
+    printf("TLS handshakes against 127.0.0.1:%d (RSA-2048, %s)\n", port, OPENSSL_VERSION_TEXT);
+    printf("%-22s %8s %12s %12s %12s %10s\n", "mode", "count", "avg us", "p50 us", "p99 us", "resumed");
+    RunResult full = run_client(port, ca_path, false, iterations);
+    report("full handshake", full);
+    RunResult resumed = run_client(port, ca_path, true, iterations);
+    report("session resumption", resumed);
+
+    if (full.ok && resumed.ok && !full.handshake_us.empty() && !resumed.handshake_us.empty()) {
+        double full_avg = 0, resumed_avg = 0;
+        for (double sample : full.handshake_us) full_avg += sample;
+        for (double sample : resumed.handshake_us) resumed_avg += sample;
+        full_avg /= full.handshake_us.size();
+        resumed_avg /= resumed.handshake_us.size();
+        printf("resumption saves %.1f us per connection (%.1fx faster)\n", full_avg - resumed_avg,
+               full_avg / resumed_avg);
+    }
+
+    // Unblock accept() with one last connection
+    stop.store(true);
+    SOCKET wake = connect_local(port);
+    if (wake != INVALID_SOCKET) {
+        CLOSE_SOCKET(wake);
+    }
+    server.join();
+    CLOSE_SOCKET(listener);
+    SSL_CTX_free(server_ctx);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    remove(ca_path);
+    return full.ok && resumed.ok ? 0 : 1;
+}
@@ -1,23 +1,86 @@
 #ifndef BOOK_H
 #define BOOK_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
+
+// Star rating in one byte; the numeric value is the number of stars
+enum class Rating : uint8_t {
+    Unknown = 0,
+    One,
+    Two,
+    Three,
+    Four,
+    Five
+};
+
+// Currency of a price in one byte; None when the price had no symbol or code
+enum class Currency : uint8_t {
+    None = 0,
+    GBP,
+    USD,
+    EUR
+};
+
+// A price as an integer number of minor units (pence, cents), so prices
+// compare and add up exactly and take no allocation
+struct Price {
+    int64_t minor = -1;                  // -1 = no price
+    Currency currency = Currency::None;
+
+    bool empty() const { return minor < 0; }
+
+    // In major units (pounds, dollars), 0 for no price
+    double value() const { return empty() ? 0.0 : (double)minor / 100; }
+
+    bool operator==(const Price& other) const {
+        return minor == other.minor && currency == other.currency;
+    }
+    bool operator!=(const Price& other) const { return !(*this == other); }
+};
+
+// Index of a category name in the process-wide table of category_id(); 0 = none
+typedef uint16_t CategoryId;
+
+const CategoryId NO_CATEGORY = 0;
 
 struct Book {
     std::string title;
-    std::string price;
-    std::string rating; // e.g., "Three", "Four", etc.
     std::string url;    // The URL where this book was found
-    
+    Price price;
+    Rating rating = Rating::Unknown;
+    CategoryId category = NO_CATEGORY;
+
     // Equality comparison based on URL
     bool operator==(const Book& other) const {
         return url == other.url;
     }
-    
+
     // Less than comparison for use in sets
     bool operator<(const Book& other) const {
         return url < other.url;
     }
 };
 
-#endif // BOOK_H 
\ No newline at end of file
+// Parse a price as written on a page ("£51.77", "$1,299.00", "12,50 €", "GBP 5")
+// into price; false, leaving price empty, if text is not one
+bool parse_price(std::string_view text, Price& price);
+
+// "£51.77" back from a parsed price; "" for no price
+std::string format_price(const Price& price);
+
+// The rating named in text, e.g. a star-rating class attribute ("star-rating Three")
+Rating parse_rating(std::string_view text);
+
+// "One" to "Five", or "Unknown"
+const char* rating_name(Rating rating);
+
+// Id of a category name, added to the table the first time it is seen; "" is
+// NO_CATEGORY. Thread-safe.
+CategoryId category_id(std::string_view name);
+
+// Name of a category id; "" for NO_CATEGORY or an id never handed out
+const std::string& category_name(CategoryId id);
+
+#endif // BOOK_H
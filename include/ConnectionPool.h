@@ -0,0 +1,107 @@
+#ifndef CONNECTION_POOL_H
+#define CONNECTION_POOL_H
+
+#include "config.h"
+#include "TlsClient.h"
+#include <string>
+#include <map>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+// A connected socket checked out of the pool for one request/response exchange
+struct PooledConnection {
+    SOCKET sock = INVALID_SOCKET;
+    std::string key;          // Pool key, "hostname:port" (prefixed "https://" for TLS)
+    std::shared_ptr<TlsConnection> tls;   // Set when the connection speaks HTTPS
+    int requests_served = 0;  // Responses already read from this socket
+    bool reused = false;      // True if the socket came from the idle list
+    std::chrono::steady_clock::time_point last_used;
+};
+
+// Tunables for the connection pool
+struct ConnectionPoolConfig {
+    size_t max_connections_per_host = 6;             // Idle + in-use sockets per host
+    std::chrono::seconds idle_timeout{30};           // Idle sockets older than this are closed
+    std::chrono::seconds acquire_timeout{30};        // How long to wait for a free slot at the cap
+    int max_requests_per_connection = 100;           // Recycle sockets after this many responses
+};
+
+// Counters describing how well the pool is doing
+struct ConnectionPoolStats {
+    unsigned long long hits = 0;            // acquire() handed out an idle socket
+    unsigned long long misses = 0;          // acquire() had to open a new socket
+    unsigned long long reconnects = 0;      // A reused socket was dead and the request was retried
+    unsigned long long idle_evictions = 0;  // Idle sockets closed by the idle timeout or a peer close
+    unsigned long long cap_waits = 0;       // acquire() blocked on max_connections_per_host
+    size_t idle_connections = 0;            // Sockets currently parked in the pool
+    size_t active_connections = 0;          // Sockets currently checked out
+};
+
+// Per-host pool of persistent HTTP/1.1 connections
+class ConnectionPool {
+public:
+    explicit ConnectionPool(const ConnectionPoolConfig& config = ConnectionPoolConfig());
+    ~ConnectionPool();
+
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // Check out a connection to hostname:port, reusing an idle one when possible.
+    // With tls a new connection completes a TLS handshake (resuming the host's
+    // cached session when there is one) before it is handed out.
+    bool acquire(const std::string& hostname, int port, PooledConnection& conn, bool tls = false);
+
+    // Check out a brand new connection (used to retry after a dead reused socket)
+    bool acquire_fresh(const std::string& hostname, int port, PooledConnection& conn, bool tls = false);
+
+    // Return a connection; it is parked for reuse only if reusable is true
+    void release(PooledConnection& conn, bool reusable);
+
+    // Note that a reused socket turned out to be closed by the server
+    void record_reconnect();
+
+    // Close every idle socket
+    void close_idle();
+
+    void set_config(const ConnectionPoolConfig& config);
+    ConnectionPoolConfig get_config() const;
+    ConnectionPoolStats get_stats() const;
+
+private:
+    struct HostEntry {
+        std::vector<PooledConnection> idle;
+        size_t active = 0;
+    };
+
+    // Check out an idle socket of entry that is still open, counting a hit
+    bool take_idle(HostEntry& entry, PooledConnection& conn);
+
+    // Wait until the host is below the connection cap and reserve a slot. With
+    // idle_conn, a socket that went idle during the wait is handed out there
+    // instead, leaving the slot unreserved for a new connection.
+    bool reserve_slot(std::unique_lock<std::mutex>& lock, HostEntry*& entry, const std::string& key,
+                      PooledConnection* idle_conn);
+
+    // Open a new connection in a slot reserve_slot() reserved, giving the slot
+    // back if that fails
+    bool open_reserved(const std::string& hostname, int port, PooledConnection& conn, bool tls);
+    void evict_expired(HostEntry& entry, std::chrono::steady_clock::time_point now);
+
+    mutable std::mutex mtx;
+    std::condition_variable slot_freed;
+    std::map<std::string, HostEntry> hosts;
+    ConnectionPoolConfig config;
+    ConnectionPoolStats stats;
+};
+
+// Open a new blocking TCP connection to hostname:port, racing its addresses
+// under the connector's deadline (INVALID_SOCKET on failure)
+SOCKET open_tcp_connection(const std::string& hostname, int port);
+
+// Process-wide pool used by http_fetch
+ConnectionPool& connection_pool();
+
+#endif // CONNECTION_POOL_H
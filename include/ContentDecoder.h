@@ -0,0 +1,51 @@
+#ifndef CONTENT_DECODER_H
+#define CONTENT_DECODER_H
+
+#include "RecvBuffer.h"
+#include <string>
+#include <memory>
+#include <cstddef>
+
+// Streaming decoder for gzip/deflate Content-Encoding.
+// Compressed body bytes are fed as they are received and inflated straight
+// into an output RecvBuffer. Needs zlib (WEBSCRAPER_HAVE_ZLIB); without it no
+// encoding is supported and requests do not advertise any.
+class ContentDecoder {
+public:
+    ContentDecoder();
+    ~ContentDecoder();
+
+    ContentDecoder(const ContentDecoder&) = delete;
+    ContentDecoder& operator=(const ContentDecoder&) = delete;
+
+    // Value for the Accept-Encoding request header, or "" if none is supported
+    static const char* accept_encoding();
+
+    // Start decoding a body with this Content-Encoding; false if unsupported
+    bool begin(const std::string& content_encoding);
+
+    // Inflate len compressed bytes, appending the output to out
+    bool feed(const char* data, size_t len, RecvBuffer& out);
+
+    // The body ended; false if the compressed stream was cut short
+    bool finish();
+
+    // Drop any stream state
+    void reset();
+
+    bool active() const { return stream != nullptr; }
+    const std::string& error() const { return error_message; }
+
+private:
+    struct Stream;
+
+    bool init_stream(bool raw_deflate);
+
+    std::unique_ptr<Stream> stream;
+    bool deflate_encoding;   // "deflate" may arrive zlib-wrapped or raw
+    bool stream_ended;
+    size_t fed;              // Compressed bytes consumed so far
+    std::string error_message;
+};
+
+#endif // CONTENT_DECODER_H
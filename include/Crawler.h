@@ -6,11 +6,35 @@
 #include <queue>
 #include <set>
 #include "Book.h"
+#include "HostScheduler.h"
+
+// Tunables for the crawlers
+struct CrawlOptions {
+    int max_in_flight = 1;   // Fetches kept outstanding at once (1 = one page at a time)
+    int pipeline_depth = 1;  // GETs pipelined on one connection when several URLs are known (1 = off)
+    std::string validator_file;  // Revalidate against and update this store, skipping unchanged pages ("" = off)
+    std::string record_file;     // Append every response to this archive segment ("" = off)
+    std::string replay_file;     // Serve every fetch from this archive segment instead of the network ("" = off)
+    int replay_latency_ms = 0;   // Delay added to each replayed fetch
+    HostSchedulerConfig politeness;  // Per-host request rate and burst
+    bool stream_parse = false;   // Parse pages while they download (one fetch at a time, no pipelining)
+    bool https = false;          // Fetch the site over TLS on port 443 instead of plain HTTP
+    int near_duplicate_bits = -1;  // Skip pages whose SimHash is this many bits or fewer from an earlier page's (-1 = off)
+    bool obey_robots = true;     // Never request what a host's robots.txt disallows, and keep to its Crawl-delay
+};
 
 // Crawl the website using a page limit approach
 std::vector<Book> crawl_website(const std::string& hostname, const std::string& start_path, int max_pages);
 
+// Page-limited crawl with explicit options (e.g. pipelining the numbered listing pages)
+std::vector<Book> crawl_website(const std::string& hostname, const std::string& start_path, int max_pages,
+                                const CrawlOptions& options);
+
 // Crawl the website using a queue-based approach
 std::vector<Book> crawl_website_queue(const std::string& hostname, const std::string& start_path, int max_pages);
 
+// Queue-based crawl with explicit options (e.g. several fetches in flight)
+std::vector<Book> crawl_website_queue(const std::string& hostname, const std::string& start_path, int max_pages,
+                                      const CrawlOptions& options);
+
 #endif // CRAWLER_H 
\ No newline at end of file
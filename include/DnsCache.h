@@ -0,0 +1,87 @@
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include "config.h"
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+// One address a hostname resolved to, with the port already filled in
+struct ResolvedAddress {
+    struct sockaddr_storage address;
+    socklen_t length = 0;
+};
+
+// Tunables for the resolver cache
+struct DnsCacheConfig {
+    std::chrono::seconds positive_ttl{300};    // How long a successful lookup is trusted
+    std::chrono::seconds negative_ttl{30};     // How long a failed lookup is remembered
+    std::chrono::seconds refresh_ahead{30};    // Refresh in the background once this close to expiry
+    size_t max_entries = 4096;                 // Oldest entries are dropped beyond this
+};
+
+// Counters for the resolver cache
+struct DnsCacheStats {
+    unsigned long long hits = 0;            // Answered from a fresh positive entry
+    unsigned long long negative_hits = 0;   // Answered from a remembered failure
+    unsigned long long misses = 0;          // Had to resolve on the caller's thread
+    unsigned long long refreshes = 0;       // Background refreshes of entries about to expire
+    unsigned long long failures = 0;        // Lookups (foreground or background) that failed
+    size_t entries = 0;                     // Hostnames currently cached
+};
+
+// Thread-safe hostname -> address cache in front of getaddrinfo.
+// Entries close to expiry are refreshed by a background thread, so a busy
+// host never pays for resolution on the request path once it is cached.
+class DnsCache {
+public:
+    explicit DnsCache(const DnsCacheConfig& config = DnsCacheConfig());
+    ~DnsCache();
+
+    DnsCache(const DnsCache&) = delete;
+    DnsCache& operator=(const DnsCache&) = delete;
+
+    // Addresses for hostname:port; false if the name does not resolve
+    bool resolve(const std::string& hostname, int port, std::vector<ResolvedAddress>& addresses);
+
+    // Forget every entry
+    void clear();
+
+    void set_config(const DnsCacheConfig& config);
+    DnsCacheConfig get_config() const;
+    DnsCacheStats get_stats() const;
+
+private:
+    struct Entry {
+        std::vector<ResolvedAddress> addresses;   // Empty for a negative entry
+        std::chrono::steady_clock::time_point expires;
+        std::chrono::steady_clock::time_point inserted;
+        bool refreshing = false;
+    };
+
+    // Blocking lookup without the cache (port left as 0)
+    static bool lookup(const std::string& hostname, std::vector<ResolvedAddress>& addresses);
+
+    void store(const std::string& hostname, std::vector<ResolvedAddress> addresses);
+    void schedule_refresh(const std::string& hostname);
+    void refresh_loop();
+
+    mutable std::mutex mtx;
+    std::condition_variable refresh_wanted;
+    std::map<std::string, Entry> entries;
+    std::deque<std::string> refresh_queue;
+    std::thread refresher;
+    bool stopping;
+    DnsCacheConfig config;
+    DnsCacheStats stats;
+};
+
+// Process-wide cache shared by the connection pool and the fetch engine
+DnsCache& dns_cache();
+
+#endif // DNS_CACHE_H
@@ -0,0 +1,151 @@
+#ifndef FETCH_ENGINE_H
+#define FETCH_ENGINE_H
+
+#include "HttpResponse.h"
+#include "IoUring.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <chrono>
+#include <functional>
+
+// Outcome of one asynchronous GET
+struct FetchResult {
+    unsigned long long id = 0;   // Value returned by FetchEngine::submit
+    std::string hostname;
+    std::string resource_path;
+    bool ok = false;             // A complete response was received
+    std::string error;           // Reason when ok is false
+    HttpResponse response;
+    double elapsed_ms = 0.0;     // Submit to completion
+};
+
+// Tunables for the fetch engine
+struct FetchEngineConfig {
+    size_t max_in_flight = 256;                          // Requests on the wire at once
+    size_t max_connections_per_host = 8;                 // Parallel sockets per host
+    std::chrono::milliseconds request_timeout{30000};    // Connect + send + receive budget
+    std::chrono::seconds idle_timeout{30};               // Keep-alive sockets older than this are closed
+    bool use_io_uring = true;                            // io_uring builds: drive sockets through the ring, not epoll
+    unsigned ring_entries = 512;                         // io_uring: submission queue slots
+    unsigned ring_buffers = 512;                         // io_uring: provided receive buffers (a power of two)
+    unsigned ring_buffer_size = 16384;                   // io_uring: bytes per receive buffer
+};
+
+// Counters for the fetch engine
+struct FetchEngineStats {
+    unsigned long long submitted = 0;
+    unsigned long long completed = 0;
+    unsigned long long failed = 0;
+    unsigned long long timeouts = 0;
+    unsigned long long connections_opened = 0;
+    unsigned long long connections_reused = 0;
+    unsigned long long connect_failovers = 0;   // Requests moved to a host's next address after a failed connect
+    unsigned long long ring_operations = 0;     // io_uring backend: operations submitted to the kernel
+    unsigned long long ring_enters = 0;         // ... and the io_uring_enter() calls that carried them
+};
+
+// Non-blocking HTTP/1.1 fetch engine.
+// One thread drives many concurrent requests: submit() queues work, poll()
+// runs the event loop (epoll on Linux) and finished requests are handed back
+// through the per-request callback or, if none was given, the completion queue.
+// Builds with WEBSCRAPER_HAVE_IO_URING drive plain HTTP sockets through an
+// io_uring instead: each poll() submits every queued connect and send in one
+// io_uring_enter() that also waits, and responses arrive through one multishot
+// receive per socket into registered buffers rather than a recv() per chunk.
+// HTTPS sockets wait for readiness on the same ring. Kernels without the
+// needed features (5.19+) get epoll.
+// https:// URLs (and hosts marked with http_set_tls_host) get non-blocking TLS
+// connections that resume the shared context's cached sessions.
+// While the response archive replays, requests are answered from it instead,
+// up to max_in_flight of them sitting out the injected latency at once.
+// The engine is not thread-safe; use it from the thread that owns it.
+class FetchEngine {
+public:
+    typedef std::function<void(FetchResult&)> Callback;
+
+    explicit FetchEngine(const FetchEngineConfig& config = FetchEngineConfig());
+    ~FetchEngine();
+
+    FetchEngine(const FetchEngine&) = delete;
+    FetchEngine& operator=(const FetchEngine&) = delete;
+
+    // Queue a GET request; returns its id
+    unsigned long long submit(const std::string& hostname, const std::string& resource_path,
+                              Callback callback = nullptr);
+
+    // Run the event loop for at most timeout_ms; returns the number of requests finished
+    size_t poll(int timeout_ms);
+
+    // Move finished results (those submitted without a callback) into out
+    size_t take_completed(std::vector<FetchResult>& out);
+
+    // Keep polling until nothing is queued or in flight
+    void run_until_idle();
+
+    // Requests queued or on the wire
+    size_t outstanding() const { return queued_count + active_count; }
+    size_t in_flight() const { return active_count; }
+
+    FetchEngineStats get_stats() const;
+
+    // Event loop in use: "io_uring", "epoll" or "blocking"
+    const char* backend() const;
+
+private:
+    struct Request;
+    struct Connection;
+    struct HostState;
+
+    void dispatch();
+    bool start_request(HostState& host, std::unique_ptr<Request>& request);
+    Connection* open_connection(HostState& host);
+    void handle_event(Connection* conn, unsigned int events);
+    void on_writable(Connection* conn);
+    void on_handshake(Connection* conn);
+    void on_readable(Connection* conn);
+    void finish(Connection* conn, bool ok, const std::string& error);
+    void connect_failed(Connection* conn, const std::string& error);
+    void close_connection(Connection* conn);
+    void expire(std::chrono::steady_clock::time_point now);
+    void deliver(std::unique_ptr<Request> request, bool ok, const std::string& error,
+                 HttpResponse* response = nullptr);
+    void update_interest(Connection* conn, unsigned int events);
+    int wait_timeout(int timeout_ms) const;
+    bool on_received(Connection* conn, size_t received);
+    void on_closed(Connection* conn);
+    size_t run_blocking_fallback();
+    size_t run_replay(int timeout_ms);
+
+    // io_uring backend
+    size_t poll_ring(int timeout_ms);
+    void on_completion(unsigned long long user_data, int result, unsigned int flags);
+    void on_connected(Connection* conn, int result);
+    void on_sent(Connection* conn, int result);
+    void on_ring_data(Connection* conn, int result, unsigned int flags);
+    void ring_connect(Connection* conn);
+    void ring_send(Connection* conn);
+    void ring_receive(Connection* conn);
+    void ring_poll(Connection* conn, unsigned int events);
+    void ring_cancel(Connection* conn);
+
+    FetchEngineConfig config;
+    FetchEngineStats stats;
+    int poll_fd;
+    unsigned long long next_id;
+    size_t queued_count;
+    size_t active_count;
+    size_t finished_in_poll;
+    std::map<std::string, std::unique_ptr<HostState>> hosts;
+    std::map<int, std::unique_ptr<Connection>> connections;
+    std::deque<FetchResult> completed;
+    std::deque<std::unique_ptr<Request>> replaying;   // Replay mode: waiting out the injected latency
+    std::unique_ptr<IoUring> ring;                    // Set while the io_uring backend is in use
+    unsigned int next_serial;                         // Tells a socket's ring completions from its fd's earlier owners
+    bool multishot_receive;                           // Cleared if the kernel rejects multishot receives
+    std::map<unsigned long long, std::string> retired_sends;   // Requests of closed sockets the kernel may still read
+};
+
+#endif // FETCH_ENGINE_H
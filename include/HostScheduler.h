@@ -0,0 +1,96 @@
+#ifndef HOST_SCHEDULER_H
+#define HOST_SCHEDULER_H
+
+#include <string>
+#include <deque>
+#include <map>
+#include <queue>
+#include <vector>
+#include <chrono>
+
+// Per-host rate limits for the scheduler
+struct HostSchedulerConfig {
+    double rate = 8.0;    // Requests per second each host may receive; 0 disables the limit
+    double burst = 16.0;  // Requests a host that has been idle may receive back to back
+};
+
+// Counters for the scheduler
+struct HostSchedulerStats {
+    unsigned long long scheduled = 0;   // Items pushed
+    unsigned long long dispatched = 0;  // Items handed out
+    unsigned long long throttled = 0;   // Pops that found work queued but no host ready yet
+    size_t hosts = 0;                   // Hosts with a bucket
+    size_t pending = 0;                 // Items waiting
+};
+
+// Politeness scheduler: one FIFO of pending items and one token bucket per
+// host, plus a min-heap of the time each host with pending work can next be
+// served. pop_ready() always hands out work for whichever host is ready first,
+// so many hosts are crawled at full aggregate speed while each one only sees
+// its configured rate and burst. Not thread-safe; callers serialize access.
+class HostScheduler {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    explicit HostScheduler(const HostSchedulerConfig& config = HostSchedulerConfig());
+
+    // Queue an item (usually a URL or path) for host
+    void push(const std::string& host, const std::string& item);
+
+    // Take the next item whose host has a token now, spending the token.
+    // Returns false if nothing is ready; wait then holds the time until the
+    // next host will be (zero when nothing is queued at all).
+    bool pop_ready(std::string& host, std::string& item, Clock::duration& wait);
+
+    // Spend tokens for requests made outside the queue (e.g. a pipelined
+    // batch); returns how long to wait before sending them
+    Clock::duration reserve(const std::string& host, int requests = 1);
+
+    // Override the limits of one host (e.g. from a robots.txt Crawl-delay)
+    void set_host_limits(const std::string& host, double rate, double burst);
+
+    bool empty() const { return pending == 0; }
+    size_t size() const { return pending; }
+
+    // Drop every queued item; buckets are kept
+    void clear();
+
+    void set_config(const HostSchedulerConfig& config);
+    HostSchedulerConfig get_config() const { return config; }
+    HostSchedulerStats get_stats() const;
+
+private:
+    struct Host {
+        std::deque<std::string> items;
+        double tokens = 0.0;
+        double rate = 0.0;
+        double burst = 1.0;
+        bool custom_limits = false;     // Set by set_host_limits; ignores set_config
+        Clock::time_point refilled;
+        unsigned long long generation = 0;  // Bumped whenever the host's heap entry is replaced
+    };
+
+    struct ReadyEntry {
+        Clock::time_point ready;
+        Host* host;
+        const std::string* name;
+        unsigned long long generation;
+        bool operator>(const ReadyEntry& other) const { return ready > other.ready; }
+    };
+
+    std::map<std::string, Host>::iterator host_entry(const std::string& name);
+    void refill(Host& host, Clock::time_point now);
+    Clock::time_point ready_time(const Host& host) const;
+    void schedule(Host& host, const std::string& name);
+
+    HostSchedulerConfig config;
+    std::map<std::string, Host> hosts;
+    std::priority_queue<ReadyEntry, std::vector<ReadyEntry>, std::greater<ReadyEntry>> ready_heap;
+    size_t pending;
+    HostSchedulerStats stats;
+};
+
+// Host part of an absolute URL, or default_host for a relative path
+std::string url_host(const std::string& url, const std::string& default_host);
+
+#endif // HOST_SCHEDULER_H
@@ -2,38 +2,133 @@
 #define HTML_PARSER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <set>
+#include <utility>
 #include "Book.h"
+#include "UrlNormalize.h"
+
+// A product_pod as views into the page it was parsed from
+struct BookView {
+    std::string_view title;
+    std::string_view href;    // As written on the page; UrlBase::resolve makes it absolute
+    std::string_view price;   // As written on the page; parse_price makes it a Price
+    Rating rating;
+};
+
+// Copy a parsed product_pod into book, resolving its link against base
+void assign_book(const BookView& view, const UrlBase& base, Book& book);
+
+// A page's links without duplicates, in the order they were added, stored
+// back to back in one buffer with an open-addressed index over them. clear()
+// keeps every buffer's capacity, so one LinkBuffer reused for each page stops
+// allocating once it has held the largest page. Views returned by operator[]
+// are invalidated by the next insert().
+class LinkBuffer {
+public:
+    void clear();
+
+    // Add url unless it is already in the buffer; true if it was added
+    bool insert(std::string_view url);
+    bool contains(std::string_view url) const;
+
+    size_t size() const { return spans.size(); }
+    bool empty() const { return spans.empty(); }
+    std::string_view operator[](size_t i) const { return std::string_view(text.data() + spans[i].first, spans[i].second); }
+
+    // Order the links from first on as a std::set<std::string> would
+    void sort(size_t first = 0);
+
+private:
+    std::string text;                                 // Every link, back to back
+    std::vector<std::pair<size_t, size_t>> spans;     // Offset and length of each link in text
+    std::vector<size_t> slots;                        // Span index + 1 per slot (0 = free), a power of two long
+
+    size_t find_slot(std::string_view url) const;
+    void rebuild_index(size_t slot_count);
+};
 
 // Extract text between two delimiters
-std::string extract_between(const std::string& text, const std::string& start_delim, const std::string& end_delim);
+std::string extract_between(std::string_view text, const std::string& start_delim, const std::string& end_delim);
 
-// Parse books from HTML content
-std::vector<Book> parse_books(const std::string& html, const std::string& base_url);
+// Parse books from HTML content (a view, so a response body can be parsed where it was received).
+// One pass over the page: each product_pod's title, link, price and rating are
+// picked out in place and copied once, into the Book.
+std::vector<Book> parse_books(std::string_view html, const std::string& base_url);
 
 // Parse a single book page and extract book information
-Book parse_book_page(const std::string& html, const std::string& hostname, const std::string& url);
+Book parse_book_page(std::string_view html, const std::string& hostname, const std::string& url);
 
 // Find the next page link in the HTML
-std::string find_next_link(const std::string& html);
+std::string find_next_link(std::string_view html);
+
+// Extract all hyperlinks from the HTML that url_rules() accept
+std::set<std::string> extract_all_links(std::string_view html, const std::string& base_url);
+
+// Incremental parse_books / extract_all_links for a page that is still arriving.
+// feed() takes the next run of body bytes and appends every book and link whose
+// markup is now complete; an element split across chunks is held back until the
+// rest of it arrives, and markup both scans are done with is discarded. Over a
+// whole page it yields the books of parse_books (in page order) and the links of
+// extract_all_links (in first-seen order).
+class HtmlStreamParser {
+public:
+    // With want_books false only links are extracted
+    explicit HtmlStreamParser(std::string_view base_url = std::string_view(), bool want_books = true);
+
+    // Start over on another page, keeping the buffers' capacity
+    void reset(std::string_view base_url, bool want_books = true);
+
+    void feed(std::string_view chunk, std::vector<Book>& books, std::vector<std::string>& links);
+
+    // Zero-copy feed(): books is replaced by the product_pods completed by this
+    // chunk, as views that stay valid until the next call, and new links are
+    // inserted into links (pass the same buffer for the whole page)
+    void feed(std::string_view chunk, std::vector<BookView>& books, LinkBuffer& links);
+
+    // Body bytes fed so far
+    size_t bytes_fed() const { return consumed + pending.size(); }
+
+    // base_url, split for resolving the page's links
+    const UrlBase& base() const { return page_base; }
+
+private:
+    UrlBase page_base;
+    bool want_books;
+    std::string pending;            // Markup not yet fully scanned
+    size_t book_pos;                // Next offset in pending to look for an article
+    size_t link_pos;                // Next offset in pending to look for an href
+    size_t consumed;                // Bytes dropped from the front of pending
+    std::string link_url;           // Scratch for resolving one href
+    std::vector<BookView> book_views;   // Used by the copying feed()
+    LinkBuffer seen_links;              // Used by the copying feed()
+};
+
+// Check if URL is a book detail page (url_rules() class book)
+bool is_book_page(std::string_view url);
+
+// Check if URL is a category page (url_rules() class listing)
+bool is_category_page(std::string_view url);
 
-// Extract all hyperlinks from the HTML
-std::set<std::string> extract_all_links(const std::string& html, const std::string& base_url);
+// Check if URL should be ignored, e.g. a stylesheet or another site (turned down by url_rules())
+bool should_ignore_url(std::string_view url);
 
-// Normalize URL (convert relative to absolute)
-std::string normalize_url(const std::string& url, const std::string& base_url);
+// Zero-copy versions of the functions above, for loops that parse page after
+// page. Results are views into the input, or are written into caller-owned
+// buffers (replacing what they held unless stated otherwise), so buffers
+// reused across pages stop allocating once they have grown to fit.
 
-// Canonicalize URL for deduplication (handle www, trailing slashes, etc.)
-std::string canonicalize_url(const std::string& url);
+// Text between two delimiters, as a view into text ("" if either is missing)
+std::string_view extract_between_view(std::string_view text, std::string_view start_delim, std::string_view end_delim);
 
-// Check if URL is a book detail page
-bool is_book_page(const std::string& url);
+// parse_books into books; the views point into html
+void parse_books(std::string_view html, std::vector<BookView>& books);
 
-// Check if URL is a category page
-bool is_category_page(const std::string& url);
+// find_next_link as a view into html
+std::string_view find_next_link_view(std::string_view html);
 
-// Check if URL should be ignored (e.g., login, admin pages)
-bool should_ignore_url(const std::string& url);
+// extract_all_links, inserting each accepted link into links (kept in page order)
+void extract_all_links(std::string_view html, const UrlBase& base, LinkBuffer& links);
 
 #endif // HTML_PARSER_H 
\ No newline at end of file
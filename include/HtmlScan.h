@@ -0,0 +1,89 @@
+#ifndef HTML_SCAN_H
+#define HTML_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Byte-scanning kernels behind the HTML parser. Each comes in SSE2 and AVX2
+// versions plus a portable fallback; the widest one the CPU supports is picked
+// on first use. Builds for other CPUs than x86-64 only have the fallback.
+enum class ScanLevel { Scalar, SSE2, AVX2 };
+
+// Widest level this CPU and build support
+ScanLevel scan_level_supported();
+
+// Level in use
+ScanLevel scan_level();
+
+// Use level (lowered to what is supported) from now on, e.g. to compare levels
+// in a benchmark; returns the level now in use. Thread-safe.
+ScanLevel set_scan_level(ScanLevel level);
+
+const char* scan_level_name(ScanLevel level);
+
+// text.find(needle, pos), 16 or 32 candidate positions per step: a position is
+// only compared in full when both the needle's first and last bytes match there
+std::string_view::size_type scan_find(std::string_view text, std::string_view needle, size_t pos = 0);
+
+// Bit i set when block[i] == c, for the first size (at most 64) bytes of block
+uint64_t scan_byte_mask(const char* block, size_t size, char c);
+
+// Every position of one byte in a text, like simdjson's structural index: each
+// 64-byte block becomes a bit mask in one pass and positions are popped off it,
+// so a run of short jumps (tag to tag) costs a bit scan each instead of a
+// memchr call each. The text must outlive the index.
+class ByteIndex {
+public:
+    ByteIndex(std::string_view text, char c)
+        : data(text.data()), size(text.size()), byte(c), block(0),
+          mask(scan_byte_mask(text.data(), text.size() < 64 ? text.size() : 64, c)) {}
+
+    // Offset of the first c at or after pos, npos if there is none. Cheapest
+    // when pos stays in or moves past the current block; moving back before
+    // it rescans from pos.
+    size_t find(size_t pos) {
+        if (pos >= size) {
+            return std::string_view::npos;
+        }
+        if (pos < block || pos - block >= 64) {
+            load(pos);
+        }
+        uint64_t after = mask & (~0ull << (pos - block));
+        while (after == 0) {
+            if (size - block <= 64) {
+                return std::string_view::npos;
+            }
+            load(block + 64);
+            after = mask;
+        }
+        return block + lowest_bit(after);
+    }
+
+private:
+    const char* data;
+    size_t size;
+    char byte;
+    size_t block;   // Offset mask starts at
+    uint64_t mask;  // Positions of byte in [block, block + 64)
+
+    void load(size_t pos) {
+        block = pos;
+        mask = scan_byte_mask(data + pos, size - pos < 64 ? size - pos : 64, byte);
+    }
+
+    static unsigned lowest_bit(uint64_t bits) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, bits);
+        return index;
+#else
+        return __builtin_ctzll(bits);
+#endif
+    }
+};
+
+#endif // HTML_SCAN_H
@@ -2,11 +2,114 @@
 #define HTTP_CLIENT_H
 
 #include <string>
+#include <vector>
+#include <string_view>
+#include <functional>
+#include "ConnectionPool.h"
+#include "HttpResponse.h"
+#include "DnsCache.h"
+#include "TcpConnect.h"
+#include "TlsClient.h"
+#include "ValidatorStore.h"
+#include "ResponseArchive.h"
 
-// Function to make an HTTP GET request
+// Fetch a page and return the parsed status, headers and body.
+// Served over pooled keep-alive connections; returns false on network or framing errors.
+// An absolute https:// resource_path (or any path of a host marked with
+// http_set_tls_host) is fetched over TLS on port 443, everything else on port 80,
+// unless hostname names a port ("host:8080", see http_endpoint).
+// In replay mode the page comes from the response archive instead of the network.
+bool http_fetch(const std::string& hostname, const std::string& resource_path, HttpResponse& response);
+
+// Receives each run of body bytes as it arrives, de-chunked and decoded, in
+// order; head carries the status and headers. Return false to stop the transfer.
+typedef std::function<bool(const HttpResponse& head, std::string_view chunk)> BodyChunkCallback;
+
+// http_fetch that hands the body to on_chunk while it downloads, so parsing can
+// overlap the network. response still receives the complete response at the end;
+// returns false on errors or if on_chunk stopped the transfer.
+bool http_get_stream(const std::string& hostname, const std::string& resource_path,
+                     const BodyChunkCallback& on_chunk, HttpResponse& response);
+
+// http_fetch for a file of the site that is not a crawled page (robots.txt):
+// sent without validators, read whatever its type and size, and not checked
+// against the validator store. It is still recorded and replayed.
+bool http_fetch_resource(const std::string& hostname, const std::string& resource_path, HttpResponse& response);
+
+// Fetch every page of hostname over HTTPS, relative paths and http:// URLs included
+void http_set_tls_host(const std::string& hostname, bool enabled = true);
+
+// Split hostname into the name to resolve and the port to connect to: an
+// explicit "host:port" (or "[v6-address]:port") wins, otherwise 443 for TLS
+// and 80 for plain HTTP. The Host header keeps hostname as given.
+void http_endpoint(const std::string& hostname, bool tls, std::string& host, int& port);
+
+// Connect every fetch to address ("host:port", curl's --connect-to) instead of
+// the host the URL names, e.g. a local stand-in for the real site. URLs, the
+// Host header and the crawl's domain filters are unchanged; a TLS certificate
+// is checked against address. "" restores normal resolution.
+void http_set_connect_to(const std::string& address);
+
+// Whether a fetch of resource_path from hostname goes over TLS. Builds without
+// TLS support warn once and fall back to plain HTTP.
+bool http_uses_tls(const std::string& hostname, const std::string& resource_path);
+
+// Decide from the headers which bodies every fetch path downloads. A rejected
+// body is abandoned: the fetch still succeeds, with response.skipped giving the
+// reason and an empty body, and the connection is closed rather than reused.
+void http_set_body_filter(const BodyFilter& filter);
+BodyFilter http_body_filter();
+
+// Serialize the GET request http_fetch and the fetch engine send for a page
+std::string build_get_request(const std::string& hostname, const std::string& resource_path);
+
+// Bookkeeping every fetch path runs on a complete response: archive it when
+// recording and check it against the stored validators
+void http_response_received(const std::string& hostname, const std::string& resource_path, HttpResponse& response);
+
+// Answer a fetch from the response archive (replay mode), without the injected latency
+bool http_replay(const std::string& hostname, const std::string& resource_path, HttpResponse& response);
+
+// One page of an http_get_many batch
+struct HttpBatchResult {
+    std::string resource_path;
+    bool ok = false;          // A complete response was received
+    HttpResponse response;
+};
+
+// Fetch several pages from one host, in the order given.
+// With pipeline_depth > 1 up to that many GETs are pipelined on one keep-alive
+// connection and the responses matched back in order; a host that breaks the
+// pipeline is remembered and served one request at a time from then on.
+std::vector<HttpBatchResult> http_get_many(const std::string& hostname, const std::vector<std::string>& resource_paths,
+                                           size_t pipeline_depth = 8);
+
+// Function to make an HTTP GET request (raw response text, kept for older callers).
+// The response is serialized again and extract_body() copies the body out once
+// more; use http_fetch, whose body is a view of the receive buffer.
+[[deprecated("use http_fetch and HttpResponse::body")]]
 std::string http_get(const std::string& hostname, const std::string& resource_path);
 
-// Helper function to separate HTTP headers from the body
+// Helper function to separate HTTP headers from the body of an http_get response
+[[deprecated("use http_fetch and HttpResponse::body")]]
 std::string extract_body(const std::string& response);
 
+// Hit/miss counters of the keep-alive connection pool behind http_fetch
+ConnectionPoolStats http_pool_stats();
+
+// Hit/miss counters of the resolver cache behind the connection pool
+DnsCacheStats http_dns_stats();
+
+// Attempt/timeout counters of the connector that opens every fetch socket
+TcpConnectStats http_connect_stats();
+
+// Handshake/resumption counters of the TLS session cache behind HTTPS fetches
+TlsStats http_tls_stats();
+
+// Conditional-request counters of the validator store (zero until it is opened)
+ValidatorStoreStats http_validator_stats();
+
+// Record/replay counters of the response archive
+ResponseArchiveStats http_archive_stats();
+
 #endif // HTTP_CLIENT_H 
\ No newline at end of file
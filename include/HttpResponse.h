@@ -0,0 +1,152 @@
+#ifndef HTTP_RESPONSE_H
+#define HTTP_RESPONSE_H
+
+#include "RecvBuffer.h"
+#include "ContentDecoder.h"
+#include <string>
+#include <string_view>
+#include <map>
+#include <cstddef>
+
+// A parsed HTTP/1.x response
+struct HttpResponse {
+    int status_code = 0;
+    std::string version;                        // e.g. "HTTP/1.1"
+    std::string reason;                         // e.g. "OK"
+    std::map<std::string, std::string> headers; // Lowercased names; repeated headers joined with ", "
+    std::string_view body;                      // Decoded body (chunked framing and gzip removed), a view into buffer
+    bool keep_alive = false;                    // Connection may be reused after this response
+    bool decoded = false;                       // Body was inflated from its Content-Encoding
+    size_t encoded_bytes = 0;                   // Body size as transferred (equals body.size() unless decoded)
+    bool unchanged = false;                     // 304, or same body as last time (see ValidatorStore)
+    std::string skipped;                        // Why the BodyFilter dropped the body ("" = it was read)
+    PooledBuffer buffer;                        // Buffer that owns the bytes body points at
+
+    // Header value by case-insensitive name, or "" if absent
+    std::string header(const std::string& name) const;
+};
+
+// Process-wide body byte counters, before and after content decoding
+struct TransferStats {
+    unsigned long long responses = 0;
+    unsigned long long decoded_responses = 0;   // Responses that arrived compressed
+    unsigned long long encoded_bytes = 0;       // Body bytes as transferred
+    unsigned long long decoded_bytes = 0;       // Body bytes after inflating
+    unsigned long long skipped_bodies = 0;      // Bodies dropped by a BodyFilter instead of downloaded
+};
+
+// Which response bodies are worth downloading. Checked as soon as the headers
+// are in (and again while a body of unknown length grows), so a rejected body
+// is abandoned instead of read; the connection is then closed, not reused.
+struct BodyFilter {
+    bool html_only = false;      // Drop bodies whose Content-Type is not HTML (a missing type passes)
+    size_t max_body_bytes = 0;   // Drop bodies larger than this, before or after decoding (0 = no cap)
+};
+
+// Incremental HTTP/1.1 response parser.
+// The socket receives straight into a RecvBuffer and advance() parses the new
+// bytes in place: header lines are read where they landed, a Content-Length
+// body is left untouched and chunked framing is stripped by compacting the
+// chunk data within the same buffer. Parsing stops at the exact end of the
+// message so any following bytes belong to the next response on the connection.
+// A gzip/deflate body is inflated as it arrives into a second pooled buffer,
+// which then backs the response body.
+class HttpResponseParser {
+public:
+    HttpResponseParser();
+
+    // Prepare for a new response starting at offset 0 of an empty buffer.
+    // Responses to HEAD requests never carry a body.
+    void reset(bool head_request = false);
+
+    // Bodies the filter rejects end the response early with response().skipped
+    // set and an empty body. Unlike everything else it survives reset().
+    void set_filter(const BodyFilter& filter) { body_filter = filter; }
+
+    // Parse whatever was committed to buffer since the last call. Once the
+    // body length is known the buffer is grown to hold the whole message.
+    void advance(RecvBuffer& buffer);
+
+    // The peer closed the connection; completes close-delimited bodies
+    void finish_on_close();
+
+    // How much to ask recv() for next: the rest of a sized body, else a default chunk
+    size_t next_read_size() const;
+
+    // Offset just past the message in the buffer; bytes beyond it were not consumed
+    size_t message_end() const { return pos; }
+
+    // Body bytes parsed so far: de-chunked and, for a compressed response,
+    // inflated. Grows with every advance(); earlier bytes never change, but the
+    // view is only valid until the next advance() (the buffers may move).
+    std::string_view body_so_far(const RecvBuffer& buffer) const;
+
+    // Hand the buffer to the parsed response, pointing its body into it.
+    // Call once complete(); returns the finished response.
+    HttpResponse& finalize(PooledBuffer buffer);
+
+    bool headers_complete() const { return state > State::Headers; }
+    bool complete() const { return state == State::Complete; }
+    bool failed() const { return state == State::Error; }
+    const std::string& error() const { return error_message; }
+
+    // Content-Length of the body, or -1 if unknown (chunked or close-delimited)
+    long long content_length() const { return body_length; }
+    bool is_chunked() const { return chunked; }
+
+    HttpResponse& response() { return result; }
+    const HttpResponse& response() const { return result; }
+
+private:
+    enum class State {
+        StatusLine,
+        Headers,
+        Body,           // Fixed Content-Length body
+        BodyUntilClose, // No framing: body ends when the peer closes
+        ChunkSize,
+        ChunkData,
+        ChunkDataEnd,   // CRLF after chunk data
+        Trailers,
+        Complete,
+        Error
+    };
+
+    void parse(RecvBuffer& buffer);
+    void decode_body(const RecvBuffer& buffer);
+
+    // Take one CRLF-terminated line at pos; returns false if more data is needed
+    bool take_line(const RecvBuffer& buffer, std::string_view& line);
+    bool parse_status_line(std::string_view line);
+    bool parse_header_line(std::string_view line);
+    void on_headers_complete();
+    void fail(const std::string& message);
+
+    // Reason the filter rejects the body for its Content-Type / its size, or ""
+    std::string rejected_type() const;
+    std::string rejected_size(unsigned long long body_bytes) const;
+    void skip_body(const std::string& reason);
+
+    State state;
+    bool head_request;
+    bool chunked;
+    long long body_length;
+    unsigned long long remaining;   // Bytes left in the current body or chunk
+    size_t pos;                     // Parse position in the buffer
+    size_t line_scanned;            // Bytes after pos already searched for a line end
+    size_t body_start;              // Offset of the first body byte
+    size_t body_end;                // End of the de-chunked body (behind pos while de-chunking)
+    size_t decode_pos;              // Body bytes before this were handed to the decoder
+    ContentDecoder decoder;
+    PooledBuffer decoded;           // Inflated body when the response is compressed
+    std::string error_message;
+    BodyFilter body_filter;
+    HttpResponse result;
+};
+
+// Body byte counters across every response parsed so far
+TransferStats http_transfer_stats();
+
+// Re-serialize a response as HTTP/1.1 text, its decoded body framed by Content-Length
+std::string serialize_response(const HttpResponse& response);
+
+#endif // HTTP_RESPONSE_H
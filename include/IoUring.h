@@ -0,0 +1,97 @@
+#ifndef IO_URING_H
+#define IO_URING_H
+
+#include <cstddef>
+#include <string>
+
+// Kernel submission entry (linux/io_uring.h), kept opaque so the header builds anywhere
+struct io_uring_sqe;
+
+// Counters for one ring
+struct IoUringStats {
+    unsigned long long enters = 0;              // io_uring_enter() calls
+    unsigned long long submitted = 0;           // Submission entries handed to the kernel
+    unsigned long long completions = 0;         // Completion entries reaped
+    unsigned long long buffers_recycled = 0;    // Provided buffers given back to the kernel
+};
+
+// A submission/completion queue pair driven through the raw io_uring syscalls,
+// plus a registered ring of receive buffers the kernel picks from for
+// buffer-select receives (IOSQE_BUFFER_SELECT with BUFFER_GROUP), so a
+// multishot receive keeps completing without a buffer being named up front.
+// Entries queued with get_sqe() reach the kernel in one batch on the next
+// submit() or wait(). Not thread-safe. Builds without
+// WEBSCRAPER_HAVE_IO_URING get stubs whose init() always fails.
+class IoUring {
+public:
+    static const unsigned short BUFFER_GROUP = 0;
+
+    IoUring();
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // False when the build has no io_uring support
+    static bool available();
+
+    // Set up a ring of entries submission slots and buffer_count receive buffers
+    // (a power of two) of buffer_size bytes each; false if the kernel lacks
+    // io_uring or a feature the fetch engine relies on
+    bool init(unsigned entries, unsigned buffer_count, unsigned buffer_size, std::string* error = nullptr);
+
+    // Next free submission entry, zeroed; submits the queued ones first when the queue is full
+    io_uring_sqe* get_sqe();
+
+    // Hand the queued entries to the kernel without waiting
+    void submit();
+
+    // Submit the queued entries and wait up to timeout_ms (-1: forever) for a completion
+    void wait(int timeout_ms);
+
+    // Pop the oldest completion; false when none is pending
+    bool next_completion(unsigned long long& user_data, int& result, unsigned int& flags);
+
+    // Contents of provided buffer id, and handing it back once consumed
+    const char* buffer(unsigned id) const { return buffers + (size_t)id * buffer_size; }
+    void recycle(unsigned id);
+
+    IoUringStats get_stats() const { return stats; }
+
+private:
+    void release();
+    void enter(unsigned to_submit, unsigned min_complete, int timeout_ms);
+
+    int ring_fd;
+    IoUringStats stats;
+
+    // Submission queue
+    void* sq_map;
+    size_t sq_map_size;
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned sq_mask;
+    unsigned sq_entries;
+    io_uring_sqe* sqes;
+    size_t sqes_size;
+    unsigned sqe_tail;      // Entries handed out by get_sqe()
+    unsigned sqe_flushed;   // ... of which published to the kernel
+
+    // Completion queue (shares sq_map when the kernel maps both rings at once)
+    void* cq_map;
+    size_t cq_map_size;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned cq_mask;
+    void* cqes;
+
+    // Provided receive buffers
+    void* buffer_ring;
+    size_t buffer_ring_size;
+    char* buffers;
+    unsigned buffer_count;
+    unsigned buffer_size;
+    unsigned short buffer_tail;
+};
+
+#endif // IO_URING_H
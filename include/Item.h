@@ -1,13 +1,15 @@
 #ifndef ITEM_H
 #define ITEM_H
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <map>
 #include <vector>
-#include <iostream>
+#include "Book.h"
 
 // Define item types
-enum class ItemType {
+enum class ItemType : uint8_t {
     BOOK,
     JOB,
     PRODUCT,
@@ -15,17 +17,19 @@ enum class ItemType {
     GENERIC
 };
 
-// Generic item structure that can represent different types of crawled content
+// Generic item structure that can represent different types of crawled content.
+// Price, rating and category are typed (Book.h), so an item carries no strings
+// it does not need and converting a Book is a plain copy.
 class Item {
 public:
     std::string id;                            // Unique identifier (usually URL or specific ID)
-    ItemType type;                             // Type of the item
     std::string url;                           // Source URL
     std::string title;                         // Title/Name
     std::map<std::string, std::string> fields; // Additional fields (vary by type)
-    std::string category;                      // Item category
-    double price = 0.0;                        // Price (if applicable)
-    int rating = 0;                            // Rating (0-5)
+    Price price;                               // Price (salary for a job), if applicable
+    ItemType type;                             // Type of the item
+    Rating rating = Rating::Unknown;           // Stars (0-5)
+    CategoryId category = NO_CATEGORY;         // Item category; category_name() gives its name
     std::string description;                   // Description text
     std::string imageUrl;                      // URL to image
     std::string date;                          // Publication/posting date
@@ -37,68 +41,14 @@ public:
     Item(ItemType itemType) : type(itemType) {}
     
     // Convert from a Book to an Item
-    static Item fromBook(const struct Book& book) {
+    static Item fromBook(const Book& book) {
         Item item(ItemType::BOOK);
         item.title = book.title;
         item.url = book.url;
         item.id = book.url;
-        
-        // Extract price as double if possible
-        if (!book.price.empty()) {
-            // Try to parse price - handle common currency symbols (£, $, €)
-            std::string priceStr = book.price;
-            
-            // Debug logging
-            std::cout << "Original price string: '" << priceStr << "'" << std::endl;
-            
-            std::string cleanPrice;
-            bool foundDigit = false;
-            
-            // Extract only digits and decimal point
-            for (char c : priceStr) {
-                // Convert to ASCII to handle UTF-8 encoding issues
-                unsigned char uc = static_cast<unsigned char>(c);
-                
-                // If the first character is a currency symbol, skip it
-                if (!foundDigit && (c == L'£' || c == L'$' || c == L'€' || uc > 127)) {
-                    continue;
-                }
-                
-                if (std::isdigit(c)) {
-                    cleanPrice += c;
-                    foundDigit = true;
-                } else if ((c == '.' || c == ',') && foundDigit) {
-                    // Replace comma with decimal point if needed
-                    cleanPrice += '.';
-                }
-            }
-            
-            std::cout << "Cleaned price string: '" << cleanPrice << "'" << std::endl;
-            
-            try {
-                if (!cleanPrice.empty()) {
-                    item.price = std::stod(cleanPrice);
-                    std::cout << "Converted price: " << item.price << std::endl;
-                } else {
-                    item.price = 0.0;
-                }
-            } catch (...) {
-                std::cout << "Price conversion exception" << std::endl;
-                item.price = 0.0;
-            }
-        }
-        
-        // Convert rating string to number
-        if (book.rating == "One") item.rating = 1;
-        else if (book.rating == "Two") item.rating = 2;
-        else if (book.rating == "Three") item.rating = 3;
-        else if (book.rating == "Four") item.rating = 4;
-        else if (book.rating == "Five") item.rating = 5;
-        
-        // Store original values in fields
-        item.fields["price_original"] = book.price;
-        item.fields["rating_original"] = book.rating;
-        
+        item.price = book.price;
+        item.rating = book.rating;
+        item.category = book.category;
         return item;
     }
     
@@ -116,27 +66,15 @@ public:
         item.fields["location"] = location;
         item.fields["salary"] = salary;
         
-        // Try to parse salary if possible
-        if (!salary.empty()) {
-            std::string salaryStr = salary;
-            // Remove non-numeric chars except decimal point
-            salaryStr.erase(
-                std::remove_if(salaryStr.begin(), salaryStr.end(), 
-                            [](char c) { return !std::isdigit(c) && c != '.'; }),
-                salaryStr.end());
-            try {
-                item.price = std::stod(salaryStr);
-            } catch (...) {
-                item.price = 0.0;
-            }
-        }
+        // Left empty unless the salary is a single amount
+        parse_price(salary, item.price);
         
         return item;
     }
     
     // Create a product
     static Item createProduct(const std::string& title, const std::string& url,
-                             double price, int rating, const std::string& category,
+                             const Price& price, Rating rating, std::string_view category,
                              const std::string& imageUrl, const std::string& description) {
         Item item(ItemType::PRODUCT);
         item.title = title;
@@ -144,7 +82,7 @@ public:
         item.id = url;
         item.price = price;
         item.rating = rating;
-        item.category = category;
+        item.category = category_id(category);
         item.imageUrl = imageUrl;
         item.description = description;
         
@@ -164,11 +102,11 @@ public:
     // Convert to string representation
     std::string toString() const {
         std::string result = "Item[" + title + ", type=" + typeToString() + ", url=" + url;
-        if (price > 0) {
-            result += ", price=" + std::to_string(price);
+        if (!price.empty()) {
+            result += ", price=" + format_price(price);
         }
-        if (rating > 0) {
-            result += ", rating=" + std::to_string(rating);
+        if (rating != Rating::Unknown) {
+            result += ", rating=" + std::to_string((int)rating);
         }
         result += "]";
         return result;
@@ -0,0 +1,100 @@
+#ifndef NEAR_DUPLICATE_H
+#define NEAR_DUPLICATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// SimHash fingerprint of a page's text: the words outside tags, lower-cased,
+// are shingled into runs of shingle_words and each shingle's 64-bit hash
+// votes on every bit. Pages sharing most of their text end up a few bits
+// apart, so the same listing served under another URL (a sort order, a
+// pagination alias, a category next to the full listing) is recognized
+// without keeping or comparing the pages themselves. The page can be fed in
+// any number of chunks, e.g. as it downloads.
+class SimHasher {
+public:
+    static constexpr size_t MAX_SHINGLE_WORDS = 16;
+
+    explicit SimHasher(size_t shingle_words = 4);
+
+    // Start a new page
+    void reset();
+
+    void feed(std::string_view html);
+
+    // Fingerprint of everything fed since reset()
+    uint64_t finish();
+
+private:
+    size_t shingle_words;
+    bool in_tag;
+    bool in_word;
+    uint64_t word_hash;             // FNV-1a of the word being read
+    uint64_t window[MAX_SHINGLE_WORDS];  // Hashes of the last shingle_words words, a ring
+    size_t words;                   // Words read since reset()
+    // Set bits per fingerprint bit, counted eight at a time: byte k of
+    // lanes[j] counts bit 8 * j + k of up to 255 shingles before being
+    // added to ones
+    uint64_t lanes[8];
+    uint32_t lane_shingles;
+    uint32_t ones[64];
+    uint32_t shingles;
+
+    void end_word();
+    void vote(uint64_t hash);
+    void flush_lanes();
+};
+
+// SimHasher over a whole page
+uint64_t simhash_page(std::string_view html, size_t shingle_words = 4);
+
+int hamming_distance(uint64_t a, uint64_t b);
+
+// When a page counts as a near-duplicate of one seen before
+struct NearDuplicateConfig {
+    int max_distance = 3;        // Fingerprint bits that may differ (0 = identical text only)
+    size_t shingle_words = 4;    // Words per shingle
+};
+
+struct NearDuplicateStats {
+    size_t pages = 0;            // Fingerprints looked up
+    size_t near_duplicates = 0;  // Of those, within max_distance bits of an earlier page
+};
+
+// The fingerprints of the pages seen so far, each split into max_distance + 1
+// bands: two fingerprints at most max_distance bits apart agree exactly on
+// at least one band, so a lookup is only compared against the pages sharing
+// a band value with it rather than against every page. Thread-safe.
+class NearDuplicateIndex {
+public:
+    explicit NearDuplicateIndex(const NearDuplicateConfig& config = NearDuplicateConfig());
+
+    // Forget every page and use config from now on
+    void set_config(const NearDuplicateConfig& config);
+    const NearDuplicateConfig& get_config() const { return config; }
+
+    // True if an earlier page is within max_distance bits of fingerprint,
+    // with that page's key in match if given; otherwise the page is added
+    // under key
+    bool check(uint64_t fingerprint, const std::string& key, std::string* match = nullptr);
+
+    NearDuplicateStats get_stats() const;
+
+private:
+    NearDuplicateConfig config;
+    int bands;
+    mutable std::mutex mutex;
+    std::vector<uint64_t> fingerprints;
+    std::vector<std::string> keys;
+    std::vector<std::unordered_map<uint64_t, std::vector<uint32_t>>> band_index;  // Band value -> fingerprint indexes
+    NearDuplicateStats stats;
+
+    uint64_t band_value(uint64_t fingerprint, int band) const;
+};
+
+#endif // NEAR_DUPLICATE_H
@@ -0,0 +1,77 @@
+#ifndef RECV_BUFFER_H
+#define RECV_BUFFER_H
+
+#include <cstddef>
+#include <memory>
+
+// Growable byte buffer that sockets receive into directly.
+// Bytes are appended with prepare()/commit() and never NUL-terminated, so
+// bodies containing NUL bytes survive intact.
+class RecvBuffer {
+public:
+    RecvBuffer();
+
+    // Grow the storage to at least new_capacity bytes, keeping the contents
+    void reserve(size_t new_capacity);
+
+    // Make room for at least min_free more bytes and return where to write them
+    char* prepare(size_t min_free);
+
+    // Mark n bytes written at prepare() as part of the contents
+    void commit(size_t n) { length += n; }
+
+    // Drop everything after the first n bytes
+    void truncate(size_t n) { if (n < length) length = n; }
+
+    void clear() { length = 0; }
+
+    char* data() { return storage.get(); }
+    const char* data() const { return storage.get(); }
+    size_t size() const { return length; }
+    size_t capacity() const { return allocated; }
+
+private:
+    std::unique_ptr<char[]> storage;
+    size_t allocated;
+    size_t length;
+};
+
+// Counters for the calling thread's buffer pool
+struct RecvBufferPoolStats {
+    unsigned long long acquired = 0;   // Buffers handed out
+    unsigned long long reused = 0;     // ...of which came from the pool
+    unsigned long long grown = 0;      // Reallocations while receiving
+    size_t pooled = 0;                 // Buffers currently parked in the pool
+};
+
+// Move-only handle to a RecvBuffer borrowed from the current thread's pool.
+// The buffer goes back to the pool (of whichever thread drops the handle)
+// when the handle is destroyed.
+class PooledBuffer {
+public:
+    PooledBuffer() {}
+    ~PooledBuffer();
+
+    PooledBuffer(PooledBuffer&& other) noexcept : buffer(std::move(other.buffer)) {}
+    PooledBuffer& operator=(PooledBuffer&& other) noexcept;
+
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+    // Borrow an empty buffer from the calling thread's pool
+    static PooledBuffer acquire();
+
+    explicit operator bool() const { return buffer != nullptr; }
+    RecvBuffer* operator->() { return buffer.get(); }
+    const RecvBuffer* operator->() const { return buffer.get(); }
+    RecvBuffer& operator*() { return *buffer; }
+    const RecvBuffer& operator*() const { return *buffer; }
+
+private:
+    std::unique_ptr<RecvBuffer> buffer;
+};
+
+// Pool counters for the calling thread
+RecvBufferPoolStats recv_buffer_pool_stats();
+
+#endif // RECV_BUFFER_H
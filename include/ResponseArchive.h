@@ -0,0 +1,88 @@
+#ifndef RESPONSE_ARCHIVE_H
+#define RESPONSE_ARCHIVE_H
+
+#include "HttpResponse.h"
+#include <string>
+#include <unordered_map>
+#include <fstream>
+#include <mutex>
+#include <chrono>
+
+// What the archive does with fetches
+enum class ArchiveMode {
+    Off,      // Fetch from the network as usual
+    Record,   // Fetch from the network and append every response to the segment file
+    Replay    // Never touch the network; answer from the segment file
+};
+
+// Counters for the response archive
+struct ResponseArchiveStats {
+    unsigned long long recorded = 0;        // Responses appended while recording
+    unsigned long long replayed = 0;        // Fetches answered from the archive
+    unsigned long long replay_misses = 0;   // Fetches for URLs that were never recorded
+    unsigned long long bytes = 0;           // Segment bytes written or loaded
+    size_t entries = 0;                     // Distinct URLs available for replay
+};
+
+// Record/replay store for offline, repeatable crawls.
+// Recording appends each response (status line, headers and decoded body,
+// framed by Content-Length) to an append-only segment file:
+//
+//   WSR1 <url-length> <response-length>\n<url>\n<response>\n
+//
+// Replay loads the whole segment into memory and indexes it by URL (the last
+// record of a URL wins), then serves fetches from it without any network I/O,
+// optionally after an injected per-request latency.
+class ResponseArchive {
+public:
+    ResponseArchive();
+    ~ResponseArchive();
+
+    ResponseArchive(const ResponseArchive&) = delete;
+    ResponseArchive& operator=(const ResponseArchive&) = delete;
+
+    // Append every response fetched from now on to path (created if missing)
+    bool start_recording(const std::string& path);
+
+    // Load path and answer all fetches from it, each delayed by latency
+    bool start_replay(const std::string& path, std::chrono::milliseconds latency = std::chrono::milliseconds(0));
+
+    // Back to network fetches; closes the segment file
+    void stop();
+
+    ArchiveMode mode() const;
+    bool recording() const { return mode() == ArchiveMode::Record; }
+    bool replaying() const { return mode() == ArchiveMode::Replay; }
+
+    // Latency injected before each replayed response
+    std::chrono::milliseconds replay_latency() const;
+
+    // Append a response fetched for url (no-op unless recording)
+    void record(const std::string& url, const HttpResponse& response);
+
+    // Parse the archived response for url into response; false if it was never recorded
+    bool lookup(const std::string& url, HttpResponse& response);
+
+    ResponseArchiveStats get_stats() const;
+
+private:
+    struct Slice {
+        size_t offset;
+        size_t length;
+    };
+
+    bool load(const std::string& path);
+
+    mutable std::mutex mtx;
+    ArchiveMode current_mode;
+    std::ofstream segment;                          // Open while recording
+    std::string replay_data;                        // Whole segment while replaying
+    std::unordered_map<std::string, Slice> index;   // URL -> response bytes in replay_data
+    std::chrono::milliseconds latency;
+    ResponseArchiveStats stats;
+};
+
+// Process-wide archive consulted by http_fetch, http_get_many and the fetch engine
+ResponseArchive& response_archive();
+
+#endif // RESPONSE_ARCHIVE_H
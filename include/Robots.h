@@ -0,0 +1,136 @@
+#ifndef ROBOTS_H
+#define ROBOTS_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "HostScheduler.h"
+
+// The robots.txt rules of one host that apply to this crawler, compiled for
+// lookups. Allow and Disallow patterns ('*' for any run of bytes, a trailing
+// '$' for the end of the path) go into a trie, which subset construction turns
+// into a DFA, so may_fetch() reads each byte of a path once however many rules
+// there are. As in RFC 9309 the longest matching pattern decides, an Allow
+// winning a tie, and a path no pattern matches may be fetched. may_fetch()
+// is thread-safe; parse() is not.
+class RobotsRules {
+public:
+    // No rules: everything may be fetched
+    RobotsRules();
+
+    // Replace the rules with those of the groups in text naming user_agent
+    // (compared case-insensitively), or else of the '*' groups
+    void parse(std::string_view text, std::string_view user_agent);
+
+    // No rules at all, or a single "Disallow: /"
+    void allow_all();
+    void disallow_all();
+
+    // Whether path (with its query, from the leading '/') may be fetched
+    bool may_fetch(std::string_view path) const;
+
+    // Seconds to leave between requests, from a Crawl-delay line (0 = none)
+    double crawl_delay() const { return delay; }
+
+    size_t rule_count() const { return rules.size(); }
+
+private:
+    struct Rule {
+        std::string pattern;   // Percent-escapes in upper case, non-ASCII bytes escaped
+        bool allow;
+    };
+
+    std::vector<Rule> rules;
+    double delay;
+
+    // The automaton: transitions[state * class_count + byte_class[byte]],
+    // state 0 being the dead state no pattern can match from
+    uint16_t byte_class[256];
+    size_t class_count;
+    uint32_t start;
+    std::vector<uint32_t> transitions;
+    std::vector<uint32_t> state_best;       // Best rule matched on reaching the state (0 = none)
+    std::vector<uint32_t> state_end_best;   // Best '$' rule matched if the path ends there
+
+    void compile();
+};
+
+// Tunables for the robots.txt cache
+struct RobotsConfig {
+    std::string user_agent = "CustomScraper";   // Product token looked for on User-agent lines
+    size_t max_bytes = 512 * 1024;              // Longest robots.txt read; the rest is ignored
+    int attempts = 3;                           // Fetches before a host whose robots.txt fails is given up on
+    double max_crawl_delay = 30.0;              // Longer Crawl-delays are cut to this many seconds
+};
+
+// Counters for the robots.txt cache
+struct RobotsStats {
+    size_t hosts = 0;                   // Hosts whose robots.txt was looked up
+    size_t fetched = 0;                 // Of those, with a robots.txt that was read
+    size_t missing = 0;                 // With none (4xx): everything allowed
+    size_t unreachable = 0;             // Failing (5xx, network errors): everything disallowed
+    unsigned long long allowed = 0;     // URLs checked and allowed
+    unsigned long long disallowed = 0;  // URLs checked and turned down
+};
+
+// The robots.txt of every host seen, each fetched once and kept compiled. A
+// robots.txt that is missing allows everything; one that cannot be fetched
+// (server errors, no connection) disallows everything, as RFC 9309 asks.
+// Thread-safe; the first lookup of a host fetches its robots.txt without
+// holding the cache, and other lookups of that host wait for it instead of
+// fetching it twice.
+class RobotsCache {
+public:
+    RobotsCache();
+
+    RobotsCache(const RobotsCache&) = delete;
+    RobotsCache& operator=(const RobotsCache&) = delete;
+
+    // Turned off, every URL is allowed and nothing is fetched
+    void set_enabled(bool enabled);
+    bool enabled() const;
+
+    void set_config(const RobotsConfig& config);
+    RobotsConfig get_config() const;
+
+    // The rules of host, fetching its robots.txt the first time; fetched is set
+    // if this call did. The reference stays valid for the cache's lifetime.
+    const RobotsRules& rules(const std::string& host, bool* fetched = nullptr);
+
+    // Whether url (absolute, or a path on host) may be fetched from host
+    bool allowed(const std::string& host, std::string_view url, bool* fetched = nullptr);
+
+    RobotsStats get_stats() const;
+
+private:
+    struct HostEntry {
+        RobotsRules rules;
+        bool loaded = false;    // Until set, the thread that added the entry is fetching it
+    };
+
+    mutable std::mutex mutex;
+    std::condition_variable host_loaded;
+    bool is_enabled;
+    RobotsConfig config;
+    std::map<std::string, std::unique_ptr<HostEntry>> hosts;
+    RobotsStats stats;
+};
+
+// Write into path the part of url robots.txt rules are matched against: path
+// and query, with "/" for a missing path (so "http://host?x" gives "/?x"); a
+// fragment is dropped
+void robots_path(std::string_view url, std::string& path);
+
+// Slow host down to its robots.txt Crawl-delay, unless the scheduler already
+// keeps it at least that slow
+void apply_crawl_delay(HostScheduler& scheduler, const std::string& host, const RobotsRules& rules);
+
+// Process-wide cache used by the crawler and the worker
+RobotsCache& robots_cache();
+
+#endif // ROBOTS_H
@@ -0,0 +1,64 @@
+#ifndef SYNTHETIC_CATALOG_H
+#define SYNTHETIC_CATALOG_H
+
+#include <string>
+#include <string_view>
+#include "Book.h"
+
+// Shape of a generated catalog
+struct SyntheticCatalogConfig {
+    size_t books = 1000;              // Book pages; the listing pages add books / books_per_page more
+    size_t books_per_page = 20;       // product_pod articles per listing page
+    size_t categories = 50;           // Categories, each with its own paginated listing
+    size_t description_words = 120;   // Average length of a book page's description
+    unsigned long long seed = 1;      // Different seeds give different titles, prices and ratings
+};
+
+// A books.toscrape.com look-alike computed on demand. Pages use the markup
+// parse_books, parse_book_page and find_next_link expect (product_pod articles,
+// price_color, star-rating, li class="next" pagination) and the site's URL layout:
+//   /index.html, /                               first listing page
+//   /catalogue/page-N.html                       every book, books_per_page at a time
+//   /catalogue/category/books/<name>_<K>/index.html, .../page-N.html
+//   /catalogue/<title-slug>_<id>/index.html      one book (ids from 1)
+// Every page is a pure function of the config and the path, and nothing is
+// stored, so a catalog of millions of pages costs no memory. Thread-safe.
+class SyntheticCatalog {
+public:
+    explicit SyntheticCatalog(const SyntheticCatalogConfig& config = SyntheticCatalogConfig());
+
+    // Render the page at path (a query string is ignored) into html, replacing
+    // its contents; false if the catalog has no such page
+    bool render(std::string_view path, std::string& html) const;
+
+    // The book shown on page book_path(id); its url is that path
+    Book book(size_t id) const;
+
+    std::string book_path(size_t id) const;
+    std::string listing_path(size_t page) const;
+    std::string category_path(size_t category, size_t page) const;
+
+    size_t listing_pages() const;
+    size_t category_pages(size_t category) const;
+
+    // Distinct pages a crawl of the whole site can reach
+    size_t page_count() const;
+
+    const SyntheticCatalogConfig& get_config() const { return config; }
+
+private:
+    SyntheticCatalogConfig config;
+
+    unsigned long long book_hash(size_t id) const;
+    std::string book_title(size_t id) const;
+    std::string category_name(size_t category) const;
+    std::string category_slug(size_t category) const;
+    size_t category_books(size_t category) const;
+
+    void render_header(std::string& html, const std::string& title) const;
+    void render_footer(std::string& html) const;
+    void render_listing(std::string& html, size_t category, size_t page, bool home) const;
+    void render_book(std::string& html, size_t id) const;
+};
+
+#endif // SYNTHETIC_CATALOG_H
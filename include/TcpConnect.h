@@ -0,0 +1,56 @@
+#ifndef TCP_CONNECT_H
+#define TCP_CONNECT_H
+
+#include "config.h"
+#include "DnsCache.h"
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+
+// Tunables for opening TCP connections
+struct TcpConnectConfig {
+    std::chrono::milliseconds connect_timeout{10000};   // Budget for reaching any address; 0 leaves it to the OS
+    std::chrono::milliseconds attempt_delay{250};       // Head start an attempt gets before the next address is tried
+};
+
+// Counters for connection establishment
+struct TcpConnectStats {
+    unsigned long long connects = 0;    // Connections established
+    unsigned long long attempts = 0;    // connect() calls started, one per address tried
+    unsigned long long failures = 0;    // Every address refused or was unreachable
+    unsigned long long timeouts = 0;    // No address answered before the deadline
+    unsigned long long fallbacks = 0;   // Won by an address other than the first one
+};
+
+// Opens TCP connections Happy Eyeballs style (RFC 8305): the addresses are
+// tried in order with non-blocking connects, each new attempt starting once
+// the previous one has had attempt_delay to answer (or has failed), and the
+// first socket to connect wins while the rest are closed. A host with a dead
+// IPv6 route or one blackholed address therefore costs attempt_delay rather
+// than a full kernel connect timeout, and connect_timeout bounds the whole race.
+class TcpConnector {
+public:
+    explicit TcpConnector(const TcpConnectConfig& config = TcpConnectConfig());
+
+    // Connect to the first address that answers (blocking socket, or
+    // INVALID_SOCKET); error receives the reason on failure
+    SOCKET open(const std::vector<ResolvedAddress>& addresses, std::string* error = nullptr);
+
+    // Resolve hostname through the shared DNS cache and race its addresses
+    SOCKET open(const std::string& hostname, int port, std::string* error = nullptr);
+
+    void set_config(const TcpConnectConfig& config);
+    TcpConnectConfig get_config() const;
+    TcpConnectStats get_stats() const;
+
+private:
+    mutable std::mutex mtx;
+    TcpConnectConfig config;
+    TcpConnectStats stats;
+};
+
+// Process-wide connector used by the connection pool, the fetch engine and the worker
+TcpConnector& tcp_connector();
+
+#endif // TCP_CONNECT_H
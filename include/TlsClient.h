@@ -0,0 +1,139 @@
+#ifndef TLS_CLIENT_H
+#define TLS_CLIENT_H
+
+#include "config.h"
+#include <string>
+#include <map>
+#include <memory>
+#include <mutex>
+
+// OpenSSL types, kept opaque so builds without TLS support need no headers
+struct ssl_st;
+struct ssl_ctx_st;
+struct ssl_session_st;
+
+// Tunables for HTTPS connections
+struct TlsConfig {
+    bool verify_peer = true;          // Check the certificate chain and that it names the host
+    std::string ca_file;              // Extra trusted certificates (PEM); the system store is always loaded
+    bool session_resumption = true;   // Offer a cached session/ticket to skip the full handshake
+    size_t max_sessions = 256;        // Cached sessions, one per host:port
+};
+
+// Counters for TLS handshakes
+struct TlsStats {
+    unsigned long long handshakes = 0;        // Handshakes completed
+    unsigned long long resumed = 0;           // ... of which resumed a cached session
+    unsigned long long failures = 0;          // Handshakes that failed, certificate errors included
+    unsigned long long sessions_stored = 0;   // Sessions and tickets the servers handed out
+    size_t cached_sessions = 0;               // Hosts with a session ready to resume
+};
+
+// Outcome of one TLS operation; WantRead/WantWrite only happen on
+// non-blocking sockets (or when a blocking socket's timeout expired)
+enum class TlsResult { Ok, WantRead, WantWrite, Closed, Error };
+
+class TlsContext;
+
+// One TLS session running over a connected socket. The socket stays owned by
+// the caller: destroying the connection frees the TLS state but never closes it.
+class TlsConnection {
+public:
+    ~TlsConnection();
+
+    TlsConnection(const TlsConnection&) = delete;
+    TlsConnection& operator=(const TlsConnection&) = delete;
+
+    // Drive the handshake; call again on WantRead/WantWrite once the socket is ready
+    TlsResult handshake();
+
+    // Decrypt up to length bytes into data (received is set on Ok)
+    TlsResult read(char* data, size_t length, size_t& received);
+
+    // Encrypt and send up to length bytes (sent is set on Ok)
+    TlsResult write(const char* data, size_t length, size_t& sent);
+
+    // Send close_notify without waiting for the peer's reply
+    void shutdown();
+
+    // True once the handshake resumed a cached session
+    bool resumed() const;
+
+    // Reason for the last Error result
+    const std::string& error() const { return last_error; }
+
+private:
+    friend class TlsContext;
+    TlsConnection(TlsContext* owner, ssl_st* ssl, const std::string& session_key);
+
+    // Turn an SSL call's return value into a TlsResult, recording any error
+    TlsResult check(int result, const char* operation);
+
+    TlsContext* owner;
+    ssl_st* ssl;
+    std::string session_key;   // "host:port" the session is cached under
+    bool handshake_done;
+    std::string last_error;
+};
+
+// Client-side TLS settings shared by every HTTPS connection, plus the session
+// cache that makes them cheap: each host's newest session (a TLS 1.3 ticket or
+// a TLS 1.2 session id/ticket) is kept and offered on the next connection, so
+// reconnecting to a host skips the certificate exchange and key agreement.
+class TlsContext {
+public:
+    explicit TlsContext(const TlsConfig& config = TlsConfig());
+    ~TlsContext();
+
+    TlsContext(const TlsContext&) = delete;
+    TlsContext& operator=(const TlsContext&) = delete;
+
+    // False when the build has no TLS library (wrap and connect always fail)
+    static bool available();
+
+    // Start TLS as a client on a connected socket, offering the host's cached
+    // session; the handshake is left to the caller (non-blocking sockets)
+    std::unique_ptr<TlsConnection> wrap(SOCKET sock, const std::string& hostname, int port,
+                                        std::string* error = nullptr);
+
+    // wrap plus a complete handshake on a blocking socket
+    std::unique_ptr<TlsConnection> connect(SOCKET sock, const std::string& hostname, int port,
+                                           std::string* error = nullptr);
+
+    // Forget every cached session (the next connection to each host does a full handshake)
+    void clear_sessions();
+
+    // New settings apply to connections opened afterwards
+    void set_config(const TlsConfig& config);
+    TlsConfig get_config() const;
+    TlsStats get_stats() const;
+
+private:
+    friend class TlsConnection;
+
+    // Build the SSL_CTX for the current config on first use; call with mtx held
+    bool ensure_context(std::string* error);
+    void release_context();
+
+    // Called by OpenSSL when a server hands out a session or ticket
+    static int on_new_session(ssl_st* ssl, ssl_session_st* session);
+    bool store_session(const std::string& key, ssl_session_st* session);
+    void record_handshake(bool ok, bool resumed);
+
+    struct CachedSession {
+        ssl_session_st* session = nullptr;
+        unsigned long long stored = 0;   // Insertion order, for evicting the oldest host
+    };
+
+    mutable std::mutex mtx;
+    TlsConfig config;
+    TlsStats stats;
+    ssl_ctx_st* ctx;
+    std::map<std::string, CachedSession> sessions;
+    unsigned long long next_sequence;
+};
+
+// Process-wide context used by the connection pool, the fetch engine and the worker
+TlsContext& tls_context();
+
+#endif // TLS_CLIENT_H
@@ -0,0 +1,51 @@
+#ifndef URL_NORMALIZE_H
+#define URL_NORMALIZE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// RFC 3986 reference resolution (section 5.2) with syntax-based
+// normalization (section 6.2.2): a resolved URL has its scheme and host in
+// lower case, no default port, no "." or ".." path segments, an empty path
+// written as "/", and its percent-escapes in upper case, those of unreserved
+// characters decoded. Everything else is kept as written.
+
+// A page URL normalized and split once, so each of the page's links is
+// resolved in a single pass over the link, written straight into a reusable
+// buffer, without re-parsing the page URL or copying through temporaries
+struct UrlBase {
+    std::string url;            // Normalized page URL, without its fragment
+    size_t origin_end = 0;      // End of "scheme://authority" in url, where the path starts
+    size_t directory_end = 0;   // Just past the last '/' of the path
+    size_t path_end = 0;        // Start of the "?query", or url.size()
+
+    UrlBase() = default;
+    explicit UrlBase(std::string_view base_url);
+
+    // Re-split for another page, reusing the string's capacity. A base_url
+    // without a scheme is taken to be http; an empty one makes the UrlBase empty.
+    void assign(std::string_view base_url);
+
+    // Resolve reference (an href as written on the page, surrounding spaces
+    // allowed) into out, replacing its contents; out is left empty for an
+    // empty reference. An empty UrlBase only resolves absolute references and
+    // copies relative ones as written.
+    void resolve(std::string_view reference, std::string& out) const;
+
+    // resolve(), writing the canonicalize_url() key of the result into key too
+    void resolve(std::string_view reference, std::string& out, std::string& key) const;
+};
+
+// Normalize URL (convert relative to absolute)
+std::string normalize_url(const std::string& url, const std::string& base_url);
+
+// Canonicalize URL for deduplication (handle www, trailing slashes, etc.)
+std::string canonicalize_url(const std::string& url);
+
+// The two above into a caller-owned buffer, replacing what it held
+void normalize_url(std::string_view url, std::string_view base_url, std::string& out);
+
+void canonicalize_url(std::string_view url, std::string& out);
+
+#endif // URL_NORMALIZE_H
@@ -0,0 +1,79 @@
+#ifndef URL_RULES_H
+#define URL_RULES_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// What kind of page a URL leads to, as far as the crawler cares
+enum class PageClass { Other, Listing, Book };
+
+// The verdict of a rule set on one URL
+struct UrlMatch {
+    bool accepted = true;                  // Not excluded, and included if there are include rules
+    PageClass page_class = PageClass::Other;
+};
+
+// Include, exclude and classify patterns compiled into one Aho-Corasick
+// automaton, so a URL is checked against every rule in a single pass over its
+// bytes. Patterns are plain substrings; a leading '^' anchors one to the start
+// of the URL and a trailing '$' to its end. A URL is accepted unless an exclude
+// pattern matches, and, when there are include patterns, only if one of them
+// matches too. Its class is that of the first class rule (in rule order) whose
+// pattern matches, or Other.
+//
+// Rules are written one per line:
+//   exclude <pattern>
+//   include <pattern>
+//   class listing|book|other <pattern>
+//   defaults                  (the built-in books.toscrape.com rules)
+// with blank lines and lines starting with '#' skipped. match() is thread-safe;
+// changing the rules is not, so load them before crawling starts.
+class UrlRules {
+public:
+    // No rules: every URL is accepted and classed Other
+    UrlRules();
+
+    // Replace the rules with those in text; false (and the rules unchanged) on
+    // a malformed line, reported on std::cerr against source
+    bool parse(std::string_view text, const std::string& source = "rules");
+
+    // parse() the contents of a file
+    bool load(const std::string& path);
+
+    UrlMatch match(std::string_view url) const;
+
+    size_t rule_count() const { return rules.size(); }
+
+    // The rules books.toscrape.com crawls have always used
+    static const char* default_rules();
+
+private:
+    enum class Kind { Exclude, Include, Classify };
+
+    struct Rule {
+        Kind kind;
+        PageClass page_class;
+        std::string pattern;   // With the anchors turned into the sentinel bytes
+    };
+
+    std::vector<Rule> rules;
+    bool has_includes;
+
+    // The automaton: transitions[state * class_count + byte_class[byte]]
+    uint16_t byte_class[256];
+    size_t class_count;
+    std::vector<uint32_t> transitions;
+    std::vector<uint8_t> state_flags;          // EXCLUDED / INCLUDED bits of every pattern ending here
+    std::vector<uint32_t> state_first_class;   // Lowest index of a class rule ending here, or NO_RULE
+
+    bool append_rules(std::string_view text, const std::string& source, int depth, std::vector<Rule>& out);
+    void compile();
+};
+
+// Rules used by extract_all_links, should_ignore_url, is_book_page and
+// is_category_page; the built-in rules until a crawl job loads its own
+UrlRules& url_rules();
+
+#endif // URL_RULES_H
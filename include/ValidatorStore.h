@@ -0,0 +1,88 @@
+#ifndef VALIDATOR_STORE_H
+#define VALIDATOR_STORE_H
+
+#include "HttpResponse.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <cstdint>
+
+// What was learned about a page the last time it was fetched
+struct PageValidators {
+    std::string etag;                 // ETag response header, sent back as If-None-Match
+    std::string last_modified;        // Last-Modified response header, sent back as If-Modified-Since
+    uint64_t content_hash = 0;        // FNV-1a of the decoded body
+    std::vector<std::string> links;   // Outlinks found on the page, replayed when it is unchanged
+};
+
+// Counters for the validator store
+struct ValidatorStoreStats {
+    unsigned long long conditional_requests = 0;  // GETs sent with If-None-Match / If-Modified-Since
+    unsigned long long not_modified = 0;          // 304 responses
+    unsigned long long hash_matches = 0;          // 200 responses whose body hashed the same as before
+    unsigned long long updated = 0;               // Changed pages whose validators and links were stored
+    size_t entries = 0;                           // Pages currently known
+};
+
+// Persistent per-URL validators for conditional re-fetching.
+// Once opened, every GET carries the page's stored validators and every
+// response is checked against them: a 304, or a 200 whose body is byte-for-byte
+// what was seen last time, is flagged HttpResponse::unchanged so the crawler can
+// skip parsing it and replay its remembered links instead. New validators of a
+// changed page are only stored once its links are, so an entry always carries
+// the links of the version its validators describe. The store is saved as a
+// tab-separated text file, one page per line.
+class ValidatorStore {
+public:
+    ValidatorStore();
+
+    ValidatorStore(const ValidatorStore&) = delete;
+    ValidatorStore& operator=(const ValidatorStore&) = delete;
+
+    // Load validators from path (a missing file is an empty store) and enable
+    // conditional requests; save() writes back to the same path
+    bool open(const std::string& path);
+
+    // Write every entry back to the file given to open()
+    bool save();
+
+    // Conditional requests are only made once the store has been opened
+    bool enabled() const;
+
+    // Extra request header lines for a page, or "" if nothing is known about it
+    std::string conditional_headers(const std::string& key);
+
+    // Check a response against the stored validators, flag it unchanged if it
+    // matches and hold the new validators of a changed 200 for set_links()
+    void record(const std::string& key, HttpResponse& response);
+
+    // Remember the outlinks of a page that was parsed, storing the validators
+    // its response brought along with them
+    void set_links(const std::string& key, const std::vector<std::string>& links);
+
+    // Outlinks remembered for a page; false if there is no entry
+    bool links(const std::string& key, std::vector<std::string>& links) const;
+
+    ValidatorStoreStats get_stats() const;
+
+private:
+    mutable std::mutex mtx;
+    std::map<std::string, PageValidators> entries;
+    std::map<std::string, PageValidators> pending;   // Validators of changed pages not parsed yet
+    std::string file_path;
+    bool is_open;
+    ValidatorStoreStats stats;
+};
+
+// Store key for a page: absolute URLs are used as-is, paths are prefixed with the host
+std::string validator_key(const std::string& hostname, const std::string& resource_path);
+
+// 64-bit FNV-1a hash used to recognise an unchanged body
+uint64_t content_hash(std::string_view data);
+
+// Process-wide store consulted by http_fetch, http_get_many and the fetch engine
+ValidatorStore& validator_store();
+
+#endif // VALIDATOR_STORE_H
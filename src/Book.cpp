@@ -0,0 +1,194 @@
+#include "../include/Book.h"
+#include <charconv>
+#include <deque>
+#include <map>
+#include <mutex>
+
+// Currency symbols and codes, longest first where one starts another
+static const struct {
+    std::string_view text;
+    Currency currency;
+} CURRENCY_MARKS[] = {
+    {"\xC3\x82\xC2\xA3", Currency::GBP},   // "Â£": a UTF-8 "£" decoded as Latin-1 and encoded again
+    {"\xC2\xA3", Currency::GBP},
+    {"\xA3", Currency::GBP},               // Latin-1 "£"
+    {"\xE2\x82\xAC", Currency::EUR},
+    {"$", Currency::USD},
+    {"GBP", Currency::GBP},
+    {"USD", Currency::USD},
+    {"EUR", Currency::EUR},
+};
+
+// Largest whole amount kept, so minor units cannot overflow
+static const int64_t MAX_UNITS = 1000000000000000LL;
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+static std::string_view trim(std::string_view text) {
+    while (!text.empty() && is_space(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && is_space(text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// Take a currency symbol or code off the front or the back of text
+static Currency take_currency(std::string_view& text) {
+    for (const auto& mark : CURRENCY_MARKS) {
+        if (text.size() >= mark.text.size() && text.compare(0, mark.text.size(), mark.text) == 0) {
+            text = trim(text.substr(mark.text.size()));
+            return mark.currency;
+        }
+        if (text.size() >= mark.text.size() &&
+            text.compare(text.size() - mark.text.size(), mark.text.size(), mark.text) == 0) {
+            text = trim(text.substr(0, text.size() - mark.text.size()));
+            return mark.currency;
+        }
+    }
+    return Currency::None;
+}
+
+// Digits, optionally in groups of three after the first separated by ',' or
+// '.', then optionally a ',' or '.' and one or two decimals
+static bool parse_amount(std::string_view text, int64_t& minor) {
+    int64_t fraction = 0;
+    size_t separator = text.find_last_of(".,");
+    if (separator != std::string_view::npos && text.size() - separator - 1 <= 2) {
+        std::string_view decimals = text.substr(separator + 1);
+        if (!decimals.empty()) {
+            auto result = std::from_chars(decimals.data(), decimals.data() + decimals.size(), fraction);
+            if (result.ec != std::errc() || result.ptr != decimals.data() + decimals.size() || fraction < 0) {
+                return false;
+            }
+            if (decimals.size() == 1) {
+                fraction *= 10;
+            }
+        }
+        text = text.substr(0, separator);
+    }
+
+    const char* pos = text.data();
+    const char* end = text.data() + text.size();
+    int64_t units = 0;
+    bool first = true;
+    while (true) {
+        if (pos == end || *pos < '0' || *pos > '9') {
+            return false;
+        }
+        int64_t group = 0;
+        auto result = std::from_chars(pos, end, group);
+        size_t digits = (size_t)(result.ptr - pos);
+        if (result.ec != std::errc() || (!first && digits != 3)) {
+            return false;
+        }
+        units = first ? group : units * 1000 + group;
+        if (units >= MAX_UNITS) {
+            return false;
+        }
+        first = false;
+        pos = result.ptr;
+        if (pos == end) {
+            break;
+        }
+        if (*pos != ',' && *pos != '.') {
+            return false;
+        }
+        pos++;
+    }
+    minor = units * 100 + fraction;
+    return true;
+}
+
+bool parse_price(std::string_view text, Price& price) {
+    price = Price();
+    text = trim(text);
+    Currency currency = take_currency(text);
+    int64_t minor = 0;
+    if (!parse_amount(text, minor)) {
+        return false;
+    }
+    price.minor = minor;
+    price.currency = currency;
+    return true;
+}
+
+std::string format_price(const Price& price) {
+    if (price.empty()) {
+        return "";
+    }
+    std::string text;
+    switch (price.currency) {
+    case Currency::GBP: text = "\xC2\xA3"; break;
+    case Currency::USD: text = "$"; break;
+    case Currency::EUR: text = "\xE2\x82\xAC"; break;
+    default: break;
+    }
+    int64_t cents = price.minor % 100;
+    text += std::to_string(price.minor / 100);
+    text += cents < 10 ? ".0" : ".";
+    text += std::to_string(cents);
+    return text;
+}
+
+Rating parse_rating(std::string_view text) {
+    if (text.find("One") != std::string_view::npos) return Rating::One;
+    if (text.find("Two") != std::string_view::npos) return Rating::Two;
+    if (text.find("Three") != std::string_view::npos) return Rating::Three;
+    if (text.find("Four") != std::string_view::npos) return Rating::Four;
+    if (text.find("Five") != std::string_view::npos) return Rating::Five;
+    return Rating::Unknown;
+}
+
+const char* rating_name(Rating rating) {
+    switch (rating) {
+    case Rating::One: return "One";
+    case Rating::Two: return "Two";
+    case Rating::Three: return "Three";
+    case Rating::Four: return "Four";
+    case Rating::Five: return "Five";
+    default: return "Unknown";
+    }
+}
+
+// Every category name seen, each stored once; ids index names
+struct CategoryTable {
+    std::mutex mutex;
+    std::map<std::string, CategoryId, std::less<>> ids;
+    std::deque<std::string> names{std::string()};   // A deque, so names handed out stay put
+};
+
+static CategoryTable& category_table() {
+    static CategoryTable table;
+    return table;
+}
+
+CategoryId category_id(std::string_view name) {
+    name = trim(name);
+    if (name.empty()) {
+        return NO_CATEGORY;
+    }
+    CategoryTable& table = category_table();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    auto it = table.ids.find(name);
+    if (it != table.ids.end()) {
+        return it->second;
+    }
+    if (table.names.size() > UINT16_MAX) {
+        // Table full: later categories go unrecorded
+        return NO_CATEGORY;
+    }
+    CategoryId id = (CategoryId)table.names.size();
+    table.names.emplace_back(name);
+    table.ids.emplace(std::string(name), id);
+    return id;
+}
+
+const std::string& category_name(CategoryId id) {
+    CategoryTable& table = category_table();
+    std::lock_guard<std::mutex> lock(table.mutex);
+    return id < table.names.size() ? table.names[id] : table.names[NO_CATEGORY];
+}
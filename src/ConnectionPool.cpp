@@ -0,0 +1,314 @@
+#ifdef _MSC_VER
+// Additional includes and defines for Visual Studio
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "../include/ConnectionPool.h"
+#include "../include/TcpConnect.h"
+#include "../include/compat.h"
+#include <iostream>
+
+#ifndef _WIN32
+#include <poll.h>
+#endif
+
+// Winsock is reference counted; pooled sockets die if the count drops to zero,
+// so the pool takes one reference for the lifetime of the process
+static bool ensure_socket_library() {
+    #ifdef _WIN32
+    static bool initialized = false;
+    static std::mutex init_mutex;
+    std::lock_guard<std::mutex> lock(init_mutex);
+    if (!initialized) {
+        WSADATA wsaData;
+        int wsa_result = WSAStartup(MAKEWORD(2, 2), &wsaData);
+        if (wsa_result != 0) {
+            std::cerr << "WSAStartup failed: " << wsa_result << std::endl;
+            return false;
+        }
+        initialized = true;
+    }
+    #endif
+    return true;
+}
+
+// Apply the receive/send timeouts every fetch socket uses
+static void set_socket_timeouts(SOCKET sock) {
+    #ifdef _WIN32
+    DWORD timeout = 30000;  // 30 seconds in milliseconds
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+    #else
+    struct timeval timeout;
+    timeout.tv_sec = 30;  // 30 seconds timeout
+    timeout.tv_usec = 0;
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (char*)&timeout, sizeof(timeout));
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (char*)&timeout, sizeof(timeout));
+    #endif
+}
+
+// An idle keep-alive socket is readable only if the server closed it (or sent
+// junk); either way it must not be reused
+static bool idle_socket_is_usable(SOCKET sock) {
+    #ifdef _WIN32
+    // A Winsock fd_set is a list of handles, so any socket value fits
+    fd_set readfds;
+    FD_ZERO(&readfds);
+    FD_SET(sock, &readfds);
+    struct timeval tv = { 0L, 0L };
+    int ready = select((int)sock + 1, &readfds, NULL, NULL, &tv);
+    return ready == 0;
+    #else
+    // poll() rather than select(): FD_SET is undefined for descriptors past
+    // FD_SETSIZE, which a busy pool and fetch engine easily reach
+    struct pollfd pfd;
+    pfd.fd = sock;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    return poll(&pfd, 1, 0) == 0;
+    #endif
+}
+
+// Close a pooled socket, ending its TLS session first if it has one
+static void close_pooled(PooledConnection& conn) {
+    if (conn.tls) {
+        conn.tls->shutdown();
+        conn.tls.reset();
+    }
+    CLOSE_SOCKET(conn.sock);
+}
+
+static std::string pool_key(const std::string& hostname, int port, bool tls) {
+    return (tls ? "https://" : "") + hostname + ":" + std::to_string(port);
+}
+
+SOCKET open_tcp_connection(const std::string& hostname, int port) {
+    if (!ensure_socket_library()) {
+        return INVALID_SOCKET;
+    }
+
+    // Resolution is served from the shared cache, so only the first
+    // connection to a host (or one after the TTL) waits on the resolver;
+    // the connector then races the addresses under the connect deadline
+    std::string error;
+    SOCKET sock = tcp_connector().open(hostname, port, &error);
+    if (sock == INVALID_SOCKET) {
+        std::cerr << "Error connecting to " << hostname << ":" << port << ": " << error << std::endl;
+        return INVALID_SOCKET;
+    }
+
+    // Add socket timeouts to prevent hanging forever on slow servers
+    set_socket_timeouts(sock);
+    return sock;
+}
+
+ConnectionPool::ConnectionPool(const ConnectionPoolConfig& cfg) : config(cfg) {}
+
+ConnectionPool::~ConnectionPool() {
+    close_idle();
+}
+
+void ConnectionPool::evict_expired(HostEntry& entry, std::chrono::steady_clock::time_point now) {
+    auto it = entry.idle.begin();
+    while (it != entry.idle.end()) {
+        if (now - it->last_used >= config.idle_timeout) {
+            close_pooled(*it);
+            stats.idle_evictions++;
+            it = entry.idle.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool ConnectionPool::take_idle(HostEntry& entry, PooledConnection& conn) {
+    // Hand out the most recently used idle socket that is still open
+    while (!entry.idle.empty()) {
+        PooledConnection candidate = entry.idle.back();
+        entry.idle.pop_back();
+        if (idle_socket_is_usable(candidate.sock)) {
+            entry.active++;
+            stats.hits++;
+            conn = candidate;
+            conn.reused = true;
+            return true;
+        }
+        close_pooled(candidate);
+        stats.idle_evictions++;
+    }
+    return false;
+}
+
+bool ConnectionPool::reserve_slot(std::unique_lock<std::mutex>& lock, HostEntry*& entry, const std::string& key,
+                                  PooledConnection* idle_conn) {
+    entry = &hosts[key];
+    if (entry->active + entry->idle.size() < config.max_connections_per_host) {
+        entry->active++;
+        return true;
+    }
+
+    // At the cap with nothing idle to hand out: wait for another thread to release
+    stats.cap_waits++;
+    bool freed = slot_freed.wait_for(lock, config.acquire_timeout, [&]() {
+        HostEntry& e = hosts[key];
+        return !e.idle.empty() || e.active + e.idle.size() < config.max_connections_per_host;
+    });
+    entry = &hosts[key];
+    if (!freed) {
+        return false;
+    }
+    if (idle_conn && take_idle(*entry, *idle_conn)) {
+        // Woken by a socket going idle: reuse it rather than close it for a new one
+        return true;
+    }
+    if (entry->active + entry->idle.size() >= config.max_connections_per_host) {
+        // Make room by dropping the oldest idle socket; the caller opens a new one
+        close_pooled(entry->idle.front());
+        entry->idle.erase(entry->idle.begin());
+    }
+    entry->active++;
+    return true;
+}
+
+bool ConnectionPool::acquire(const std::string& hostname, int port, PooledConnection& conn, bool tls) {
+    std::string key = pool_key(hostname, port, tls);
+    auto now = std::chrono::steady_clock::now();
+
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        HostEntry* entry = &hosts[key];
+        evict_expired(*entry, now);
+        if (take_idle(*entry, conn)) {
+            return true;
+        }
+
+        conn.sock = INVALID_SOCKET;
+        if (!reserve_slot(lock, entry, key, &conn)) {
+            std::cerr << "Timed out waiting for a free connection to " << key << std::endl;
+            return false;
+        }
+        if (conn.sock != INVALID_SOCKET) {
+            return true;
+        }
+        stats.misses++;
+    }
+
+    return open_reserved(hostname, port, conn, tls);
+}
+
+bool ConnectionPool::acquire_fresh(const std::string& hostname, int port, PooledConnection& conn, bool tls) {
+    std::string key = pool_key(hostname, port, tls);
+
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        HostEntry* entry = nullptr;
+        if (!reserve_slot(lock, entry, key, nullptr)) {
+            std::cerr << "Timed out waiting for a free connection to " << key << std::endl;
+            return false;
+        }
+        stats.misses++;
+    }
+
+    return open_reserved(hostname, port, conn, tls);
+}
+
+bool ConnectionPool::open_reserved(const std::string& hostname, int port, PooledConnection& conn, bool tls) {
+    std::string key = pool_key(hostname, port, tls);
+
+    // Connect (and shake hands) outside the lock so other hosts are not held up
+    SOCKET sock = open_tcp_connection(hostname, port);
+    std::shared_ptr<TlsConnection> session;
+    if (sock != INVALID_SOCKET && tls) {
+        std::string error;
+        session = tls_context().connect(sock, hostname, port, &error);
+        if (!session) {
+            std::cerr << "Error securing connection to " << hostname << ":" << port << ": " << error << std::endl;
+            CLOSE_SOCKET(sock);
+            sock = INVALID_SOCKET;
+        }
+    }
+    if (sock == INVALID_SOCKET) {
+        std::lock_guard<std::mutex> lock(mtx);
+        hosts[key].active--;
+        slot_freed.notify_all();
+        return false;
+    }
+
+    conn.sock = sock;
+    conn.tls = session;
+    conn.key = key;
+    conn.requests_served = 0;
+    conn.reused = false;
+    conn.last_used = std::chrono::steady_clock::now();
+    return true;
+}
+
+void ConnectionPool::release(PooledConnection& conn, bool reusable) {
+    if (conn.sock == INVALID_SOCKET) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+    HostEntry& entry = hosts[conn.key];
+    if (entry.active > 0) {
+        entry.active--;
+    }
+
+    conn.requests_served++;
+    conn.last_used = std::chrono::steady_clock::now();
+    if (reusable && conn.requests_served < config.max_requests_per_connection &&
+        entry.idle.size() + entry.active < config.max_connections_per_host) {
+        entry.idle.push_back(conn);
+    } else {
+        close_pooled(conn);
+    }
+    conn.sock = INVALID_SOCKET;
+    conn.tls.reset();
+    slot_freed.notify_all();
+}
+
+void ConnectionPool::record_reconnect() {
+    std::lock_guard<std::mutex> lock(mtx);
+    stats.reconnects++;
+}
+
+void ConnectionPool::close_idle() {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (auto& pair : hosts) {
+        for (auto& idle : pair.second.idle) {
+            close_pooled(idle);
+        }
+        pair.second.idle.clear();
+    }
+    slot_freed.notify_all();
+}
+
+void ConnectionPool::set_config(const ConnectionPoolConfig& cfg) {
+    std::lock_guard<std::mutex> lock(mtx);
+    config = cfg;
+}
+
+ConnectionPoolConfig ConnectionPool::get_config() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return config;
+}
+
+ConnectionPoolStats ConnectionPool::get_stats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    ConnectionPoolStats result = stats;
+    result.idle_connections = 0;
+    result.active_connections = 0;
+    for (const auto& pair : hosts) {
+        result.idle_connections += pair.second.idle.size();
+        result.active_connections += pair.second.active;
+    }
+    return result;
+}
+
+ConnectionPool& connection_pool() {
+    static ConnectionPool pool;
+    return pool;
+}
@@ -0,0 +1,148 @@
+#include "../include/ContentDecoder.h"
+#include <algorithm>
+#include <cctype>
+
+#ifdef WEBSCRAPER_HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+// Smallest slice of output space handed to inflate()
+const size_t INFLATE_CHUNK = 16 * 1024;
+
+#ifdef WEBSCRAPER_HAVE_ZLIB
+struct ContentDecoder::Stream {
+    z_stream z;
+};
+#else
+struct ContentDecoder::Stream {};
+#endif
+
+ContentDecoder::ContentDecoder() : deflate_encoding(false), stream_ended(false), fed(0) {}
+
+ContentDecoder::~ContentDecoder() {
+    reset();
+}
+
+const char* ContentDecoder::accept_encoding() {
+    #ifdef WEBSCRAPER_HAVE_ZLIB
+    return "gzip, deflate";
+    #else
+    return "";
+    #endif
+}
+
+void ContentDecoder::reset() {
+    #ifdef WEBSCRAPER_HAVE_ZLIB
+    if (stream) {
+        inflateEnd(&stream->z);
+    }
+    #endif
+    stream.reset();
+    deflate_encoding = false;
+    stream_ended = false;
+    fed = 0;
+    error_message.clear();
+}
+
+bool ContentDecoder::init_stream(bool raw_deflate) {
+    #ifdef WEBSCRAPER_HAVE_ZLIB
+    if (stream) {
+        inflateEnd(&stream->z);
+    }
+    stream.reset(new Stream());
+    // 15 + 32 detects gzip and zlib headers; -15 is a bare deflate stream
+    if (inflateInit2(&stream->z, raw_deflate ? -15 : 15 + 32) != Z_OK) {
+        stream.reset();
+        error_message = "inflateInit2 failed";
+        return false;
+    }
+    return true;
+    #else
+    (void)raw_deflate;
+    return false;
+    #endif
+}
+
+bool ContentDecoder::begin(const std::string& content_encoding) {
+    reset();
+
+    std::string encoding = content_encoding;
+    std::transform(encoding.begin(), encoding.end(), encoding.begin(),
+                  [](unsigned char c){ return std::tolower(c); });
+    encoding.erase(0, encoding.find_first_not_of(" \t"));
+    encoding.erase(encoding.find_last_not_of(" \t") + 1);
+
+    if (encoding == "gzip" || encoding == "x-gzip") {
+        return init_stream(false);
+    }
+    if (encoding == "deflate") {
+        deflate_encoding = true;
+        return init_stream(false);
+    }
+    return false;
+}
+
+bool ContentDecoder::feed(const char* data, size_t len, RecvBuffer& out) {
+    #ifdef WEBSCRAPER_HAVE_ZLIB
+    if (!stream) {
+        error_message = "Decoder not started";
+        return false;
+    }
+    if (stream_ended || len == 0) {
+        return true;  // Anything after the end of the stream is ignored
+    }
+
+    z_stream& z = stream->z;
+    z.next_in = (Bytef*)data;
+    z.avail_in = (uInt)len;
+
+    while (z.avail_in > 0) {
+        // Text typically inflates 4-8x; ask for room accordingly
+        size_t room = std::max(INFLATE_CHUNK, (size_t)z.avail_in * 4);
+        z.next_out = (Bytef*)out.prepare(room);
+        z.avail_out = (uInt)room;
+
+        int result = inflate(&z, Z_NO_FLUSH);
+        out.commit(room - z.avail_out);
+
+        if (result == Z_DATA_ERROR && deflate_encoding && z.total_out == 0 && fed == 0) {
+            // Some servers send "deflate" without the zlib wrapper
+            deflate_encoding = false;
+            if (!init_stream(true)) {
+                return false;
+            }
+            return feed(data, len, out);
+        }
+        if (result == Z_STREAM_END) {
+            stream_ended = true;
+            break;
+        }
+        if (result != Z_OK && result != Z_BUF_ERROR) {
+            error_message = std::string("inflate failed: ") + (z.msg != nullptr ? z.msg : "corrupt data");
+            return false;
+        }
+        if (result == Z_BUF_ERROR && z.avail_in > 0 && z.avail_out > 0) {
+            error_message = "inflate made no progress";
+            return false;
+        }
+    }
+
+    fed += len;
+    return true;
+    #else
+    (void)data;
+    (void)len;
+    (void)out;
+    error_message = "Built without zlib";
+    return false;
+    #endif
+}
+
+bool ContentDecoder::finish() {
+    // An empty body is fine; a stream that started must have reached its end
+    if (!stream_ended && fed > 0) {
+        error_message = "Compressed body ended early";
+        return false;
+    }
+    return true;
+}
@@ -1,8 +1,16 @@
 #include "../include/Crawler.h"
 #include "../include/HttpClient.h"
 #include "../include/HtmlParser.h"
+#include "../include/FetchEngine.h"
+#include "../include/NearDuplicate.h"
+#include "../include/Robots.h"
 #include <iostream>
 #include <chrono>
+#include <map>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <thread>
 
 #ifdef _WIN32
 #include <conio.h>  // For _kbhit() on Windows
@@ -34,20 +42,177 @@ int _getch() {
 }
 #endif
 
+// Report how many fetches reused a kept-alive connection and a cached address,
+// and how much compression saved
+static void print_pool_stats() {
+    ConnectionPoolStats stats = http_pool_stats();
+    std::cout << "Connection pool: " << stats.hits << " hits, " << stats.misses << " misses, "
+              << stats.reconnects << " reconnects, " << stats.idle_evictions << " idle evictions" << std::endl;
+    DnsCacheStats dns = http_dns_stats();
+    std::cout << "DNS cache: " << dns.hits << " hits, " << dns.misses << " misses, "
+              << dns.negative_hits << " negative hits, " << dns.refreshes << " refreshes, "
+              << dns.failures << " failures" << std::endl;
+    TcpConnectStats connect = http_connect_stats();
+    std::cout << "Connect: " << connect.connects << " connected (" << connect.fallbacks << " via a fallback address), "
+              << connect.timeouts << " timed out, " << connect.failures << " failed, "
+              << connect.attempts << " attempts" << std::endl;
+    TlsStats tls = http_tls_stats();
+    if (tls.handshakes > 0 || tls.failures > 0) {
+        std::cout << "TLS: " << tls.handshakes << " handshakes (" << tls.resumed << " resumed), "
+                  << tls.failures << " failed, " << tls.cached_sessions << " sessions cached" << std::endl;
+    }
+    TransferStats transfer = http_transfer_stats();
+    std::cout << "Transfer: " << transfer.responses << " responses (" << transfer.decoded_responses
+              << " compressed), " << transfer.encoded_bytes << " body bytes received, "
+              << transfer.decoded_bytes << " after decoding" << std::endl;
+    if (transfer.skipped_bodies > 0) {
+        std::cout << "Content filter: " << transfer.skipped_bodies << " bodies skipped after their headers" << std::endl;
+    }
+    ValidatorStoreStats validators = http_validator_stats();
+    if (validator_store().enabled()) {
+        std::cout << "Revalidation: " << validators.conditional_requests << " conditional requests, "
+                  << validators.not_modified << " not modified, " << validators.hash_matches
+                  << " unchanged bodies, " << validators.entries << " pages known" << std::endl;
+    }
+    if (robots_cache().enabled()) {
+        RobotsStats robots = robots_cache().get_stats();
+        std::cout << "Robots.txt: " << robots.hosts << " hosts (" << robots.fetched << " with rules, "
+                  << robots.missing << " without, " << robots.unreachable << " unreachable), "
+                  << robots.disallowed << " URLs disallowed" << std::endl;
+    }
+    ArchiveMode archive_mode = response_archive().mode();
+    if (archive_mode != ArchiveMode::Off) {
+        ResponseArchiveStats archive = http_archive_stats();
+        if (archive_mode == ArchiveMode::Record) {
+            std::cout << "Archive: " << archive.recorded << " responses recorded (" << archive.bytes << " bytes)" << std::endl;
+        } else {
+            std::cout << "Archive: " << archive.replayed << " responses replayed, " << archive.replay_misses
+                      << " not recorded" << std::endl;
+        }
+    }
+}
+
+// Switch fetches to recording or replaying if the options ask for it
+static void open_response_archive(const CrawlOptions& options) {
+    if (!options.replay_file.empty()) {
+        if (response_archive().start_replay(options.replay_file,
+                                            std::chrono::milliseconds(options.replay_latency_ms))) {
+            std::cout << "Replaying " << http_archive_stats().entries << " responses from " << options.replay_file;
+            if (options.replay_latency_ms > 0) {
+                std::cout << " with " << options.replay_latency_ms << " ms latency";
+            }
+            std::cout << std::endl;
+        }
+    } else if (!options.record_file.empty()) {
+        if (response_archive().start_recording(options.record_file)) {
+            std::cout << "Recording responses to " << options.record_file << std::endl;
+        }
+    }
+}
+
+// Whether robots.txt lets the crawl fetch path (or an absolute URL) from host.
+// The first lookup of a host fetches its robots.txt; its Crawl-delay then
+// slows the host down in scheduler.
+static bool robots_allow(HostScheduler& scheduler, const std::string& host, std::string_view path) {
+    bool fetched = false;
+    bool allowed = robots_cache().allowed(host, path, &fetched);
+    if (fetched) {
+        const RobotsRules& rules = robots_cache().rules(host);
+        std::cout << "robots.txt of " << host << ": " << rules.rule_count() << " rules";
+        if (rules.crawl_delay() > 0) {
+            std::cout << ", crawl delay " << rules.crawl_delay() << " s";
+        }
+        std::cout << std::endl;
+        apply_crawl_delay(scheduler, host, rules);
+    }
+    return allowed;
+}
+
+// Scheme-qualified site URL; over HTTPS every path of the host is fetched with TLS
+static std::string site_base_url(const std::string& hostname, const CrawlOptions& options) {
+    if (options.https) {
+        http_set_tls_host(hostname);
+        return "https://" + hostname;
+    }
+    return "http://" + hostname;
+}
+
+// Load the validators of an earlier crawl if the options ask for revalidation
+static void open_validator_store(const CrawlOptions& options) {
+    if (!options.validator_file.empty() && validator_store().open(options.validator_file)) {
+        std::cout << "Revalidating against " << options.validator_file << " ("
+                  << validator_store().get_stats().entries << " pages known)" << std::endl;
+    }
+}
+
+// Persist what this crawl learned for the next one
+static void save_validator_store(const CrawlOptions& options) {
+    if (!options.validator_file.empty() && validator_store().save()) {
+        std::cout << "Validators saved to " << options.validator_file << std::endl;
+    }
+}
+
+// For a numbered listing page ("...page-N.html") return the path offset pages
+// further on, or "" if the path is not one
+static std::string listing_page_path(const std::string& path, int offset) {
+    const std::string marker = "page-";
+    const std::string suffix = ".html";
+    size_t marker_pos = path.rfind(marker);
+    if (marker_pos == std::string::npos || path.length() < suffix.length() ||
+        path.compare(path.length() - suffix.length(), suffix.length(), suffix) != 0) {
+        return "";
+    }
+    size_t digits_start = marker_pos + marker.length();
+    size_t digits_end = path.length() - suffix.length();
+    if (digits_end <= digits_start) {
+        return "";
+    }
+    for (size_t i = digits_start; i < digits_end; ++i) {
+        if (!std::isdigit((unsigned char)path[i])) {
+            return "";
+        }
+    }
+    int number = std::atoi(path.substr(digits_start, digits_end - digits_start).c_str());
+    return path.substr(0, digits_start) + std::to_string(number + offset) + suffix;
+}
+
 std::vector<Book> crawl_website(const std::string& hostname, const std::string& start_path, int max_pages) {
+    return crawl_website(hostname, start_path, max_pages, CrawlOptions());
+}
+
+std::vector<Book> crawl_website(const std::string& hostname, const std::string& start_path, int max_pages,
+                                const CrawlOptions& options) {
     std::vector<Book> all_books;
     std::string current_path = start_path;
     int pages_crawled = 0;
     bool crawl_all = (max_pages <= 0);  // If max_pages is 0 or negative, crawl all available pages
     
     // Set to track book URLs to prevent duplicates
-    std::set<std::string> book_urls;
+    std::set<std::string, std::less<>> book_urls;
+    
+    // Reused for every page so parsing allocates nothing once they have grown to fit
+    std::string page_url;
+    UrlBase page_base;
+    std::vector<BookView> page_books;
+    std::string book_url;
+    std::string canonical_url;
+    std::string next_url;
+    
+    // Listing pages fetched ahead of time by the pipeline, keyed by path
+    std::map<std::string, HttpResponse> prefetched;
+    
+    // Keeps the request rate to the host within the politeness limits
+    HostScheduler scheduler(options.politeness);
     
     auto start_time = std::chrono::high_resolution_clock::now();
     
     std::cout << "Crawling started. Press any key to stop..." << std::endl;
     
-    std::string base_url = "http://" + hostname;
+    std::string base_url = site_base_url(hostname, options);
+    open_response_archive(options);
+    open_validator_store(options);
+    robots_cache().set_enabled(options.obey_robots);
+    int unchanged_pages = 0;
     
     while (!current_path.empty() && (crawl_all || pages_crawled < max_pages)) {
         // Check if a key was pressed to stop crawling
@@ -56,24 +221,84 @@ std::vector<Book> crawl_website(const std::string& hostname, const std::string&
             break;
         }
         
+        if (!robots_allow(scheduler, hostname, current_path)) {
+            std::cout << "robots.txt disallows " << current_path << ", stopping" << std::endl;
+            break;
+        }
+        
         std::cout << "Crawling page " << (pages_crawled + 1) << ": " << current_path << std::endl;
         
         // Time the HTTP request
         auto http_start = std::chrono::high_resolution_clock::now();
-        std::string response = http_get(hostname, current_path);
+        HttpResponse response;
+        bool fetched = false;
+        auto ahead = prefetched.find(current_path);
+        if (ahead != prefetched.end()) {
+            response = std::move(ahead->second);
+            prefetched.erase(ahead);
+            fetched = true;
+        } else if (options.pipeline_depth > 1) {
+            // Numbered listing pages are predictable: pipeline the next few with this one
+            std::vector<std::string> batch(1, current_path);
+            for (int k = 1; k < options.pipeline_depth && (crawl_all || pages_crawled + k < max_pages); ++k) {
+                std::string predicted = listing_page_path(current_path, k);
+                if (predicted.empty() || !robots_allow(scheduler, hostname, predicted)) {
+                    break;
+                }
+                batch.push_back(predicted);
+            }
+            std::this_thread::sleep_for(scheduler.reserve(hostname, (int)batch.size()));
+            std::vector<HttpBatchResult> results = http_get_many(hostname, batch, (size_t)options.pipeline_depth);
+            fetched = results[0].ok;
+            response = std::move(results[0].response);
+            prefetched.clear();
+            for (size_t i = 1; i < results.size(); ++i) {
+                if (results[i].ok && (results[i].response.status_code == 200 || results[i].response.unchanged)) {
+                    prefetched[results[i].resource_path] = std::move(results[i].response);
+                }
+            }
+        } else {
+            std::this_thread::sleep_for(scheduler.reserve(hostname));
+            fetched = http_fetch(hostname, current_path, response);
+        }
         auto http_end = std::chrono::high_resolution_clock::now();
         
-        if (response.empty()) {
+        if (!fetched) {
             std::cerr << "Failed to get response for " << current_path << std::endl;
             break;
         }
         
-        // Extract the HTML body from the HTTP response
-        std::string html = extract_body(response);
+        if (!response.skipped.empty()) {
+            // No body means no next link to follow
+            std::cerr << "Skipped " << current_path << ": " << response.skipped << std::endl;
+            break;
+        }
+        
+        if (response.unchanged) {
+            // Same page as last crawl: follow the remembered next link without parsing
+            std::vector<std::string> known_links;
+            validator_store().links(validator_key(hostname, current_path), known_links);
+            std::chrono::duration<double, std::milli> http_duration = http_end - http_start;
+            std::cout << "Page unchanged since last crawl, skipped parsing" << std::endl;
+            std::cout << "HTTP request took " << http_duration.count() << " ms" << std::endl;
+            std::cout << "----------------------------------------------------" << std::endl;
+            current_path = known_links.empty() ? "" : known_links[0];
+            pages_crawled++;
+            unchanged_pages++;
+            if (current_path.empty()) {
+                std::cout << "No more pages to crawl." << std::endl;
+            }
+            continue;
+        }
+        
+        // The parser already separated the HTML body from the headers
+        std::string_view html = response.body;
         
         // Time the parsing
         auto parse_start = std::chrono::high_resolution_clock::now();
-        std::vector<Book> page_books = parse_books(html, base_url + current_path);
+        page_url.assign(base_url).append(current_path);
+        page_base.assign(page_url);
+        parse_books(html, page_books);
         auto parse_end = std::chrono::high_resolution_clock::now();
         
         // Track new and duplicate books
@@ -81,12 +306,13 @@ std::vector<Book> crawl_website(const std::string& hostname, const std::string&
         int duplicate_books = 0;
         
         // Add new books to our collection, avoiding duplicates
-        for (const auto& book : page_books) {
+        for (const BookView& book : page_books) {
             // Use the canonicalized URL for deduplication
-            std::string canonical_url = canonicalize_url(book.url);
+            page_base.resolve(book.href, book_url, canonical_url);
             
             if (book_urls.find(canonical_url) == book_urls.end()) {
-                all_books.push_back(book);
+                all_books.emplace_back();
+                assign_book(book, page_base, all_books.back());
                 book_urls.insert(canonical_url);
                 new_books++;
             } else {
@@ -98,8 +324,21 @@ std::vector<Book> crawl_website(const std::string& hostname, const std::string&
         std::cout << "Added " << new_books << " new books" << std::endl;
         std::cout << "Skipped " << duplicate_books << " duplicate books" << std::endl;
         
-        // Find the next page link
-        std::string next_link = find_next_link(html);
+        // Find the next page link, resolved to a path on the site so it can be
+        // requested as is and matches the paths the pipeline predicted
+        std::string_view next_link = find_next_link_view(html);
+        next_url.clear();
+        if (!next_link.empty()) {
+            page_base.resolve(next_link, next_url);
+            if (next_url.compare(0, base_url.length(), base_url) == 0) {
+                next_url.erase(0, base_url.length());
+            }
+        }
+        if (validator_store().enabled()) {
+            validator_store().set_links(validator_key(hostname, current_path),
+                                        next_url.empty() ? std::vector<std::string>()
+                                                         : std::vector<std::string>(1, next_url));
+        }
         
         // Print timing information
         std::chrono::duration<double, std::milli> http_duration = http_end - http_start;
@@ -111,7 +350,7 @@ std::vector<Book> crawl_website(const std::string& hostname, const std::string&
         std::cout << "----------------------------------------------------" << std::endl;
         
         // Update for next iteration
-        current_path = next_link;
+        current_path = next_url;
         pages_crawled++;
         
         // If there's no next link, we've reached the end
@@ -125,193 +364,568 @@ std::vector<Book> crawl_website(const std::string& hostname, const std::string&
     
     std::cout << "\nCrawling completed:" << std::endl;
     std::cout << "Total pages crawled: " << pages_crawled << std::endl;
+    if (validator_store().enabled()) {
+        std::cout << "Pages unchanged since last crawl: " << unchanged_pages << std::endl;
+    }
     std::cout << "Total unique books found: " << all_books.size() << std::endl;
     std::cout << "Total time: " << total_duration.count() << " seconds" << std::endl;
+    print_pool_stats();
+    save_validator_store(options);
+    response_archive().stop();
     
     return all_books;
 }
 
-// Queue-based crawling
-std::vector<Book> crawl_website_queue(const std::string& hostname, const std::string& start_path, int max_pages) {
+// Bookkeeping shared by the serial and concurrent queue-based crawl loops
+struct QueueCrawlState {
+    std::string hostname;
+    std::string base_url;
     std::vector<Book> all_books;
     int pages_crawled = 0;
-    bool crawl_all = (max_pages <= 0);  // If max_pages is 0 or negative, crawl all available pages
     
-    // Queue of URLs to be processed
-    std::queue<std::string> pending_urls;
+    // URLs to be processed, handed out per host as politeness allows
+    HostScheduler pending_urls;
     
-    // Set of URLs that have been processed or are in the queue (stored in canonicalized form)
-    std::set<std::string> processed_urls;
+    // Set of URLs that have been processed or are in the queue (stored in canonicalized form,
+    // looked up by view so checking a link allocates nothing)
+    std::set<std::string, std::less<>> processed_urls;
     
     // Set of URLs that are currently being processed
     std::set<std::string> processing_urls;
     
     // Set of book URLs to prevent duplicates (stored in canonicalized form)
-    std::set<std::string> book_urls;
-    
-    // Start with the initial URL
-    std::string base_url = "http://" + hostname;
-    std::string full_start_url = base_url + start_path;
-    
-    // Add starting URL to queue
-    pending_urls.push(start_path);
+    std::set<std::string, std::less<>> book_urls;
     
-    // Also add its canonicalized form to processed set
-    std::string canonical_start = canonicalize_url(full_start_url);
-    processed_urls.insert(canonical_start);
+    // Reused for every page, so parsing one allocates nothing once they have
+    // grown to fit; only new books and new links are copied out of them
+    std::string page_url;
+    UrlBase page_base;
+    HtmlStreamParser stream_parser;
+    std::vector<BookView> page_books;
+    LinkBuffer page_links;
+    std::string book_url;
+    std::string canonical_url;
     
-    auto start_time = std::chrono::high_resolution_clock::now();
-    
-    std::cout << "Queue-based crawling started. Press any key to stop..." << std::endl;
+    // Fingerprints of the pages parsed so far, when near-duplicates are skipped
+    bool skip_near_duplicates = false;
+    NearDuplicateIndex near_duplicates;
+    SimHasher page_fingerprint;
+    std::string near_duplicate_of;
     
     // Track statistics
     int duplicate_count = 0;
     int ignored_count = 0;
     int duplicate_book_count = 0;
+    int unchanged_count = 0;
+    int skipped_count = 0;
+    int robots_count = 0;
+};
+
+// Queue the unseen links of a page, from links[first] on; returns how many were new
+static int queue_page_links(QueueCrawlState& state, const LinkBuffer& links, size_t first,
+                            int& page_duplicates, int& page_ignored) {
+    const std::string& base_url = state.base_url;
+    int new_links = 0;
     
-    while (!pending_urls.empty() && (crawl_all || pages_crawled < max_pages)) {
-        // Check if a key was pressed to stop crawling
-        if (_kbhit()) {
-            std::cout << "\nKey pressed. Stopping crawler..." << std::endl;
-            break;
-        }
-        
-        // Get the next URL from the queue
-        std::string current_path = pending_urls.front();
-        pending_urls.pop();
-        
-        // Move to processing set
-        processing_urls.insert(current_path);
-        
-        std::cout << "Crawling page " << (pages_crawled + 1) << ": " << current_path << std::endl;
+    for (size_t i = first; i < links.size(); ++i) {
+        std::string_view link = links[i];
         
-        // Time the HTTP request
-        auto http_start = std::chrono::high_resolution_clock::now();
-        std::string response = http_get(hostname, current_path);
-        auto http_end = std::chrono::high_resolution_clock::now();
-        
-        if (response.empty()) {
-            std::cerr << "Failed to get response for " << current_path << std::endl;
-            // Remove from processing, but keep in processed to avoid reprocessing
-            processing_urls.erase(current_path);
+        // First check if we should ignore this URL
+        if (should_ignore_url(link)) {
+            page_ignored++;
+            state.ignored_count++;
             continue;
         }
         
-        // Extract the HTML body from the HTTP response
-        std::string html = extract_body(response);
+        // Get canonical form for deduplication checking
+        canonicalize_url(link, state.canonical_url);
         
-        // Time the parsing
-        auto parse_start = std::chrono::high_resolution_clock::now();
-        
-        // Parse books from this page if it's a book listing page
-        int new_books = 0;
-        int page_duplicate_books = 0;
-        
-        if (is_category_page(current_path) || current_path.find("index.html") != std::string::npos || 
-            current_path.find("page-") != std::string::npos) {
+        // Check if we've already processed or queued this URL
+        if (state.processed_urls.find(state.canonical_url) == state.processed_urls.end()) {
+            // Convert to relative path for consistency
+            std::string relative_path(link);
+            if (link.compare(0, base_url.length(), base_url) == 0) {
+                relative_path.erase(0, base_url.length());
+            }
+            
+            // Mark canonical form as processed to avoid duplicates
+            state.processed_urls.insert(state.canonical_url);
             
-            std::vector<Book> page_books = parse_books(html, base_url + current_path);
+            // A page robots.txt disallows is never requested
+            std::string host = url_host(relative_path, state.hostname);
+            if (!robots_allow(state.pending_urls, host, relative_path)) {
+                state.robots_count++;
+                continue;
+            }
             
-            std::cout << "Found " << page_books.size() << " books on this page" << std::endl;
+            // Add to pending queue
+            state.pending_urls.push(host, relative_path);
+            new_links++;
+        } else {
+            // Track duplicates
+            page_duplicates++;
+            state.duplicate_count++;
+        }
+    }
+    return new_links;
+}
+
+// A page that has not changed since the last crawl: skip parsing and queue the links it had then
+static void replay_unchanged_page(QueueCrawlState& state, const std::string& current_path, double http_ms) {
+    std::vector<std::string> known_links;
+    validator_store().links(validator_key(state.hostname, current_path), known_links);
+    LinkBuffer& links = state.page_links;
+    links.clear();
+    for (const std::string& link : known_links) {
+        links.insert(link);
+    }
+    links.sort();
+    
+    int page_duplicates = 0;
+    int page_ignored = 0;
+    int new_links = queue_page_links(state, links, 0, page_duplicates, page_ignored);
+    
+    std::cout << "Page unchanged since last crawl, skipped parsing" << std::endl;
+    std::cout << "HTTP request took " << http_ms << " ms" << std::endl;
+    std::cout << "Replayed " << links.size() << " known links, " << new_links << " new to queue" << std::endl;
+    std::cout << "Pending URLs: " << state.pending_urls.size() << std::endl;
+    std::cout << "----------------------------------------------------" << std::endl;
+    
+    state.processing_urls.erase(current_path);
+    state.unchanged_count++;
+    state.pages_crawled++;
+}
+
+// A page whose body the content filter turned down: nothing to parse or follow
+static void skip_queue_page(QueueCrawlState& state, const std::string& current_path, const std::string& reason) {
+    std::cout << "Skipped " << current_path << ": " << reason << std::endl;
+    std::cout << "----------------------------------------------------" << std::endl;
+    state.processing_urls.erase(current_path);
+    state.skipped_count++;
+}
+
+// A page with the same text as one already parsed under another URL (a sort
+// order, a pagination alias): its books and links are already known
+static void skip_near_duplicate_page(QueueCrawlState& state, const std::string& current_path, double http_ms) {
+    std::cout << "Near-duplicate of " << state.near_duplicate_of << ", skipped parsing" << std::endl;
+    std::cout << "HTTP request took " << http_ms << " ms" << std::endl;
+    std::cout << "----------------------------------------------------" << std::endl;
+    state.processing_urls.erase(current_path);
+    state.pages_crawled++;
+}
+
+// Per-page tallies reported once a page has been processed
+struct PageTally {
+    size_t links = 0;
+    int new_links = 0;
+    int duplicates = 0;
+    int ignored = 0;
+    int new_books = 0;
+    int duplicate_books = 0;
+};
+
+// Book listings are only parsed on pages the URL rules class as listings
+// (by default category and numbered listing pages)
+static bool is_listing_page(const std::string& path) {
+    return is_category_page(path);
+}
+
+// Add a page's books to the collection, avoiding duplicates; only new ones are copied
+static void add_page_books(QueueCrawlState& state, const std::vector<BookView>& page_books, const UrlBase& base,
+                           PageTally& tally) {
+    for (const BookView& book : page_books) {
+        // Use the canonicalized URL for book deduplication
+        base.resolve(book.href, state.book_url, state.canonical_url);
+        
+        if (state.book_urls.find(state.canonical_url) == state.book_urls.end()) {
+            state.all_books.emplace_back();
+            assign_book(book, base, state.all_books.back());
+            state.book_urls.insert(state.canonical_url);
+            tally.new_books++;
+        } else {
+            tally.duplicate_books++;
+            state.duplicate_book_count++;
+        }
+    }
+}
+
+// Remember a parsed page's links for revalidation, print its summary and mark it done
+static void finish_queue_page(QueueCrawlState& state, const std::string& current_path,
+                              const LinkBuffer& links, const PageTally& tally,
+                              double http_ms, double parse_ms) {
+    if (validator_store().enabled()) {
+        std::vector<std::string> known_links;
+        for (size_t i = 0; i < links.size(); ++i) {
+            known_links.emplace_back(links[i]);
+        }
+        validator_store().set_links(validator_key(state.hostname, current_path), known_links);
+    }
+    
+    std::cout << "HTTP request took " << http_ms << " ms" << std::endl;
+    std::cout << "Parsing took " << parse_ms << " ms" << std::endl;
+    std::cout << "Found " << tally.links << " total links on the page" << std::endl;
+    std::cout << "Added " << tally.new_links << " new links to queue" << std::endl;
+    std::cout << "Skipped " << tally.duplicates << " duplicate URLs" << std::endl;
+    std::cout << "Ignored " << tally.ignored << " irrelevant URLs" << std::endl;
+    
+    if (tally.new_books > 0 || tally.duplicate_books > 0) {
+        std::cout << "Added " << tally.new_books << " new books" << std::endl;
+        std::cout << "Skipped " << tally.duplicate_books << " duplicate books" << std::endl;
+    }
+    
+    std::cout << "Pending URLs: " << state.pending_urls.size() << std::endl;
+    std::cout << "Processed URLs: " << state.processed_urls.size() << std::endl;
+    std::cout << "Total unique books found so far: " << state.all_books.size() << std::endl;
+    std::cout << "----------------------------------------------------" << std::endl;
+    
+    // Remove from processing set
+    state.processing_urls.erase(current_path);
+    
+    // Increment page counter
+    state.pages_crawled++;
+}
+
+// Parse one fetched page: collect its books and queue its unseen links
+static void process_queue_page(QueueCrawlState& state, const std::string& current_path,
+                               std::string_view html, double http_ms) {
+    if (state.skip_near_duplicates) {
+        state.page_fingerprint.reset();
+        state.page_fingerprint.feed(html);
+        if (state.near_duplicates.check(state.page_fingerprint.finish(), current_path, &state.near_duplicate_of)) {
+            skip_near_duplicate_page(state, current_path, http_ms);
+            return;
+        }
+    }
+    
+    PageTally tally;
+    
+    // Time the parsing
+    auto parse_start = std::chrono::high_resolution_clock::now();
+    state.page_url.assign(state.base_url).append(current_path);
+    state.page_base.assign(state.page_url);
+    const UrlBase& base = state.page_base;
+    
+    // Parse books from this page if it's a book listing page
+    if (is_listing_page(current_path)) {
+        parse_books(html, state.page_books);
+        std::cout << "Found " << state.page_books.size() << " books on this page" << std::endl;
+        add_page_books(state, state.page_books, base, tally);
+    }
+    
+    // Extract all links from this page and queue the new ones, in sorted order
+    LinkBuffer& links = state.page_links;
+    links.clear();
+    extract_all_links(html, base, links);
+    links.sort();
+    tally.links = links.size();
+    tally.new_links = queue_page_links(state, links, 0, tally.duplicates, tally.ignored);
+    
+    auto parse_end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double, std::milli> parse_duration = parse_end - parse_start;
+    
+    finish_queue_page(state, current_path, links, tally, http_ms, parse_duration.count());
+}
+
+// Fetch one page and parse it while it downloads: books are collected and new
+// links queued chunk by chunk, overlapping the parsing with the network.
+// Returns false if the fetch failed.
+static bool stream_queue_page(QueueCrawlState& state, const std::string& host, const std::string& current_path) {
+    HtmlStreamParser& parser = state.stream_parser;
+    state.page_url.assign(state.base_url).append(current_path);
+    parser.reset(state.page_url, is_listing_page(current_path));
+    PageTally tally;
+    size_t page_books = 0;
+    LinkBuffer& links = state.page_links;
+    links.clear();
+    std::chrono::duration<double, std::milli> parse_duration(0);
+    state.page_fingerprint.reset();
+    
+    auto http_start = std::chrono::high_resolution_clock::now();
+    HttpResponse response;
+    bool fetched = http_get_stream(host, current_path,
+                                   [&](const HttpResponse&, std::string_view chunk) {
+        auto parse_start = std::chrono::high_resolution_clock::now();
+        size_t known_links = links.size();
+        parser.feed(chunk, state.page_books, links);
+        if (state.skip_near_duplicates) {
+            state.page_fingerprint.feed(chunk);
+        }
+        page_books += state.page_books.size();
+        add_page_books(state, state.page_books, parser.base(), tally);
+        
+        // Queue this chunk's links right away; the rest of the page is still on its way
+        links.sort(known_links);
+        tally.new_links += queue_page_links(state, links, known_links, tally.duplicates, tally.ignored);
+        parse_duration += std::chrono::high_resolution_clock::now() - parse_start;
+        return true;
+    }, response);
+    auto http_end = std::chrono::high_resolution_clock::now();
+    
+    if (!fetched) {
+        return false;
+    }
+    
+    // Time spent parsing inside the callback is not network time
+    std::chrono::duration<double, std::milli> http_duration = http_end - http_start;
+    double http_ms = http_duration.count() - parse_duration.count();
+    if (!response.skipped.empty()) {
+        // Whatever was parsed before the cap was hit stays counted
+        skip_queue_page(state, current_path, response.skipped);
+        return true;
+    }
+    if (response.unchanged && response.body.empty()) {
+        replay_unchanged_page(state, current_path, http_ms);
+        return true;
+    }
+    
+    // The page was parsed as it arrived, so a near-duplicate can only be counted
+    if (state.skip_near_duplicates &&
+        state.near_duplicates.check(state.page_fingerprint.finish(), current_path, &state.near_duplicate_of)) {
+        std::cout << "Near-duplicate of " << state.near_duplicate_of << std::endl;
+    }
+    if (is_listing_page(current_path)) {
+        std::cout << "Found " << page_books << " books on this page" << std::endl;
+    }
+    tally.links = links.size();
+    finish_queue_page(state, current_path, links, tally, http_ms, parse_duration.count());
+    return true;
+}
+
+// Queue-based crawling
+std::vector<Book> crawl_website_queue(const std::string& hostname, const std::string& start_path, int max_pages) {
+    return crawl_website_queue(hostname, start_path, max_pages, CrawlOptions());
+}
+
+std::vector<Book> crawl_website_queue(const std::string& hostname, const std::string& start_path, int max_pages,
+                                      const CrawlOptions& options) {
+    QueueCrawlState state;
+    bool crawl_all = (max_pages <= 0);  // If max_pages is 0 or negative, crawl all available pages
+    
+    // Start with the initial URL
+    state.hostname = hostname;
+    state.base_url = site_base_url(hostname, options);
+    std::string full_start_url = state.base_url + start_path;
+    
+    state.pending_urls.set_config(options.politeness);
+    if (options.near_duplicate_bits >= 0) {
+        NearDuplicateConfig near_duplicate_config;
+        near_duplicate_config.max_distance = options.near_duplicate_bits;
+        state.near_duplicates.set_config(near_duplicate_config);
+        state.skip_near_duplicates = true;
+    }
+    
+    // Also add its canonicalized form to processed set
+    std::string canonical_start = canonicalize_url(full_start_url);
+    state.processed_urls.insert(canonical_start);
+    
+    auto start_time = std::chrono::high_resolution_clock::now();
+    
+    std::cout << "Queue-based crawling started. Press any key to stop..." << std::endl;
+    open_response_archive(options);
+    open_validator_store(options);
+    robots_cache().set_enabled(options.obey_robots);
+    
+    // Add starting URL to queue, if robots.txt allows it
+    std::string start_host = url_host(start_path, hostname);
+    if (robots_allow(state.pending_urls, start_host, start_path)) {
+        state.pending_urls.push(start_host, start_path);
+    } else {
+        std::cout << "robots.txt disallows " << start_path << ", nothing to crawl" << std::endl;
+        state.robots_count++;
+    }
+    
+    if (options.max_in_flight <= 1) {
+        size_t batch_size = (size_t)std::max(1, options.pipeline_depth);
+        while (!state.pending_urls.empty() && (crawl_all || state.pages_crawled < max_pages)) {
+            // Check if a key was pressed to stop crawling
+            if (_kbhit()) {
+                std::cout << "\nKey pressed. Stopping crawler..." << std::endl;
+                break;
+            }
             
-            // Add books to our collection, avoiding duplicates
-            for (const auto& book : page_books) {
-                // Use the canonicalized URL for book deduplication
-                std::string canonical_book_url = canonicalize_url(book.url);
+            // Get the next URL(s) from the queue; with pipelining several share one connection
+            std::vector<std::string> batch;
+            std::vector<std::string> batch_hosts;   // The host the scheduler charged for each page
+            std::string host;
+            std::string current_path;
+            HostScheduler::Clock::duration wait = HostScheduler::Clock::duration::zero();
+            while (batch.size() < batch_size && (crawl_all || state.pages_crawled + (int)batch.size() < max_pages) &&
+                   state.pending_urls.pop_ready(host, current_path, wait)) {
+                // Move to processing set
+                state.processing_urls.insert(current_path);
                 
-                if (book_urls.find(canonical_book_url) == book_urls.end()) {
-                    all_books.push_back(book);
-                    book_urls.insert(canonical_book_url);
-                    new_books++;
-                } else {
-                    page_duplicate_books++;
-                    duplicate_book_count++;
-                }
+                std::cout << "Crawling page " << (state.pages_crawled + (int)batch.size() + 1) << ": "
+                          << current_path << std::endl;
+                batch.push_back(current_path);
+                batch_hosts.push_back(host);
             }
-        }
-        
-        // Extract all links from this page
-        std::set<std::string> links = extract_all_links(html, base_url + current_path);
-        
-        // Update the queue with new links
-        int new_links = 0;
-        int page_duplicates = 0;
-        int page_ignored = 0;
-        
-        for (const auto& link : links) {
-            // First check if we should ignore this URL
-            if (should_ignore_url(link)) {
-                page_ignored++;
-                ignored_count++;
+            
+            if (batch.empty()) {
+                // Every queued host is still inside its rate limit
+                std::this_thread::sleep_for(wait);
                 continue;
             }
             
-            // Convert to relative path for consistency
-            std::string relative_path = link;
-            if (link.find(base_url) == 0) {
-                relative_path = link.substr(base_url.length());
+            // A single page can be parsed while it downloads
+            if (options.stream_parse && batch.size() == 1) {
+                if (!stream_queue_page(state, batch_hosts[0], batch[0])) {
+                    std::cerr << "Failed to get response for " << batch[0] << std::endl;
+                    state.processing_urls.erase(batch[0]);
+                }
+                continue;
+            }
+            
+            // Time the HTTP request(s); each run of pages on one host shares a connection
+            auto http_start = std::chrono::high_resolution_clock::now();
+            std::vector<HttpBatchResult> results;
+            for (size_t first = 0; first < batch.size(); ) {
+                size_t last = first + 1;
+                while (last < batch.size() && batch_hosts[last] == batch_hosts[first]) {
+                    last++;
+                }
+                if (first == 0 && last == batch.size()) {
+                    results = http_get_many(batch_hosts[first], batch, batch_size);
+                    break;
+                }
+                std::vector<std::string> run(batch.begin() + first, batch.begin() + last);
+                for (HttpBatchResult& result : http_get_many(batch_hosts[first], run, batch_size)) {
+                    results.push_back(std::move(result));
+                }
+                first = last;
             }
+            auto http_end = std::chrono::high_resolution_clock::now();
             
-            // Get canonical form for deduplication checking
-            std::string canonical_url = canonicalize_url(link);
+            // Report the batch time amortized over its pages
+            std::chrono::duration<double, std::milli> http_duration = http_end - http_start;
+            double http_ms = http_duration.count() / (double)results.size();
             
-            // Check if we've already processed or queued this URL
-            if (processed_urls.find(canonical_url) == processed_urls.end()) {
-                // Add to pending queue
-                pending_urls.push(relative_path);
-                
-                // Mark canonical form as processed to avoid duplicates
-                processed_urls.insert(canonical_url);
-                new_links++;
-            } else {
-                // Track duplicates
-                page_duplicates++;
-                duplicate_count++;
+            for (auto& result : results) {
+                if (!result.ok) {
+                    std::cerr << "Failed to get response for " << result.resource_path << std::endl;
+                    // Remove from processing, but keep in processed to avoid reprocessing
+                    state.processing_urls.erase(result.resource_path);
+                    continue;
+                }
+                if (!result.response.skipped.empty()) {
+                    skip_queue_page(state, result.resource_path, result.response.skipped);
+                    continue;
+                }
+                if (result.response.unchanged) {
+                    replay_unchanged_page(state, result.resource_path, http_ms);
+                    continue;
+                }
+                process_queue_page(state, result.resource_path, result.response.body, http_ms);
             }
         }
-        
-        auto parse_end = std::chrono::high_resolution_clock::now();
-        
-        // Print timing information
-        std::chrono::duration<double, std::milli> http_duration = http_end - http_start;
-        std::chrono::duration<double, std::milli> parse_duration = parse_end - parse_start;
-        
-        std::cout << "HTTP request took " << http_duration.count() << " ms" << std::endl;
-        std::cout << "Parsing took " << parse_duration.count() << " ms" << std::endl;
-        std::cout << "Found " << links.size() << " total links on the page" << std::endl;
-        std::cout << "Added " << new_links << " new links to queue" << std::endl;
-        std::cout << "Skipped " << page_duplicates << " duplicate URLs" << std::endl;
-        std::cout << "Ignored " << page_ignored << " irrelevant URLs" << std::endl;
-        
-        if (new_books > 0 || page_duplicate_books > 0) {
-            std::cout << "Added " << new_books << " new books" << std::endl;
-            std::cout << "Skipped " << page_duplicate_books << " duplicate books" << std::endl;
+    } else {
+        // Keep up to max_in_flight fetches outstanding and parse pages as they complete
+        FetchEngineConfig engine_config;
+        engine_config.max_in_flight = (size_t)options.max_in_flight;
+        engine_config.max_connections_per_host = (size_t)options.max_in_flight;
+        FetchEngine engine(engine_config);
+        int submitted = 0;
+        bool stopped = false;
+        std::vector<FetchResult> results;
+        
+        while (true) {
+            if (!stopped && _kbhit()) {
+                std::cout << "\nKey pressed. Stopping crawler..." << std::endl;
+                stopped = true;
+            }
+            
+            // Top up the engine with whatever the hosts' rate limits allow
+            std::string host;
+            std::string current_path;
+            HostScheduler::Clock::duration wait = HostScheduler::Clock::duration::zero();
+            while (!stopped && engine.outstanding() < (size_t)options.max_in_flight &&
+                   (crawl_all || submitted < max_pages) &&
+                   state.pending_urls.pop_ready(host, current_path, wait)) {
+                state.processing_urls.insert(current_path);
+                engine.submit(host, current_path);
+                submitted++;
+            }
+            
+            bool throttled = wait > HostScheduler::Clock::duration::zero();
+            if (engine.outstanding() == 0) {
+                if (stopped || !throttled) {
+                    break;
+                }
+                std::this_thread::sleep_for(wait);
+                continue;
+            }
+            
+            // Wake up in time to submit the next host that becomes ready
+            int timeout_ms = 100;
+            if (throttled) {
+                timeout_ms = (int)std::min<long long>(timeout_ms,
+                    std::chrono::duration_cast<std::chrono::milliseconds>(wait).count() + 1);
+            }
+            engine.poll(timeout_ms);
+            
+            results.clear();
+            engine.take_completed(results);
+            for (auto& result : results) {
+                if (!result.ok) {
+                    std::cerr << "Failed to get response for " << result.resource_path
+                              << ": " << result.error << std::endl;
+                    state.processing_urls.erase(result.resource_path);
+                    submitted--;
+                    continue;
+                }
+                if (!result.response.skipped.empty()) {
+                    skip_queue_page(state, result.resource_path, result.response.skipped);
+                    submitted--;
+                    continue;
+                }
+                std::cout << "Crawled page " << (state.pages_crawled + 1) << ": " << result.resource_path
+                          << " (" << engine.in_flight() << " in flight)" << std::endl;
+                if (result.response.unchanged) {
+                    replay_unchanged_page(state, result.resource_path, result.elapsed_ms);
+                    continue;
+                }
+                process_queue_page(state, result.resource_path, result.response.body, result.elapsed_ms);
+            }
         }
         
-        std::cout << "Pending URLs: " << pending_urls.size() << std::endl;
-        std::cout << "Processed URLs: " << processed_urls.size() << std::endl;
-        std::cout << "Total unique books found so far: " << all_books.size() << std::endl;
-        std::cout << "----------------------------------------------------" << std::endl;
-        
-        // Remove from processing set
-        processing_urls.erase(current_path);
-        
-        // Increment page counter
-        pages_crawled++;
+        FetchEngineStats engine_stats = engine.get_stats();
+        std::cout << "Fetch engine (" << engine.backend() << "): " << engine_stats.completed << " completed, "
+                  << engine_stats.failed << " failed, " << engine_stats.connections_opened << " connections opened, "
+                  << engine_stats.connections_reused << " reused" << std::endl;
     }
     
     auto end_time = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> total_duration = end_time - start_time;
     
     std::cout << "\nCrawling completed:" << std::endl;
-    std::cout << "Total pages crawled: " << pages_crawled << std::endl;
-    std::cout << "Total unique URLs found: " << processed_urls.size() << std::endl;
-    std::cout << "Total duplicate URLs skipped: " << duplicate_count << std::endl;
-    std::cout << "Total irrelevant URLs ignored: " << ignored_count << std::endl;
-    std::cout << "Total unique books found: " << all_books.size() << std::endl;
-    std::cout << "Total duplicate books skipped: " << duplicate_book_count << std::endl;
-    std::cout << "Queue size at completion: " << pending_urls.size() << std::endl;
+    std::cout << "Total pages crawled: " << state.pages_crawled << std::endl;
+    if (validator_store().enabled()) {
+        std::cout << "Pages unchanged since last crawl: " << state.unchanged_count << std::endl;
+    }
+    if (state.skipped_count > 0) {
+        std::cout << "Pages skipped by the content filter: " << state.skipped_count << std::endl;
+    }
+    if (state.skip_near_duplicates) {
+        NearDuplicateStats near_duplicates = state.near_duplicates.get_stats();
+        double ratio = near_duplicates.pages > 0 ? 100.0 * near_duplicates.near_duplicates / near_duplicates.pages : 0;
+        std::cout << "Near-duplicate pages: " << near_duplicates.near_duplicates << " of "
+                  << near_duplicates.pages << " fingerprinted (" << ratio << "%)" << std::endl;
+    }
+    std::cout << "Total unique URLs found: " << state.processed_urls.size() << std::endl;
+    std::cout << "Total duplicate URLs skipped: " << state.duplicate_count << std::endl;
+    std::cout << "Total irrelevant URLs ignored: " << state.ignored_count << std::endl;
+    if (state.robots_count > 0) {
+        std::cout << "Total URLs disallowed by robots.txt: " << state.robots_count << std::endl;
+    }
+    std::cout << "Total unique books found: " << state.all_books.size() << std::endl;
+    std::cout << "Total duplicate books skipped: " << state.duplicate_book_count << std::endl;
+    std::cout << "Queue size at completion: " << state.pending_urls.size() << std::endl;
+    HostSchedulerStats politeness = state.pending_urls.get_stats();
+    std::cout << "Politeness: " << politeness.dispatched << " URLs dispatched across " << politeness.hosts
+              << " hosts, " << politeness.throttled << " waits for a rate limit" << std::endl;
     std::cout << "Total time: " << total_duration.count() << " seconds" << std::endl;
+    print_pool_stats();
+    save_validator_store(options);
+    response_archive().stop();
     
-    return all_books;
-} 
\ No newline at end of file
+    return state.all_books;
+}
\ No newline at end of file
@@ -0,0 +1,259 @@
+#ifdef _MSC_VER
+// Additional includes and defines for Visual Studio
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "../include/DnsCache.h"
+#include "../include/compat.h"
+#include <iostream>
+
+DnsCache::DnsCache(const DnsCacheConfig& cfg) : stopping(false), config(cfg) {}
+
+DnsCache::~DnsCache() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    refresh_wanted.notify_all();
+    if (refresher.joinable()) {
+        refresher.join();
+    }
+}
+
+// Copy the addrinfo list into plain storage
+static void collect_addresses(const struct addrinfo* list, std::vector<ResolvedAddress>& addresses) {
+    for (const struct addrinfo* ai = list; ai != nullptr; ai = ai->ai_next) {
+        if (ai->ai_addrlen > sizeof(struct sockaddr_storage)) {
+            continue;
+        }
+        ResolvedAddress resolved;
+        ZeroMemory(&resolved.address, sizeof(resolved.address));
+        memcpy(&resolved.address, ai->ai_addr, ai->ai_addrlen);
+        resolved.length = (socklen_t)ai->ai_addrlen;
+        addresses.push_back(resolved);
+    }
+}
+
+// Reorder so the address families alternate, starting with the family the
+// resolver preferred (RFC 8305 section 4). A connection race then reaches the
+// other family after one attempt delay instead of after every preferred address.
+static void interleave_address_families(std::vector<ResolvedAddress>& addresses) {
+    if (addresses.size() < 3) {
+        return;
+    }
+    int preferred = addresses.front().address.ss_family;
+    std::vector<ResolvedAddress> first;
+    std::vector<ResolvedAddress> other;
+    for (const ResolvedAddress& resolved : addresses) {
+        (resolved.address.ss_family == preferred ? first : other).push_back(resolved);
+    }
+    addresses.clear();
+    for (size_t i = 0; i < first.size() || i < other.size(); ++i) {
+        if (i < first.size()) {
+            addresses.push_back(first[i]);
+        }
+        if (i < other.size()) {
+            addresses.push_back(other[i]);
+        }
+    }
+}
+
+bool DnsCache::lookup(const std::string& hostname, std::vector<ResolvedAddress>& addresses) {
+    addresses.clear();
+
+    struct addrinfo hints;
+    struct addrinfo* addr_info = nullptr;
+    ZeroMemory(&hints, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;  // Both IPv6 and IPv4; the connector races them
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    // First try using getaddrinfo if available
+    #ifdef _WIN32
+    // Check if getaddrinfo is available (it is in most modern Windows systems)
+    HMODULE ws2_32 = GetModuleHandle("ws2_32.dll");
+    if (ws2_32 != NULL) {
+        typedef int (WSAAPI *PGETADDRINFO)(const char*, const char*, const struct addrinfo*, struct addrinfo**);
+        typedef void (WSAAPI *PFREEADDRINFO)(struct addrinfo*);
+
+        PGETADDRINFO pGetAddrInfo = (PGETADDRINFO)GetProcAddress(ws2_32, "getaddrinfo");
+        PFREEADDRINFO pFreeAddrInfo = (PFREEADDRINFO)GetProcAddress(ws2_32, "freeaddrinfo");
+
+        if (pGetAddrInfo != NULL && pFreeAddrInfo != NULL) {
+            if ((*pGetAddrInfo)(hostname.c_str(), NULL, &hints, &addr_info) == 0 && addr_info != nullptr) {
+                collect_addresses(addr_info, addresses);
+                (*pFreeAddrInfo)(addr_info);
+            }
+        }
+    }
+    #else
+    if (getaddrinfo(hostname.c_str(), NULL, &hints, &addr_info) == 0 && addr_info != nullptr) {
+        collect_addresses(addr_info, addresses);
+        freeaddrinfo(addr_info);
+    }
+    #endif
+    interleave_address_families(addresses);
+
+    // Fallback to older method if getaddrinfo failed or is not available
+    if (addresses.empty()) {
+        struct sockaddr_in server_addr;
+        ZeroMemory(&server_addr, sizeof(server_addr));
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_addr.s_addr = inet_addr(hostname.c_str());
+
+        // If hostname is not a valid IP address, try to resolve it
+        if (server_addr.sin_addr.s_addr == INADDR_NONE) {
+            // Use gethostbyname (older but widely available)
+            struct hostent* host = gethostbyname(hostname.c_str());
+            if (host == nullptr || host->h_addr_list[0] == nullptr) {
+                return false;
+            }
+            memcpy(&server_addr.sin_addr, host->h_addr_list[0], host->h_length);
+        }
+
+        ResolvedAddress resolved;
+        ZeroMemory(&resolved.address, sizeof(resolved.address));
+        memcpy(&resolved.address, &server_addr, sizeof(server_addr));
+        resolved.length = sizeof(server_addr);
+        addresses.push_back(resolved);
+    }
+
+    return !addresses.empty();
+}
+
+void DnsCache::store(const std::string& hostname, std::vector<ResolvedAddress> addresses) {
+    auto now = std::chrono::steady_clock::now();
+    Entry& entry = entries[hostname];
+    entry.expires = now + (addresses.empty() ? config.negative_ttl : config.positive_ttl);
+    entry.inserted = now;
+    entry.addresses = std::move(addresses);
+    entry.refreshing = false;
+
+    // Over capacity: drop the entry that has been cached longest
+    while (entries.size() > config.max_entries) {
+        auto oldest = entries.begin();
+        for (auto it = entries.begin(); it != entries.end(); ++it) {
+            if (it->second.inserted < oldest->second.inserted) {
+                oldest = it;
+            }
+        }
+        entries.erase(oldest);
+    }
+}
+
+bool DnsCache::resolve(const std::string& hostname, int port, std::vector<ResolvedAddress>& addresses) {
+    addresses.clear();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = entries.find(hostname);
+        auto now = std::chrono::steady_clock::now();
+        if (it != entries.end() && now < it->second.expires) {
+            Entry& entry = it->second;
+            if (entry.addresses.empty()) {
+                stats.negative_hits++;
+                return false;
+            }
+            stats.hits++;
+            addresses = entry.addresses;
+
+            // Refresh ahead of expiry so callers keep hitting the cache
+            if (!entry.refreshing && entry.expires - now <= config.refresh_ahead) {
+                entry.refreshing = true;
+                schedule_refresh(hostname);
+            }
+        } else {
+            stats.misses++;
+        }
+    }
+
+    if (addresses.empty()) {
+        // Resolve outside the lock so one slow name does not stall the others
+        std::vector<ResolvedAddress> resolved;
+        bool ok = lookup(hostname, resolved);
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!ok) {
+            stats.failures++;
+            std::cerr << "Failed to resolve hostname: " << hostname << std::endl;
+        }
+        store(hostname, resolved);
+        addresses = std::move(resolved);
+        if (!ok) {
+            return false;
+        }
+    }
+
+    // Cached addresses are port-agnostic
+    for (ResolvedAddress& resolved : addresses) {
+        if (resolved.address.ss_family == AF_INET) {
+            ((struct sockaddr_in*)&resolved.address)->sin_port = htons((unsigned short)port);
+        } else if (resolved.address.ss_family == AF_INET6) {
+            ((struct sockaddr_in6*)&resolved.address)->sin6_port = htons((unsigned short)port);
+        }
+    }
+    return true;
+}
+
+// Called with mtx held
+void DnsCache::schedule_refresh(const std::string& hostname) {
+    refresh_queue.push_back(hostname);
+    if (!refresher.joinable()) {
+        refresher = std::thread(&DnsCache::refresh_loop, this);
+    }
+    refresh_wanted.notify_one();
+}
+
+void DnsCache::refresh_loop() {
+    std::unique_lock<std::mutex> lock(mtx);
+    while (true) {
+        refresh_wanted.wait(lock, [this] { return stopping || !refresh_queue.empty(); });
+        if (stopping) {
+            return;
+        }
+        std::string hostname = refresh_queue.front();
+        refresh_queue.pop_front();
+
+        lock.unlock();
+        std::vector<ResolvedAddress> resolved;
+        bool ok = lookup(hostname, resolved);
+        lock.lock();
+
+        stats.refreshes++;
+        if (ok) {
+            store(hostname, std::move(resolved));
+        } else {
+            // Keep serving the old addresses until they expire (still marked as
+            // refreshing, so hits do not requeue it); the next miss retries
+            stats.failures++;
+        }
+    }
+}
+
+void DnsCache::clear() {
+    std::lock_guard<std::mutex> lock(mtx);
+    entries.clear();
+}
+
+void DnsCache::set_config(const DnsCacheConfig& cfg) {
+    std::lock_guard<std::mutex> lock(mtx);
+    config = cfg;
+}
+
+DnsCacheConfig DnsCache::get_config() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return config;
+}
+
+DnsCacheStats DnsCache::get_stats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    DnsCacheStats result = stats;
+    result.entries = entries.size();
+    return result;
+}
+
+DnsCache& dns_cache() {
+    static DnsCache cache;
+    return cache;
+}
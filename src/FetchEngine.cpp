@@ -0,0 +1,983 @@
+#include "../include/FetchEngine.h"
+#include "../include/HttpClient.h"
+#include "../include/TcpConnect.h"
+#include "../include/TlsClient.h"
+#include "../include/config.h"
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <fcntl.h>
+#endif
+
+#ifdef WEBSCRAPER_HAVE_IO_URING
+#include <linux/io_uring.h>
+#endif
+
+// Events handled per epoll_wait() call
+const int FETCH_MAX_EVENTS = 128;
+
+// What a ring completion belongs to, in the low bits of its user_data (0 is
+// left for cancellations, whose results are not needed)
+enum RingOperation { RING_CONNECT = 1, RING_SEND = 2, RING_RECEIVE = 3, RING_POLL = 4 };
+
+struct FetchEngine::Request {
+    unsigned long long id = 0;
+    std::string hostname;
+    std::string resource_path;
+    Callback callback;
+    std::chrono::steady_clock::time_point submitted;
+    std::chrono::steady_clock::time_point ready;   // Replay mode: when the archived answer is due
+    int attempts = 0;
+    size_t connect_failures = 0;   // Addresses of the host that already failed to connect for it
+};
+
+struct FetchEngine::Connection {
+    enum class State { Connecting, Handshaking, Sending, Receiving, Idle };
+
+    int fd = -1;
+    HostState* host = nullptr;
+    State state = State::Connecting;
+    std::unique_ptr<TlsConnection> tls;   // HTTPS hosts: the session over fd
+    std::string out;               // Serialized request being written
+    size_t out_offset = 0;
+    bool reused = false;           // Carried an earlier response
+    bool received_any = false;     // Bytes of the current response have arrived
+    bool reusable = true;          // Cleared if the server sent bytes past the response
+    unsigned int interest = 0;     // Current epoll event mask (io_uring: the armed poll's)
+    unsigned int serial = 0;       // io_uring: tags this socket's completions
+    bool send_pending = false;     // io_uring: the kernel is still sending from out
+    bool receive_armed = false;    // io_uring: a receive is waiting for data
+    ResolvedAddress address;       // Where the socket connects to
+    HttpResponseParser parser;
+    PooledBuffer buffer;           // Receives the current response in place
+    std::unique_ptr<Request> request;
+    std::chrono::steady_clock::time_point deadline;
+    std::chrono::steady_clock::time_point connect_deadline;   // Give up on this address after it
+    std::chrono::steady_clock::time_point last_used;
+};
+
+struct FetchEngine::HostState {
+    std::string hostname;
+    bool tls = false;           // Connections speak HTTPS (a host's http and https URLs get separate states)
+    int port = 80;
+    std::deque<std::unique_ptr<Request>> queue;
+    std::vector<Connection*> idle;
+    size_t open = 0;
+    size_t address_index = 0;   // Address new sockets go to; moves on when one fails to connect
+    size_t address_count = 0;   // Addresses the host resolved to last time
+};
+
+unsigned long long FetchEngine::submit(const std::string& hostname, const std::string& resource_path,
+                                       Callback callback) {
+    std::unique_ptr<Request> request(new Request());
+    request->id = next_id++;
+    request->hostname = hostname;
+    request->resource_path = resource_path;
+    request->callback = callback;
+    request->submitted = std::chrono::steady_clock::now();
+
+    bool tls = http_uses_tls(hostname, resource_path);
+    std::unique_ptr<HostState>& host = hosts[tls ? "https://" + hostname : hostname];
+    if (!host) {
+        host.reset(new HostState());
+        host->tls = tls;
+        http_endpoint(hostname, tls, host->hostname, host->port);
+    }
+
+    unsigned long long id = request->id;
+    host->queue.push_back(std::move(request));
+    queued_count++;
+    stats.submitted++;
+    return id;
+}
+
+size_t FetchEngine::take_completed(std::vector<FetchResult>& out) {
+    size_t count = completed.size();
+    while (!completed.empty()) {
+        out.push_back(std::move(completed.front()));
+        completed.pop_front();
+    }
+    return count;
+}
+
+void FetchEngine::run_until_idle() {
+    while (outstanding() > 0) {
+        poll(100);
+    }
+}
+
+void FetchEngine::deliver(std::unique_ptr<Request> request, bool ok, const std::string& error,
+                          HttpResponse* response) {
+    FetchResult result;
+    result.id = request->id;
+    result.hostname = request->hostname;
+    result.resource_path = request->resource_path;
+    result.ok = ok;
+    result.error = error;
+    if (response != nullptr) {
+        result.response = std::move(*response);
+    }
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - request->submitted;
+    result.elapsed_ms = elapsed.count();
+
+    if (ok) {
+        stats.completed++;
+    } else {
+        stats.failed++;
+    }
+    finished_in_poll++;
+
+    if (request->callback) {
+        request->callback(result);
+    } else {
+        completed.push_back(std::move(result));
+    }
+}
+
+FetchEngineStats FetchEngine::get_stats() const {
+    FetchEngineStats current = stats;
+    if (ring) {
+        IoUringStats ring_stats = ring->get_stats();
+        current.ring_operations = ring_stats.submitted;
+        current.ring_enters = ring_stats.enters;
+    }
+    return current;
+}
+
+const char* FetchEngine::backend() const {
+    if (ring) {
+        return "io_uring";
+    }
+    return poll_fd >= 0 ? "epoll" : "blocking";
+}
+
+#ifdef __linux__
+
+FetchEngine::FetchEngine(const FetchEngineConfig& cfg)
+    : config(cfg), poll_fd(-1), next_id(1), queued_count(0), active_count(0), finished_in_poll(0),
+      next_serial(1), multishot_receive(true) {
+    if (config.use_io_uring && IoUring::available()) {
+        std::string error;
+        ring.reset(new IoUring());
+        if (!ring->init(config.ring_entries, config.ring_buffers, config.ring_buffer_size, &error)) {
+            std::cerr << error << ", using epoll instead" << std::endl;
+            ring.reset();
+        }
+    }
+    if (ring) {
+        return;
+    }
+    poll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (poll_fd < 0) {
+        std::cerr << "epoll_create1 failed, falling back to blocking fetches" << std::endl;
+    }
+}
+
+FetchEngine::~FetchEngine() {
+    // Tear the ring down first so the kernel lets go of the sockets and send buffers
+    ring.reset();
+    for (auto& pair : connections) {
+        close(pair.first);
+    }
+    connections.clear();
+    if (poll_fd >= 0) {
+        close(poll_fd);
+    }
+}
+
+void FetchEngine::update_interest(Connection* conn, unsigned int events) {
+    if (ring) {
+        // Plain sockets are driven by their own ring operations; HTTPS ones
+        // wait for readiness so OpenSSL can do the I/O
+        if (conn->tls) {
+            ring_poll(conn, events);
+        }
+        return;
+    }
+    if (conn->interest == events) {
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.fd = conn->fd;
+    epoll_ctl(poll_fd, conn->interest == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, conn->fd, &ev);
+    conn->interest = events;
+}
+
+FetchEngine::Connection* FetchEngine::open_connection(HostState& host) {
+    // Served from the shared cache; only a cold or expired host blocks the loop
+    std::vector<ResolvedAddress> addresses;
+    if (!dns_cache().resolve(host.hostname, host.port, addresses)) {
+        return nullptr;
+    }
+    // Stick with the address that last worked; the connector's ordering
+    // alternates IPv6 and IPv4, so a failover also tries the other family
+    host.address_count = addresses.size();
+    const ResolvedAddress& resolved = addresses[host.address_index % addresses.size()];
+
+    // Ring sockets stay blocking: the kernel never blocks a ring operation,
+    // and would hand EAGAIN back for a non-blocking socket on older kernels
+    int fd = socket(resolved.address.ss_family, SOCK_STREAM | SOCK_CLOEXEC | (ring ? 0 : SOCK_NONBLOCK), IPPROTO_TCP);
+    if (fd < 0) {
+        return nullptr;
+    }
+
+    if (!ring) {
+        int result = connect(fd, (const struct sockaddr*)&resolved.address, resolved.length);
+        if (result < 0 && errno != EINPROGRESS) {
+            close(fd);
+            return nullptr;
+        }
+    }
+
+    std::unique_ptr<Connection> conn(new Connection());
+    conn->fd = fd;
+    conn->serial = next_serial++;
+    conn->address = resolved;
+    conn->host = &host;
+    conn->state = Connection::State::Connecting;
+    std::chrono::milliseconds connect_timeout = tcp_connector().get_config().connect_timeout;
+    conn->connect_deadline = connect_timeout.count() > 0
+        ? std::chrono::steady_clock::now() + connect_timeout
+        : std::chrono::steady_clock::time_point::max();
+    Connection* raw = conn.get();
+    connections[fd] = std::move(conn);
+    host.open++;
+    stats.connections_opened++;
+    if (ring) {
+        ring_connect(raw);
+    }
+    return raw;
+}
+
+bool FetchEngine::start_request(HostState& host, std::unique_ptr<Request>& request) {
+    Connection* conn = nullptr;
+    auto now = std::chrono::steady_clock::now();
+
+    // Prefer a kept-alive socket
+    while (!host.idle.empty() && conn == nullptr) {
+        Connection* candidate = host.idle.back();
+        host.idle.pop_back();
+        if (now - candidate->last_used < config.idle_timeout) {
+            conn = candidate;
+            conn->reused = true;
+            stats.connections_reused++;
+        } else {
+            close_connection(candidate);
+        }
+    }
+
+    if (conn == nullptr) {
+        if (host.open >= config.max_connections_per_host) {
+            return false;
+        }
+        conn = open_connection(host);
+        if (conn == nullptr) {
+            queued_count--;
+            deliver(std::move(request), false, "Failed to connect to " + host.hostname);
+            return true;
+        }
+        conn->reused = false;
+    }
+
+    conn->out = build_get_request(request->hostname, request->resource_path);
+    conn->out_offset = 0;
+    conn->received_any = false;
+    conn->reusable = true;
+    conn->parser.reset();
+    conn->parser.set_filter(http_body_filter());
+    conn->buffer = PooledBuffer::acquire();
+    conn->deadline = now + config.request_timeout;
+    conn->request = std::move(request);
+    queued_count--;
+    active_count++;
+
+    if (conn->state == Connection::State::Idle) {
+        // Connected already: write straight away
+        conn->state = Connection::State::Sending;
+        if (ring && !conn->tls && !conn->receive_armed) {
+            ring_receive(conn);
+        }
+        on_writable(conn);
+    } else {
+        update_interest(conn, EPOLLOUT);
+    }
+    return true;
+}
+
+void FetchEngine::dispatch() {
+    for (auto& pair : hosts) {
+        HostState& host = *pair.second;
+        while (!host.queue.empty() && active_count < config.max_in_flight) {
+            std::unique_ptr<Request> request = std::move(host.queue.front());
+            host.queue.pop_front();
+            if (!start_request(host, request)) {
+                // Host is at its connection cap; try again when a socket frees up
+                host.queue.push_front(std::move(request));
+                break;
+            }
+        }
+    }
+}
+
+void FetchEngine::on_writable(Connection* conn) {
+    if (conn->state == Connection::State::Connecting) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+            connect_failed(conn, "Connect failed: " + std::string(strerror(error)));
+            return;
+        }
+        if (conn->host->tls) {
+            std::string tls_error;
+            conn->tls = tls_context().wrap(conn->fd, conn->host->hostname, conn->host->port, &tls_error);
+            if (!conn->tls) {
+                finish(conn, false, tls_error);
+                return;
+            }
+            conn->state = Connection::State::Handshaking;
+            on_handshake(conn);
+            return;
+        }
+        conn->state = Connection::State::Sending;
+    }
+
+    if (ring && !conn->tls) {
+        ring_send(conn);
+        return;
+    }
+
+    while (conn->out_offset < conn->out.length()) {
+        if (conn->tls) {
+            size_t written = 0;
+            TlsResult result = conn->tls->write(conn->out.data() + conn->out_offset,
+                                                conn->out.length() - conn->out_offset, written);
+            if (result == TlsResult::Ok) {
+                conn->out_offset += written;
+            } else if (result == TlsResult::WantRead || result == TlsResult::WantWrite) {
+                update_interest(conn, result == TlsResult::WantRead ? EPOLLIN : EPOLLOUT);
+                return;
+            } else {
+                // Copied: finishing may close the connection that owns the message
+                std::string error = result == TlsResult::Error ? conn->tls->error() : "Error sending request";
+                finish(conn, false, error);
+                return;
+            }
+            continue;
+        }
+        ssize_t sent = send(conn->fd, conn->out.data() + conn->out_offset,
+                            conn->out.length() - conn->out_offset, MSG_NOSIGNAL);
+        if (sent > 0) {
+            conn->out_offset += (size_t)sent;
+        } else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            update_interest(conn, EPOLLOUT);
+            return;
+        } else {
+            finish(conn, false, "Error sending request");
+            return;
+        }
+    }
+
+    conn->state = Connection::State::Receiving;
+    update_interest(conn, EPOLLIN | EPOLLRDHUP);
+}
+
+// Advance the TLS handshake, waiting on whichever readiness it asks for
+void FetchEngine::on_handshake(Connection* conn) {
+    TlsResult result = conn->tls->handshake();
+    if (result == TlsResult::WantRead) {
+        update_interest(conn, EPOLLIN);
+        return;
+    }
+    if (result == TlsResult::WantWrite) {
+        update_interest(conn, EPOLLOUT);
+        return;
+    }
+    if (result != TlsResult::Ok) {
+        std::string error = conn->tls->error();
+        finish(conn, false, error);
+        return;
+    }
+    conn->state = Connection::State::Sending;
+    on_writable(conn);
+}
+
+void FetchEngine::on_readable(Connection* conn) {
+    RecvBuffer& buffer = *conn->buffer;
+
+    while (true) {
+        size_t wanted = conn->parser.next_read_size();
+        ssize_t received = 0;
+        if (conn->tls) {
+            // Loop until TLS wants the socket again: decrypted bytes it still
+            // holds would not wake epoll
+            size_t decrypted = 0;
+            TlsResult result = conn->tls->read(buffer.prepare(wanted), wanted, decrypted);
+            if (result == TlsResult::WantRead || result == TlsResult::WantWrite) {
+                update_interest(conn, result == TlsResult::WantRead ? (EPOLLIN | EPOLLRDHUP) : EPOLLOUT);
+                return;
+            }
+            if (result == TlsResult::Error) {
+                std::string error = conn->tls->error();
+                finish(conn, false, error);
+                return;
+            }
+            received = result == TlsResult::Closed ? 0 : (ssize_t)decrypted;
+        } else {
+            received = recv(conn->fd, buffer.prepare(wanted), wanted, 0);
+        }
+        if (received > 0) {
+            if (!on_received(conn, (size_t)received)) {
+                return;
+            }
+        } else if (received == 0) {
+            on_closed(conn);
+            return;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            return;
+        } else {
+            finish(conn, false, "Error receiving data: " + std::string(strerror(errno)));
+            return;
+        }
+    }
+}
+
+// Count a chunk of response bytes written at the buffer's prepare() position;
+// false once the response is finished (the connection may be gone by then)
+bool FetchEngine::on_received(Connection* conn, size_t received) {
+    RecvBuffer& buffer = *conn->buffer;
+    conn->received_any = true;
+    buffer.commit(received);
+    conn->parser.advance(buffer);
+    if (conn->parser.failed()) {
+        finish(conn, false, "Invalid HTTP response: " + conn->parser.error());
+        return false;
+    }
+    if (conn->parser.complete()) {
+        if (conn->parser.message_end() < buffer.size()) {
+            conn->reusable = false;
+        }
+        finish(conn, true, "");
+        return false;
+    }
+    return true;
+}
+
+// The server closed the connection mid-request
+void FetchEngine::on_closed(Connection* conn) {
+    conn->parser.finish_on_close();
+    conn->reusable = false;
+    finish(conn, conn->parser.complete(), conn->parser.complete() ? "" : "Connection closed early");
+}
+
+void FetchEngine::finish(Connection* conn, bool ok, const std::string& error) {
+    std::unique_ptr<Request> request = std::move(conn->request);
+    HostState& host = *conn->host;
+    active_count--;
+
+    // A kept-alive socket the server dropped before answering: retry once on a new one
+    if (!ok && conn->reused && !conn->received_any && request->attempts == 0) {
+        request->attempts++;
+        close_connection(conn);
+        host.queue.push_front(std::move(request));
+        queued_count++;
+        return;
+    }
+
+    if (ok && conn->reusable && conn->parser.response().keep_alive) {
+        HttpResponse response = std::move(conn->parser.finalize(std::move(conn->buffer)));
+        http_response_received(request->hostname, request->resource_path, response);
+        conn->state = Connection::State::Idle;
+        conn->last_used = std::chrono::steady_clock::now();
+        update_interest(conn, EPOLLIN | EPOLLRDHUP);
+        host.idle.push_back(conn);
+        deliver(std::move(request), true, "", &response);
+        return;
+    }
+
+    HttpResponse response = std::move(conn->parser.finalize(std::move(conn->buffer)));
+    if (ok) {
+        http_response_received(request->hostname, request->resource_path, response);
+    }
+    close_connection(conn);
+    deliver(std::move(request), ok, error, ok ? &response : nullptr);
+}
+
+void FetchEngine::connect_failed(Connection* conn, const std::string& error) {
+    HostState& host = *conn->host;
+    host.address_index++;
+
+    // Untried addresses left: requeue the request so it goes to the next one
+    if (conn->request->connect_failures + 1 < host.address_count) {
+        std::unique_ptr<Request> request = std::move(conn->request);
+        request->connect_failures++;
+        active_count--;
+        close_connection(conn);
+        host.queue.push_front(std::move(request));
+        queued_count++;
+        stats.connect_failovers++;
+        return;
+    }
+    finish(conn, false, error);
+}
+
+void FetchEngine::close_connection(Connection* conn) {
+    HostState& host = *conn->host;
+    host.idle.erase(std::remove(host.idle.begin(), host.idle.end(), conn), host.idle.end());
+    if (host.open > 0) {
+        host.open--;
+    }
+    if (conn->tls) {
+        conn->tls->shutdown();
+    }
+    int fd = conn->fd;
+    if (ring) {
+        ring_cancel(conn);
+    } else {
+        epoll_ctl(poll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+    close(fd);
+    connections.erase(fd);
+}
+
+void FetchEngine::handle_event(Connection* conn, unsigned int events) {
+    if (conn->state == Connection::State::Idle) {
+        // Idle sockets should be silent; anything here means close or junk
+        close_connection(conn);
+        return;
+    }
+
+    if (conn->state == Connection::State::Handshaking) {
+        on_handshake(conn);
+        return;
+    }
+
+    // A TLS connection may be waiting on the other direction (e.g. a write that
+    // needs a record read first), so any event lets it retry
+    if (conn->state == Connection::State::Connecting || conn->state == Connection::State::Sending) {
+        if ((events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) || conn->tls) {
+            on_writable(conn);
+        }
+        return;
+    }
+
+    if ((events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP)) || conn->tls) {
+        on_readable(conn);
+    }
+}
+
+void FetchEngine::expire(std::chrono::steady_clock::time_point now) {
+    std::vector<Connection*> timed_out;
+    std::vector<Connection*> unreachable;
+    std::vector<Connection*> stale;
+    for (auto& pair : connections) {
+        Connection* conn = pair.second.get();
+        if (conn->state == Connection::State::Idle) {
+            if (now - conn->last_used >= config.idle_timeout) {
+                stale.push_back(conn);
+            }
+        } else if (conn->request && now >= conn->deadline) {
+            timed_out.push_back(conn);
+        } else if (conn->state == Connection::State::Connecting && now >= conn->connect_deadline) {
+            unreachable.push_back(conn);
+        }
+    }
+
+    for (Connection* conn : stale) {
+        close_connection(conn);
+    }
+    for (Connection* conn : unreachable) {
+        connect_failed(conn, "Connect timed out");
+    }
+    for (Connection* conn : timed_out) {
+        stats.timeouts++;
+        conn->reused = false;  // Do not retry a request that simply took too long
+        finish(conn, false, "Request timed out");
+    }
+}
+
+// Never sleep past the nearest request or connect deadline
+int FetchEngine::wait_timeout(int timeout_ms) const {
+    auto now = std::chrono::steady_clock::now();
+    for (auto& pair : connections) {
+        Connection* conn = pair.second.get();
+        if (conn->request) {
+            auto deadline = conn->deadline;
+            if (conn->state == Connection::State::Connecting) {
+                deadline = std::min(deadline, conn->connect_deadline);
+            }
+            auto until = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count();
+            timeout_ms = (int)std::max<long long>(0, std::min<long long>(timeout_ms, until + 1));
+        }
+    }
+    return timeout_ms;
+}
+
+size_t FetchEngine::poll(int timeout_ms) {
+    if (response_archive().replaying()) {
+        return run_replay(timeout_ms);
+    }
+    if (ring) {
+        return poll_ring(timeout_ms);
+    }
+    if (poll_fd < 0) {
+        return run_blocking_fallback();
+    }
+
+    finished_in_poll = 0;
+    dispatch();
+
+    if (active_count == 0) {
+        return finished_in_poll;
+    }
+
+    struct epoll_event events[FETCH_MAX_EVENTS];
+    int ready = epoll_wait(poll_fd, events, FETCH_MAX_EVENTS, wait_timeout(timeout_ms));
+    for (int i = 0; i < ready; ++i) {
+        auto it = connections.find(events[i].data.fd);
+        if (it != connections.end()) {
+            handle_event(it->second.get(), events[i].events);
+        }
+    }
+
+    expire(std::chrono::steady_clock::now());
+    dispatch();
+    return finished_in_poll;
+}
+
+#ifdef WEBSCRAPER_HAVE_IO_URING
+
+// Completion tag: the socket's fd and serial plus the operation
+static unsigned long long ring_tag(int fd, unsigned int serial, RingOperation operation) {
+    return ((unsigned long long)(unsigned)fd << 32) | ((unsigned long long)(serial & 0x1fffffff) << 3) |
+           (unsigned long long)operation;
+}
+
+size_t FetchEngine::poll_ring(int timeout_ms) {
+    finished_in_poll = 0;
+    dispatch();
+
+    if (active_count == 0) {
+        return finished_in_poll;
+    }
+
+    // One syscall submits everything queued since the last poll and waits
+    ring->wait(wait_timeout(timeout_ms));
+    unsigned long long user_data = 0;
+    int result = 0;
+    unsigned int flags = 0;
+    while (ring->next_completion(user_data, result, flags)) {
+        on_completion(user_data, result, flags);
+    }
+
+    expire(std::chrono::steady_clock::now());
+    dispatch();
+    return finished_in_poll;
+}
+
+void FetchEngine::on_completion(unsigned long long user_data, int result, unsigned int flags) {
+    if (user_data == 0) {
+        return;
+    }
+    auto it = connections.find((int)(user_data >> 32));
+    if (it == connections.end() || (it->second->serial & 0x1fffffff) != ((user_data >> 3) & 0x1fffffff)) {
+        // Left over from a closed socket: free what the operation held
+        if ((user_data & 7) == RING_SEND) {
+            retired_sends.erase(user_data);
+        }
+        if (flags & IORING_CQE_F_BUFFER) {
+            ring->recycle(flags >> IORING_CQE_BUFFER_SHIFT);
+        }
+        return;
+    }
+
+    Connection* conn = it->second.get();
+    switch (user_data & 7) {
+    case RING_CONNECT:
+        on_connected(conn, result);
+        break;
+    case RING_SEND:
+        on_sent(conn, result);
+        break;
+    case RING_RECEIVE:
+        on_ring_data(conn, result, flags);
+        break;
+    case RING_POLL:
+        conn->interest = 0;
+        if (result != -ECANCELED) {
+            handle_event(conn, result < 0 ? (unsigned int)EPOLLERR : (unsigned int)result);
+        }
+        break;
+    }
+}
+
+void FetchEngine::on_connected(Connection* conn, int result) {
+    if (result < 0) {
+        connect_failed(conn, "Connect failed: " + std::string(strerror(-result)));
+        return;
+    }
+    if (conn->host->tls) {
+        // OpenSSL does the I/O itself, readiness-driven
+        fcntl(conn->fd, F_SETFL, fcntl(conn->fd, F_GETFL) | O_NONBLOCK);
+    } else {
+        ring_receive(conn);
+    }
+    on_writable(conn);
+}
+
+void FetchEngine::on_sent(Connection* conn, int result) {
+    conn->send_pending = false;
+    if (conn->state != Connection::State::Sending) {
+        return;
+    }
+    if (result < 0) {
+        finish(conn, false, "Error sending request");
+        return;
+    }
+    conn->out_offset += (size_t)result;
+    if (conn->out_offset < conn->out.length()) {
+        ring_send(conn);
+        return;
+    }
+    conn->state = Connection::State::Receiving;
+}
+
+void FetchEngine::on_ring_data(Connection* conn, int result, unsigned int flags) {
+    if (!(flags & IORING_CQE_F_MORE)) {
+        conn->receive_armed = false;
+    }
+
+    if (result > 0) {
+        unsigned id = flags >> IORING_CQE_BUFFER_SHIFT;
+        if (!conn->request) {
+            // Idle sockets should be silent
+            ring->recycle(id);
+            close_connection(conn);
+            return;
+        }
+        memcpy(conn->buffer->prepare((size_t)result), ring->buffer(id), (size_t)result);
+        ring->recycle(id);
+        if (on_received(conn, (size_t)result) && !conn->receive_armed) {
+            ring_receive(conn);
+        }
+        return;
+    }
+
+    if (result == -ENOBUFS) {
+        // Every buffer was in use; they have been handed back since
+        ring_receive(conn);
+        return;
+    }
+    if (result == -EINVAL && multishot_receive) {
+        std::cerr << "Kernel rejects multishot receives, using one receive per chunk" << std::endl;
+        multishot_receive = false;
+        ring_receive(conn);
+        return;
+    }
+    if (result == -ECANCELED) {
+        return;
+    }
+    if (!conn->request) {
+        close_connection(conn);
+    } else if (result == 0) {
+        on_closed(conn);
+    } else {
+        finish(conn, false, "Error receiving data: " + std::string(strerror(-result)));
+    }
+}
+
+void FetchEngine::ring_connect(Connection* conn) {
+    struct io_uring_sqe* sqe = ring->get_sqe();
+    if (sqe == nullptr) {
+        return;  // Left to the connect deadline
+    }
+    sqe->opcode = IORING_OP_CONNECT;
+    sqe->fd = conn->fd;
+    sqe->addr = (unsigned long long)(uintptr_t)&conn->address.address;
+    sqe->off = conn->address.length;
+    sqe->user_data = ring_tag(conn->fd, conn->serial, RING_CONNECT);
+}
+
+void FetchEngine::ring_send(Connection* conn) {
+    struct io_uring_sqe* sqe = ring->get_sqe();
+    if (sqe == nullptr) {
+        return;  // Left to the request deadline
+    }
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = conn->fd;
+    sqe->addr = (unsigned long long)(uintptr_t)(conn->out.data() + conn->out_offset);
+    sqe->len = (unsigned)(conn->out.length() - conn->out_offset);
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = ring_tag(conn->fd, conn->serial, RING_SEND);
+    conn->send_pending = true;
+}
+
+// Keep one receive armed per plain socket; the kernel picks a buffer from the
+// registered ring for each chunk, and a multishot receive stays armed across
+// chunks and responses until the socket closes or the buffers run out
+void FetchEngine::ring_receive(Connection* conn) {
+    struct io_uring_sqe* sqe = ring->get_sqe();
+    if (sqe == nullptr) {
+        return;  // Left to the request deadline
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn->fd;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = IoUring::BUFFER_GROUP;
+    sqe->ioprio = multishot_receive ? IORING_RECV_MULTISHOT : 0;
+    sqe->user_data = ring_tag(conn->fd, conn->serial, RING_RECEIVE);
+    conn->receive_armed = true;
+}
+
+// One-shot readiness wait, replacing whichever one is armed
+void FetchEngine::ring_poll(Connection* conn, unsigned int events) {
+    if (conn->interest == events) {
+        return;
+    }
+    struct io_uring_sqe* sqe = nullptr;
+    if (conn->interest != 0) {
+        sqe = ring->get_sqe();
+        if (sqe != nullptr) {
+            sqe->opcode = IORING_OP_POLL_REMOVE;
+            sqe->addr = ring_tag(conn->fd, conn->serial, RING_POLL);
+        }
+    }
+    sqe = ring->get_sqe();
+    if (sqe == nullptr) {
+        return;  // Left to the request deadline
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = conn->fd;
+    #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    events = (events << 16) | (events >> 16);
+    #endif
+    sqe->poll32_events = events;
+    sqe->user_data = ring_tag(conn->fd, conn->serial, RING_POLL);
+    conn->interest = events;
+}
+
+// Withdraw a closing socket's operations before its fd can be reused
+void FetchEngine::ring_cancel(Connection* conn) {
+    if (conn->send_pending) {
+        // The kernel may still read the request; keep it until the send completes
+        retired_sends[ring_tag(conn->fd, conn->serial, RING_SEND)] = std::move(conn->out);
+    }
+    bool pending = conn->state == Connection::State::Connecting || conn->send_pending ||
+                   conn->receive_armed || conn->interest != 0;
+    if (!pending) {
+        return;
+    }
+    struct io_uring_sqe* sqe = ring->get_sqe();
+    if (sqe != nullptr) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = conn->fd;
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    }
+    // Submitted now, while the fd still names this socket
+    ring->submit();
+}
+
+#else
+
+// Never reached: the ring is only set up in io_uring builds
+
+size_t FetchEngine::poll_ring(int) {
+    return 0;
+}
+
+void FetchEngine::on_completion(unsigned long long, int, unsigned int) {}
+void FetchEngine::on_connected(Connection*, int) {}
+void FetchEngine::on_sent(Connection*, int) {}
+void FetchEngine::on_ring_data(Connection*, int, unsigned int) {}
+void FetchEngine::ring_connect(Connection*) {}
+void FetchEngine::ring_send(Connection*) {}
+void FetchEngine::ring_receive(Connection*) {}
+void FetchEngine::ring_poll(Connection*, unsigned int) {}
+void FetchEngine::ring_cancel(Connection*) {}
+
+#endif // WEBSCRAPER_HAVE_IO_URING
+
+#else
+
+// Without epoll the engine degrades to one blocking http_fetch per poll() call
+
+FetchEngine::FetchEngine(const FetchEngineConfig& cfg)
+    : config(cfg), poll_fd(-1), next_id(1), queued_count(0), active_count(0), finished_in_poll(0),
+      next_serial(1), multishot_receive(true) {}
+
+FetchEngine::~FetchEngine() {}
+
+size_t FetchEngine::poll(int timeout_ms) {
+    if (response_archive().replaying()) {
+        return run_replay(timeout_ms);
+    }
+    return run_blocking_fallback();
+}
+
+#endif // __linux__
+
+size_t FetchEngine::run_replay(int timeout_ms) {
+    finished_in_poll = 0;
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::milliseconds latency = response_archive().replay_latency();
+
+    // Fill the in-flight window; every request waits out the same latency, so
+    // the window stays ordered by due time
+    for (auto& pair : hosts) {
+        HostState& host = *pair.second;
+        while (!host.queue.empty() && active_count < config.max_in_flight) {
+            std::unique_ptr<Request> request = std::move(host.queue.front());
+            host.queue.pop_front();
+            queued_count--;
+            active_count++;
+            request->ready = now + latency;
+            replaying.push_back(std::move(request));
+        }
+    }
+    if (replaying.empty()) {
+        return 0;
+    }
+
+    if (replaying.front()->ready > now) {
+        std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+            replaying.front()->ready - now, std::chrono::milliseconds(std::max(0, timeout_ms))));
+        now = std::chrono::steady_clock::now();
+    }
+
+    while (!replaying.empty() && replaying.front()->ready <= now) {
+        std::unique_ptr<Request> request = std::move(replaying.front());
+        replaying.pop_front();
+        active_count--;
+
+        HttpResponse response;
+        bool ok = http_replay(request->hostname, request->resource_path, response);
+        deliver(std::move(request), ok, ok ? "" : "Not in response archive", &response);
+    }
+    return finished_in_poll;
+}
+
+size_t FetchEngine::run_blocking_fallback() {
+    finished_in_poll = 0;
+    for (auto& pair : hosts) {
+        HostState& host = *pair.second;
+        if (host.queue.empty()) {
+            continue;
+        }
+        std::unique_ptr<Request> request = std::move(host.queue.front());
+        host.queue.pop_front();
+        queued_count--;
+
+        HttpResponse response;
+        bool ok = http_fetch(request->hostname, request->resource_path, response);
+        deliver(std::move(request), ok, ok ? "" : "Fetch failed", &response);
+        break;
+    }
+    return finished_in_poll;
+}
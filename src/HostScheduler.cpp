@@ -0,0 +1,167 @@
+#include "../include/HostScheduler.h"
+#include <algorithm>
+
+HostScheduler::HostScheduler(const HostSchedulerConfig& cfg) : config(cfg), pending(0) {}
+
+std::map<std::string, HostScheduler::Host>::iterator HostScheduler::host_entry(const std::string& name) {
+    auto it = hosts.find(name);
+    if (it != hosts.end()) {
+        return it;
+    }
+    it = hosts.emplace(name, Host()).first;
+    Host& host = it->second;
+    host.rate = config.rate;
+    host.burst = std::max(1.0, config.burst);
+    host.tokens = host.burst;  // A new host may take a full burst straight away
+    host.refilled = Clock::now();
+    return it;
+}
+
+void HostScheduler::refill(Host& host, Clock::time_point now) {
+    if (host.rate <= 0.0) {
+        host.tokens = host.burst;
+    } else if (now > host.refilled) {
+        std::chrono::duration<double> elapsed = now - host.refilled;
+        host.tokens = std::min(host.burst, host.tokens + elapsed.count() * host.rate);
+    }
+    host.refilled = now;
+}
+
+HostScheduler::Clock::time_point HostScheduler::ready_time(const Host& host) const {
+    if (host.rate <= 0.0 || host.tokens >= 1.0) {
+        return host.refilled;
+    }
+    std::chrono::duration<double> until((1.0 - host.tokens) / host.rate);
+    return host.refilled + std::chrono::duration_cast<Clock::duration>(until);
+}
+
+void HostScheduler::schedule(Host& host, const std::string& name) {
+    host.generation++;
+    ready_heap.push(ReadyEntry{ready_time(host), &host, &name, host.generation});
+}
+
+void HostScheduler::push(const std::string& host_name, const std::string& item) {
+    auto it = host_entry(host_name);
+    Host& host = it->second;
+    host.items.push_back(item);
+    pending++;
+    stats.scheduled++;
+    if (host.items.size() == 1) {
+        // The host just got work: enter it into the heap
+        refill(host, Clock::now());
+        schedule(host, it->first);
+    }
+}
+
+bool HostScheduler::pop_ready(std::string& host_name, std::string& item, Clock::duration& wait) {
+    wait = Clock::duration::zero();
+    Clock::time_point now = Clock::now();
+
+    while (!ready_heap.empty()) {
+        ReadyEntry top = ready_heap.top();
+        if (top.generation != top.host->generation || top.host->items.empty()) {
+            ready_heap.pop();  // Superseded entry
+            continue;
+        }
+        if (top.ready > now) {
+            wait = top.ready - now;
+            stats.throttled++;
+            return false;
+        }
+        ready_heap.pop();
+
+        Host& host = *top.host;
+        refill(host, now);
+        host.tokens -= 1.0;
+        host_name = *top.name;
+        item = std::move(host.items.front());
+        host.items.pop_front();
+        pending--;
+        stats.dispatched++;
+
+        if (!host.items.empty()) {
+            schedule(host, *top.name);
+        }
+        return true;
+    }
+    return false;
+}
+
+HostScheduler::Clock::duration HostScheduler::reserve(const std::string& host_name, int requests) {
+    auto it = host_entry(host_name);
+    Host& host = it->second;
+    Clock::time_point now = Clock::now();
+    refill(host, now);
+    if (host.rate <= 0.0) {
+        return Clock::duration::zero();
+    }
+
+    // Borrow against future refills; the debt delays whatever comes next
+    host.tokens -= std::max(1, requests);
+    Clock::duration wait = Clock::duration::zero();
+    if (host.tokens < 0.0) {
+        std::chrono::duration<double> until(-host.tokens / host.rate);
+        wait = std::chrono::duration_cast<Clock::duration>(until);
+    }
+    if (!host.items.empty()) {
+        schedule(host, it->first);
+    }
+    return wait;
+}
+
+void HostScheduler::set_host_limits(const std::string& host_name, double rate, double burst) {
+    auto it = host_entry(host_name);
+    Host& host = it->second;
+    refill(host, Clock::now());
+    host.rate = rate;
+    host.burst = std::max(1.0, burst);
+    host.tokens = std::min(host.tokens, host.burst);
+    host.custom_limits = true;
+    if (!host.items.empty()) {
+        schedule(host, it->first);
+    }
+}
+
+void HostScheduler::clear() {
+    for (auto& pair : hosts) {
+        pair.second.items.clear();
+    }
+    ready_heap = decltype(ready_heap)();
+    pending = 0;
+}
+
+void HostScheduler::set_config(const HostSchedulerConfig& cfg) {
+    config = cfg;
+    Clock::time_point now = Clock::now();
+    for (auto& pair : hosts) {
+        Host& host = pair.second;
+        if (host.custom_limits) {
+            continue;
+        }
+        refill(host, now);
+        host.rate = config.rate;
+        host.burst = std::max(1.0, config.burst);
+        host.tokens = std::min(host.tokens, host.burst);
+        if (!host.items.empty()) {
+            schedule(host, pair.first);
+        }
+    }
+}
+
+HostSchedulerStats HostScheduler::get_stats() const {
+    HostSchedulerStats result = stats;
+    result.hosts = hosts.size();
+    result.pending = pending;
+    return result;
+}
+
+std::string url_host(const std::string& url, const std::string& default_host) {
+    size_t scheme_end = url.find("://");
+    if (scheme_end == std::string::npos) {
+        return default_host;
+    }
+    size_t host_start = scheme_end + 3;
+    size_t host_end = url.find_first_of("/?#", host_start);
+    std::string host = url.substr(host_start, host_end == std::string::npos ? std::string::npos : host_end - host_start);
+    return host.empty() ? default_host : host;
+}
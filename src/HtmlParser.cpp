@@ -1,329 +1,430 @@
 #include "../include/HtmlParser.h"
+#include "../include/HtmlScan.h"
+#include "../include/UrlRules.h"
 #include <algorithm>
+#include <cstring>
+#include <functional>
 #include <iostream>
 
 // Extract text between two delimiters
-std::string extract_between(const std::string& text, const std::string& start_delim, const std::string& end_delim) {
-    size_t start_pos = text.find(start_delim);
+std::string_view extract_between_view(std::string_view text, std::string_view start_delim, std::string_view end_delim) {
+    size_t start_pos = scan_find(text, start_delim);
     if (start_pos == std::string::npos) {
-        return "";
+        return std::string_view();
     }
     
     start_pos += start_delim.length();
-    size_t end_pos = text.find(end_delim, start_pos);
+    size_t end_pos = scan_find(text, end_delim, start_pos);
     if (end_pos == std::string::npos) {
-        return "";
+        return std::string_view();
     }
     
     return text.substr(start_pos, end_pos - start_pos);
 }
 
-// Parse the rating value from the class attribute
-std::string parse_rating(const std::string& rating_class) {
-    if (rating_class.find("One") != std::string::npos) return "One";
-    if (rating_class.find("Two") != std::string::npos) return "Two";
-    if (rating_class.find("Three") != std::string::npos) return "Three";
-    if (rating_class.find("Four") != std::string::npos) return "Four";
-    if (rating_class.find("Five") != std::string::npos) return "Five";
-    return "Unknown";
+std::string extract_between(std::string_view text, const std::string& start_delim, const std::string& end_delim) {
+    return std::string(extract_between_view(text, start_delim, end_delim));
 }
 
-// Parse books from HTML content
-std::vector<Book> parse_books(const std::string& html, const std::string& base_url) {
-    std::vector<Book> books;
-    
-    // Each book is contained within an "article" tag with class "product_pod"
-    const std::string book_start = "<article class=\"product_pod\">";
-    const std::string book_end = "</article>";
-    
-    size_t pos = 0;
-    while ((pos = html.find(book_start, pos)) != std::string::npos) {
-        size_t book_end_pos = html.find(book_end, pos);
-        if (book_end_pos == std::string::npos) {
-            break;
+// Markers around each book on a listing page
+static const std::string BOOK_START = "<article class=\"product_pod\">";
+static const std::string BOOK_END = "</article>";
+
+static bool has_at(std::string_view text, size_t pos, std::string_view token) {
+    return text.size() - pos >= token.size() && text.compare(pos, token.size(), token) == 0;
+}
+
+// Read the double-quoted href and title attributes of the tag whose name ends
+// at pos; returns the offset just past the tag's '>', or npos if it is cut off
+static size_t read_anchor_attributes(std::string_view html, size_t pos, std::string_view& href,
+                                     std::string_view& title) {
+    while (pos < html.size()) {
+        char c = html[pos];
+        if (c == '>') {
+            return pos + 1;
         }
-        
-        // Extract the HTML for this book
-        std::string book_html = html.substr(pos, book_end_pos - pos + book_end.length());
-        
-        Book book;
-        
-        // Extract title - it's in the h3 tag and inside an a tag with title attribute
-        std::string title_tag = extract_between(book_html, "<h3>", "</h3>");
-        std::string title_attr = extract_between(title_tag, "title=\"", "\"");
-        book.title = title_attr;
-        
-        // If title attribute extraction failed, try getting text content
-        if (book.title.empty()) {
-            book.title = extract_between(title_tag, "\">", "</a>");
+        if (c == '"' || c == '\'') {
+            size_t close = html.find(c, pos + 1);
+            if (close == std::string_view::npos) {
+                return std::string_view::npos;
+            }
+            pos = close + 1;
+            continue;
         }
-        
-        // Extract the book detail URL - it's in the a tag as href attribute
-        std::string book_relative_url = extract_between(title_tag, "href=\"", "\"");
-        book.url = normalize_url(book_relative_url, base_url);
-        
-        // Extract price - it's in a p tag with class "price_color"
-        std::string price = extract_between(book_html, "<p class=\"price_color\">", "</p>");
-        book.price = price;
-        
-        // Extract rating - it's in a p tag with class "star-rating" followed by the rating level
-        std::string rating_class = extract_between(book_html, "<p class=\"star-rating ", "\"");
-        book.rating = parse_rating(rating_class);
-        
-        // Only add book if it has a valid URL (to avoid duplicates)
-        if (!book.url.empty()) {
-            books.push_back(book);
+        if (has_at(html, pos, "href=\"") || has_at(html, pos, "title=\"")) {
+            bool is_href = html[pos] == 'h';
+            size_t value_start = pos + (is_href ? 6 : 7);
+            size_t close = html.find('"', value_start);
+            if (close == std::string_view::npos) {
+                return std::string_view::npos;
+            }
+            std::string_view& target = is_href ? href : title;
+            if (target.data() == nullptr) {
+                target = html.substr(value_start, close - value_start);
+            }
+            pos = close + 1;
+            continue;
         }
-        
-        // Move past this book to find the next one
-        pos = book_end_pos + book_end.length();
+        pos++;
     }
-    
-    return books;
+    return std::string_view::npos;
 }
 
-// Find the next page link in the HTML
-std::string find_next_link(const std::string& html) {
-    // Look for the "next" link in the pagination section
-    const std::string next_link_start = "<li class=\"next\">";
-    const std::string next_link_end = "</li>";
-    
-    std::string next_li = extract_between(html, next_link_start, next_link_end);
-    if (next_li.empty()) {
-        return ""; // No next page
-    }
-    
-    // Extract the href attribute from the a tag
-    std::string href = extract_between(next_li, "href=\"", "\"");
-    return href;
-}
+// Single pass over a listing page: finds each product_pod, then jumps from
+// '<' to '<' through it (popped off a ByteIndex of the page) and tells the few
+// tags it needs apart by the character after the '<', keeping each field as a
+// view into html. Each article with a link becomes a BookView when it closes.
+// Starts at pos; returns where a later call should resume: the start of an
+// article whose closing tag has not arrived yet, or the first byte that could
+// still begin one.
+static size_t scan_product_pods(std::string_view html, size_t pos, std::vector<BookView>& books) {
+    static const std::string_view PRICE_START = "<p class=\"price_color\">";
+    static const std::string_view RATING_START = "<p class=\"star-rating ";
+    const size_t first = pos;
+    const size_t npos = std::string_view::npos;
 
-// Normalize URL (convert relative to absolute)
-std::string normalize_url(const std::string& url, const std::string& base_url) {
-    // If URL starts with http:// or https://, it's already absolute
-    if (url.find("http://") == 0 || url.find("https://") == 0) {
-        return url;
-    }
-    
-    // Empty URLs aren't valid
-    if (url.empty()) {
-        return "";
-    }
-    
-    // If URL starts with '//', add http:
-    if (url.substr(0, 2) == "//") {
-        return "http:" + url;
-    }
-    
-    // Extract domain from base_url to prevent domain concatenation issues
-    std::string domain = "";
-    size_t domain_start = base_url.find("://");
-    if (domain_start != std::string::npos) {
-        domain_start += 3; // Skip "://"
-        size_t domain_end = base_url.find('/', domain_start);
-        if (domain_end != std::string::npos) {
-            domain = base_url.substr(0, domain_end); // Include protocol
-        } else {
-            domain = base_url; // The base_url is just the domain
+    bool in_article = false;
+    size_t article_start = 0;
+    int h3_state = 0;            // 0 before the article's h3, 1 inside it, 2 after it
+    size_t anchor_text = npos;   // Start of the h3 link's text while inside it
+    size_t price_text = npos;    // Start of the price while inside its <p>
+    std::string_view href, title, anchor, price, rating;
+    ByteIndex tags(html, '<');
+
+    while (true) {
+        if (!in_article) {
+            // Between articles only the next start tag matters
+            size_t start = scan_find(html, BOOK_START, pos);
+            if (start == npos) {
+                break;
+            }
+            in_article = true;
+            article_start = start;
+            h3_state = 0;
+            anchor_text = price_text = npos;
+            href = title = anchor = price = rating = std::string_view();
+            pos = start + BOOK_START.length();
+            continue;
         }
-    } else {
-        // If no protocol in base_url, assume http://
-        domain = "http://" + base_url.substr(0, base_url.find('/'));
+
+        pos = tags.find(pos);
+        if (pos == npos) {
+            break;
+        }
+        char kind = pos + 1 < html.size() ? html[pos + 1] : '\0';
+
+        switch (kind) {
+        case '/':
+            if (has_at(html, pos, BOOK_END)) {
+                // The first h3 link is the book; without an href there is nothing to keep
+                if (!href.empty()) {
+                    books.push_back(BookView{title.empty() ? anchor : title, href, price, parse_rating(rating)});
+                }
+                in_article = false;
+                pos += BOOK_END.length();
+                continue;
+            }
+            if (price_text != npos && has_at(html, pos, "</p>")) {
+                price = html.substr(price_text, pos - price_text);
+                price_text = npos;
+            } else if (h3_state == 1 && anchor_text != npos && anchor.data() == nullptr && has_at(html, pos, "</a>")) {
+                anchor = html.substr(anchor_text, pos - anchor_text);
+            } else if (h3_state == 1 && has_at(html, pos, "</h3>")) {
+                h3_state = 2;
+            }
+            break;
+        case 'h':
+            if (h3_state == 0 && price_text == npos && has_at(html, pos, "<h3>")) {
+                h3_state = 1;
+            }
+            break;
+        case 'a':
+            if (h3_state == 1 && anchor_text == npos && price_text == npos && has_at(html, pos, "<a ")) {
+                size_t tag_end = read_anchor_attributes(html, pos + 3, href, title);
+                if (tag_end == npos) {
+                    return article_start;
+                }
+                anchor_text = tag_end;
+                pos = tag_end;
+                continue;
+            }
+            break;
+        case 'p':
+            if (price_text != npos) {
+                break;
+            }
+            if (price.data() == nullptr && has_at(html, pos, PRICE_START)) {
+                pos += PRICE_START.length();
+                price_text = pos;
+                continue;
+            }
+            if (rating.data() == nullptr && has_at(html, pos, RATING_START)) {
+                size_t value_start = pos + RATING_START.length();
+                size_t close = html.find('"', value_start);
+                if (close == npos) {
+                    return article_start;
+                }
+                rating = html.substr(value_start, close - value_start);
+                pos = close + 1;
+                continue;
+            }
+            break;
+        default:
+            break;
+        }
+        pos++;
     }
-    
-    // If URL starts with '/', it's relative to domain root
-    if (url[0] == '/') {
-        return domain + url;
+    if (in_article) {
+        return article_start;
     }
-    
-    // Otherwise, it's relative to current path
-    size_t last_slash = base_url.find_last_of('/');
-    if (last_slash != std::string::npos && last_slash > 8) { // 8 to skip http(s)://
-        return base_url.substr(0, last_slash + 1) + url;
+    return std::max(first, html.size() - std::min(html.size(), BOOK_START.length() - 1));
+}
+
+void assign_book(const BookView& view, const UrlBase& base, Book& book) {
+    book.title.assign(view.title);
+    base.resolve(view.href, book.url);
+    parse_price(view.price, book.price);
+    book.rating = view.rating;
+    book.category = NO_CATEGORY;
+}
+
+void parse_books(std::string_view html, std::vector<BookView>& books) {
+    books.clear();
+    scan_product_pods(html, 0, books);
+}
+
+// Parse books from HTML content
+std::vector<Book> parse_books(std::string_view html, const std::string& base_url) {
+    std::vector<BookView> views;
+    scan_product_pods(html, 0, views);
+    std::vector<Book> books(views.size());
+    if (!views.empty()) {
+        UrlBase base(base_url);
+        for (size_t i = 0; i < views.size(); ++i) {
+            assign_book(views[i], base, books[i]);
+        }
     }
-    
-    return domain + "/" + url;
+    return books;
+}
+
+// Find the next page link in the HTML
+std::string_view find_next_link_view(std::string_view html) {
+    // Look for the "next" link in the pagination section, then the href of its a tag
+    std::string_view next_li = extract_between_view(html, "<li class=\"next\">", "</li>");
+    return extract_between_view(next_li, "href=\"", "\"");
+}
+
+std::string find_next_link(std::string_view html) {
+    return std::string(find_next_link_view(html));
+}
+
+// Attribute that introduces every link extract_all_links looks at
+static const std::string HREF_START = "href=\"";
+
+// Turn one href value into an absolute URL; false if url_rules() turn it down
+static bool accept_link(std::string_view href, const UrlBase& base, std::string& full_url) {
+    base.resolve(href, full_url);
+    return !full_url.empty() && url_rules().match(full_url).accepted;
 }
 
 // Extract all hyperlinks from the HTML
-std::set<std::string> extract_all_links(const std::string& html, const std::string& base_url) {
-    std::set<std::string> links;
+void extract_all_links(std::string_view html, const UrlBase& base, LinkBuffer& links) {
+    // Each link is resolved here before the buffer checks whether it is new
+    thread_local std::string full_url;
     
     // Look for all a tags with href attributes
-    const std::string a_href = "href=\"";
-    
     size_t pos = 0;
-    while ((pos = html.find(a_href, pos)) != std::string::npos) {
-        pos += a_href.length();
-        size_t end_pos = html.find("\"", pos);
+    while ((pos = scan_find(html, HREF_START, pos)) != std::string::npos) {
+        pos += HREF_START.length();
+        size_t end_pos = html.find('"', pos);
         if (end_pos == std::string::npos) {
             break;
         }
         
-        std::string href = html.substr(pos, end_pos - pos);
-        
-        // Skip URLs that are obviously not content (static resources, etc.)
-        if (href.find(".css") != std::string::npos ||
-            href.find(".js") != std::string::npos ||
-            href.find(".ico") != std::string::npos ||
-            href.find(".jpg") != std::string::npos ||
-            href.find(".png") != std::string::npos ||
-            href.find("/static/") != std::string::npos) {
-            pos = end_pos + 1;
-            continue;
-        }
-        
-        // Normalize the URL
-        std::string full_url = normalize_url(href, base_url);
-        
-        // Skip malformed URLs
-        if (full_url.find("http://books.toscrape.comhttp") != std::string::npos ||
-            full_url.find("http://books.toscrape.comhttps") != std::string::npos ||
-            full_url.find("mhttp") != std::string::npos ||
-            full_url.find("mhttps") != std::string::npos) {
-            pos = end_pos + 1;
-            continue;
-        }
-        
-        // Only add if it's from the same domain (books.toscrape.com)
-        if (!full_url.empty() && full_url.find("books.toscrape.com") != std::string::npos) {
+        if (accept_link(html.substr(pos, end_pos - pos), base, full_url)) {
             links.insert(full_url);
         }
         
         pos = end_pos + 1;
     }
-    
+}
+
+std::set<std::string> extract_all_links(std::string_view html, const std::string& base_url) {
+    LinkBuffer page_links;
+    extract_all_links(html, UrlBase(base_url), page_links);
+    std::set<std::string> links;
+    for (size_t i = 0; i < page_links.size(); ++i) {
+        links.emplace(page_links[i]);
+    }
     return links;
 }
 
-// Check if URL is a book detail page
-bool is_book_page(const std::string& url) {
-    // Book detail pages contain "/catalogue/" and don't end with .html but have no trailing slash
-    return url.find("/catalogue/") != std::string::npos && 
-           url.rfind(".html") == std::string::npos &&
-           url.back() != '/';
+void LinkBuffer::clear() {
+    text.clear();
+    spans.clear();
+    std::fill(slots.begin(), slots.end(), 0);
 }
 
-// Check if URL is a category page
-bool is_category_page(const std::string& url) {
-    // Category pages are in /category/ directory and typically end with index.html or page-X.html
-    return url.find("/category/") != std::string::npos ||
-           url.find("index.html") != std::string::npos ||
-           url.find("page-") != std::string::npos;
+// Slot holding url, or the free slot where it would go
+size_t LinkBuffer::find_slot(std::string_view url) const {
+    size_t mask = slots.size() - 1;
+    size_t slot = std::hash<std::string_view>()(url) & mask;
+    while (slots[slot] != 0 && (*this)[slots[slot] - 1] != url) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
 }
 
-// Canonicalize URL for deduplication
-std::string canonicalize_url(const std::string& url) {
-    std::string result = url;
-    
-    // Convert to lowercase for case-insensitive comparison
-    std::transform(result.begin(), result.end(), result.begin(), 
-                  [](unsigned char c){ return std::tolower(c); });
-    
-    // Remove protocol part for matching
-    size_t protocol_pos = result.find("://");
-    if (protocol_pos != std::string::npos) {
-        result = result.substr(protocol_pos + 3);
+void LinkBuffer::rebuild_index(size_t slot_count) {
+    slots.assign(slot_count, 0);
+    for (size_t i = 0; i < spans.size(); ++i) {
+        slots[find_slot((*this)[i])] = i + 1;
     }
-    
-    // Remove 'www.' prefix if present
-    if (result.substr(0, 4) == "www.") {
-        result = result.substr(4);
+}
+
+bool LinkBuffer::insert(std::string_view url) {
+    // Keep the table at most half full
+    if ((spans.size() + 1) * 2 > slots.size()) {
+        rebuild_index(std::max<size_t>(64, slots.size() * 2));
     }
-    
-    // Handle trailing slashes consistently
-    if (!result.empty() && result.back() == '/') {
-        result.pop_back();
+    size_t slot = find_slot(url);
+    if (slots[slot] != 0) {
+        return false;
     }
-    
-    // Remove anchor part (anything after #)
-    size_t anchor_pos = result.find('#');
-    if (anchor_pos != std::string::npos) {
-        result = result.substr(0, anchor_pos);
+    spans.emplace_back(text.size(), url.size());
+    text.append(url.data(), url.size());
+    slots[slot] = spans.size();
+    return true;
+}
+
+bool LinkBuffer::contains(std::string_view url) const {
+    return !slots.empty() && slots[find_slot(url)] != 0;
+}
+
+void LinkBuffer::sort(size_t first) {
+    std::sort(spans.begin() + std::min(first, spans.size()), spans.end(),
+              [this](const std::pair<size_t, size_t>& a, const std::pair<size_t, size_t>& b) {
+        return std::string_view(text.data() + a.first, a.second) < std::string_view(text.data() + b.first, b.second);
+    });
+    rebuild_index(slots.size());
+}
+
+HtmlStreamParser::HtmlStreamParser(std::string_view base_url, bool books)
+    : page_base(base_url), want_books(books), book_pos(0), link_pos(0), consumed(0) {}
+
+void HtmlStreamParser::reset(std::string_view base_url, bool books) {
+    page_base.assign(base_url);
+    want_books = books;
+    pending.clear();
+    book_pos = link_pos = consumed = 0;
+    seen_links.clear();
+}
+
+void HtmlStreamParser::feed(std::string_view chunk, std::vector<Book>& books, std::vector<std::string>& links) {
+    size_t known_links = seen_links.size();
+    feed(chunk, book_views, seen_links);
+    for (const BookView& view : book_views) {
+        books.emplace_back();
+        assign_book(view, page_base, books.back());
     }
-    
-    // Remove query parameters for page content matching
-    // Only do this for pages that aren't search or filtered results
-    size_t query_pos = result.find('?');
-    if (query_pos != std::string::npos && 
-        result.find("search") == std::string::npos && 
-        result.find("filter") == std::string::npos) {
-        result = result.substr(0, query_pos);
+    for (size_t i = known_links; i < seen_links.size(); ++i) {
+        links.emplace_back(seen_links[i]);
     }
-    
-    return result;
 }
 
-// Check if URL should be ignored
-bool should_ignore_url(const std::string& url) {
-    // Check for irrelevant sections
-    if (url.find("/accounts/") != std::string::npos ||
-        url.find("/login") != std::string::npos ||
-        url.find("/logout") != std::string::npos ||
-        url.find("/admin") != std::string::npos ||
-        url.find("/static/") != std::string::npos ||
-        url.find(".jpg") != std::string::npos ||
-        url.find(".png") != std::string::npos ||
-        url.find(".css") != std::string::npos ||
-        url.find(".js") != std::string::npos) {
-        return true;
+void HtmlStreamParser::feed(std::string_view chunk, std::vector<BookView>& books, LinkBuffer& links) {
+    // Drop the markup both scans finished with on the last call, now that its
+    // book views are no longer needed, so memory stays bounded by one unfinished element
+    size_t done = want_books ? std::min(book_pos, link_pos) : link_pos;
+    if (done > 0) {
+        pending.erase(0, done);
+        book_pos -= std::min(book_pos, done);
+        link_pos -= done;
+        consumed += done;
     }
     
-    // Non-books.toscrape.com URLs
-    if (url.find("books.toscrape.com") == std::string::npos) {
-        return true;
+    pending.append(chunk.data(), chunk.size());
+    std::string_view html(pending);
+    
+    // Books: every article whose closing tag has arrived
+    books.clear();
+    if (want_books) {
+        book_pos = scan_product_pods(html, book_pos, books);
     }
     
-    return false;
+    // Links: every href whose closing quote has arrived
+    while (true) {
+        size_t start = scan_find(html, HREF_START, link_pos);
+        if (start == std::string::npos) {
+            link_pos = std::max(link_pos, html.size() - std::min(html.size(), HREF_START.length() - 1));
+            break;
+        }
+        size_t value_start = start + HREF_START.length();
+        size_t end = html.find('"', value_start);
+        if (end == std::string::npos) {
+            link_pos = start;
+            break;
+        }
+        if (accept_link(html.substr(value_start, end - value_start), page_base, link_url)) {
+            links.insert(link_url);
+        }
+        link_pos = end + 1;
+    }
 }
 
-// Add this at the end of the file
-Book parse_book_page(const std::string& html, const std::string& hostname, const std::string& url) {
+// Check if URL is a book detail page
+bool is_book_page(std::string_view url) {
+    return url_rules().match(url).page_class == PageClass::Book;
+}
+
+// Check if URL is a category page
+bool is_category_page(std::string_view url) {
+    return url_rules().match(url).page_class == PageClass::Listing;
+}
+
+// Check if URL should be ignored
+bool should_ignore_url(std::string_view url) {
+    return !url_rules().match(url).accepted;
+}
+
+// The category a book page files its book under: the last link of the
+// breadcrumb, after Home and Books
+static CategoryId breadcrumb_category(std::string_view html) {
+    std::string_view crumbs = extract_between_view(html, "<ul class=\"breadcrumb\">", "</ul>");
+    std::string_view last;
+    int links = 0;
+    size_t pos = 0;
+    while ((pos = crumbs.find("<a ", pos)) != std::string_view::npos) {
+        size_t text_start = crumbs.find('>', pos);
+        size_t text_end = text_start == std::string_view::npos ? text_start : crumbs.find("</a>", text_start);
+        if (text_end == std::string_view::npos) {
+            break;
+        }
+        last = crumbs.substr(text_start + 1, text_end - text_start - 1);
+        links++;
+        pos = text_end;
+    }
+    return links >= 3 ? category_id(last) : NO_CATEGORY;
+}
+
+// Parse a single book page: its title, price, rating and category, typed as it is read
+Book parse_book_page(std::string_view html, const std::string& hostname, const std::string& url) {
+    static const std::string_view RATING_START = "<p class=\"star-rating";
     Book book;
-    
-    // Initialize the book with empty fields
-    book.title = "";
-    book.price = "";
-    book.rating = "";
     book.url = url;
+    book.title.assign(extract_between_view(html, "<h1>", "</h1>"));
+    parse_price(extract_between_view(html, "<p class=\"price_color\">", "</p>"), book.price);
     
-    // Extract the title
-    std::string title_start = "<h1>";
-    std::string title_end = "</h1>";
-    book.title = extract_between(html, title_start, title_end);
-    
-    // Extract the price
-    std::string price_start = "<p class=\"price_color\">";
-    std::string price_end = "</p>";
-    book.price = extract_between(html, price_start, price_end);
-    
-    // Extract the rating - find the star-rating class
-    size_t ratingPos = html.find("<p class=\"star-rating");
-    if (ratingPos != std::string::npos) {
-        // Find the closing quote after the class name
-        size_t classStart = ratingPos + 18; // Length of "<p class=\"star-rating"
-        size_t classEnd = html.find("\"", classStart);
-        
-        if (classEnd != std::string::npos) {
-            // Extract the class which contains the rating
-            std::string ratingClass = html.substr(classStart, classEnd - classStart);
-            
-            // Convert the rating class to a rating value
-            if (ratingClass.find("One") != std::string::npos) {
-                book.rating = "One";
-            } else if (ratingClass.find("Two") != std::string::npos) {
-                book.rating = "Two";
-            } else if (ratingClass.find("Three") != std::string::npos) {
-                book.rating = "Three";
-            } else if (ratingClass.find("Four") != std::string::npos) {
-                book.rating = "Four";
-            } else if (ratingClass.find("Five") != std::string::npos) {
-                book.rating = "Five";
-            } else {
-                book.rating = "Unknown";
-            }
+    // The rating is a word in the star-rating class
+    size_t rating_pos = scan_find(html, RATING_START);
+    if (rating_pos != std::string::npos) {
+        size_t class_start = rating_pos + RATING_START.length();
+        size_t class_end = html.find('"', class_start);
+        if (class_end != std::string::npos) {
+            book.rating = parse_rating(html.substr(class_start, class_end - class_start));
         }
     }
     
+    book.category = breadcrumb_category(html);
     return book;
-} 
\ No newline at end of file
+}
@@ -0,0 +1,220 @@
+#include "../include/HtmlScan.h"
+#include <atomic>
+#include <cstring>
+
+// x86-64 only, where SSE2 is part of the baseline
+#if defined(__x86_64__) || defined(_M_X64)
+#define HTML_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(HTML_SCAN_X86) && (defined(__GNUC__) || defined(__clang__))
+// Compile the AVX2 kernels for AVX2 without raising the baseline of the rest of the build
+#define HTML_SCAN_AVX2 __attribute__((target("avx2")))
+#else
+#define HTML_SCAN_AVX2
+#endif
+
+namespace {
+
+// One implementation of each kernel
+struct ScanKernels {
+    ScanLevel level;
+    uint64_t (*byte_mask)(const char* block, char c);   // Exactly 64 bytes
+    size_t (*find)(const char* text, size_t size, std::string_view needle);   // needle is at least 2 bytes
+};
+
+uint64_t scalar_byte_mask(const char* block, char c) {
+    uint64_t mask = 0;
+    const char* end = block + 64;
+    for (const char* p = block; (p = (const char*)memchr(p, c, end - p)) != nullptr; ++p) {
+        mask |= 1ull << (p - block);
+    }
+    return mask;
+}
+
+size_t scalar_find(const char* text, size_t size, std::string_view needle) {
+    return std::string_view(text, size).find(needle);
+}
+
+#ifdef HTML_SCAN_X86
+
+unsigned lowest_bit(uint32_t bits) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, bits);
+    return index;
+#else
+    return __builtin_ctz(bits);
+#endif
+}
+
+uint64_t sse2_byte_mask(const char* block, char c) {
+    const __m128i wanted = _mm_set1_epi8(c);
+    uint64_t mask = 0;
+    for (int i = 0; i < 4; ++i) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+        mask |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, wanted)) << (16 * i);
+    }
+    return mask;
+}
+
+// Candidates are the positions where both the first and the last byte of the
+// needle match; on HTML that filters out nearly every '<' or 'h' up front
+size_t sse2_find(const char* text, size_t size, std::string_view needle) {
+    const size_t last = needle.size() - 1;
+    const __m128i first_byte = _mm_set1_epi8(needle[0]);
+    const __m128i last_byte = _mm_set1_epi8(needle[last]);
+    size_t i = 0;
+    for (; i + last + 16 <= size; i += 16) {
+        __m128i head = _mm_loadu_si128((const __m128i*)(text + i));
+        __m128i tail = _mm_loadu_si128((const __m128i*)(text + i + last));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(head, first_byte),
+                                                                      _mm_cmpeq_epi8(tail, last_byte)));
+        while (mask != 0) {
+            unsigned bit = lowest_bit(mask);
+            if (memcmp(text + i + bit + 1, needle.data() + 1, last - 1) == 0) {
+                return i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+    size_t rest = scalar_find(text + i, size - i, needle);
+    return rest == std::string_view::npos ? rest : i + rest;
+}
+
+HTML_SCAN_AVX2 uint64_t avx2_byte_mask(const char* block, char c) {
+    const __m256i wanted = _mm256_set1_epi8(c);
+    __m256i low = _mm256_loadu_si256((const __m256i*)block);
+    __m256i high = _mm256_loadu_si256((const __m256i*)(block + 32));
+    uint32_t low_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(low, wanted));
+    uint32_t high_mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(high, wanted));
+    return ((uint64_t)high_mask << 32) | low_mask;
+}
+
+HTML_SCAN_AVX2 size_t avx2_find(const char* text, size_t size, std::string_view needle) {
+    const size_t last = needle.size() - 1;
+    const __m256i first_byte = _mm256_set1_epi8(needle[0]);
+    const __m256i last_byte = _mm256_set1_epi8(needle[last]);
+    size_t i = 0;
+    for (; i + last + 32 <= size; i += 32) {
+        __m256i head = _mm256_loadu_si256((const __m256i*)(text + i));
+        __m256i tail = _mm256_loadu_si256((const __m256i*)(text + i + last));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(head, first_byte),
+                                                                         _mm256_cmpeq_epi8(tail, last_byte)));
+        while (mask != 0) {
+            unsigned bit = lowest_bit(mask);
+            if (memcmp(text + i + bit + 1, needle.data() + 1, last - 1) == 0) {
+                return i + bit;
+            }
+            mask &= mask - 1;
+        }
+    }
+    size_t rest = sse2_find(text + i, size - i, needle);
+    return rest == std::string_view::npos ? rest : i + rest;
+}
+
+#endif // HTML_SCAN_X86
+
+const ScanKernels SCALAR_KERNELS = {ScanLevel::Scalar, scalar_byte_mask, scalar_find};
+#ifdef HTML_SCAN_X86
+const ScanKernels SSE2_KERNELS = {ScanLevel::SSE2, sse2_byte_mask, sse2_find};
+const ScanKernels AVX2_KERNELS = {ScanLevel::AVX2, avx2_byte_mask, avx2_find};
+#endif
+
+bool cpu_has_avx2() {
+#if !defined(HTML_SCAN_X86)
+    return false;
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    // AVX2 needs the OS to save the YMM registers too (OSXSAVE, then XCR0 bits 1 and 2)
+    __cpuid(info, 1);
+    if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    // Also checks that the OS saves the YMM registers
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+const ScanKernels* kernels_for(ScanLevel level) {
+#ifdef HTML_SCAN_X86
+    if (level == ScanLevel::AVX2) {
+        return &AVX2_KERNELS;
+    }
+    if (level == ScanLevel::SSE2) {
+        return &SSE2_KERNELS;
+    }
+#endif
+    return &SCALAR_KERNELS;
+}
+
+std::atomic<const ScanKernels*>& active_kernels() {
+    static std::atomic<const ScanKernels*> kernels(kernels_for(scan_level_supported()));
+    return kernels;
+}
+
+} // namespace
+
+ScanLevel scan_level_supported() {
+#ifdef HTML_SCAN_X86
+    static const ScanLevel supported = cpu_has_avx2() ? ScanLevel::AVX2 : ScanLevel::SSE2;
+    return supported;
+#else
+    return ScanLevel::Scalar;
+#endif
+}
+
+ScanLevel scan_level() {
+    return active_kernels().load(std::memory_order_relaxed)->level;
+}
+
+ScanLevel set_scan_level(ScanLevel level) {
+    if (level > scan_level_supported()) {
+        level = scan_level_supported();
+    }
+    active_kernels().store(kernels_for(level), std::memory_order_relaxed);
+    return level;
+}
+
+const char* scan_level_name(ScanLevel level) {
+    switch (level) {
+    case ScanLevel::AVX2:
+        return "avx2";
+    case ScanLevel::SSE2:
+        return "sse2";
+    default:
+        return "scalar";
+    }
+}
+
+std::string_view::size_type scan_find(std::string_view text, std::string_view needle, size_t pos) {
+    if (pos > text.size() || needle.size() > text.size() - pos) {
+        return std::string_view::npos;
+    }
+    if (needle.size() < 2) {
+        return text.find(needle, pos);
+    }
+    size_t found = active_kernels().load(std::memory_order_relaxed)->find(text.data() + pos, text.size() - pos, needle);
+    return found == std::string_view::npos ? found : pos + found;
+}
+
+uint64_t scan_byte_mask(const char* block, size_t size, char c) {
+    if (size == 64) {
+        return active_kernels().load(std::memory_order_relaxed)->byte_mask(block, c);
+    }
+    // The last, partial block of a text
+    uint64_t mask = 0;
+    for (size_t i = 0; i < size; ++i) {
+        mask |= (uint64_t)(block[i] == c) << i;
+    }
+    return mask;
+}
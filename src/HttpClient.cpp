@@ -7,200 +7,586 @@
 #endif
 
 #include "../include/HttpClient.h"
+#include "../include/ConnectionPool.h"
 #include "../include/config.h"
 #include "../include/compat.h"
 #include <iostream>
 #include <sstream>
+#include <set>
+#include <mutex>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+#include <thread>
+#include <chrono>
 
-std::string http_get(const std::string& hostname, const std::string& resource_path) {
-    #ifdef _WIN32
-    // Initialize Winsock
-    WSADATA wsaData;
-    int wsa_result = WSAStartup(MAKEWORD(2, 2), &wsaData);
-    if (wsa_result != 0) {
-        std::cerr << "WSAStartup failed: " << wsa_result << std::endl;
-        return "";
+// Writing to a socket the server already closed must not raise SIGPIPE
+#ifdef MSG_NOSIGNAL
+#define SEND_FLAGS MSG_NOSIGNAL
+#else
+#define SEND_FLAGS 0
+#endif
+
+// Outcome of reading one response from a (possibly reused) socket
+enum class ReadResult {
+    Complete,     // Full response read; socket state decided by keep_alive
+    PeerClosed,   // Server closed before sending anything (stale keep-alive socket)
+    Error,        // Receive error, malformed or truncated response
+    Stopped       // The body callback asked to stop mid-response
+};
+
+// Where read_response hands body bytes as they arrive (http_get_stream)
+struct BodyStream {
+    const BodyChunkCallback* on_chunk = nullptr;
+    size_t delivered = 0;   // Body bytes already passed to on_chunk
+
+    // Pass on whatever the parser has added to the body; false if the callback said stop
+    bool deliver(const HttpResponseParser& parser, const RecvBuffer& buffer) {
+        if (on_chunk == nullptr || !parser.headers_complete()) {
+            return true;
+        }
+        std::string_view body = parser.body_so_far(buffer);
+        if (body.size() <= delivered) {
+            return true;
+        }
+        std::string_view chunk = body.substr(delivered);
+        delivered = body.size();
+        return (*on_chunk)(parser.response(), chunk);
     }
-    #endif
-
-    SOCKET sock = INVALID_SOCKET;
-    std::string response;
-    int result = 0;  // Declare result variable at the start
-
-    // First try using getaddrinfo if available
-    #ifdef _WIN32
-    // Check if getaddrinfo is available (it is in most modern Windows systems)
-    HMODULE ws2_32 = GetModuleHandle("ws2_32.dll");
-    if (ws2_32 != NULL) {
-        typedef int (WSAAPI *PGETADDRINFO)(const char*, const char*, const struct addrinfo*, struct addrinfo**);
-        typedef void (WSAAPI *PFREEADDRINFO)(struct addrinfo*);
-        
-        PGETADDRINFO pGetAddrInfo = (PGETADDRINFO)GetProcAddress(ws2_32, "getaddrinfo");
-        PFREEADDRINFO pFreeAddrInfo = (PFREEADDRINFO)GetProcAddress(ws2_32, "freeaddrinfo");
-        
-        if (pGetAddrInfo != NULL && pFreeAddrInfo != NULL) {
-            // Modern system, use getaddrinfo
-            struct addrinfo hints;
-            struct addrinfo* addr_info = nullptr;
-            
-            ZeroMemory(&hints, sizeof(hints));
-            hints.ai_family = AF_INET;
-            hints.ai_socktype = SOCK_STREAM;
-            hints.ai_protocol = IPPROTO_TCP;
-            
-            result = (*pGetAddrInfo)(hostname.c_str(), "80", &hints, &addr_info);
-            if (result == 0 && addr_info != nullptr) {
-                // Create socket
-                sock = socket(addr_info->ai_family, addr_info->ai_socktype, addr_info->ai_protocol);
-                if (sock != INVALID_SOCKET) {
-                    // Connect to the server
-                    result = connect(sock, addr_info->ai_addr, (int)addr_info->ai_addrlen);
-                    if (result == SOCKET_ERROR) {
-                        std::cerr << "Error connecting to server via getaddrinfo: " << WSAGetLastError() << std::endl;
-                        CLOSE_SOCKET(sock);
-                        sock = INVALID_SOCKET;
-                    }
-                }
-                (*pFreeAddrInfo)(addr_info);
-            }
+};
+
+// send() on the connection, through its TLS session if it has one.
+// Returns the bytes written or SOCKET_ERROR.
+static int conn_send(PooledConnection& conn, const char* data, size_t length) {
+    if (!conn.tls) {
+        return send(conn.sock, data, (int)length, SEND_FLAGS);
+    }
+    size_t sent = 0;
+    TlsResult result = conn.tls->write(data, length, sent);
+    if (result != TlsResult::Ok) {
+        if (result == TlsResult::Error) {
+            std::cerr << conn.tls->error() << std::endl;
         }
+        return SOCKET_ERROR;
     }
-    #else
-    // On non-Windows systems, use getaddrinfo directly
-    struct addrinfo hints;
-    struct addrinfo* addr_info = nullptr;
-    
-    memset(&hints, 0, sizeof(hints));
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
-    hints.ai_protocol = IPPROTO_TCP;
-    
-    result = getaddrinfo(hostname.c_str(), "80", &hints, &addr_info);
-    if (result == 0 && addr_info != nullptr) {
-        // Create socket
-        sock = socket(addr_info->ai_family, addr_info->ai_socktype, addr_info->ai_protocol);
-        if (sock != INVALID_SOCKET) {
-            // Connect to the server
-            result = connect(sock, addr_info->ai_addr, (int)addr_info->ai_addrlen);
-            if (result == SOCKET_ERROR) {
-                std::cerr << "Error connecting to server via getaddrinfo" << std::endl;
-                CLOSE_SOCKET(sock);
-                sock = INVALID_SOCKET;
-            }
+    return (int)sent;
+}
+
+// recv() on the connection, through its TLS session if it has one.
+// Returns the bytes read, 0 once the peer closed, or SOCKET_ERROR.
+static int conn_recv(PooledConnection& conn, char* data, size_t length) {
+    if (!conn.tls) {
+        return recv(conn.sock, data, (int)length, 0);
+    }
+    size_t received = 0;
+    TlsResult result = conn.tls->read(data, length, received);
+    if (result == TlsResult::Ok) {
+        return (int)received;
+    }
+    if (result == TlsResult::Closed) {
+        return 0;
+    }
+    // The socket blocks, so WantRead/WantWrite mean its timeout expired
+    if (result == TlsResult::Error) {
+        std::cerr << conn.tls->error() << std::endl;
+    }
+    return SOCKET_ERROR;
+}
+
+// Read exactly one HTTP response into buffer, stopping as soon as the parser
+// reports the message complete so the socket can carry the next request.
+// Bytes already in the buffer (left over from a pipelined response) are parsed
+// first; anything past message_end() belongs to the next response.
+// With a stream, body bytes are handed to its callback after every receive.
+static ReadResult read_response(PooledConnection& conn, HttpResponseParser& parser, RecvBuffer& buffer, bool& keep_alive,
+                                BodyStream* stream = nullptr) {
+    size_t total_received = buffer.size();
+    keep_alive = false;
+
+    if (total_received > 0) {
+        parser.advance(buffer);
+        if (stream != nullptr && !stream->deliver(parser, buffer)) {
+            return ReadResult::Stopped;
+        }
+    }
+
+    while (!parser.complete()) {
+        if (parser.failed()) {
+            std::cerr << "Invalid HTTP response: " << parser.error() << std::endl;
+            return ReadResult::Error;
         }
-        freeaddrinfo(addr_info);
-    }
-    #endif
-
-    // Fallback to older method if getaddrinfo failed or is not available
-    if (sock == INVALID_SOCKET) {
-        // Set up server address using older methods
-        struct sockaddr_in serverAddr;
-        ZeroMemory(&serverAddr, sizeof(serverAddr));
-        serverAddr.sin_family = AF_INET;
-        serverAddr.sin_port = htons(80);  // HTTP port
-        
-        // Convert hostname to IP address
-        serverAddr.sin_addr.s_addr = inet_addr(hostname.c_str());
-        
-        // If hostname is not a valid IP address, try to resolve it
-        if (serverAddr.sin_addr.s_addr == INADDR_NONE) {
-            // Use gethostbyname (older but widely available)
-            struct hostent* host = gethostbyname(hostname.c_str());
-            if (host == nullptr) {
-                std::cerr << "Failed to resolve hostname: " << hostname << std::endl;
-                SOCKET_CLEANUP;
-                return "";
+        size_t wanted = parser.next_read_size();
+        int result = conn_recv(conn, buffer.prepare(wanted), wanted);
+        if (result > 0) {
+            total_received += result;
+            buffer.commit((size_t)result);
+            parser.advance(buffer);
+            if (stream != nullptr && !parser.failed() && !stream->deliver(parser, buffer)) {
+                return ReadResult::Stopped;
             }
-            // Copy the resolved IP address
-            memcpy(&serverAddr.sin_addr, host->h_addr_list[0], host->h_length);
-        }
-        
-        // Create socket
-        sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-        if (sock == INVALID_SOCKET) {
-            std::cerr << "Error creating socket in fallback method" << std::endl;
-            SOCKET_CLEANUP;
-            return "";
-        }
-        
-        // Connect to the server
-        result = connect(sock, (struct sockaddr*)&serverAddr, sizeof(serverAddr));
-        if (result == SOCKET_ERROR) {
-            std::cerr << "Error connecting to server in fallback method" << std::endl;
-            CLOSE_SOCKET(sock);
-            SOCKET_CLEANUP;
-            return "";
-        }
-    }
-
-    // If we get here, we have a valid connected socket
-    // Add socket timeouts to prevent hanging forever on slow servers
-    #ifdef _WIN32
-    DWORD timeout = 30000;  // 30 seconds in milliseconds
-    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
-    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
-    #else
-    struct timeval timeout;
-    timeout.tv_sec = 30;  // 30 seconds timeout
-    timeout.tv_usec = 0;
-    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (char*)&timeout, sizeof(timeout));
-    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (char*)&timeout, sizeof(timeout));
-    #endif
-    
-    // Build the HTTP request
+        } else if (result == 0) {
+            // Connection closed
+            if (total_received == 0) {
+                return ReadResult::PeerClosed;
+            }
+            parser.finish_on_close();
+            if (parser.failed()) {
+                std::cerr << "Invalid HTTP response: " << parser.error() << std::endl;
+                return ReadResult::Error;
+            }
+            if (stream != nullptr && !stream->deliver(parser, buffer)) {
+                return ReadResult::Stopped;
+            }
+            return ReadResult::Complete;
+        } else {
+            #ifdef _WIN32
+            std::cerr << "Error receiving data: " << WSAGetLastError() << std::endl;
+            #else
+            std::cerr << "Error receiving data" << std::endl;
+            #endif
+            return total_received == 0 ? ReadResult::PeerClosed : ReadResult::Error;
+        }
+    }
+
+    keep_alive = parser.response().keep_alive;
+    return ReadResult::Complete;
+}
+
+// Hosts every path of which is fetched over TLS (http_set_tls_host)
+static std::mutex tls_hosts_mutex;
+static std::set<std::string> tls_hosts;
+
+void http_set_tls_host(const std::string& hostname, bool enabled) {
+    std::lock_guard<std::mutex> lock(tls_hosts_mutex);
+    if (enabled) {
+        tls_hosts.insert(hostname);
+    } else {
+        tls_hosts.erase(hostname);
+    }
+}
+
+bool http_uses_tls(const std::string& hostname, const std::string& resource_path) {
+    bool wanted = resource_path.compare(0, 8, "https://") == 0;
+    if (!wanted) {
+        std::lock_guard<std::mutex> lock(tls_hosts_mutex);
+        wanted = tls_hosts.find(hostname) != tls_hosts.end();
+    }
+    if (wanted && !TlsContext::available()) {
+        static std::once_flag warned;
+        std::call_once(warned, []() {
+            std::cerr << "Built without TLS support; fetching https:// URLs over plain HTTP" << std::endl;
+        });
+        return false;
+    }
+    return wanted;
+}
+
+// Filter every response parser starts from (http_set_body_filter)
+static std::mutex body_filter_mutex;
+static BodyFilter body_filter;
+
+void http_set_body_filter(const BodyFilter& filter) {
+    std::lock_guard<std::mutex> lock(body_filter_mutex);
+    body_filter = filter;
+}
+
+BodyFilter http_body_filter() {
+    std::lock_guard<std::mutex> lock(body_filter_mutex);
+    return body_filter;
+}
+
+// Address every fetch connects to instead of the URL's host (http_set_connect_to)
+static std::mutex connect_to_mutex;
+static std::string connect_to;
+
+void http_set_connect_to(const std::string& address) {
+    std::lock_guard<std::mutex> lock(connect_to_mutex);
+    connect_to = address;
+}
+
+// Split "host:port" (or "[v6-address]:port"); without a valid port host is
+// the whole address and port stays as given
+static void split_host_port(const std::string& address, std::string& host, int& port) {
+    host = address;
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos || colon + 1 == address.length()) {
+        return;
+    }
+    // A bare IPv6 literal has colons of its own; one with a port is bracketed
+    bool bracketed = address[0] == '[';
+    if (!bracketed && address.find(':') != colon) {
+        return;
+    }
+    if (bracketed && address[colon - 1] != ']') {
+        return;
+    }
+    int parsed = 0;
+    for (size_t i = colon + 1; i < address.length(); ++i) {
+        if (!isdigit((unsigned char)address[i]) || parsed > 65535) {
+            return;
+        }
+        parsed = parsed * 10 + (address[i] - '0');
+    }
+    if (parsed == 0 || parsed > 65535) {
+        return;
+    }
+    host = bracketed ? address.substr(1, colon - 2) : address.substr(0, colon);
+    port = parsed;
+}
+
+void http_endpoint(const std::string& hostname, bool tls, std::string& host, int& port) {
+    port = tls ? 443 : 80;
+    std::string address;
+    {
+        std::lock_guard<std::mutex> lock(connect_to_mutex);
+        address = connect_to.empty() ? hostname : connect_to;
+    }
+    split_host_port(address, host, port);
+}
+
+// The GET for a page; conditional adds the validators of an earlier crawl
+static std::string build_request(const std::string& hostname, const std::string& resource_path, bool conditional) {
     std::ostringstream request_stream;
     request_stream << "GET " << resource_path << " HTTP/1.1\r\n";
     request_stream << "Host: " << hostname << "\r\n";
-    request_stream << "Connection: close\r\n";
+    request_stream << "Connection: keep-alive\r\n";
+    const char* accept_encoding = ContentDecoder::accept_encoding();
+    if (*accept_encoding != '\0') {
+        request_stream << "Accept-Encoding: " << accept_encoding << "\r\n";
+    }
     request_stream << "User-Agent: CustomScraper/1.0\r\n";
+    // Revalidate pages seen on an earlier crawl
+    if (conditional) {
+        request_stream << validator_store().conditional_headers(validator_key(hostname, resource_path));
+    }
     request_stream << "\r\n";
-    
-    std::string request = request_stream.str();
-
-    // Send the request
-    int send_result = send(sock, request.c_str(), (int)request.length(), 0);
-    if (send_result == SOCKET_ERROR) {
-        #ifdef _WIN32
-        std::cerr << "Error sending request: " << WSAGetLastError() << std::endl;
-        #else
-        std::cerr << "Error sending request" << std::endl;
-        #endif
-        CLOSE_SOCKET(sock);
-        SOCKET_CLEANUP;
-        return "";
+    return request_stream.str();
+}
+
+std::string build_get_request(const std::string& hostname, const std::string& resource_path) {
+    return build_request(hostname, resource_path, true);
+}
+
+void http_response_received(const std::string& hostname, const std::string& resource_path, HttpResponse& response) {
+    if (!response.skipped.empty()) {
+        return;  // Only the headers arrived; there is no body to archive or fingerprint
     }
+    std::string key = validator_key(hostname, resource_path);
+    response_archive().record(key, response);
+    validator_store().record(key, response);
+}
 
-    // Receive the response
-    const int buffer_size = 4096;
-    char buffer[buffer_size];
+bool http_replay(const std::string& hostname, const std::string& resource_path, HttpResponse& response) {
+    std::string key = validator_key(hostname, resource_path);
+    if (!response_archive().lookup(key, response)) {
+        std::cerr << "Not in response archive: " << key << std::endl;
+        return false;
+    }
+    validator_store().record(key, response);
+    return true;
+}
 
-    // Loop until connection is closed or error occurs
-    while (true) {
-        result = recv(sock, buffer, buffer_size - 1, 0);
-        if (result > 0) {
-            buffer[result] = '\0';  // Null-terminate the received data
-            response += buffer;
-        } else if (result == 0) {
-            // Connection closed
-            break;
-        } else {
+// http_fetch, optionally streaming the body to on_chunk as it arrives. A
+// resource that is not a page (!page) skips the validators and the body filter.
+static bool fetch_response(const std::string& hostname, const std::string& resource_path, HttpResponse& response,
+                           const BodyChunkCallback* on_chunk, bool page = true) {
+    if (response_archive().replaying()) {
+        std::chrono::milliseconds latency = response_archive().replay_latency();
+        if (latency.count() > 0) {
+            std::this_thread::sleep_for(latency);
+        }
+        if (!page) {
+            return response_archive().lookup(validator_key(hostname, resource_path), response);
+        }
+        if (!http_replay(hostname, resource_path, response)) {
+            return false;
+        }
+        // The archived body is all there at once: one chunk
+        return on_chunk == nullptr || response.body.empty() || (*on_chunk)(response, response.body);
+    }
+
+    ConnectionPool& pool = connection_pool();
+
+    // Build the HTTP request
+    std::string request = build_request(hostname, resource_path, page);
+
+    bool tls = http_uses_tls(hostname, resource_path);
+    std::string host;
+    int port = 0;
+    http_endpoint(hostname, tls, host, port);
+    PooledConnection conn;
+    if (!pool.acquire(host, port, conn, tls)) {
+        std::cerr << "Failed to connect to " << hostname << std::endl;
+        return false;
+    }
+
+    HttpResponseParser parser;
+    parser.set_filter(page ? http_body_filter() : BodyFilter());
+    PooledBuffer buffer = PooledBuffer::acquire();
+
+    // A reused socket may have been closed by the server while idle; in that
+    // case reconnect once and resend transparently
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        bool keep_alive = false;
+        ReadResult read_result = ReadResult::Error;
+        parser.reset();
+        buffer->clear();
+        // Nothing reaches the callback unless the response arrives, so a retry never repeats bytes
+        BodyStream stream;
+        stream.on_chunk = on_chunk;
+
+        // Send the request
+        int send_result = conn_send(conn, request.c_str(), request.length());
+        if (send_result != SOCKET_ERROR) {
+            read_result = read_response(conn, parser, *buffer, keep_alive, on_chunk != nullptr ? &stream : nullptr);
+        } else if (!conn.reused) {
             #ifdef _WIN32
-            std::cerr << "Error receiving data: " << WSAGetLastError() << std::endl;
+            std::cerr << "Error sending request: " << WSAGetLastError() << std::endl;
             #else
-            std::cerr << "Error receiving data" << std::endl;
+            std::cerr << "Error sending request" << std::endl;
             #endif
-            CLOSE_SOCKET(sock);
-            SOCKET_CLEANUP;
-            return "";
         }
+
+        if (read_result == ReadResult::Complete) {
+            if (parser.message_end() < buffer->size()) {
+                // Unsolicited bytes after the response: do not trust this socket again
+                keep_alive = false;
+            }
+            pool.release(conn, keep_alive);
+            response = std::move(parser.finalize(std::move(buffer)));
+            if (page) {
+                http_response_received(hostname, resource_path, response);
+            } else {
+                response_archive().record(validator_key(hostname, resource_path), response);
+            }
+            return true;
+        }
+
+        bool was_reused = conn.reused;
+        pool.release(conn, false);
+
+        if (read_result == ReadResult::Stopped) {
+            return false;  // The rest of the body was not wanted; the socket is discarded
+        }
+        if (!was_reused || (send_result != SOCKET_ERROR && read_result != ReadResult::PeerClosed)) {
+            return false;
+        }
+
+        pool.record_reconnect();
+        if (!pool.acquire_fresh(host, port, conn, tls)) {
+            std::cerr << "Failed to reconnect to " << hostname << std::endl;
+            return false;
+        }
+    }
+
+    return false;
+}
+
+bool http_fetch(const std::string& hostname, const std::string& resource_path, HttpResponse& response) {
+    return fetch_response(hostname, resource_path, response, nullptr);
+}
+
+bool http_get_stream(const std::string& hostname, const std::string& resource_path,
+                     const BodyChunkCallback& on_chunk, HttpResponse& response) {
+    return fetch_response(hostname, resource_path, response, &on_chunk);
+}
+
+bool http_fetch_resource(const std::string& hostname, const std::string& resource_path, HttpResponse& response) {
+    return fetch_response(hostname, resource_path, response, nullptr, false);
+}
+
+// Hosts that mishandled a pipelined batch; later batches to them go serial
+static std::mutex no_pipelining_mutex;
+static std::set<std::string> no_pipelining_hosts;
+
+static bool pipelining_allowed(const std::string& hostname) {
+    std::lock_guard<std::mutex> lock(no_pipelining_mutex);
+    return no_pipelining_hosts.find(hostname) == no_pipelining_hosts.end();
+}
+
+static void disable_pipelining(const std::string& hostname) {
+    std::lock_guard<std::mutex> lock(no_pipelining_mutex);
+    if (no_pipelining_hosts.insert(hostname).second) {
+        std::cerr << "Pipelining disabled for " << hostname << ", falling back to serial requests" << std::endl;
+    }
+}
+
+// Send the GETs for results[from, to) back to back in one write
+static bool send_requests(PooledConnection& conn, const std::string& hostname,
+                          const std::vector<HttpBatchResult>& results, size_t from, size_t to) {
+    std::string batch;
+    for (size_t i = from; i < to; ++i) {
+        batch += build_get_request(hostname, results[i].resource_path);
+    }
+    size_t sent = 0;
+    while (sent < batch.length()) {
+        int result = conn_send(conn, batch.data() + sent, batch.length() - sent);
+        if (result == SOCKET_ERROR || result == 0) {
+            return false;
+        }
+        sent += (size_t)result;
+    }
+    return true;
+}
+
+// Run one pipelined exchange on a single connection, starting at results[first].
+// Keeps up to depth requests outstanding and matches responses back in order.
+// Returns how many results were answered; misbehaved is set if the server
+// broke the pipeline (garbled framing, or hung up without answering anything).
+static size_t pipeline_round(const std::string& hostname, std::vector<HttpBatchResult>& results,
+                             size_t first, size_t depth, bool tls, bool& misbehaved) {
+    ConnectionPool& pool = connection_pool();
+    misbehaved = false;
+
+    std::string host;
+    int port = 0;
+    http_endpoint(hostname, tls, host, port);
+    PooledConnection conn;
+    if (!pool.acquire(host, port, conn, tls)) {
+        std::cerr << "Failed to connect to " << hostname << std::endl;
+        return 0;
+    }
+
+    size_t total = results.size();
+    size_t sent = first;
+    size_t answered = first;
+    bool keep_alive = true;
+    bool send_failed = false;   // A request may be half written; the socket must not be reused
+    PooledBuffer buffer = PooledBuffer::acquire();
+    HttpResponseParser parser;
+    parser.set_filter(http_body_filter());
+
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        sent = std::min(total, first + depth);
+        bool sent_ok = send_requests(conn, hostname, results, first, sent);
+
+        ReadResult read_result = ReadResult::Complete;
+        while (sent_ok && answered < sent) {
+            parser.reset();
+            read_result = read_response(conn, parser, *buffer, keep_alive);
+            if (read_result != ReadResult::Complete) {
+                break;
+            }
+
+            // Carry bytes of the following responses over into a fresh buffer
+            PooledBuffer next = PooledBuffer::acquire();
+            size_t leftover = buffer->size() - parser.message_end();
+            if (leftover > 0) {
+                memcpy(next->prepare(leftover), buffer->data() + parser.message_end(), leftover);
+                next->commit(leftover);
+            }
+            results[answered].ok = true;
+            results[answered].response = std::move(parser.finalize(std::move(buffer)));
+            http_response_received(hostname, results[answered].resource_path, results[answered].response);
+            buffer = std::move(next);
+            answered++;
+
+            if (!keep_alive) {
+                break;  // Server is closing; unanswered requests go on a new connection
+            }
+            // Slide the window: one request out for each response in
+            if (sent < total) {
+                if (!send_requests(conn, hostname, results, sent, sent + 1)) {
+                    send_failed = true;
+                    break;
+                }
+                sent++;
+            }
+        }
+
+        bool stale_socket = answered == first && conn.reused &&
+                            (!sent_ok || read_result == ReadResult::PeerClosed);
+        if (!stale_socket) {
+            misbehaved = read_result == ReadResult::Error ||
+                         (answered == first && sent_ok && read_result == ReadResult::PeerClosed);
+            break;
+        }
+
+        // A stale keep-alive socket: reconnect once and resend the window
+        pool.release(conn, false);
+        pool.record_reconnect();
+        if (!pool.acquire_fresh(host, port, conn, tls)) {
+            std::cerr << "Failed to reconnect to " << hostname << std::endl;
+            return 0;
+        }
+        buffer->clear();
     }
 
-    // Clean up
-    CLOSE_SOCKET(sock);
-    SOCKET_CLEANUP;
+    bool reusable = !send_failed && keep_alive && answered == sent && buffer->size() == 0;
+    pool.release(conn, reusable);
+    return answered - first;
+}
+
+std::vector<HttpBatchResult> http_get_many(const std::string& hostname, const std::vector<std::string>& resource_paths,
+                                           size_t pipeline_depth) {
+    std::vector<HttpBatchResult> results(resource_paths.size());
+    for (size_t i = 0; i < resource_paths.size(); ++i) {
+        results[i].resource_path = resource_paths[i];
+    }
+
+    // One connection carries the whole pipeline, so every page must want the same scheme
+    bool tls = !results.empty() && http_uses_tls(hostname, results[0].resource_path);
+    bool same_scheme = true;
+    for (const HttpBatchResult& result : results) {
+        same_scheme = same_scheme && http_uses_tls(hostname, result.resource_path) == tls;
+    }
+
+    size_t next = 0;
+    // Replayed fetches never touch a socket, so there is nothing to pipeline
+    if (pipeline_depth > 1 && results.size() > 1 && same_scheme && pipelining_allowed(hostname) &&
+        !response_archive().replaying()) {
+        while (next < results.size()) {
+            bool misbehaved = false;
+            size_t answered = pipeline_round(hostname, results, next, pipeline_depth, tls, misbehaved);
+            next += answered;
+            if (misbehaved) {
+                disable_pipelining(hostname);
+            }
+            if (misbehaved || answered == 0) {
+                break;
+            }
+        }
+    }
+
+    // Serial fallback for whatever the pipeline did not answer
+    for (; next < results.size(); ++next) {
+        results[next].ok = http_fetch(hostname, results[next].resource_path, results[next].response);
+    }
+    return results;
+}
+
+std::string http_get(const std::string& hostname, const std::string& resource_path) {
+    HttpResponse response;
+    if (!http_fetch(hostname, resource_path, response)) {
+        return "";
+    }
+
+    // Re-serialize for callers that still split headers from the body themselves
+    return serialize_response(response);
+}
+
+ConnectionPoolStats http_pool_stats() {
+    return connection_pool().get_stats();
+}
+
+DnsCacheStats http_dns_stats() {
+    return dns_cache().get_stats();
+}
+
+TcpConnectStats http_connect_stats() {
+    return tcp_connector().get_stats();
+}
+
+TlsStats http_tls_stats() {
+    return tls_context().get_stats();
+}
+
+ValidatorStoreStats http_validator_stats() {
+    return validator_store().get_stats();
+}
 
-    return response;
+ResponseArchiveStats http_archive_stats() {
+    return response_archive().get_stats();
 }
 
 std::string extract_body(const std::string& response) {
@@ -212,4 +598,4 @@ std::string extract_body(const std::string& response) {
     
     // Return the body (everything after the separator)
     return response.substr(pos + 4);
-} 
\ No newline at end of file
+}
\ No newline at end of file
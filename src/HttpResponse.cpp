@@ -0,0 +1,466 @@
+#include "../include/HttpResponse.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <atomic>
+#include <sstream>
+
+// Guard against servers that never terminate a status or header line
+const size_t MAX_LINE_LENGTH = 64 * 1024;
+
+// Totals behind http_transfer_stats()
+static std::atomic<unsigned long long> total_responses(0);
+static std::atomic<unsigned long long> total_decoded_responses(0);
+static std::atomic<unsigned long long> total_encoded_bytes(0);
+static std::atomic<unsigned long long> total_decoded_bytes(0);
+static std::atomic<unsigned long long> total_skipped_bodies(0);
+
+// recv() size while the body length is unknown
+const size_t RECV_CHUNK_SIZE = 16 * 1024;
+
+// Largest single recv() into a sized body
+const size_t MAX_RECV_SIZE = 1024 * 1024;
+
+// Longest chunk size line accepted, in hex digits (a 64-bit count)
+const size_t MAX_CHUNK_SIZE_DIGITS = 16;
+
+static std::string to_lower(std::string value) {
+    std::transform(value.begin(), value.end(), value.begin(),
+                  [](unsigned char c){ return std::tolower(c); });
+    return value;
+}
+
+static std::string trim(const std::string& value) {
+    size_t first = value.find_first_not_of(" \t");
+    if (first == std::string::npos) {
+        return "";
+    }
+    size_t last = value.find_last_not_of(" \t");
+    return value.substr(first, last - first + 1);
+}
+
+std::string HttpResponse::header(const std::string& name) const {
+    auto it = headers.find(to_lower(name));
+    return it != headers.end() ? it->second : "";
+}
+
+HttpResponseParser::HttpResponseParser() {
+    reset();
+}
+
+void HttpResponseParser::reset(bool head) {
+    state = State::StatusLine;
+    head_request = head;
+    chunked = false;
+    body_length = -1;
+    remaining = 0;
+    pos = 0;
+    line_scanned = 0;
+    body_start = 0;
+    body_end = 0;
+    decode_pos = 0;
+    decoder.reset();
+    decoded = PooledBuffer();
+    error_message.clear();
+    result = HttpResponse();
+}
+
+void HttpResponseParser::fail(const std::string& message) {
+    state = State::Error;
+    error_message = message;
+}
+
+std::string HttpResponseParser::rejected_type() const {
+    if (!body_filter.html_only) {
+        return "";
+    }
+    std::string content_type = to_lower(result.header("content-type"));
+    std::string media_type = trim(content_type.substr(0, content_type.find(';')));
+    if (media_type.empty() || media_type == "text/html" || media_type == "application/xhtml+xml") {
+        return "";
+    }
+    return "Content-Type " + media_type + " is not HTML";
+}
+
+std::string HttpResponseParser::rejected_size(unsigned long long body_bytes) const {
+    if (body_filter.max_body_bytes == 0 || body_bytes <= body_filter.max_body_bytes) {
+        return "";
+    }
+    return "body of " + std::to_string(body_bytes) + " bytes exceeds the " +
+           std::to_string(body_filter.max_body_bytes) + " byte cap";
+}
+
+void HttpResponseParser::skip_body(const std::string& reason) {
+    result.skipped = reason;
+    if (state != State::Complete) {
+        result.keep_alive = false;   // The rest of the body is still on its way; only a new connection is clean
+    }
+    body_end = body_start;
+    decode_pos = body_start;
+    decoder.reset();
+    decoded = PooledBuffer();
+    state = State::Complete;
+    total_skipped_bodies++;
+}
+
+bool HttpResponseParser::take_line(const RecvBuffer& buffer, std::string_view& line) {
+    const char* data = buffer.data();
+    size_t available = buffer.size() - pos;
+
+    // Only search bytes that arrived since the last attempt
+    const char* newline = static_cast<const char*>(
+        memchr(data + pos + line_scanned, '\n', available - line_scanned));
+    if (newline == nullptr) {
+        line_scanned = available;
+        if (available > MAX_LINE_LENGTH) {
+            fail("Header line too long");
+        }
+        return false;
+    }
+
+    size_t line_length = newline - (data + pos);
+    line = std::string_view(data + pos, line_length);
+    if (!line.empty() && line.back() == '\r') {
+        line.remove_suffix(1);
+    }
+    pos += line_length + 1;
+    line_scanned = 0;
+    return true;
+}
+
+bool HttpResponseParser::parse_status_line(std::string_view line) {
+    // HTTP/1.1 200 OK
+    if (line.compare(0, 5, "HTTP/") != 0) {
+        return false;
+    }
+    size_t first_space = line.find(' ');
+    if (first_space == std::string_view::npos) {
+        return false;
+    }
+    result.version = std::string(line.substr(0, first_space));
+
+    size_t code_start = first_space + 1;
+    if (line.length() < code_start + 3 ||
+        !std::isdigit((unsigned char)line[code_start]) ||
+        !std::isdigit((unsigned char)line[code_start + 1]) ||
+        !std::isdigit((unsigned char)line[code_start + 2])) {
+        return false;
+    }
+    result.status_code = (line[code_start] - '0') * 100 +
+                         (line[code_start + 1] - '0') * 10 +
+                         (line[code_start + 2] - '0');
+    result.reason = line.length() > code_start + 4 ? std::string(line.substr(code_start + 4)) : "";
+    return true;
+}
+
+bool HttpResponseParser::parse_header_line(std::string_view line) {
+    size_t colon = line.find(':');
+    if (colon == std::string_view::npos || colon == 0) {
+        return false;
+    }
+    std::string name = to_lower(trim(std::string(line.substr(0, colon))));
+    std::string value = trim(std::string(line.substr(colon + 1)));
+
+    auto it = result.headers.find(name);
+    if (it == result.headers.end()) {
+        result.headers[name] = value;
+    } else {
+        it->second += ", " + value;
+    }
+    return true;
+}
+
+void HttpResponseParser::on_headers_complete() {
+    // Interim 1xx responses are followed by the real one on the same connection
+    if (result.status_code >= 100 && result.status_code < 200 && result.status_code != 101) {
+        size_t next_message = pos;
+        reset(head_request);
+        pos = next_message;
+        return;
+    }
+
+    body_start = pos;
+    body_end = pos;
+    decode_pos = pos;
+
+    std::string connection = to_lower(result.header("connection"));
+    if (result.version == "HTTP/1.0") {
+        result.keep_alive = connection.find("keep-alive") != std::string::npos;
+    } else {
+        result.keep_alive = connection.find("close") == std::string::npos;
+    }
+
+    // Responses that never have a body (RFC 7230 section 3.3.3)
+    if (head_request || result.status_code == 204 || result.status_code == 304 ||
+        (result.status_code >= 100 && result.status_code < 200)) {
+        body_length = 0;
+        state = State::Complete;
+        return;
+    }
+
+    std::string skip = rejected_type();
+    if (!skip.empty()) {
+        skip_body(skip);
+        return;
+    }
+
+    // Compressed bodies are inflated as they arrive; unknown encodings pass through
+    std::string content_encoding = result.header("content-encoding");
+    if (!content_encoding.empty() && decoder.begin(content_encoding)) {
+        decoded = PooledBuffer::acquire();
+    }
+
+    std::string transfer_encoding = to_lower(result.header("transfer-encoding"));
+    if (transfer_encoding.find("chunked") != std::string::npos) {
+        chunked = true;
+        state = State::ChunkSize;
+        return;
+    }
+
+    std::string length = result.header("content-length");
+    if (!length.empty()) {
+        char* end = nullptr;
+        errno = 0;
+        long long parsed = std::strtoll(length.c_str(), &end, 10);
+        while (*end == ' ' || *end == '\t') {
+            end++;
+        }
+        if (parsed < 0 || end == length.c_str() || *end != '\0' || errno == ERANGE) {
+            fail("Invalid Content-Length: " + length);
+            return;
+        }
+        skip = rejected_size((unsigned long long)parsed);
+        if (!skip.empty()) {
+            skip_body(skip);
+            return;
+        }
+        body_length = parsed;
+        remaining = (unsigned long long)parsed;
+        state = remaining == 0 ? State::Complete : State::Body;
+        return;
+    }
+
+    // No framing information: the body runs until the server closes
+    result.keep_alive = false;
+    state = State::BodyUntilClose;
+}
+
+void HttpResponseParser::advance(RecvBuffer& buffer) {
+    parse(buffer);
+    if (decoder.active() && state != State::Error) {
+        decode_body(buffer);
+    }
+
+    // Bodies of unknown length are held to the cap as they grow, and so is
+    // what a compressed body inflates to, even once it is complete
+    if (body_filter.max_body_bytes > 0 && headers_complete() && !failed() && result.skipped.empty()) {
+        size_t body_bytes = std::max(body_end - body_start, decoded ? decoded->size() : (size_t)0);
+        std::string skip = rejected_size(body_bytes);
+        if (!skip.empty()) {
+            skip_body(skip);
+        }
+    }
+}
+
+void HttpResponseParser::decode_body(const RecvBuffer& buffer) {
+    if (body_end > decode_pos) {
+        if (!decoder.feed(buffer.data() + decode_pos, body_end - decode_pos, *decoded)) {
+            fail("Content decoding failed: " + decoder.error());
+            return;
+        }
+        decode_pos = body_end;
+    }
+    if (state == State::Complete && !decoder.finish()) {
+        fail("Content decoding failed: " + decoder.error());
+    }
+}
+
+void HttpResponseParser::parse(RecvBuffer& buffer) {
+    std::string_view line;
+
+    while (pos < buffer.size() && state != State::Complete && state != State::Error) {
+        switch (state) {
+            case State::StatusLine:
+                if (!take_line(buffer, line)) return;
+                if (line.empty()) break;  // Tolerate stray CRLF before the status line
+                if (!parse_status_line(line)) {
+                    fail("Malformed status line: " + std::string(line));
+                } else {
+                    state = State::Headers;
+                }
+                break;
+
+            case State::Headers:
+                if (!take_line(buffer, line)) return;
+                if (line.empty()) {
+                    on_headers_complete();
+                    if (state == State::Body) {
+                        // Size the buffer for the whole message so the body lands without
+                        // regrowth, up to MAX_RECV_SIZE: the length is the server's word, and
+                        // a bigger body grows the buffer as it actually arrives
+                        buffer.reserve(body_start + (size_t)std::min<long long>(body_length, MAX_RECV_SIZE));
+                    }
+                } else if (!parse_header_line(line)) {
+                    fail("Malformed header line: " + std::string(line));
+                }
+                break;
+
+            case State::Body: {
+                // The body is already where it belongs; just account for it
+                size_t take = (size_t)std::min<unsigned long long>(remaining, buffer.size() - pos);
+                pos += take;
+                body_end = pos;
+                remaining -= take;
+                if (remaining == 0) {
+                    state = State::Complete;
+                }
+                break;
+            }
+
+            case State::BodyUntilClose:
+                pos = buffer.size();
+                body_end = pos;
+                break;
+
+            case State::ChunkSize: {
+                if (!take_line(buffer, line)) return;
+                // Ignore chunk extensions after ';'
+                std::string size_str = trim(std::string(line.substr(0, line.find(';'))));
+                // Hex digits only: no sign or "0x", and few enough that the size cannot overflow
+                unsigned long long size = 0;
+                bool valid = !size_str.empty() && size_str.size() <= MAX_CHUNK_SIZE_DIGITS;
+                for (size_t i = 0; valid && i < size_str.size(); ++i) {
+                    char c = size_str[i];
+                    int digit = c >= '0' && c <= '9' ? c - '0'
+                              : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                              : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+                    valid = digit >= 0;
+                    size = size * 16 + (unsigned long long)(valid ? digit : 0);
+                }
+                if (!valid) {
+                    fail("Malformed chunk size: " + std::string(line));
+                    break;
+                }
+                remaining = size;
+                state = size == 0 ? State::Trailers : State::ChunkData;
+                break;
+            }
+
+            case State::ChunkData: {
+                // Slide the chunk down over the framing so the body stays contiguous
+                size_t take = (size_t)std::min<unsigned long long>(remaining, buffer.size() - pos);
+                if (body_end != pos) {
+                    memmove(buffer.data() + body_end, buffer.data() + pos, take);
+                }
+                body_end += take;
+                pos += take;
+                remaining -= take;
+                if (remaining == 0) {
+                    state = State::ChunkDataEnd;
+                }
+                break;
+            }
+
+            case State::ChunkDataEnd:
+                if (!take_line(buffer, line)) return;
+                if (!line.empty()) {
+                    fail("Missing CRLF after chunk data");
+                } else {
+                    state = State::ChunkSize;
+                }
+                break;
+
+            case State::Trailers:
+                if (!take_line(buffer, line)) return;
+                if (line.empty()) {
+                    state = State::Complete;
+                } else {
+                    parse_header_line(line);
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+void HttpResponseParser::finish_on_close() {
+    if (state == State::BodyUntilClose) {
+        state = State::Complete;
+        if (decoder.active() && !decoder.finish()) {
+            fail("Content decoding failed: " + decoder.error());
+        }
+    } else if (state != State::Complete) {
+        fail("Connection closed before the response was complete");
+    }
+}
+
+size_t HttpResponseParser::next_read_size() const {
+    if (state == State::Body && remaining > 0) {
+        return (size_t)std::min<unsigned long long>(remaining, MAX_RECV_SIZE);
+    }
+    return RECV_CHUNK_SIZE;
+}
+
+std::string_view HttpResponseParser::body_so_far(const RecvBuffer& buffer) const {
+    if (!headers_complete() || failed()) {
+        return std::string_view();
+    }
+    if (decoder.active()) {
+        return decoded ? std::string_view(decoded->data(), decoded->size()) : std::string_view();
+    }
+    return std::string_view(buffer.data() + body_start, body_end - body_start);
+}
+
+HttpResponse& HttpResponseParser::finalize(PooledBuffer buffer) {
+    result.encoded_bytes = body_end - body_start;
+    if (decoder.active()) {
+        // The inflated copy backs the body; the raw buffer goes back to the pool
+        result.decoded = true;
+        result.buffer = std::move(decoded);
+        result.body = std::string_view(result.buffer->data(), result.buffer->size());
+        total_decoded_responses++;
+    } else {
+        result.buffer = std::move(buffer);
+        if (result.buffer && body_end > body_start) {
+            result.body = std::string_view(result.buffer->data() + body_start, body_end - body_start);
+        } else {
+            result.body = std::string_view();
+        }
+    }
+    total_responses++;
+    total_encoded_bytes += result.encoded_bytes;
+    total_decoded_bytes += result.body.size();
+    return result;
+}
+
+std::string serialize_response(const HttpResponse& response) {
+    std::ostringstream raw;
+    raw << response.version << " " << response.status_code << " " << response.reason << "\r\n";
+    for (const auto& header : response.headers) {
+        if (header.first == "transfer-encoding" || header.first == "content-length") {
+            continue;  // The body below is already de-chunked and gets its own length
+        }
+        if (response.decoded && header.first == "content-encoding") {
+            continue;  // ...and already inflated
+        }
+        raw << header.first << ": " << header.second << "\r\n";
+    }
+    raw << "content-length: " << response.body.size() << "\r\n";
+    raw << "\r\n";
+    raw << response.body;
+    return raw.str();
+}
+
+TransferStats http_transfer_stats() {
+    TransferStats stats;
+    stats.responses = total_responses.load();
+    stats.decoded_responses = total_decoded_responses.load();
+    stats.encoded_bytes = total_encoded_bytes.load();
+    stats.decoded_bytes = total_decoded_bytes.load();
+    stats.skipped_bodies = total_skipped_bodies.load();
+    return stats;
+}
@@ -0,0 +1,311 @@
+#include "../include/IoUring.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+
+#ifdef WEBSCRAPER_HAVE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <csignal>
+#include <ctime>
+#endif
+
+static void set_error(std::string* error, const std::string& message) {
+    if (error != nullptr) {
+        *error = message;
+    }
+}
+
+IoUring::IoUring()
+    : ring_fd(-1), sq_map(nullptr), sq_map_size(0), sq_head(nullptr), sq_tail(nullptr), sq_mask(0),
+      sq_entries(0), sqes(nullptr), sqes_size(0), sqe_tail(0), sqe_flushed(0), cq_map(nullptr),
+      cq_map_size(0), cq_head(nullptr), cq_tail(nullptr), cq_mask(0), cqes(nullptr), buffer_ring(nullptr),
+      buffer_ring_size(0), buffers(nullptr), buffer_count(0), buffer_size(0), buffer_tail(0) {}
+
+IoUring::~IoUring() {
+    release();
+}
+
+#ifdef WEBSCRAPER_HAVE_IO_URING
+
+// The rings are shared with the kernel: our tail stores must publish the
+// entries written before them, and head loads must see the kernel's writes
+static unsigned load_acquire(const unsigned* p) {
+    return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+static void store_release(unsigned* p, unsigned value) {
+    __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+bool IoUring::available() {
+    return true;
+}
+
+bool IoUring::init(unsigned entries, unsigned count, unsigned size, std::string* error) {
+    release();
+    if (count == 0 || (count & (count - 1)) != 0 || count > 32768 || size == 0) {
+        set_error(error, "io_uring: buffer count must be a power of two up to 32768");
+        return false;
+    }
+
+    // Cooperative task running saves an interrupt per completion; older kernels reject the flag
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CLAMP | IORING_SETUP_COOP_TASKRUN;
+    ring_fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring_fd < 0 && errno == EINVAL) {
+        memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CLAMP;
+        ring_fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    }
+    if (ring_fd < 0) {
+        set_error(error, "io_uring_setup failed: " + std::string(strerror(errno)));
+        return false;
+    }
+    // Timed waits need EXT_ARG (5.11); NODROP keeps completions from being lost on overflow
+    if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP)) {
+        set_error(error, "io_uring: kernel too old (needs timed waits)");
+        release();
+        return false;
+    }
+
+    sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        sq_map_size = cq_map_size = std::max(sq_map_size, cq_map_size);
+    }
+    sq_map = mmap(nullptr, sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                  IORING_OFF_SQ_RING);
+    if (sq_map == MAP_FAILED) {
+        sq_map = nullptr;
+        set_error(error, "io_uring: cannot map the submission queue");
+        release();
+        return false;
+    }
+    if (single_mmap) {
+        cq_map = sq_map;
+    } else {
+        cq_map = mmap(nullptr, cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                      IORING_OFF_CQ_RING);
+        if (cq_map == MAP_FAILED) {
+            cq_map = nullptr;
+            set_error(error, "io_uring: cannot map the completion queue");
+            release();
+            return false;
+        }
+    }
+    sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqe_map = mmap(nullptr, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                         IORING_OFF_SQES);
+    if (sqe_map == MAP_FAILED) {
+        set_error(error, "io_uring: cannot map the submission entries");
+        release();
+        return false;
+    }
+    sqes = (struct io_uring_sqe*)sqe_map;
+
+    char* sq = (char*)sq_map;
+    sq_head = (unsigned*)(sq + params.sq_off.head);
+    sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    sq_mask = *(unsigned*)(sq + params.sq_off.ring_mask);
+    sq_entries = params.sq_entries;
+    // Slot i of the queue always holds entry i
+    unsigned* array = (unsigned*)(sq + params.sq_off.array);
+    for (unsigned i = 0; i < sq_entries; ++i) {
+        array[i] = i;
+    }
+    sqe_tail = sqe_flushed = *sq_tail;
+
+    char* cq = (char*)cq_map;
+    cq_head = (unsigned*)(cq + params.cq_off.head);
+    cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    cq_mask = *(unsigned*)(cq + params.cq_off.ring_mask);
+    cqes = cq + params.cq_off.cqes;
+
+    // Receive buffers, published to the kernel through a registered buffer ring (5.19)
+    buffer_count = count;
+    buffer_size = size;
+    buffer_ring_size = count * sizeof(struct io_uring_buf);
+    buffer_ring = mmap(nullptr, buffer_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    void* buffer_map = mmap(nullptr, (size_t)count * size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer_ring == MAP_FAILED || buffer_map == MAP_FAILED) {
+        if (buffer_ring == MAP_FAILED) {
+            buffer_ring = nullptr;
+        }
+        if (buffer_map != MAP_FAILED) {
+            munmap(buffer_map, (size_t)count * size);
+        }
+        set_error(error, "io_uring: cannot allocate receive buffers");
+        release();
+        return false;
+    }
+    buffers = (char*)buffer_map;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (unsigned long long)(uintptr_t)buffer_ring;
+    reg.ring_entries = count;
+    reg.bgid = BUFFER_GROUP;
+    if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        set_error(error, "io_uring: cannot register receive buffers: " + std::string(strerror(errno)));
+        release();
+        return false;
+    }
+    buffer_tail = 0;
+    for (unsigned id = 0; id < count; ++id) {
+        recycle(id);
+    }
+    stats = IoUringStats();
+    return true;
+}
+
+void IoUring::release() {
+    if (buffers != nullptr) {
+        munmap(buffers, (size_t)buffer_count * buffer_size);
+        buffers = nullptr;
+    }
+    if (buffer_ring != nullptr) {
+        munmap(buffer_ring, buffer_ring_size);
+        buffer_ring = nullptr;
+    }
+    if (sqes != nullptr) {
+        munmap(sqes, sqes_size);
+        sqes = nullptr;
+    }
+    if (cq_map != nullptr && cq_map != sq_map) {
+        munmap(cq_map, cq_map_size);
+    }
+    cq_map = nullptr;
+    if (sq_map != nullptr) {
+        munmap(sq_map, sq_map_size);
+        sq_map = nullptr;
+    }
+    if (ring_fd >= 0) {
+        close(ring_fd);
+        ring_fd = -1;
+    }
+}
+
+io_uring_sqe* IoUring::get_sqe() {
+    if (sqe_tail - load_acquire(sq_head) >= sq_entries) {
+        submit();
+        if (sqe_tail - load_acquire(sq_head) >= sq_entries) {
+            return nullptr;
+        }
+    }
+    struct io_uring_sqe* sqe = &sqes[sqe_tail & sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe_tail++;
+    return sqe;
+}
+
+void IoUring::enter(unsigned to_submit, unsigned min_complete, int timeout_ms) {
+    unsigned flags = min_complete > 0 ? IORING_ENTER_GETEVENTS : 0;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    if (min_complete > 0 && timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+        arg.ts = (unsigned long long)(uintptr_t)&ts;
+        flags |= IORING_ENTER_EXT_ARG;
+    }
+    stats.enters++;
+    int result = (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags,
+                              (flags & IORING_ENTER_EXT_ARG) ? (void*)&arg : nullptr,
+                              (flags & IORING_ENTER_EXT_ARG) ? sizeof(arg) : 0);
+    // ETIME (timed out) and EINTR just end the wait
+    if (result > 0) {
+        stats.submitted += (unsigned)result;
+    }
+}
+
+void IoUring::submit() {
+    unsigned pending = sqe_tail - sqe_flushed;
+    if (pending == 0 || ring_fd < 0) {
+        return;
+    }
+    store_release(sq_tail, sqe_tail);
+    sqe_flushed = sqe_tail;
+    enter(pending, 0, 0);
+}
+
+void IoUring::wait(int timeout_ms) {
+    if (ring_fd < 0) {
+        return;
+    }
+    unsigned pending = sqe_tail - sqe_flushed;
+    store_release(sq_tail, sqe_tail);
+    sqe_flushed = sqe_tail;
+    // Completions already waiting need no sleep, only the submission
+    bool ready = load_acquire(cq_tail) != *cq_head;
+    if (ready && pending == 0) {
+        return;
+    }
+    enter(pending, ready ? 0 : 1, timeout_ms);
+}
+
+bool IoUring::next_completion(unsigned long long& user_data, int& result, unsigned int& flags) {
+    if (ring_fd < 0) {
+        return false;
+    }
+    unsigned head = *cq_head;
+    if (head == load_acquire(cq_tail)) {
+        return false;
+    }
+    const struct io_uring_cqe* cqe = (const struct io_uring_cqe*)cqes + (head & cq_mask);
+    user_data = cqe->user_data;
+    result = cqe->res;
+    flags = cqe->flags;
+    store_release(cq_head, head + 1);
+    stats.completions++;
+    return true;
+}
+
+void IoUring::recycle(unsigned id) {
+    // Indexed by hand: the header's flexible array sits at the wrong offset when compiled as C++
+    struct io_uring_buf_ring* ring = (struct io_uring_buf_ring*)buffer_ring;
+    struct io_uring_buf* slot = (struct io_uring_buf*)buffer_ring + (buffer_tail & (buffer_count - 1));
+    slot->addr = (unsigned long long)(uintptr_t)(buffers + (size_t)id * buffer_size);
+    slot->len = buffer_size;
+    slot->bid = (unsigned short)id;
+    buffer_tail++;
+    __atomic_store_n(&ring->tail, buffer_tail, __ATOMIC_RELEASE);
+    stats.buffers_recycled++;
+}
+
+#else
+
+bool IoUring::available() {
+    return false;
+}
+
+bool IoUring::init(unsigned, unsigned, unsigned, std::string* error) {
+    set_error(error, "Built without io_uring support");
+    return false;
+}
+
+void IoUring::release() {}
+
+io_uring_sqe* IoUring::get_sqe() {
+    return nullptr;
+}
+
+void IoUring::enter(unsigned, unsigned, int) {}
+
+void IoUring::submit() {}
+
+void IoUring::wait(int) {}
+
+bool IoUring::next_completion(unsigned long long&, int&, unsigned int&) {
+    return false;
+}
+
+void IoUring::recycle(unsigned) {}
+
+#endif // WEBSCRAPER_HAVE_IO_URING
@@ -0,0 +1,215 @@
+#include "../include/NearDuplicate.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+static const uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+static const uint64_t FNV_PRIME = 0x100000001b3ull;
+
+// splitmix64's finalizer: every input bit affects every output bit, so each
+// shingle votes on all 64 bits about evenly
+static uint64_t mix(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+// Byte b spread over a 64-bit word, bit k of b in the low bit of byte k
+static std::array<uint64_t, 256> make_spread_table() {
+    std::array<uint64_t, 256> table{};
+    for (int b = 0; b < 256; ++b) {
+        for (int k = 0; k < 8; ++k) {
+            if (b & (1 << k)) {
+                table[b] |= 1ull << (8 * k);
+            }
+        }
+    }
+    return table;
+}
+
+static const std::array<uint64_t, 256> SPREAD = make_spread_table();
+
+// Letters and digits, and every byte of a UTF-8 sequence
+static bool is_word_byte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+SimHasher::SimHasher(size_t shingle_words)
+    : shingle_words(std::min(std::max<size_t>(1, shingle_words), MAX_SHINGLE_WORDS)) {
+    reset();
+}
+
+void SimHasher::reset() {
+    in_tag = false;
+    in_word = false;
+    word_hash = FNV_OFFSET;
+    words = 0;
+    std::fill(std::begin(lanes), std::end(lanes), 0);
+    lane_shingles = 0;
+    std::fill(std::begin(ones), std::end(ones), 0);
+    shingles = 0;
+}
+
+// Count the set bits of a shingle's hash: eight byte-wide adds instead of
+// one per bit
+void SimHasher::vote(uint64_t hash) {
+    for (int j = 0; j < 8; ++j) {
+        lanes[j] += SPREAD[(hash >> (8 * j)) & 0xff];
+    }
+    shingles++;
+    if (++lane_shingles == 255) {
+        flush_lanes();
+    }
+}
+
+void SimHasher::flush_lanes() {
+    for (int j = 0; j < 8; ++j) {
+        for (int k = 0; k < 8; ++k) {
+            ones[8 * j + k] += (uint32_t)((lanes[j] >> (8 * k)) & 0xff);
+        }
+        lanes[j] = 0;
+    }
+    lane_shingles = 0;
+}
+
+void SimHasher::end_word() {
+    in_word = false;
+    window[words % shingle_words] = word_hash;
+    word_hash = FNV_OFFSET;
+    words++;
+    if (words < shingle_words) {
+        return;
+    }
+    // The last shingle_words words, oldest first
+    uint64_t shingle = FNV_OFFSET;
+    for (size_t i = words - shingle_words; i < words; ++i) {
+        shingle = (shingle ^ window[i % shingle_words]) * FNV_PRIME;
+    }
+    vote(mix(shingle));
+}
+
+void SimHasher::feed(std::string_view html) {
+    const char* data = html.data();
+    size_t size = html.size();
+    size_t i = 0;
+    while (i < size) {
+        if (in_tag) {
+            // Most of a page is markup: skip to the end of the tag in one go
+            const void* close = memchr(data + i, '>', size - i);
+            if (close == nullptr) {
+                return;
+            }
+            i = (size_t)((const char*)close - data) + 1;
+            in_tag = false;
+            continue;
+        }
+        unsigned char c = (unsigned char)data[i++];
+        if (is_word_byte(c)) {
+            in_word = true;
+            word_hash = (word_hash ^ (unsigned char)(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c)) * FNV_PRIME;
+        } else {
+            if (in_word) {
+                end_word();
+            }
+            in_tag = c == '<';
+        }
+    }
+}
+
+uint64_t SimHasher::finish() {
+    if (in_word) {
+        end_word();
+    }
+    if (words > 0 && words < shingle_words) {
+        // Too short for one full shingle: the words there are make one
+        uint64_t shingle = FNV_OFFSET;
+        for (size_t i = 0; i < words; ++i) {
+            shingle = (shingle ^ window[i]) * FNV_PRIME;
+        }
+        vote(mix(shingle));
+    }
+    flush_lanes();
+    // A bit is set if most shingles have it set
+    uint64_t fingerprint = 0;
+    for (int bit = 0; bit < 64; ++bit) {
+        if (2 * ones[bit] > shingles) {
+            fingerprint |= 1ull << bit;
+        }
+    }
+    return fingerprint;
+}
+
+uint64_t simhash_page(std::string_view html, size_t shingle_words) {
+    SimHasher hasher(shingle_words);
+    hasher.feed(html);
+    return hasher.finish();
+}
+
+int hamming_distance(uint64_t a, uint64_t b) {
+    uint64_t x = a ^ b;
+    int bits = 0;
+    while (x != 0) {
+        x &= x - 1;
+        bits++;
+    }
+    return bits;
+}
+
+NearDuplicateIndex::NearDuplicateIndex(const NearDuplicateConfig& config) {
+    set_config(config);
+}
+
+void NearDuplicateIndex::set_config(const NearDuplicateConfig& new_config) {
+    std::lock_guard<std::mutex> lock(mutex);
+    config = new_config;
+    config.max_distance = std::min(std::max(config.max_distance, 0), 63);
+    bands = config.max_distance + 1;
+    fingerprints.clear();
+    keys.clear();
+    band_index.assign(bands, std::unordered_map<uint64_t, std::vector<uint32_t>>());
+    stats = NearDuplicateStats();
+}
+
+// Bits [64 * band / bands, 64 * (band + 1) / bands) of fingerprint
+uint64_t NearDuplicateIndex::band_value(uint64_t fingerprint, int band) const {
+    int first = 64 * band / bands;
+    int width = 64 * (band + 1) / bands - first;
+    uint64_t mask = width == 64 ? ~0ull : (1ull << width) - 1;
+    return (fingerprint >> first) & mask;
+}
+
+bool NearDuplicateIndex::check(uint64_t fingerprint, const std::string& key, std::string* match) {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.pages++;
+    for (int band = 0; band < bands; ++band) {
+        auto candidates = band_index[band].find(band_value(fingerprint, band));
+        if (candidates == band_index[band].end()) {
+            continue;
+        }
+        for (uint32_t candidate : candidates->second) {
+            if (hamming_distance(fingerprints[candidate], fingerprint) <= config.max_distance) {
+                stats.near_duplicates++;
+                if (match != nullptr) {
+                    *match = keys[candidate];
+                }
+                return true;
+            }
+        }
+    }
+
+    uint32_t index = (uint32_t)fingerprints.size();
+    fingerprints.push_back(fingerprint);
+    keys.push_back(key);
+    for (int band = 0; band < bands; ++band) {
+        band_index[band][band_value(fingerprint, band)].push_back(index);
+    }
+    return false;
+}
+
+NearDuplicateStats NearDuplicateIndex::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
@@ -0,0 +1,93 @@
+#include "../include/RecvBuffer.h"
+#include <vector>
+#include <cstring>
+
+// Capacity of a freshly allocated buffer; enough for a typical header block plus a listing page
+const size_t RECV_BUFFER_INITIAL_CAPACITY = 64 * 1024;
+
+// Buffers that grew beyond this are freed rather than pooled
+const size_t RECV_BUFFER_MAX_POOLED_CAPACITY = 4 * 1024 * 1024;
+
+// Idle buffers kept per thread
+const size_t RECV_BUFFER_MAX_POOLED = 16;
+
+RecvBuffer::RecvBuffer() : allocated(0), length(0) {}
+
+void RecvBuffer::reserve(size_t new_capacity) {
+    if (new_capacity <= allocated) {
+        return;
+    }
+    std::unique_ptr<char[]> grown(new char[new_capacity]);
+    if (length > 0) {
+        memcpy(grown.get(), storage.get(), length);
+    }
+    storage.swap(grown);
+    allocated = new_capacity;
+}
+
+// Per-thread free list; destroyed (and its buffers freed) when the thread exits
+struct RecvBufferPool {
+    std::vector<std::unique_ptr<RecvBuffer>> free_buffers;
+    RecvBufferPoolStats stats;
+};
+
+static RecvBufferPool& thread_pool() {
+    thread_local RecvBufferPool pool;
+    return pool;
+}
+
+char* RecvBuffer::prepare(size_t min_free) {
+    if (allocated - length < min_free) {
+        size_t wanted = length + min_free;
+        size_t new_capacity = allocated == 0 ? RECV_BUFFER_INITIAL_CAPACITY : allocated;
+        while (new_capacity < wanted) {
+            new_capacity *= 2;
+        }
+        if (allocated != 0) {
+            thread_pool().stats.grown++;
+        }
+        reserve(new_capacity);
+    }
+    return storage.get() + length;
+}
+
+PooledBuffer::~PooledBuffer() {
+    if (!buffer) {
+        return;
+    }
+    RecvBufferPool& pool = thread_pool();
+    if (buffer->capacity() <= RECV_BUFFER_MAX_POOLED_CAPACITY &&
+        pool.free_buffers.size() < RECV_BUFFER_MAX_POOLED) {
+        buffer->clear();
+        pool.free_buffers.push_back(std::move(buffer));
+    }
+}
+
+PooledBuffer& PooledBuffer::operator=(PooledBuffer&& other) noexcept {
+    if (this != &other) {
+        PooledBuffer released(std::move(*this));
+        buffer = std::move(other.buffer);
+    }
+    return *this;
+}
+
+PooledBuffer PooledBuffer::acquire() {
+    RecvBufferPool& pool = thread_pool();
+    PooledBuffer handle;
+    pool.stats.acquired++;
+    if (!pool.free_buffers.empty()) {
+        handle.buffer = std::move(pool.free_buffers.back());
+        pool.free_buffers.pop_back();
+        pool.stats.reused++;
+    } else {
+        handle.buffer.reset(new RecvBuffer());
+    }
+    return handle;
+}
+
+RecvBufferPoolStats recv_buffer_pool_stats() {
+    RecvBufferPool& pool = thread_pool();
+    RecvBufferPoolStats result = pool.stats;
+    result.pooled = pool.free_buffers.size();
+    return result;
+}
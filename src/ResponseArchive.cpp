@@ -0,0 +1,173 @@
+#include "../include/ResponseArchive.h"
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+
+// Tag at the start of every segment record
+static const char RECORD_MAGIC[] = "WSR1 ";
+
+ResponseArchive::ResponseArchive() : current_mode(ArchiveMode::Off), latency(0) {}
+
+ResponseArchive::~ResponseArchive() {
+    stop();
+}
+
+bool ResponseArchive::start_recording(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (segment.is_open()) {
+        segment.close();
+    }
+    replay_data.clear();
+    index.clear();
+
+    segment.open(path, std::ios::binary | std::ios::app);
+    if (!segment.is_open()) {
+        std::cerr << "Failed to open response archive " << path << " for recording" << std::endl;
+        current_mode = ArchiveMode::Off;
+        return false;
+    }
+    current_mode = ArchiveMode::Record;
+    return true;
+}
+
+bool ResponseArchive::start_replay(const std::string& path, std::chrono::milliseconds replay_latency) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (segment.is_open()) {
+        segment.close();
+    }
+    if (!load(path)) {
+        current_mode = ArchiveMode::Off;
+        return false;
+    }
+    latency = replay_latency;
+    current_mode = ArchiveMode::Replay;
+    return true;
+}
+
+bool ResponseArchive::load(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open response archive " << path << std::endl;
+        return false;
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    replay_data = contents.str();
+    index.clear();
+
+    const size_t magic_length = sizeof(RECORD_MAGIC) - 1;
+    size_t pos = 0;
+    while (pos < replay_data.size()) {
+        size_t header_end = replay_data.find('\n', pos);
+        if (header_end == std::string::npos ||
+            replay_data.compare(pos, magic_length, RECORD_MAGIC) != 0) {
+            std::cerr << "Corrupt record at offset " << pos << " in " << path << ", ignoring the rest" << std::endl;
+            break;
+        }
+        char* end = nullptr;
+        unsigned long long url_length = std::strtoull(replay_data.c_str() + pos + magic_length, &end, 10);
+        unsigned long long response_length = std::strtoull(end, nullptr, 10);
+
+        // Header line, URL, newline, response, newline
+        size_t url_start = header_end + 1;
+        size_t response_start = url_start + url_length + 1;
+        size_t record_end = response_start + response_length + 1;
+        if (record_end > replay_data.size()) {
+            // Typically a record cut short by a crash while recording
+            std::cerr << "Truncated record at offset " << pos << " in " << path << ", ignoring it" << std::endl;
+            break;
+        }
+        index[replay_data.substr(url_start, url_length)] = Slice{response_start, (size_t)response_length};
+        pos = record_end;
+    }
+
+    stats.bytes += replay_data.size();
+    return true;
+}
+
+void ResponseArchive::stop() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (segment.is_open()) {
+        segment.close();
+    }
+    replay_data.clear();
+    index.clear();
+    current_mode = ArchiveMode::Off;
+}
+
+ArchiveMode ResponseArchive::mode() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return current_mode;
+}
+
+std::chrono::milliseconds ResponseArchive::replay_latency() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return latency;
+}
+
+void ResponseArchive::record(const std::string& url, const HttpResponse& response) {
+    if (!recording()) {
+        return;
+    }
+    std::string raw = serialize_response(response);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (current_mode != ArchiveMode::Record) {
+        return;
+    }
+    segment << RECORD_MAGIC << url.size() << ' ' << raw.size() << '\n' << url << '\n';
+    segment.write(raw.data(), (std::streamsize)raw.size());
+    segment << '\n';
+    // Flush per record so a crash loses at most the record being written
+    segment.flush();
+    if (!segment.good()) {
+        std::cerr << "Failed to append to response archive, recording stopped" << std::endl;
+        segment.close();
+        current_mode = ArchiveMode::Off;
+        return;
+    }
+    stats.recorded++;
+    stats.bytes += raw.size();
+}
+
+bool ResponseArchive::lookup(const std::string& url, HttpResponse& response) {
+    PooledBuffer buffer = PooledBuffer::acquire();
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = index.find(url);
+        if (current_mode != ArchiveMode::Replay || it == index.end()) {
+            stats.replay_misses++;
+            return false;
+        }
+        memcpy(buffer->prepare(it->second.length), replay_data.data() + it->second.offset, it->second.length);
+        buffer->commit(it->second.length);
+        stats.replayed++;
+    }
+
+    // Run the copy through the same parser a live response goes through
+    HttpResponseParser parser;
+    parser.reset();
+    parser.advance(*buffer);
+    if (!parser.complete()) {
+        parser.finish_on_close();
+    }
+    if (!parser.complete()) {
+        std::cerr << "Archived response for " << url << " does not parse: " << parser.error() << std::endl;
+        return false;
+    }
+    response = std::move(parser.finalize(std::move(buffer)));
+    return true;
+}
+
+ResponseArchiveStats ResponseArchive::get_stats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    ResponseArchiveStats result = stats;
+    result.entries = index.size();
+    return result;
+}
+
+ResponseArchive& response_archive() {
+    static ResponseArchive archive;
+    return archive;
+}
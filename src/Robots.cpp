@@ -0,0 +1,543 @@
+#include "../include/Robots.h"
+#include "../include/HttpClient.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+static const uint32_t NO_NODE = UINT32_MAX;
+
+// Beyond this many DFA states the rules are matched one by one instead
+static const size_t MAX_STATES = 1 << 14;
+
+static const char HEX[] = "0123456789ABCDEF";
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\f' || c == '\v';
+}
+
+static std::string_view trim(std::string_view text) {
+    while (!text.empty() && is_space(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && is_space(text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+static bool is_hex(char c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static char to_lower(char c) {
+    return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c;
+}
+
+static char to_upper(char c) {
+    return c >= 'a' && c <= 'z' ? (char)(c - 'a' + 'A') : c;
+}
+
+static bool equals_ignore_case(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (to_lower(a[i]) != to_lower(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Write text the way patterns and paths are compared: percent-escapes in upper
+// case and bytes outside ASCII escaped, so "/caf%c3%a9" and "/café" agree
+static void append_normalized(std::string& out, std::string_view text) {
+    int escape_left = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = (unsigned char)text[i];
+        if (c >= 0x80) {
+            out += '%';
+            out += HEX[c >> 4];
+            out += HEX[c & 15];
+        } else if (escape_left > 0) {
+            out += to_upper((char)c);
+            escape_left--;
+        } else {
+            if (c == '%' && i + 2 < text.size() && is_hex(text[i + 1]) && is_hex(text[i + 2])) {
+                escape_left = 2;
+            }
+            out += (char)c;
+        }
+    }
+}
+
+// Whether pattern matches path from its start: a '*' stands for any bytes, a
+// trailing '$' ties the pattern to the end of path. Greedy, retrying from the
+// last '*' on a mismatch.
+static bool glob_match(std::string_view pattern, std::string_view path) {
+    bool anchored = !pattern.empty() && pattern.back() == '$';
+    if (anchored) {
+        pattern.remove_suffix(1);
+    }
+    size_t p = 0;
+    size_t s = 0;
+    size_t star = std::string_view::npos;
+    size_t star_s = 0;
+    while (true) {
+        if (p == pattern.size() && (!anchored || s == path.size())) {
+            return true;
+        }
+        if (p < pattern.size() && pattern[p] == '*') {
+            star = p++;
+            star_s = s;
+        } else if (p < pattern.size() && s < path.size() && pattern[p] == path[s]) {
+            p++;
+            s++;
+        } else if (star != std::string_view::npos && star_s < path.size()) {
+            p = star + 1;
+            s = ++star_s;
+        } else {
+            return false;
+        }
+    }
+}
+
+RobotsRules::RobotsRules() : delay(0.0), class_count(1), start(0) {
+    compile();
+}
+
+void RobotsRules::allow_all() {
+    rules.clear();
+    delay = 0.0;
+    compile();
+}
+
+void RobotsRules::disallow_all() {
+    rules.assign(1, Rule{"/", false});
+    delay = 0.0;
+    compile();
+}
+
+void RobotsRules::parse(std::string_view text, std::string_view user_agent) {
+    // Rules of the groups naming us and of the '*' groups, kept apart until
+    // the whole file has been read
+    std::vector<Rule> named_rules;
+    std::vector<Rule> any_rules;
+    double named_delay = 0.0;
+    double any_delay = 0.0;
+    bool named_seen = false;
+
+    bool in_agents = false;   // The previous line was a User-agent line
+    bool group_named = false;
+    bool group_any = false;
+    while (!text.empty()) {
+        size_t line_end = text.find('\n');
+        std::string_view line = text.substr(0, line_end);
+        text = line_end == std::string_view::npos ? std::string_view() : text.substr(line_end + 1);
+        line = trim(line.substr(0, line.find('#')));
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) {
+            continue;
+        }
+        std::string_view key = trim(line.substr(0, colon));
+        std::string_view value = trim(line.substr(colon + 1));
+
+        if (equals_ignore_case(key, "user-agent")) {
+            if (!in_agents) {
+                // A User-agent line after rules starts a new group
+                group_named = false;
+                group_any = false;
+            }
+            in_agents = true;
+            std::string_view product = value.substr(0, std::min(value.find_first_of(" \t/"), value.size()));
+            if (equals_ignore_case(product, user_agent)) {
+                group_named = true;
+                named_seen = true;
+            } else if (product == "*") {
+                group_any = true;
+            }
+            continue;
+        }
+
+        bool allow = equals_ignore_case(key, "allow");
+        if (allow || equals_ignore_case(key, "disallow")) {
+            in_agents = false;
+            if (value.empty()) {
+                continue;  // "Disallow:" with no path allows everything anyway
+            }
+            Rule rule;
+            append_normalized(rule.pattern, value);
+            rule.allow = allow;
+            if (group_named) {
+                named_rules.push_back(rule);
+            }
+            if (group_any) {
+                any_rules.push_back(rule);
+            }
+        } else if (equals_ignore_case(key, "crawl-delay")) {
+            in_agents = false;
+            double seconds = std::strtod(std::string(value).c_str(), nullptr);
+            if (seconds > 0) {
+                if (group_named) {
+                    named_delay = seconds;
+                }
+                if (group_any) {
+                    any_delay = seconds;
+                }
+            }
+        } else if (!equals_ignore_case(key, "sitemap")) {
+            // Other lines end a run of User-agent lines like a rule does
+            in_agents = false;
+        }
+    }
+
+    rules.swap(named_seen ? named_rules : any_rules);
+    delay = named_seen ? named_delay : any_delay;
+    compile();
+}
+
+// A node of the pattern trie. A '*' leads to a node that loops on every byte
+// (and is entered without consuming one); a node where patterns end records
+// the best of them.
+struct RobotsTrieNode {
+    std::map<uint16_t, uint32_t> next;
+    uint32_t star = NO_NODE;
+    bool loop = false;
+    uint32_t best = 0;       // Of the patterns ending here
+    uint32_t end_best = 0;   // Of the '$' patterns ending here
+};
+
+// Add the nodes reachable from set through '*' edges; keeps set sorted
+static void star_closure(const std::vector<RobotsTrieNode>& trie, std::vector<uint32_t>& set) {
+    for (size_t i = 0; i < set.size(); ++i) {
+        uint32_t star = trie[set[i]].star;
+        if (star != NO_NODE && std::find(set.begin(), set.end(), star) == set.end()) {
+            set.push_back(star);
+        }
+    }
+    std::sort(set.begin(), set.end());
+}
+
+// Build the trie of every pattern, then its DFA breadth first: each DFA state
+// is the set of trie nodes a path prefix can be at. A rule ranks by its length
+// (an Allow above a Disallow of the same length), so the longest match wins.
+void RobotsRules::compile() {
+    // Bytes no pattern spells out all share class 0; '*' and a final '$' are
+    // not spelled out
+    std::fill(std::begin(byte_class), std::end(byte_class), 0);
+    class_count = 1;
+    for (const Rule& rule : rules) {
+        std::string_view pattern = rule.pattern;
+        if (!pattern.empty() && pattern.back() == '$') {
+            pattern.remove_suffix(1);
+        }
+        for (unsigned char c : pattern) {
+            if (c != '*' && byte_class[c] == 0) {
+                byte_class[c] = (uint16_t)class_count++;
+            }
+        }
+    }
+
+    std::vector<RobotsTrieNode> trie(1);
+    for (const Rule& rule : rules) {
+        uint32_t rank = (uint32_t)rule.pattern.size() * 2 + (rule.allow ? 1 : 0);
+        std::string_view pattern = rule.pattern;
+        bool anchored = !pattern.empty() && pattern.back() == '$';
+        if (anchored) {
+            pattern.remove_suffix(1);
+        } else {
+            // A pattern matches any path it is a prefix of: a final '*' adds nothing
+            while (!pattern.empty() && pattern.back() == '*') {
+                pattern.remove_suffix(1);
+            }
+        }
+        uint32_t node = 0;
+        for (size_t i = 0; i < pattern.size(); ++i) {
+            if (pattern[i] == '*') {
+                if (trie[node].star == NO_NODE) {
+                    trie[node].star = (uint32_t)trie.size();
+                    trie.emplace_back();
+                    trie.back().loop = true;
+                }
+                node = trie[node].star;
+                while (i + 1 < pattern.size() && pattern[i + 1] == '*') {
+                    i++;
+                }
+                continue;
+            }
+            uint16_t cls = byte_class[(unsigned char)pattern[i]];
+            auto next = trie[node].next.find(cls);
+            if (next != trie[node].next.end()) {
+                node = next->second;
+                continue;
+            }
+            uint32_t created = (uint32_t)trie.size();
+            trie[node].next[cls] = created;
+            trie.emplace_back();
+            node = created;
+        }
+        uint32_t& best = anchored ? trie[node].end_best : trie[node].best;
+        best = std::max(best, rank);
+    }
+
+    // State 0 is the empty set, where every transition stays
+    std::map<std::vector<uint32_t>, uint32_t> state_ids;
+    std::vector<std::vector<uint32_t>> state_sets(1);
+    state_ids[state_sets[0]] = 0;
+    transitions.assign(class_count, 0);
+    state_best.assign(1, 0);
+    state_end_best.assign(1, 0);
+
+    auto add_state = [&](std::vector<uint32_t>& set) -> uint32_t {
+        auto found = state_ids.find(set);
+        if (found != state_ids.end()) {
+            return found->second;
+        }
+        uint32_t id = (uint32_t)state_sets.size();
+        uint32_t best = 0;
+        uint32_t end_best = 0;
+        for (uint32_t node : set) {
+            best = std::max(best, trie[node].best);
+            end_best = std::max(end_best, trie[node].end_best);
+        }
+        state_ids.emplace(set, id);
+        state_sets.push_back(std::move(set));
+        transitions.resize(transitions.size() + class_count, 0);
+        state_best.push_back(best);
+        state_end_best.push_back(end_best);
+        return id;
+    };
+
+    std::vector<uint32_t> set(1, 0);
+    star_closure(trie, set);
+    start = add_state(set);
+    for (uint32_t state = start; state < state_sets.size(); ++state) {
+        if (state_sets.size() > MAX_STATES) {
+            std::cerr << "robots.txt rules too intricate to compile (" << rules.size()
+                      << " rules); matching them one by one" << std::endl;
+            transitions.clear();
+            return;
+        }
+        for (size_t c = 0; c < class_count; ++c) {
+            set.clear();
+            for (uint32_t node : state_sets[state]) {
+                if (trie[node].loop) {
+                    set.push_back(node);
+                }
+                auto next = trie[node].next.find((uint16_t)c);
+                if (next != trie[node].next.end()) {
+                    set.push_back(next->second);
+                }
+            }
+            star_closure(trie, set);
+            set.erase(std::unique(set.begin(), set.end()), set.end());
+            uint32_t target = add_state(set);
+            transitions[state * class_count + c] = target;
+        }
+    }
+}
+
+bool RobotsRules::may_fetch(std::string_view path) const {
+    if (rules.empty() || path == "/robots.txt") {
+        return true;
+    }
+
+    uint32_t best = 0;
+    if (transitions.empty()) {
+        // Too many states to compile: try every rule
+        std::string normalized;
+        append_normalized(normalized, path);
+        for (const Rule& rule : rules) {
+            uint32_t rank = (uint32_t)rule.pattern.size() * 2 + (rule.allow ? 1 : 0);
+            if (rank > best && glob_match(rule.pattern, normalized)) {
+                best = rank;
+            }
+        }
+        return best == 0 || (best & 1) != 0;
+    }
+
+    // Walk the DFA over the normalized path without building it
+    uint32_t state = start;
+    best = state_best[state];
+    auto step = [&](unsigned char c) {
+        state = transitions[state * class_count + byte_class[c]];
+        best = std::max(best, state_best[state]);
+    };
+    int escape_left = 0;
+    for (size_t i = 0; i < path.size() && state != 0; ++i) {
+        unsigned char c = (unsigned char)path[i];
+        if (c >= 0x80) {
+            step('%');
+            step((unsigned char)HEX[c >> 4]);
+            step((unsigned char)HEX[c & 15]);
+        } else if (escape_left > 0) {
+            step((unsigned char)to_upper((char)c));
+            escape_left--;
+        } else {
+            if (c == '%' && i + 2 < path.size() && is_hex(path[i + 1]) && is_hex(path[i + 2])) {
+                escape_left = 2;
+            }
+            step(c);
+        }
+    }
+    best = std::max(best, state_end_best[state]);
+    return best == 0 || (best & 1) != 0;
+}
+
+RobotsCache::RobotsCache() : is_enabled(true) {}
+
+void RobotsCache::set_enabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex);
+    is_enabled = enabled;
+}
+
+bool RobotsCache::enabled() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return is_enabled;
+}
+
+void RobotsCache::set_config(const RobotsConfig& new_config) {
+    std::lock_guard<std::mutex> lock(mutex);
+    config = new_config;
+    config.attempts = std::max(1, config.attempts);
+}
+
+RobotsConfig RobotsCache::get_config() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return config;
+}
+
+// How a host's robots.txt lookup ended
+enum class RobotsOutcome {
+    Fetched,
+    Missing,
+    Unreachable
+};
+
+// Fetch and compile the robots.txt of host, retrying server errors a few times
+static RobotsOutcome load_robots(const std::string& host, const RobotsConfig& config, RobotsRules& rules) {
+    int status = 0;
+    for (int attempt = 0; attempt < config.attempts; ++attempt) {
+        if (attempt > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(250 * attempt));
+        }
+        HttpResponse response;
+        if (!http_fetch_resource(host, "/robots.txt", response)) {
+            if (response_archive().replaying()) {
+                // Not recorded: the archive decides which pages exist
+                break;
+            }
+            status = 0;
+            continue;
+        }
+        status = response.status_code;
+        if (status >= 200 && status < 300) {
+            std::string_view text = response.body;
+            rules.parse(text.substr(0, config.max_bytes), config.user_agent);
+            return RobotsOutcome::Fetched;
+        }
+        if (status != 429 && status < 500) {
+            // No robots.txt (redirects are not followed either): no restrictions
+            rules.allow_all();
+            return RobotsOutcome::Missing;
+        }
+    }
+    if (response_archive().replaying()) {
+        rules.allow_all();
+        return RobotsOutcome::Missing;
+    }
+    std::cerr << "robots.txt of " << host << " could not be fetched ("
+              << (status == 0 ? std::string("no response") : "status " + std::to_string(status))
+              << "); not crawling the host" << std::endl;
+    rules.disallow_all();
+    return RobotsOutcome::Unreachable;
+}
+
+const RobotsRules& RobotsCache::rules(const std::string& host, bool* fetched) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = hosts.find(host);
+    if (it != hosts.end()) {
+        // Another thread may still be fetching it; only lookups of this host wait
+        HostEntry& entry = *it->second;
+        host_loaded.wait(lock, [&entry]() { return entry.loaded; });
+        return entry.rules;
+    }
+    HostEntry& entry = *hosts.emplace(host, std::unique_ptr<HostEntry>(new HostEntry())).first->second;
+    if (!is_enabled) {
+        entry.loaded = true;
+        return entry.rules;
+    }
+
+    // Fetch without holding the cache, so other hosts are not held up
+    RobotsConfig load_config = config;
+    stats.hosts++;
+    lock.unlock();
+    RobotsOutcome outcome = load_robots(host, load_config, entry.rules);
+    lock.lock();
+    switch (outcome) {
+    case RobotsOutcome::Fetched: stats.fetched++; break;
+    case RobotsOutcome::Missing: stats.missing++; break;
+    case RobotsOutcome::Unreachable: stats.unreachable++; break;
+    }
+    entry.loaded = true;
+    host_loaded.notify_all();
+    if (fetched != nullptr) {
+        *fetched = true;
+    }
+    return entry.rules;
+}
+
+bool RobotsCache::allowed(const std::string& host, std::string_view url, bool* fetched) {
+    if (!enabled()) {
+        return true;
+    }
+    thread_local std::string path;
+    robots_path(url, path);
+    bool may_fetch = rules(host, fetched).may_fetch(path);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (may_fetch) {
+        stats.allowed++;
+    } else {
+        stats.disallowed++;
+    }
+    return may_fetch;
+}
+
+RobotsStats RobotsCache::get_stats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void robots_path(std::string_view url, std::string& path) {
+    size_t scheme_end = url.find("://");
+    if (scheme_end != std::string_view::npos) {
+        size_t path_start = url.find_first_of("/?#", scheme_end + 3);
+        url = path_start == std::string_view::npos ? std::string_view() : url.substr(path_start);
+    }
+    url = url.substr(0, url.find('#'));
+    path.clear();
+    if (url.empty() || url[0] == '?') {
+        // "http://host?x" asks for the root, "/?x"
+        path.push_back('/');
+    }
+    path.append(url.data(), url.size());
+}
+
+void apply_crawl_delay(HostScheduler& scheduler, const std::string& host, const RobotsRules& rules) {
+    double delay = std::min(rules.crawl_delay(), robots_cache().get_config().max_crawl_delay);
+    if (delay <= 0) {
+        return;
+    }
+    double rate = 1.0 / delay;
+    double configured = scheduler.get_config().rate;
+    if (configured > 0 && configured <= rate) {
+        return;
+    }
+    scheduler.set_host_limits(host, rate, 1.0);
+}
+
+RobotsCache& robots_cache() {
+    static RobotsCache cache;
+    return cache;
+}
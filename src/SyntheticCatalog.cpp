@@ -0,0 +1,416 @@
+#include "../include/SyntheticCatalog.h"
+#include <algorithm>
+#include <cctype>
+
+// Category index standing for the listing of every book
+static const size_t ALL_BOOKS = (size_t)-1;
+
+static const char* const CATEGORY_NAMES[] = {
+    "Travel", "Mystery", "Historical Fiction", "Sequential Art", "Classics", "Philosophy", "Romance",
+    "Womens Fiction", "Fiction", "Childrens", "Religion", "Nonfiction", "Music", "Default",
+    "Science Fiction", "Sports and Games", "Fantasy", "New Adult", "Young Adult", "Science", "Poetry",
+    "Paranormal", "Art", "Psychology", "Autobiography", "Parenting", "Adult Fiction", "Humor", "Horror",
+    "History", "Food and Drink", "Christian Fiction", "Business", "Biography", "Thriller", "Contemporary",
+    "Spirituality", "Academic", "Self Help", "Historical", "Christian", "Suspense", "Short Stories",
+    "Novels", "Health", "Politics", "Cultural", "Erotica", "Crime", "Cookbooks"};
+
+static const char* const ADJECTIVES[] = {
+    "Silent", "Golden", "Broken", "Hidden", "Last", "Wild", "Forgotten", "Crimson", "Distant", "Secret",
+    "Burning", "Quiet", "Endless", "Lonely", "Midnight", "Northern", "Painted", "Restless", "Shattered",
+    "Velvet", "Winter", "Electric", "Hollow", "Little", "Savage", "Tender", "Bitter", "Luminous"};
+
+static const char* const NOUNS[] = {
+    "Harbor", "Garden", "Kingdom", "River", "Letters", "Machine", "Orchard", "Mountain", "Lighthouse",
+    "Daughter", "Stranger", "Library", "Empire", "Season", "Voyage", "Promise", "Shadow", "Mirror",
+    "Island", "Alchemist", "Cartographer", "Symphony", "Archive", "Frontier", "Traveler's Guide", "Bones",
+    "Tides", "Hours"};
+
+static const char* const FILLER[] = {
+    "the", "a", "of", "and", "to", "in", "her", "his", "their", "story", "world", "when", "every", "night",
+    "city", "family", "secret", "years", "after", "before", "war", "love", "home", "journey", "discover",
+    "must", "never", "between", "beyond", "truth", "memory", "finds", "under", "small", "town", "winter",
+    "summer", "letters", "together", "across", "ocean", "old", "new", "life", "friend", "dangerous",
+    "beautiful", "unexpected", "novel", "author", "readers", "bestselling", "haunting", "brilliant"};
+
+static const Rating RATINGS[] = {Rating::One, Rating::Two, Rating::Three, Rating::Four, Rating::Five};
+
+template <typename T, size_t N>
+static size_t count_of(T (&)[N]) {
+    return N;
+}
+
+// SplitMix64: cheap, stateless mixing so page content needs no stored state
+static unsigned long long mix(unsigned long long x) {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static std::string slugify(const std::string& text) {
+    std::string slug;
+    for (char c : text) {
+        if (std::isalnum((unsigned char)c)) {
+            slug += (char)std::tolower((unsigned char)c);
+        } else if (c == ' ' && !slug.empty() && slug.back() != '-') {
+            slug += '-';
+        }
+    }
+    while (!slug.empty() && slug.back() == '-') {
+        slug.pop_back();
+    }
+    return slug;
+}
+
+// Parse a positive decimal without sign or leading zeros; false on anything else
+static bool parse_number(std::string_view text, size_t& value) {
+    if (text.empty() || text.length() > 18 || text[0] == '0') {
+        return false;
+    }
+    value = 0;
+    for (char c : text) {
+        if (!std::isdigit((unsigned char)c)) {
+            return false;
+        }
+        value = value * 10 + (size_t)(c - '0');
+    }
+    return true;
+}
+
+static bool starts_with(std::string_view text, std::string_view prefix) {
+    return text.substr(0, prefix.length()) == prefix;
+}
+
+// "page-N.html" with N >= first; false for any other file name
+static bool parse_page_file(std::string_view file, size_t first, size_t& page) {
+    const std::string_view suffix = ".html";
+    if (!starts_with(file, "page-") || file.length() <= 5 + suffix.length() ||
+        file.substr(file.length() - suffix.length()) != suffix) {
+        return false;
+    }
+    return parse_number(file.substr(5, file.length() - 5 - suffix.length()), page) && page >= first;
+}
+
+SyntheticCatalog::SyntheticCatalog(const SyntheticCatalogConfig& cfg) : config(cfg) {
+    config.books_per_page = std::max<size_t>(1, config.books_per_page);
+    config.categories = std::max<size_t>(1, config.categories);
+}
+
+unsigned long long SyntheticCatalog::book_hash(size_t id) const {
+    return mix(config.seed * 0x100000001b3ULL + id);
+}
+
+std::string SyntheticCatalog::category_name(size_t category) const {
+    std::string name = CATEGORY_NAMES[category % count_of(CATEGORY_NAMES)];
+    if (category >= count_of(CATEGORY_NAMES)) {
+        name += " " + std::to_string(category / count_of(CATEGORY_NAMES) + 1);
+    }
+    return name;
+}
+
+// Directory name as on the real site, where books_1 is the listing of every book
+std::string SyntheticCatalog::category_slug(size_t category) const {
+    return slugify(category_name(category)) + "_" + std::to_string(category + 2);
+}
+
+// Book id i belongs to category (i - 1) % categories
+size_t SyntheticCatalog::category_books(size_t category) const {
+    if (category >= config.categories || config.books <= category) {
+        return 0;
+    }
+    return (config.books - category - 1) / config.categories + 1;
+}
+
+size_t SyntheticCatalog::listing_pages() const {
+    return std::max<size_t>(1, (config.books + config.books_per_page - 1) / config.books_per_page);
+}
+
+size_t SyntheticCatalog::category_pages(size_t category) const {
+    size_t books = category_books(category);
+    return std::max<size_t>(1, (books + config.books_per_page - 1) / config.books_per_page);
+}
+
+size_t SyntheticCatalog::page_count() const {
+    size_t pages = 1 + listing_pages() + config.books;
+    for (size_t category = 0; category < config.categories; ++category) {
+        pages += category_pages(category);
+    }
+    return pages;
+}
+
+std::string SyntheticCatalog::book_title(size_t id) const {
+    unsigned long long h = book_hash(id);
+    const char* adjective = ADJECTIVES[(h >> 8) % count_of(ADJECTIVES)];
+    const char* noun = NOUNS[(h >> 16) % count_of(NOUNS)];
+    const char* other = NOUNS[(h >> 24) % count_of(NOUNS)];
+    std::string title;
+    switch ((h >> 32) % 4) {
+    case 0:
+        title = std::string("The ") + adjective + " " + noun;
+        break;
+    case 1:
+        title = std::string(noun) + " of the " + adjective + " " + other;
+        break;
+    case 2:
+        title = std::string(adjective) + " " + noun + ": A Novel";
+        break;
+    default:
+        title = std::string("The ") + noun + " and the " + adjective + " " + other;
+        break;
+    }
+    // Titles repeat across the catalog; the volume number keeps every one unique
+    return title + ", Vol. " + std::to_string(id);
+}
+
+Book SyntheticCatalog::book(size_t id) const {
+    unsigned long long h = book_hash(id);
+    Book book;
+    book.title = book_title(id);
+    unsigned pence = (unsigned)((h >> 40) % 5000) + 1000;
+    book.price.minor = pence;
+    book.price.currency = Currency::GBP;
+    book.rating = RATINGS[h % count_of(RATINGS)];
+    book.url = book_path(id);
+    return book;
+}
+
+std::string SyntheticCatalog::book_path(size_t id) const {
+    return "/catalogue/" + slugify(book_title(id)) + "_" + std::to_string(id) + "/index.html";
+}
+
+std::string SyntheticCatalog::listing_path(size_t page) const {
+    return "/catalogue/page-" + std::to_string(page) + ".html";
+}
+
+std::string SyntheticCatalog::category_path(size_t category, size_t page) const {
+    std::string path = "/catalogue/category/books/" + category_slug(category) + "/";
+    return page <= 1 ? path + "index.html" : path + "page-" + std::to_string(page) + ".html";
+}
+
+void SyntheticCatalog::render_header(std::string& html, const std::string& title) const {
+    html += "<!DOCTYPE html>\n<html lang=\"en-us\" class=\"no-js\">\n<head>\n    <title>";
+    html += title;
+    html += " | Books to Scrape - Sandbox</title>\n"
+            "    <meta http-equiv=\"content-type\" content=\"text/html; charset=UTF-8\" />\n"
+            "    <link rel=\"stylesheet\" type=\"text/css\" href=\"/static/oscar/css/styles.css\" />\n"
+            "</head>\n<body id=\"default\" class=\"default\">\n"
+            "<header class=\"header container-fluid\">\n    <div class=\"page_inner\">\n"
+            "        <div class=\"row\"><div class=\"col-sm-8 h1\"><a href=\"/index.html\">Books to Scrape</a>"
+            "<small> We love being scraped!</small></div></div>\n    </div>\n</header>\n"
+            "<div class=\"container-fluid page\">\n    <div class=\"page_inner\">\n";
+}
+
+void SyntheticCatalog::render_footer(std::string& html) const {
+    html += "    </div>\n</div>\n<footer class=\"footer container-fluid\"></footer>\n"
+            "<script src=\"/static/oscar/js/oscar/ui.js\" type=\"text/javascript\"></script>\n"
+            "</body>\n</html>\n";
+}
+
+static void append_product_pod(std::string& html, const Book& book, unsigned long long h) {
+    static const char* const HEX = "0123456789abcdef";
+    std::string image;
+    for (int shift = 0; shift < 64; shift += 4) {
+        image += HEX[(h >> shift) & 15];
+    }
+    std::string shown = book.title.length() > 40 ? book.title.substr(0, 37) + "..." : book.title;
+    html += "            <li class=\"col-xs-6 col-sm-4 col-md-3 col-lg-3\">\n"
+            "                <article class=\"product_pod\">\n"
+            "                    <div class=\"image_container\"><a href=\"";
+    html += book.url;
+    html += "\"><img src=\"/media/cache/";
+    html += image;
+    html += ".jpg\" alt=\"";
+    html += book.title;
+    html += "\" class=\"thumbnail\"></a></div>\n                    <p class=\"star-rating ";
+    html += rating_name(book.rating);
+    html += "\">\n                        <i class=\"icon-star\"></i><i class=\"icon-star\"></i><i class=\"icon-star\"></i>"
+            "<i class=\"icon-star\"></i><i class=\"icon-star\"></i>\n                    </p>\n"
+            "                    <h3><a href=\"";
+    html += book.url;
+    html += "\" title=\"";
+    html += book.title;
+    html += "\">";
+    html += shown;
+    html += "</a></h3>\n                    <div class=\"product_price\">\n"
+            "                        <p class=\"price_color\">";
+    html += format_price(book.price);
+    html += "</p>\n                        <p class=\"instock availability\"><i class=\"icon-ok\"></i> In stock</p>\n"
+            "                        <form><button type=\"submit\" class=\"btn btn-primary btn-block\">"
+            "Add to basket</button></form>\n                    </div>\n"
+            "                </article>\n            </li>\n";
+}
+
+// One page of the full listing (category ALL_BOOKS) or of a category. The home
+// page is the first full listing page served from the site root.
+void SyntheticCatalog::render_listing(std::string& html, size_t category, size_t page, bool home) const {
+    bool all = category == ALL_BOOKS;
+    std::string name = all ? "All products" : category_name(category);
+    size_t total = all ? config.books : category_books(category);
+    size_t pages = all ? listing_pages() : category_pages(category);
+    size_t first = (page - 1) * config.books_per_page + 1;
+    size_t last = std::min(total, page * config.books_per_page);
+
+    render_header(html, name);
+    html += "        <ul class=\"breadcrumb\">\n            <li><a href=\"/index.html\">Home</a></li>\n";
+    if (!all) {
+        html += "            <li><a href=\"/catalogue/page-1.html\">Books</a></li>\n";
+    }
+    html += "            <li class=\"active\">" + name + "</li>\n        </ul>\n";
+
+    html += "        <div class=\"row\">\n        <aside class=\"sidebar col-sm-4 col-md-3\">\n"
+            "            <div class=\"side_categories\"><ul class=\"nav nav-list\"><li>"
+            "<a href=\"/catalogue/page-1.html\">Books</a>\n            <ul>\n";
+    for (size_t c = 0; c < config.categories; ++c) {
+        html += "                <li><a href=\"" + category_path(c, 1) + "\">" + category_name(c) + "</a></li>\n";
+    }
+    html += "            </ul></li></ul></div>\n        </aside>\n";
+
+    html += "        <div class=\"col-sm-8 col-md-9\">\n"
+            "        <div class=\"page-header action\"><h1>" + name + "</h1></div>\n"
+            "        <form class=\"form-horizontal\"><strong>" + std::to_string(total) + "</strong> results";
+    if (last >= first) {
+        html += " - showing <strong>" + std::to_string(first) + "</strong> to <strong>" + std::to_string(last) +
+                "</strong>";
+    }
+    html += ".</form>\n        <section>\n        <ol class=\"row\">\n";
+    for (size_t i = first; i <= last; ++i) {
+        size_t id = all ? i : category + 1 + (i - 1) * config.categories;
+        append_product_pod(html, book(id), book_hash(id));
+    }
+    html += "        </ol>\n";
+
+    // Relative links, as the real site writes them
+    if (pages > 1) {
+        std::string prefix = home ? "catalogue/" : "";
+        html += "        <div><ul class=\"pager\">\n";
+        if (page > 1) {
+            std::string previous = !all && page == 2 ? "index.html" : "page-" + std::to_string(page - 1) + ".html";
+            html += "            <li class=\"previous\"><a href=\"" + prefix + previous + "\">previous</a></li>\n";
+        }
+        html += "            <li class=\"current\">Page " + std::to_string(page) + " of " + std::to_string(pages) +
+                "</li>\n";
+        if (page < pages) {
+            html += "            <li class=\"next\"><a href=\"" + prefix + "page-" + std::to_string(page + 1) +
+                    ".html\">next</a></li>\n";
+        }
+        html += "        </ul></div>\n";
+    }
+    html += "        </section>\n        </div>\n        </div>\n";
+    render_footer(html);
+}
+
+void SyntheticCatalog::render_book(std::string& html, size_t id) const {
+    unsigned long long h = book_hash(id);
+    Book shown = book(id);
+    size_t category = (id - 1) % config.categories;
+
+    render_header(html, shown.title);
+    html += "        <ul class=\"breadcrumb\">\n            <li><a href=\"/index.html\">Home</a></li>\n"
+            "            <li><a href=\"/catalogue/page-1.html\">Books</a></li>\n            <li><a href=\"";
+    html += category_path(category, 1);
+    html += "\">" + category_name(category) + "</a></li>\n            <li class=\"active\">" + shown.title +
+            "</li>\n        </ul>\n";
+    html += "        <article class=\"product_page\">\n        <div class=\"row\">\n"
+            "            <div class=\"col-sm-6 product_main\">\n                <h1>";
+    html += shown.title;
+    html += "</h1>\n                <p class=\"price_color\">" + format_price(shown.price) + "</p>\n"
+            "                <p class=\"instock availability\"><i class=\"icon-ok\"></i> In stock (" +
+            std::to_string(h % 22 + 1) + " available)</p>\n"
+            "                <p class=\"star-rating " + rating_name(shown.rating) + "\">\n"
+            "                    <i class=\"icon-star\"></i><i class=\"icon-star\"></i><i class=\"icon-star\"></i>"
+            "<i class=\"icon-star\"></i><i class=\"icon-star\"></i>\n                </p>\n"
+            "            </div>\n        </div>\n"
+            "        <div id=\"product_description\" class=\"sub-header\"><h2>Product Description</h2></div>\n"
+            "        <p>";
+
+    // Filler prose, so book pages vary in size like real descriptions do
+    size_t words = config.description_words / 2 + (size_t)(h % (config.description_words + 1));
+    unsigned long long state = h;
+    size_t sentence = 0;
+    for (size_t i = 0; i < words; ++i) {
+        state = mix(state);
+        std::string word = FILLER[state % count_of(FILLER)];
+        if (sentence == 0) {
+            word[0] = (char)std::toupper((unsigned char)word[0]);
+        } else {
+            html += ' ';
+        }
+        html += word;
+        if (++sentence >= 8 + (state >> 32) % 9 || i + 1 == words) {
+            html += ". ";
+            sentence = 0;
+        }
+    }
+    html += "</p>\n        <table class=\"table table-striped\">\n            <tr><th>UPC</th><td>";
+    static const char* const HEX = "0123456789abcdef";
+    for (int shift = 60; shift >= 0; shift -= 4) {
+        html += HEX[(h >> shift) & 15];
+    }
+    html += "</td></tr>\n            <tr><th>Product Type</th><td>Books</td></tr>\n"
+            "            <tr><th>Number of reviews</th><td>0</td></tr>\n        </table>\n"
+            "        </article>\n";
+    render_footer(html);
+}
+
+bool SyntheticCatalog::render(std::string_view path, std::string& html) const {
+    html.clear();
+    size_t query = path.find_first_of("?#");
+    if (query != std::string_view::npos) {
+        path = path.substr(0, query);
+    }
+    if (path == "/" || path == "/index.html") {
+        render_listing(html, ALL_BOOKS, 1, true);
+        return true;
+    }
+    const std::string_view catalogue = "/catalogue/";
+    if (!starts_with(path, catalogue)) {
+        return false;
+    }
+    std::string_view rest = path.substr(catalogue.length());
+    size_t page = 0;
+
+    if (parse_page_file(rest, 1, page)) {
+        if (page > listing_pages()) {
+            return false;
+        }
+        render_listing(html, ALL_BOOKS, page, false);
+        return true;
+    }
+
+    // Everything else is a directory holding index.html (or a category's page-N.html)
+    size_t slash = rest.find('/');
+    if (slash == std::string_view::npos) {
+        return false;
+    }
+    const std::string_view category_dir = "category/books/";
+    if (starts_with(rest, category_dir)) {
+        std::string_view dir_and_file = rest.substr(category_dir.length());
+        slash = dir_and_file.find('/');
+        size_t underscore = dir_and_file.rfind('_', slash);
+        size_t number = 0;
+        if (slash == std::string_view::npos || underscore == std::string_view::npos ||
+            !parse_number(dir_and_file.substr(underscore + 1, slash - underscore - 1), number) || number < 2 ||
+            number - 2 >= config.categories || dir_and_file.substr(0, slash) != category_slug(number - 2)) {
+            return false;
+        }
+        size_t category = number - 2;
+        std::string_view file = dir_and_file.substr(slash + 1);
+        if (file == "index.html") {
+            page = 1;
+        } else if (!parse_page_file(file, 2, page) || page > category_pages(category)) {
+            return false;
+        }
+        render_listing(html, category, page, false);
+        return true;
+    }
+
+    size_t underscore = rest.rfind('_', slash);
+    size_t id = 0;
+    if (underscore == std::string_view::npos || rest.substr(slash + 1) != "index.html" ||
+        !parse_number(rest.substr(underscore + 1, slash - underscore - 1), id) || id > config.books ||
+        path != book_path(id)) {
+        return false;
+    }
+    render_book(html, id);
+    return true;
+}
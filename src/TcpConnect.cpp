@@ -0,0 +1,291 @@
+#ifdef _MSC_VER
+// Additional includes and defines for Visual Studio
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "../include/TcpConnect.h"
+#include "../include/compat.h"
+#include <algorithm>
+#include <climits>
+#include <cerrno>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#endif
+
+typedef std::chrono::steady_clock Clock;
+
+// One connect() still waiting for an answer
+struct ConnectAttempt {
+    SOCKET sock;
+    size_t index;   // Position of its address in the list
+};
+
+static bool set_blocking(SOCKET sock, bool blocking) {
+    #ifdef _WIN32
+    u_long mode = blocking ? 0 : 1;
+    return ioctlsocket(sock, FIONBIO, &mode) == 0;
+    #else
+    int flags = fcntl(sock, F_GETFL, 0);
+    if (flags < 0) {
+        return false;
+    }
+    flags = blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+    return fcntl(sock, F_SETFL, flags) == 0;
+    #endif
+}
+
+static std::string socket_error_text(int error) {
+    #ifdef _WIN32
+    return "error " + std::to_string(error);
+    #else
+    return strerror(error);
+    #endif
+}
+
+// Start a non-blocking connect; connected is set if it finished at once.
+// Returns INVALID_SOCKET (and the reason in error) if the attempt failed outright.
+static SOCKET start_connect(const ResolvedAddress& resolved, bool& connected, int& error) {
+    connected = false;
+    SOCKET sock = socket(resolved.address.ss_family, SOCK_STREAM, IPPROTO_TCP);
+    if (sock == INVALID_SOCKET) {
+        #ifdef _WIN32
+        error = WSAGetLastError();
+        #else
+        error = errno;
+        #endif
+        return INVALID_SOCKET;
+    }
+    if (!set_blocking(sock, false)) {
+        error = 0;
+        CLOSE_SOCKET(sock);
+        return INVALID_SOCKET;
+    }
+
+    if (connect(sock, (const struct sockaddr*)&resolved.address, (int)resolved.length) != SOCKET_ERROR) {
+        connected = true;
+        return sock;
+    }
+    #ifdef _WIN32
+    error = WSAGetLastError();
+    bool in_progress = error == WSAEWOULDBLOCK;
+    #else
+    error = errno;
+    bool in_progress = error == EINPROGRESS;
+    #endif
+    if (!in_progress) {
+        CLOSE_SOCKET(sock);
+        return INVALID_SOCKET;
+    }
+    return sock;
+}
+
+// Wait up to timeout_ms (-1 = no limit) for pending connects to finish.
+// Marks in done the attempts that connected or failed.
+static void wait_for_connects(const std::vector<ConnectAttempt>& pending, int timeout_ms, std::vector<bool>& done) {
+    done.assign(pending.size(), false);
+
+    #ifdef _WIN32
+    // Winsock reports a finished connect as writable and a failed one as an exception
+    fd_set writefds;
+    fd_set exceptfds;
+    FD_ZERO(&writefds);
+    FD_ZERO(&exceptfds);
+    for (const ConnectAttempt& attempt : pending) {
+        FD_SET(attempt.sock, &writefds);
+        FD_SET(attempt.sock, &exceptfds);
+    }
+    struct timeval tv;
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+    if (select(0, NULL, &writefds, &exceptfds, timeout_ms < 0 ? NULL : &tv) <= 0) {
+        return;
+    }
+    for (size_t i = 0; i < pending.size(); ++i) {
+        done[i] = FD_ISSET(pending[i].sock, &writefds) || FD_ISSET(pending[i].sock, &exceptfds);
+    }
+    #else
+    // poll() rather than select(): fetch engines can hold descriptors past FD_SETSIZE
+    std::vector<struct pollfd> fds(pending.size());
+    for (size_t i = 0; i < pending.size(); ++i) {
+        fds[i].fd = pending[i].sock;
+        fds[i].events = POLLOUT;
+        fds[i].revents = 0;
+    }
+    if (poll(fds.data(), (nfds_t)fds.size(), timeout_ms) <= 0) {
+        return;
+    }
+    for (size_t i = 0; i < pending.size(); ++i) {
+        done[i] = (fds[i].revents & (POLLOUT | POLLERR | POLLHUP)) != 0;
+    }
+    #endif
+}
+
+// Milliseconds from now until then, rounded up so a wait never ends early
+static int millis_until(Clock::time_point now, Clock::time_point then) {
+    if (then <= now) {
+        return 0;
+    }
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(then - now).count() + 1;
+    return (int)std::min<long long>(wait, INT_MAX);
+}
+
+TcpConnector::TcpConnector(const TcpConnectConfig& cfg) : config(cfg) {}
+
+SOCKET TcpConnector::open(const std::vector<ResolvedAddress>& addresses, std::string* error) {
+    TcpConnectConfig cfg = get_config();
+    Clock::time_point start = Clock::now();
+    bool bounded = cfg.connect_timeout.count() > 0;
+    Clock::time_point deadline = start + cfg.connect_timeout;
+
+    std::vector<ConnectAttempt> pending;
+    std::vector<bool> done;
+    size_t next = 0;                     // Next address to try
+    Clock::time_point next_start = start;
+    SOCKET winner = INVALID_SOCKET;
+    size_t winner_index = 0;
+    unsigned long long started = 0;
+    int last_error = 0;
+    bool timed_out = false;
+
+    while (winner == INVALID_SOCKET) {
+        Clock::time_point now = Clock::now();
+        if (bounded && now >= deadline) {
+            timed_out = true;
+            break;
+        }
+
+        // Start the next address once the last attempt has had its head start or failed
+        if (next < addresses.size() && now >= next_start) {
+            bool connected = false;
+            int attempt_error = 0;
+            SOCKET sock = start_connect(addresses[next], connected, attempt_error);
+            started++;
+            if (connected) {
+                winner = sock;
+                winner_index = next;
+            } else if (sock != INVALID_SOCKET) {
+                pending.push_back(ConnectAttempt{sock, next});
+                next_start = now + cfg.attempt_delay;
+            } else {
+                last_error = attempt_error;
+            }
+            next++;
+            continue;
+        }
+        if (pending.empty()) {
+            break;  // Every address failed
+        }
+
+        // Sleep until an attempt finishes, the next one is due or the deadline passes
+        int timeout_ms = -1;
+        if (bounded) {
+            timeout_ms = millis_until(now, deadline);
+        }
+        if (next < addresses.size()) {
+            int until_next = millis_until(now, next_start);
+            timeout_ms = timeout_ms < 0 ? until_next : std::min(timeout_ms, until_next);
+        }
+        wait_for_connects(pending, timeout_ms, done);
+
+        std::vector<ConnectAttempt> still_pending;
+        for (size_t i = 0; i < pending.size(); ++i) {
+            if (!done[i]) {
+                still_pending.push_back(pending[i]);
+                continue;
+            }
+            int so_error = 0;
+            socklen_t length = sizeof(so_error);
+            if (getsockopt(pending[i].sock, SOL_SOCKET, SO_ERROR, (char*)&so_error, &length) != 0) {
+                so_error = -1;
+            }
+            if (so_error == 0 && winner == INVALID_SOCKET) {
+                winner = pending[i].sock;
+                winner_index = pending[i].index;
+            } else {
+                if (so_error != 0) {
+                    last_error = so_error;
+                    // A failed attempt hands its head start straight to the next address
+                    next_start = Clock::now();
+                }
+                CLOSE_SOCKET(pending[i].sock);
+            }
+        }
+        pending.swap(still_pending);
+    }
+
+    // The race is decided: drop the losers
+    for (const ConnectAttempt& attempt : pending) {
+        CLOSE_SOCKET(attempt.sock);
+    }
+
+    if (winner != INVALID_SOCKET && !set_blocking(winner, true)) {
+        CLOSE_SOCKET(winner);
+        winner = INVALID_SOCKET;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stats.attempts += started;
+        if (winner != INVALID_SOCKET) {
+            stats.connects++;
+            if (winner_index > 0) {
+                stats.fallbacks++;
+            }
+        } else if (timed_out) {
+            stats.timeouts++;
+        } else {
+            stats.failures++;
+        }
+    }
+
+    if (winner == INVALID_SOCKET && error != nullptr) {
+        if (addresses.empty()) {
+            *error = "no addresses to connect to";
+        } else if (timed_out) {
+            *error = "timed out after " + std::to_string(cfg.connect_timeout.count()) + " ms (" +
+                     std::to_string(started) + " of " + std::to_string(addresses.size()) + " addresses tried)";
+        } else if (last_error != 0) {
+            *error = socket_error_text(last_error);
+        } else {
+            *error = "connect failed";
+        }
+    }
+    return winner;
+}
+
+SOCKET TcpConnector::open(const std::string& hostname, int port, std::string* error) {
+    std::vector<ResolvedAddress> addresses;
+    if (!dns_cache().resolve(hostname, port, addresses)) {
+        if (error != nullptr) {
+            *error = "cannot resolve " + hostname;
+        }
+        return INVALID_SOCKET;
+    }
+    return open(addresses, error);
+}
+
+void TcpConnector::set_config(const TcpConnectConfig& cfg) {
+    std::lock_guard<std::mutex> lock(mtx);
+    config = cfg;
+}
+
+TcpConnectConfig TcpConnector::get_config() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return config;
+}
+
+TcpConnectStats TcpConnector::get_stats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return stats;
+}
+
+TcpConnector& tcp_connector() {
+    static TcpConnector connector;
+    return connector;
+}
@@ -0,0 +1,414 @@
+#ifdef _MSC_VER
+// Additional includes and defines for Visual Studio
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+#include "../include/TlsClient.h"
+#include <cerrno>
+#include <cstring>
+
+#ifdef WEBSCRAPER_HAVE_OPENSSL
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+#include <openssl/x509v3.h>
+#endif
+
+#ifndef _WIN32
+#include <csignal>
+#endif
+
+static void set_error(std::string* error, const std::string& message) {
+    if (error != nullptr) {
+        *error = message;
+    }
+}
+
+#ifdef WEBSCRAPER_HAVE_OPENSSL
+
+// Certificates name IP hosts in a different field, and SNI must not carry an IP
+static bool is_ip_literal(const std::string& hostname) {
+    unsigned char address[16];
+    return inet_pton(AF_INET, hostname.c_str(), address) == 1 ||
+           inet_pton(AF_INET6, hostname.c_str(), address) == 1;
+}
+
+TlsConnection::TlsConnection(TlsContext* ctx_owner, ssl_st* session, const std::string& key)
+    : owner(ctx_owner), ssl(session), session_key(key), handshake_done(false) {}
+
+TlsConnection::~TlsConnection() {
+    SSL_free(ssl);
+}
+
+TlsResult TlsConnection::check(int result, const char* operation) {
+    int code = SSL_get_error(ssl, result);
+    if (code == SSL_ERROR_WANT_READ) {
+        return TlsResult::WantRead;
+    }
+    if (code == SSL_ERROR_WANT_WRITE) {
+        return TlsResult::WantWrite;
+    }
+    if (code == SSL_ERROR_ZERO_RETURN) {
+        return TlsResult::Closed;
+    }
+
+    std::string reason;
+    unsigned long queued = ERR_get_error();
+    long verify_result = SSL_get_verify_result(ssl);
+    if (!handshake_done && verify_result != X509_V_OK) {
+        reason = std::string("certificate verification failed: ") + X509_verify_cert_error_string(verify_result);
+    } else if (queued != 0) {
+        char buffer[256];
+        ERR_error_string_n(queued, buffer, sizeof(buffer));
+        reason = buffer;
+    } else if (code == SSL_ERROR_SYSCALL && errno == 0) {
+        // A plain TCP close without close_notify (OpenSSL before 3.0)
+        ERR_clear_error();
+        return TlsResult::Closed;
+    } else if (code == SSL_ERROR_SYSCALL) {
+        reason = strerror(errno);
+    } else {
+        reason = "error " + std::to_string(code);
+    }
+    ERR_clear_error();
+    last_error = std::string(operation) + " failed: " + reason;
+    return TlsResult::Error;
+}
+
+TlsResult TlsConnection::handshake() {
+    ERR_clear_error();
+    errno = 0;
+    int result = SSL_do_handshake(ssl);
+    if (result == 1) {
+        handshake_done = true;
+        owner->record_handshake(true, resumed());
+        return TlsResult::Ok;
+    }
+
+    TlsResult outcome = check(result, "TLS handshake");
+    if (outcome == TlsResult::Closed) {
+        last_error = "TLS handshake failed: connection closed by peer";
+        outcome = TlsResult::Error;
+    }
+    if (outcome == TlsResult::Error) {
+        owner->record_handshake(false, false);
+    }
+    return outcome;
+}
+
+TlsResult TlsConnection::read(char* data, size_t length, size_t& received) {
+    ERR_clear_error();
+    errno = 0;
+    received = 0;
+    int result = SSL_read_ex(ssl, data, length, &received);
+    if (result == 1) {
+        return TlsResult::Ok;
+    }
+    return check(result, "TLS read");
+}
+
+TlsResult TlsConnection::write(const char* data, size_t length, size_t& sent) {
+    ERR_clear_error();
+    errno = 0;
+    sent = 0;
+    int result = SSL_write_ex(ssl, data, length, &sent);
+    if (result == 1) {
+        return TlsResult::Ok;
+    }
+    return check(result, "TLS write");
+}
+
+void TlsConnection::shutdown() {
+    if (handshake_done) {
+        ERR_clear_error();
+        SSL_shutdown(ssl);
+        ERR_clear_error();
+    }
+}
+
+bool TlsConnection::resumed() const {
+    return SSL_session_reused(ssl) == 1;
+}
+
+TlsContext::TlsContext(const TlsConfig& cfg) : config(cfg), ctx(nullptr), next_sequence(0) {}
+
+TlsContext::~TlsContext() {
+    clear_sessions();
+    std::lock_guard<std::mutex> lock(mtx);
+    release_context();
+}
+
+bool TlsContext::available() {
+    return true;
+}
+
+bool TlsContext::ensure_context(std::string* error) {
+    if (ctx != nullptr) {
+        return true;
+    }
+
+    #ifndef _WIN32
+    // OpenSSL writes with plain send(), so a server resetting the connection
+    // mid-write would otherwise kill the process with SIGPIPE
+    signal(SIGPIPE, SIG_IGN);
+    #endif
+
+    ctx = SSL_CTX_new(TLS_client_method());
+    if (ctx == nullptr) {
+        set_error(error, "Cannot create TLS context");
+        return false;
+    }
+    SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+    // The fetch paths resend from wherever a partial write stopped
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    #ifdef SSL_OP_IGNORE_UNEXPECTED_EOF
+    // Plenty of servers end a Connection: close response without close_notify;
+    // the HTTP framing still tells a complete body from a truncated one
+    SSL_CTX_set_options(ctx, SSL_OP_IGNORE_UNEXPECTED_EOF);
+    #endif
+
+    if (config.verify_peer) {
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, nullptr);
+        SSL_CTX_set_default_verify_paths(ctx);
+        if (!config.ca_file.empty() && SSL_CTX_load_verify_locations(ctx, config.ca_file.c_str(), nullptr) != 1) {
+            ERR_clear_error();
+            set_error(error, "Cannot load CA file " + config.ca_file);
+            release_context();
+            return false;
+        }
+    } else {
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
+    }
+
+    static const unsigned char alpn[] = { 8, 'h', 't', 't', 'p', '/', '1', '.', '1' };
+    SSL_CTX_set_alpn_protos(ctx, alpn, sizeof(alpn));
+
+    // Sessions are cached here per host rather than in OpenSSL's internal
+    // store, which a client cannot look up by server name
+    SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+    SSL_CTX_sess_set_new_cb(ctx, on_new_session);
+    return true;
+}
+
+void TlsContext::release_context() {
+    if (ctx != nullptr) {
+        SSL_CTX_free(ctx);   // Live connections hold their own reference
+        ctx = nullptr;
+    }
+}
+
+int TlsContext::on_new_session(ssl_st* ssl, ssl_session_st* session) {
+    TlsConnection* conn = static_cast<TlsConnection*>(SSL_get_app_data(ssl));
+    if (conn == nullptr) {
+        return 0;
+    }
+    // Returning 1 keeps the reference OpenSSL passed in
+    return conn->owner->store_session(conn->session_key, session) ? 1 : 0;
+}
+
+bool TlsContext::store_session(const std::string& key, ssl_session_st* session) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!config.session_resumption || config.max_sessions == 0) {
+        return false;
+    }
+
+    auto it = sessions.find(key);
+    if (it != sessions.end()) {
+        // Newest wins: TLS 1.3 servers hand out fresh tickets on every connection
+        SSL_SESSION_free(it->second.session);
+    } else if (sessions.size() >= config.max_sessions) {
+        auto oldest = sessions.begin();
+        for (auto candidate = sessions.begin(); candidate != sessions.end(); ++candidate) {
+            if (candidate->second.stored < oldest->second.stored) {
+                oldest = candidate;
+            }
+        }
+        SSL_SESSION_free(oldest->second.session);
+        sessions.erase(oldest);
+    }
+
+    CachedSession& entry = sessions[key];
+    entry.session = session;
+    entry.stored = next_sequence++;
+    stats.sessions_stored++;
+    return true;
+}
+
+void TlsContext::record_handshake(bool ok, bool resumed) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (ok) {
+        stats.handshakes++;
+        if (resumed) {
+            stats.resumed++;
+        }
+    } else {
+        stats.failures++;
+    }
+}
+
+std::unique_ptr<TlsConnection> TlsContext::wrap(SOCKET sock, const std::string& hostname, int port,
+                                                std::string* error) {
+    std::string key = hostname + ":" + std::to_string(port);
+    SSL* ssl = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!ensure_context(error)) {
+            return nullptr;
+        }
+        ssl = SSL_new(ctx);
+        if (ssl == nullptr) {
+            ERR_clear_error();
+            set_error(error, "Cannot create TLS session");
+            return nullptr;
+        }
+        auto cached = sessions.find(key);
+        if (config.session_resumption && cached != sessions.end()) {
+            if (SSL_SESSION_is_resumable(cached->second.session)) {
+                SSL_set_session(ssl, cached->second.session);
+            } else {
+                SSL_SESSION_free(cached->second.session);
+                sessions.erase(cached);
+            }
+        }
+    }
+
+    std::unique_ptr<TlsConnection> conn(new TlsConnection(this, ssl, key));
+    if (SSL_set_fd(ssl, (int)sock) != 1) {
+        ERR_clear_error();
+        set_error(error, "Cannot attach TLS to the socket");
+        return nullptr;
+    }
+    SSL_set_connect_state(ssl);
+    SSL_set_app_data(ssl, conn.get());
+
+    if (is_ip_literal(hostname)) {
+        X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(ssl), hostname.c_str());
+    } else {
+        SSL_set_tlsext_host_name(ssl, hostname.c_str());
+        SSL_set1_host(ssl, hostname.c_str());
+    }
+    return conn;
+}
+
+void TlsContext::clear_sessions() {
+    std::lock_guard<std::mutex> lock(mtx);
+    for (auto& pair : sessions) {
+        SSL_SESSION_free(pair.second.session);
+    }
+    sessions.clear();
+}
+
+void TlsContext::set_config(const TlsConfig& cfg) {
+    clear_sessions();
+    std::lock_guard<std::mutex> lock(mtx);
+    config = cfg;
+    release_context();
+}
+
+#else
+
+// Built without OpenSSL: every TLS request fails cleanly
+
+TlsConnection::TlsConnection(TlsContext* ctx_owner, ssl_st* session, const std::string& key)
+    : owner(ctx_owner), ssl(session), session_key(key), handshake_done(false) {}
+
+TlsConnection::~TlsConnection() {}
+
+TlsResult TlsConnection::check(int, const char*) {
+    last_error = "built without TLS support";
+    return TlsResult::Error;
+}
+
+TlsResult TlsConnection::handshake() { return check(0, "TLS handshake"); }
+
+TlsResult TlsConnection::read(char*, size_t, size_t& received) {
+    received = 0;
+    return check(0, "TLS read");
+}
+
+TlsResult TlsConnection::write(const char*, size_t, size_t& sent) {
+    sent = 0;
+    return check(0, "TLS write");
+}
+
+void TlsConnection::shutdown() {}
+
+bool TlsConnection::resumed() const { return false; }
+
+TlsContext::TlsContext(const TlsConfig& cfg) : config(cfg), ctx(nullptr), next_sequence(0) {}
+
+TlsContext::~TlsContext() {}
+
+bool TlsContext::available() {
+    return false;
+}
+
+bool TlsContext::ensure_context(std::string* error) {
+    set_error(error, "built without TLS support");
+    return false;
+}
+
+void TlsContext::release_context() {}
+
+int TlsContext::on_new_session(ssl_st*, ssl_session_st*) {
+    return 0;
+}
+
+bool TlsContext::store_session(const std::string&, ssl_session_st*) {
+    return false;
+}
+
+void TlsContext::record_handshake(bool, bool) {}
+
+std::unique_ptr<TlsConnection> TlsContext::wrap(SOCKET, const std::string&, int, std::string* error) {
+    ensure_context(error);
+    return nullptr;
+}
+
+void TlsContext::clear_sessions() {}
+
+void TlsContext::set_config(const TlsConfig& cfg) {
+    std::lock_guard<std::mutex> lock(mtx);
+    config = cfg;
+}
+
+#endif // WEBSCRAPER_HAVE_OPENSSL
+
+std::unique_ptr<TlsConnection> TlsContext::connect(SOCKET sock, const std::string& hostname, int port,
+                                                   std::string* error) {
+    std::unique_ptr<TlsConnection> conn = wrap(sock, hostname, port, error);
+    if (!conn) {
+        return nullptr;
+    }
+    // On a blocking socket the handshake only wants more I/O if the socket timeout expired
+    TlsResult result = conn->handshake();
+    if (result != TlsResult::Ok) {
+        if (result != TlsResult::Error) {
+            record_handshake(false, false);
+            set_error(error, "TLS handshake timed out");
+        } else {
+            set_error(error, conn->error());
+        }
+        return nullptr;
+    }
+    return conn;
+}
+
+TlsConfig TlsContext::get_config() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return config;
+}
+
+TlsStats TlsContext::get_stats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    TlsStats result = stats;
+    result.cached_sessions = sessions.size();
+    return result;
+}
+
+TlsContext& tls_context() {
+    static TlsContext context;
+    return context;
+}
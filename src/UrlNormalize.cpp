@@ -0,0 +1,379 @@
+#include "../include/UrlNormalize.h"
+
+static char lower(char c) {
+    return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c;
+}
+
+static char upper(char c) {
+    return c >= 'a' && c <= 'z' ? (char)(c - 'a' + 'A') : c;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = lower(c);
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+static bool is_alpha(char c) {
+    return lower(c) >= 'a' && lower(c) <= 'z';
+}
+
+static bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// ALPHA / DIGIT / "-" / "." / "_" / "~"
+static bool is_unreserved(char c) {
+    return is_alpha(c) || is_digit(c) || c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+static void append_lower(std::string& out, std::string_view text) {
+    for (char c : text) {
+        out.push_back(lower(c));
+    }
+}
+
+// Append text, decoding the percent-escapes of unreserved characters and
+// upper-casing the hex digits of the others
+static void append_escaped(std::string& out, std::string_view text) {
+    size_t percent;
+    while ((percent = text.find('%')) != std::string_view::npos) {
+        out.append(text.data(), percent);
+        text.remove_prefix(percent);
+        int high = text.size() > 2 ? hex_value(text[1]) : -1;
+        int low = text.size() > 2 ? hex_value(text[2]) : -1;
+        if (high < 0 || low < 0) {
+            out.push_back('%');
+            text.remove_prefix(1);
+            continue;
+        }
+        char decoded = (char)(high * 16 + low);
+        if (is_unreserved(decoded)) {
+            out.push_back(decoded);
+        } else {
+            out.push_back('%');
+            out.push_back(upper(text[1]));
+            out.push_back(upper(text[2]));
+        }
+        text.remove_prefix(3);
+    }
+    out.append(text.data(), text.size());
+}
+
+// Length of the scheme of an absolute reference ("http" in "http://..."), 0 for a relative one
+static size_t scheme_length(std::string_view reference) {
+    if (reference.empty() || !is_alpha(reference[0])) {
+        return 0;
+    }
+    for (size_t i = 1; i < reference.size(); ++i) {
+        char c = reference[i];
+        if (c == ':') {
+            return i;
+        }
+        if (!is_alpha(c) && !is_digit(c) && c != '+' && c != '-' && c != '.') {
+            return 0;
+        }
+    }
+    return 0;
+}
+
+static bool equals_ignoring_case(std::string_view text, std::string_view lower_word) {
+    if (text.size() != lower_word.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (lower(text[i]) != lower_word[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Append "[userinfo@]host[:port]" with the host in lower case and the
+// scheme's default port left out
+static void append_authority(std::string& out, std::string_view scheme, std::string_view authority) {
+    size_t at = authority.rfind('@');
+    if (at != std::string_view::npos) {
+        out.append(authority.data(), at + 1);
+        authority.remove_prefix(at + 1);
+    }
+    std::string_view port;
+    size_t colon = authority.rfind(':');
+    size_t bracket = authority.rfind(']');   // An IPv6 literal has colons of its own
+    if (colon != std::string_view::npos && (bracket == std::string_view::npos || colon > bracket)) {
+        port = authority.substr(colon + 1);
+        authority = authority.substr(0, colon);
+    }
+    append_lower(out, authority);
+    if (port.empty() || (equals_ignoring_case(scheme, "http") && port == "80") ||
+        (equals_ignoring_case(scheme, "https") && port == "443")) {
+        return;
+    }
+    out.push_back(':');
+    out.append(port.data(), port.size());
+}
+
+// Append the '/'-separated segments of a relative path to out, whose path
+// starts at root and so far ends in '/', removing "." and ".." segments as
+// they come (remove_dot_segments with the merge folded in)
+static void append_segments(std::string& out, size_t root, std::string_view segments) {
+    while (true) {
+        size_t slash = segments.find('/');
+        std::string_view segment = segments.substr(0, slash);
+        bool last = slash == std::string_view::npos;
+        if (segment == "..") {
+            // Drop the last segment written, never the root
+            if (out.size() - 1 > root) {
+                out.resize(out.rfind('/', out.size() - 2) + 1);
+            }
+        } else if (segment != ".") {
+            append_escaped(out, segment);
+            if (!last) {
+                out.push_back('/');
+            }
+        }
+        if (last) {
+            return;
+        }
+        segments.remove_prefix(slash + 1);
+    }
+}
+
+// Append an absolute or empty path; an empty one becomes "/"
+static void append_path(std::string& out, std::string_view path) {
+    size_t root = out.size();
+    out.push_back('/');
+    if (!path.empty()) {
+        append_segments(out, root, path.substr(1));
+    }
+}
+
+// The parts of a reference, as views into it
+struct Reference {
+    std::string_view scheme;      // Empty for a relative reference
+    std::string_view authority;
+    bool has_authority = false;
+    std::string_view path;
+    std::string_view query;       // With its '?', empty if there is none
+    std::string_view fragment;    // With its '#', empty if there is none
+};
+
+static Reference split_reference(std::string_view text) {
+    Reference reference;
+    size_t hash = text.find('#');
+    if (hash != std::string_view::npos) {
+        reference.fragment = text.substr(hash);
+        text = text.substr(0, hash);
+    }
+    size_t question = text.find('?');
+    if (question != std::string_view::npos) {
+        reference.query = text.substr(question);
+        text = text.substr(0, question);
+    }
+    size_t scheme = scheme_length(text);
+    if (scheme > 0) {
+        reference.scheme = text.substr(0, scheme);
+        text.remove_prefix(scheme + 1);
+    }
+    if (text.compare(0, 2, "//") == 0) {
+        size_t authority_end = text.find('/', 2);
+        reference.authority = text.substr(2, authority_end == std::string_view::npos ? authority_end : authority_end - 2);
+        reference.has_authority = true;
+        text = authority_end == std::string_view::npos ? std::string_view() : text.substr(authority_end);
+    }
+    reference.path = text;
+    return reference;
+}
+
+// Write an absolute reference into out; false if it has no scheme
+static bool write_absolute(const Reference& reference, std::string& out) {
+    if (reference.scheme.empty()) {
+        return false;
+    }
+    out.clear();
+    append_lower(out, reference.scheme);
+    out.push_back(':');
+    if (reference.has_authority) {
+        out.append("//");
+        append_authority(out, reference.scheme, reference.authority);
+        append_path(out, reference.path);
+    } else {
+        // Opaque, e.g. mailto:
+        append_escaped(out, reference.path);
+    }
+    append_escaped(out, reference.query);
+    return true;
+}
+
+static std::string_view trim(std::string_view text) {
+    while (!text.empty() && is_space(text.front())) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && is_space(text.back())) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+UrlBase::UrlBase(std::string_view base_url) {
+    assign(base_url);
+}
+
+void UrlBase::assign(std::string_view base_url) {
+    base_url = trim(base_url);
+    if (base_url.empty()) {
+        // No page: relative references are left as written
+        url.clear();
+        origin_end = directory_end = path_end = 0;
+        return;
+    }
+    Reference reference = split_reference(base_url);
+    if (base_url.find("://") == std::string_view::npos) {
+        // If no protocol in base_url, assume http://
+        reference = Reference();
+        reference.scheme = "http";
+        reference.has_authority = true;
+        base_url = base_url.substr(0, base_url.find('#'));
+        size_t path_start = base_url.find_first_of("/?");
+        reference.authority = base_url.substr(0, path_start);
+        reference.path = base_url.substr(0, base_url.find('?')).substr(reference.authority.size());
+        reference.query = base_url.substr(reference.authority.size() + reference.path.size());
+    }
+    if (!write_absolute(reference, url)) {
+        url.clear();
+    }
+    origin_end = url.find('/', url.find("://") + 3);
+    if (origin_end == std::string::npos) {
+        origin_end = directory_end = path_end = url.size();
+        return;
+    }
+    path_end = url.find('?', origin_end);
+    if (path_end == std::string::npos) {
+        path_end = url.size();
+    }
+    directory_end = url.rfind('/', path_end - 1) + 1;
+}
+
+void UrlBase::resolve(std::string_view text, std::string& out) const {
+    text = trim(text);
+    if (text.empty()) {
+        // Empty URLs aren't valid
+        out.clear();
+        return;
+    }
+    Reference reference = split_reference(text);
+    if (write_absolute(reference, out)) {
+        // Already absolute
+    } else if (reference.has_authority) {
+        // "//host/path" keeps the page's scheme
+        std::string_view scheme = url.empty() ? std::string_view("http") : std::string_view(url.data(), url.find(':'));
+        out.assign(scheme.data(), scheme.size()).append("://");
+        append_authority(out, scheme, reference.authority);
+        append_path(out, reference.path);
+        append_escaped(out, reference.query);
+    } else if (url.empty()) {
+        // Nothing to resolve against
+        out.clear();
+        append_escaped(out, text.substr(0, text.size() - reference.fragment.size()));
+    } else if (reference.path.empty()) {
+        // Just a query or a fragment: the page itself
+        if (reference.query.empty()) {
+            out.assign(url);
+        } else {
+            out.assign(url, 0, path_end);
+            append_escaped(out, reference.query);
+        }
+    } else {
+        if (reference.path[0] == '/') {
+            // Relative to the domain root
+            out.assign(url, 0, origin_end);
+            append_path(out, reference.path);
+        } else {
+            // Relative to the page's directory
+            out.assign(url, 0, directory_end);
+            append_segments(out, origin_end, reference.path);
+        }
+        append_escaped(out, reference.query);
+    }
+    append_escaped(out, reference.fragment);
+}
+
+void UrlBase::resolve(std::string_view reference, std::string& out, std::string& key) const {
+    resolve(reference, out);
+    canonicalize_url(out, key);
+}
+
+// Normalize URL (convert relative to absolute)
+void normalize_url(std::string_view url, std::string_view base_url, std::string& out) {
+    thread_local UrlBase base;
+    base.assign(base_url);
+    base.resolve(url, out);
+}
+
+std::string normalize_url(const std::string& url, const std::string& base_url) {
+    std::string full_url;
+    normalize_url(url, base_url, full_url);
+    return full_url;
+}
+
+static bool contains_ignoring_case(std::string_view text, std::string_view lower_word) {
+    for (size_t i = 0; i + lower_word.size() <= text.size(); ++i) {
+        size_t n = 0;
+        while (n < lower_word.size() && lower(text[i + n]) == lower_word[n]) {
+            n++;
+        }
+        if (n == lower_word.size()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Canonicalize URL for deduplication: the views are trimmed first and the
+// result is written once, in lower case
+void canonicalize_url(std::string_view url, std::string& result) {
+    // Remove protocol part for matching
+    size_t protocol_pos = url.find("://");
+    if (protocol_pos != std::string_view::npos) {
+        url.remove_prefix(protocol_pos + 3);
+    }
+
+    // Remove 'www.' prefix if present
+    if (url.size() >= 4 && lower(url[0]) == 'w' && lower(url[1]) == 'w' && lower(url[2]) == 'w' && url[3] == '.') {
+        url.remove_prefix(4);
+    }
+
+    // Handle trailing slashes consistently
+    if (!url.empty() && url.back() == '/') {
+        url.remove_suffix(1);
+    }
+
+    // Remove anchor part (anything after #)
+    url = url.substr(0, url.find('#'));
+
+    // Remove query parameters for page content matching
+    // Only do this for pages that aren't search or filtered results
+    size_t query_pos = url.find('?');
+    if (query_pos != std::string_view::npos && !contains_ignoring_case(url, "search") &&
+        !contains_ignoring_case(url, "filter")) {
+        url = url.substr(0, query_pos);
+    }
+
+    // Convert to lowercase for case-insensitive comparison
+    result.resize(url.size());
+    for (size_t i = 0; i < url.size(); ++i) {
+        result[i] = lower(url[i]);
+    }
+}
+
+std::string canonicalize_url(const std::string& url) {
+    std::string result;
+    canonicalize_url(url, result);
+    return result;
+}
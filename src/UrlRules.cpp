@@ -0,0 +1,252 @@
+#include "../include/UrlRules.h"
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <sstream>
+
+// Bytes fed before and after every URL, which anchored patterns are spelled with
+static const char URL_START = '\x02';
+static const char URL_END = '\x03';
+
+static const uint8_t EXCLUDED = 1;
+static const uint8_t INCLUDED = 2;
+static const uint32_t NO_RULE = UINT32_MAX;
+
+const char* UrlRules::default_rules() {
+    return
+        "# Static resources are never crawled; which pages a site wants left\n"
+        "# alone (accounts, admin) is up to its robots.txt\n"
+        "exclude .css\n"
+        "exclude .js\n"
+        "exclude .ico\n"
+        "exclude .jpg\n"
+        "exclude .png\n"
+        "exclude /static/\n"
+        "# An absolute URL that got resolved onto the domain again\n"
+        "exclude http://books.toscrape.comhttp\n"
+        "exclude mhttp\n"
+        "# Same site only\n"
+        "include books.toscrape.com\n"
+        "# Category and numbered listing pages, then book pages: any other .html\n"
+        "# page or directory is neither\n"
+        "class listing /category/\n"
+        "class listing index.html\n"
+        "class listing page-\n"
+        "class other .html\n"
+        "class other /$\n"
+        "class book /catalogue/\n";
+}
+
+UrlRules::UrlRules() : has_includes(false), class_count(1) {
+    compile();
+}
+
+static std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t' || text.front() == '\r')) {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+// Split off the first whitespace-separated word of text
+static std::string_view next_word(std::string_view& text) {
+    text = trim(text);
+    size_t end = std::min(text.find(' '), text.find('\t'));
+    std::string_view word = text.substr(0, end);
+    text = end == std::string_view::npos ? std::string_view() : trim(text.substr(end));
+    return word;
+}
+
+bool UrlRules::append_rules(std::string_view text, const std::string& source, int depth, std::vector<Rule>& out) {
+    size_t line_number = 0;
+    while (!text.empty()) {
+        size_t line_end = text.find('\n');
+        std::string_view line = trim(text.substr(0, line_end));
+        text = line_end == std::string_view::npos ? std::string_view() : text.substr(line_end + 1);
+        line_number++;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::string_view kind = next_word(line);
+        Rule rule;
+        rule.page_class = PageClass::Other;
+        if (kind == "defaults" && line.empty()) {
+            if (depth > 0) {
+                std::cerr << source << ":" << line_number << ": defaults cannot be nested" << std::endl;
+                return false;
+            }
+            if (!append_rules(default_rules(), "built-in rules", depth + 1, out)) {
+                return false;
+            }
+            continue;
+        } else if (kind == "exclude") {
+            rule.kind = Kind::Exclude;
+        } else if (kind == "include") {
+            rule.kind = Kind::Include;
+        } else if (kind == "class") {
+            rule.kind = Kind::Classify;
+            std::string_view name = next_word(line);
+            if (name == "listing") {
+                rule.page_class = PageClass::Listing;
+            } else if (name == "book") {
+                rule.page_class = PageClass::Book;
+            } else if (name != "other") {
+                std::cerr << source << ":" << line_number << ": unknown page class '" << name
+                          << "' (expected listing, book or other)" << std::endl;
+                return false;
+            }
+        } else {
+            std::cerr << source << ":" << line_number << ": unknown rule '" << kind
+                      << "' (expected exclude, include, class or defaults)" << std::endl;
+            return false;
+        }
+
+        std::string_view pattern = line;
+        bool anchored_start = !pattern.empty() && pattern.front() == '^';
+        if (anchored_start) {
+            pattern.remove_prefix(1);
+        }
+        bool anchored_end = !pattern.empty() && pattern.back() == '$';
+        if (anchored_end) {
+            pattern.remove_suffix(1);
+        }
+        if (pattern.empty() && !anchored_start && !anchored_end) {
+            std::cerr << source << ":" << line_number << ": rule has no pattern" << std::endl;
+            return false;
+        }
+        if (anchored_start) {
+            rule.pattern.push_back(URL_START);
+        }
+        rule.pattern.append(pattern);
+        if (anchored_end) {
+            rule.pattern.push_back(URL_END);
+        }
+        out.push_back(rule);
+    }
+    return true;
+}
+
+bool UrlRules::parse(std::string_view text, const std::string& source) {
+    std::vector<Rule> parsed;
+    if (!append_rules(text, source, 0, parsed)) {
+        return false;
+    }
+    rules.swap(parsed);
+    compile();
+    return true;
+}
+
+bool UrlRules::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::cerr << "Cannot open URL rules file " << path << std::endl;
+        return false;
+    }
+    std::stringstream contents;
+    contents << in.rdbuf();
+    return parse(contents.str(), path);
+}
+
+// Build the trie of every pattern, then turn it into a DFA breadth first: a
+// state's missing transitions are its failure state's, and it inherits what
+// the patterns ending at its failure state report
+void UrlRules::compile() {
+    has_includes = false;
+
+    // Bytes no pattern uses all share class 0
+    std::fill(std::begin(byte_class), std::end(byte_class), 0);
+    class_count = 1;
+    for (const Rule& rule : rules) {
+        for (unsigned char c : rule.pattern) {
+            if (byte_class[c] == 0) {
+                byte_class[c] = (uint16_t)class_count++;
+            }
+        }
+    }
+
+    std::vector<std::map<uint16_t, uint32_t>> trie(1);
+    state_flags.assign(1, 0);
+    state_first_class.assign(1, NO_RULE);
+    for (size_t i = 0; i < rules.size(); ++i) {
+        const Rule& rule = rules[i];
+        uint32_t state = 0;
+        for (unsigned char c : rule.pattern) {
+            auto next = trie[state].find(byte_class[c]);
+            if (next != trie[state].end()) {
+                state = next->second;
+                continue;
+            }
+            uint32_t created = (uint32_t)trie.size();
+            trie[state][byte_class[c]] = created;
+            trie.emplace_back();
+            state_flags.push_back(0);
+            state_first_class.push_back(NO_RULE);
+            state = created;
+        }
+        if (rule.kind == Kind::Exclude) {
+            state_flags[state] |= EXCLUDED;
+        } else if (rule.kind == Kind::Include) {
+            state_flags[state] |= INCLUDED;
+            has_includes = true;
+        } else {
+            state_first_class[state] = std::min(state_first_class[state], (uint32_t)i);
+        }
+    }
+
+    transitions.assign(trie.size() * class_count, 0);
+    std::vector<uint32_t> fail(trie.size(), 0);
+    std::vector<uint32_t> queue;
+    for (const auto& edge : trie[0]) {
+        transitions[edge.first] = edge.second;
+        queue.push_back(edge.second);
+    }
+    for (size_t head = 0; head < queue.size(); ++head) {
+        uint32_t state = queue[head];
+        state_flags[state] |= state_flags[fail[state]];
+        state_first_class[state] = std::min(state_first_class[state], state_first_class[fail[state]]);
+        for (size_t c = 0; c < class_count; ++c) {
+            transitions[state * class_count + c] = transitions[fail[state] * class_count + c];
+        }
+        for (const auto& edge : trie[state]) {
+            fail[edge.second] = transitions[fail[state] * class_count + edge.first];
+            transitions[state * class_count + edge.first] = edge.second;
+            queue.push_back(edge.second);
+        }
+    }
+}
+
+UrlMatch UrlRules::match(std::string_view url) const {
+    uint32_t state = transitions[byte_class[(unsigned char)URL_START]];
+    uint8_t flags = state_flags[state];
+    uint32_t first_class = state_first_class[state];
+    for (unsigned char c : url) {
+        state = transitions[state * class_count + byte_class[c]];
+        flags |= state_flags[state];
+        first_class = std::min(first_class, state_first_class[state]);
+    }
+    state = transitions[state * class_count + byte_class[(unsigned char)URL_END]];
+    flags |= state_flags[state];
+    first_class = std::min(first_class, state_first_class[state]);
+
+    UrlMatch result;
+    result.accepted = (flags & EXCLUDED) == 0 && (!has_includes || (flags & INCLUDED) != 0);
+    if (first_class != NO_RULE) {
+        result.page_class = rules[first_class].page_class;
+    }
+    return result;
+}
+
+UrlRules& url_rules() {
+    static UrlRules rules = [] {
+        UrlRules defaults;
+        defaults.parse(UrlRules::default_rules(), "built-in rules");
+        return defaults;
+    }();
+    return rules;
+}
@@ -0,0 +1,241 @@
+#include "../include/ValidatorStore.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
+
+// A header value that would break the one-line-per-page file format
+static bool storable(const std::string& value) {
+    return value.find_first_of("\t\r\n") == std::string::npos;
+}
+
+// Split a line on tabs, keeping empty fields
+static std::vector<std::string> split_fields(const std::string& line) {
+    std::vector<std::string> fields;
+    size_t start = 0;
+    while (true) {
+        size_t tab = line.find('\t', start);
+        if (tab == std::string::npos) {
+            fields.push_back(line.substr(start));
+            return fields;
+        }
+        fields.push_back(line.substr(start, tab - start));
+        start = tab + 1;
+    }
+}
+
+ValidatorStore::ValidatorStore() : is_open(false) {}
+
+bool ValidatorStore::open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mtx);
+    file_path = path;
+    is_open = true;
+    entries.clear();
+    pending.clear();
+
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return true;  // First crawl: nothing recorded yet
+    }
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::vector<std::string> fields = split_fields(line);
+        if (fields.size() < 4 || fields[0].empty()) {
+            std::cerr << "Skipping malformed validator entry in " << path << std::endl;
+            continue;
+        }
+        PageValidators& entry = entries[fields[0]];
+        entry.etag = fields[1];
+        entry.last_modified = fields[2];
+        entry.content_hash = std::strtoull(fields[3].c_str(), nullptr, 16);
+        entry.links.clear();
+        if (fields.size() > 4) {
+            std::istringstream links(fields[4]);
+            std::string link;
+            while (links >> link) {
+                entry.links.push_back(link);
+            }
+        }
+    }
+    return true;
+}
+
+bool ValidatorStore::save() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!is_open || file_path.empty()) {
+        return false;
+    }
+
+    // Write a temporary file and swap it in, so a crash never leaves a torn store
+    std::string temp_path = file_path + ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Failed to write validator store " << temp_path << std::endl;
+            return false;
+        }
+        file << "# url\tetag\tlast-modified\tcontent-hash\tlinks\n";
+        char hash[17];
+        for (const auto& pair : entries) {
+            const PageValidators& entry = pair.second;
+            snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)entry.content_hash);
+            file << pair.first << '\t' << entry.etag << '\t' << entry.last_modified << '\t' << hash << '\t';
+            for (size_t i = 0; i < entry.links.size(); ++i) {
+                if (i > 0) {
+                    file << ' ';
+                }
+                file << entry.links[i];
+            }
+            file << '\n';
+        }
+        if (!file.good()) {
+            std::cerr << "Failed to write validator store " << temp_path << std::endl;
+            return false;
+        }
+    }
+
+    #ifdef _WIN32
+    std::remove(file_path.c_str());  // rename() does not replace an existing file on Windows
+    #endif
+    if (std::rename(temp_path.c_str(), file_path.c_str()) != 0) {
+        std::cerr << "Failed to replace validator store " << file_path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ValidatorStore::enabled() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return is_open;
+}
+
+std::string ValidatorStore::conditional_headers(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!is_open) {
+        return "";
+    }
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        return "";
+    }
+
+    std::string headers;
+    if (!it->second.etag.empty()) {
+        headers += "If-None-Match: " + it->second.etag + "\r\n";
+    }
+    if (!it->second.last_modified.empty()) {
+        headers += "If-Modified-Since: " + it->second.last_modified + "\r\n";
+    }
+    if (!headers.empty()) {
+        stats.conditional_requests++;
+    }
+    return headers;
+}
+
+void ValidatorStore::record(const std::string& key, HttpResponse& response) {
+    if (response.status_code != 200 && response.status_code != 304) {
+        return;
+    }
+
+    if (!enabled()) {
+        return;
+    }
+    // Hash outside the lock; bodies can be large and workers record concurrently
+    uint64_t hash = response.status_code == 200 ? content_hash(response.body) : 0;
+
+    std::lock_guard<std::mutex> lock(mtx);
+    if (response.status_code == 304) {
+        // Only ever sent in answer to our validators, so the stored copy is current
+        response.unchanged = true;
+        stats.not_modified++;
+        return;
+    }
+
+    std::string etag = response.header("etag");
+    std::string last_modified = response.header("last-modified");
+    auto it = entries.find(key);
+    if (it != entries.end() && it->second.content_hash == hash) {
+        // The server ignored (or could not use) the validators but nothing
+        // changed, so the stored links still hold and the entry can be updated
+        response.unchanged = true;
+        stats.hash_matches++;
+        it->second.etag = storable(etag) ? etag : "";
+        it->second.last_modified = storable(last_modified) ? last_modified : "";
+        return;
+    }
+
+    // A changed page: its old entry stays until set_links() commits the new
+    // validators together with the new links, so a page that is fetched but
+    // never parsed is not later taken as unchanged with no links
+    PageValidators& entry = pending[key];
+    entry.etag = storable(etag) ? etag : "";
+    entry.last_modified = storable(last_modified) ? last_modified : "";
+    entry.content_hash = hash;
+}
+
+void ValidatorStore::set_links(const std::string& key, const std::vector<std::string>& links) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!is_open || key.empty()) {
+        return;
+    }
+    auto fetched = pending.find(key);
+    if (fetched != pending.end()) {
+        entries[key] = std::move(fetched->second);
+        pending.erase(fetched);
+        stats.updated++;
+    }
+    std::vector<std::string>& stored = entries[key].links;
+    stored.clear();
+    for (const std::string& link : links) {
+        // Links are stored space-separated
+        if (!link.empty() && link.find_first_of(" \t\r\n") == std::string::npos) {
+            stored.push_back(link);
+        }
+    }
+}
+
+bool ValidatorStore::links(const std::string& key, std::vector<std::string>& links) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        return false;
+    }
+    links = it->second.links;
+    return true;
+}
+
+ValidatorStoreStats ValidatorStore::get_stats() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    ValidatorStoreStats result = stats;
+    result.entries = entries.size();
+    return result;
+}
+
+std::string validator_key(const std::string& hostname, const std::string& resource_path) {
+    if (resource_path.compare(0, 7, "http://") == 0 || resource_path.compare(0, 8, "https://") == 0) {
+        return resource_path;
+    }
+    return "http://" + hostname + resource_path;
+}
+
+uint64_t content_hash(std::string_view data) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+ValidatorStore& validator_store() {
+    static ValidatorStore store;
+    return store;
+}
@@ -0,0 +1,385 @@
+/**
+ * Web Scraper - Synthetic Catalog Server
+ *
+ * Serves a generated books.toscrape.com look-alike (see SyntheticCatalog.h)
+ * over HTTP/1.1 keep-alive, so the crawler, the workers and the server can be
+ * load-tested without a network. Latency and failures can be injected.
+ */
+
+#include "../include/config.h"
+#include "../include/compat.h"
+#include "../include/SyntheticCatalog.h"
+#ifndef _WIN32
+#include <netinet/tcp.h>
+#endif
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// What the server injects into its responses
+struct FaultConfig {
+    int latency_ms = 0;        // Delay before every response
+    int jitter_ms = 0;         // Extra delay, uniform in [0, jitter_ms]
+    double error_rate = 0.0;   // Fraction of requests answered 503 Service Unavailable
+    double drop_rate = 0.0;    // Fraction of requests whose connection is closed without an answer
+    unsigned long long seed = 1;
+};
+
+// Counters, reported periodically and at shutdown
+struct CatalogServerStats {
+    std::atomic<unsigned long long> connections{0};
+    std::atomic<unsigned long long> requests{0};
+    std::atomic<unsigned long long> pages{0};        // 200 responses
+    std::atomic<unsigned long long> not_found{0};
+    std::atomic<unsigned long long> errors{0};       // Injected 503s
+    std::atomic<unsigned long long> drops{0};        // Injected hang-ups
+    std::atomic<unsigned long long> bytes_sent{0};
+};
+
+static std::atomic<bool> shutdown_requested(false);
+static CatalogServerStats server_stats;
+
+// Served as /robots.txt when set (--robots); otherwise that path is a 404
+static std::string robots_txt;
+
+static void handle_signal(int) {
+    shutdown_requested.store(true);
+}
+
+static bool send_all(SOCKET client, const std::string& data) {
+    size_t offset = 0;
+    while (offset < data.length()) {
+        int sent = send(client, data.data() + offset, (int)(data.length() - offset), 0);
+        if (sent <= 0) {
+            return false;
+        }
+        offset += (size_t)sent;
+    }
+    server_stats.bytes_sent += data.length();
+    return true;
+}
+
+static std::string response_head(const char* status, size_t length, bool keep_alive,
+                                 const char* content_type = "text/html; charset=utf-8") {
+    std::string head = "HTTP/1.1 ";
+    head += status;
+    head += "\r\nServer: catalog_server\r\nContent-Type: ";
+    head += content_type;
+    head += "\r\nContent-Length: ";
+    head += std::to_string(length);
+    head += keep_alive ? "\r\nConnection: keep-alive\r\n\r\n" : "\r\nConnection: close\r\n\r\n";
+    return head;
+}
+
+// Case-insensitive search for a header line "name: value" in the request head
+static bool header_has(const std::string& head, const std::string& name, const std::string& value) {
+    std::string lower = head;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return std::tolower(c); });
+    size_t pos = lower.find("\r\n" + name + ":");
+    if (pos == std::string::npos) {
+        return false;
+    }
+    size_t end = lower.find("\r\n", pos + 2);
+    return lower.substr(pos, end - pos).find(value) != std::string::npos;
+}
+
+// Serve requests on one connection until the client hangs up, asks to close
+// or an injected drop ends it. Pipelined requests are answered in order.
+static void serve_connection(SOCKET client, const SyntheticCatalog* catalog, FaultConfig faults,
+                             unsigned long long connection) {
+    std::mt19937_64 random(faults.seed * 0x9e3779b97f4a7c15ULL + connection);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+    std::string pending;
+    std::string page;
+    char chunk[16384];
+
+    while (!shutdown_requested.load()) {
+        size_t end = pending.find("\r\n\r\n");
+        if (end == std::string::npos) {
+            if (pending.length() > 65536) {
+                send_all(client, response_head("431 Request Header Fields Too Large", 0, false));
+                break;
+            }
+            int received = recv(client, chunk, sizeof(chunk), 0);
+            if (received <= 0) {
+                break;
+            }
+            pending.append(chunk, (size_t)received);
+            continue;
+        }
+        std::string head = pending.substr(0, end + 2);
+        pending.erase(0, end + 4);
+        server_stats.requests++;
+
+        size_t method_end = head.find(' ');
+        size_t target_end = method_end == std::string::npos ? std::string::npos : head.find(' ', method_end + 1);
+        if (target_end == std::string::npos) {
+            send_all(client, response_head("400 Bad Request", 0, false));
+            break;
+        }
+        std::string method = head.substr(0, method_end);
+        std::string target = head.substr(method_end + 1, target_end - method_end - 1);
+        bool http10 = head.compare(target_end + 1, 8, "HTTP/1.0") == 0;
+        bool keep_alive = http10 ? header_has(head, "connection", "keep-alive")
+                                 : !header_has(head, "connection", "close");
+
+        // Absolute-form targets ("http://host/path") are served by their path
+        size_t scheme = target.find("://");
+        if (scheme != std::string::npos) {
+            size_t path_start = target.find('/', scheme + 3);
+            target = path_start == std::string::npos ? "/" : target.substr(path_start);
+        }
+
+        int delay = faults.latency_ms;
+        if (faults.jitter_ms > 0) {
+            delay += (int)(random() % (unsigned long long)(faults.jitter_ms + 1));
+        }
+        if (delay > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+        }
+
+        if (faults.drop_rate > 0 && chance(random) < faults.drop_rate) {
+            server_stats.drops++;
+            break;
+        }
+
+        std::string response;
+        if (method != "GET" && method != "HEAD") {
+            response = response_head("405 Method Not Allowed", 0, keep_alive);
+        } else if (faults.error_rate > 0 && chance(random) < faults.error_rate) {
+            server_stats.errors++;
+            const std::string body = "<html><body><h1>503 Service Unavailable</h1></body></html>\n";
+            response = response_head("503 Service Unavailable", body.length(), keep_alive);
+            if (method == "GET") {
+                response += body;
+            }
+        } else if (!robots_txt.empty() && target.compare(0, target.find('?'), "/robots.txt") == 0) {
+            server_stats.pages++;
+            response = response_head("200 OK", robots_txt.length(), keep_alive, "text/plain");
+            if (method == "GET") {
+                response += robots_txt;
+            }
+        } else if (catalog->render(target, page)) {
+            server_stats.pages++;
+            response = response_head("200 OK", page.length(), keep_alive);
+            if (method == "GET") {
+                response += page;
+            }
+        } else {
+            server_stats.not_found++;
+            const std::string body = "<html><body><h1>404 Not Found</h1></body></html>\n";
+            response = response_head("404 Not Found", body.length(), keep_alive);
+            if (method == "GET") {
+                response += body;
+            }
+        }
+        if (!send_all(client, response) || !keep_alive) {
+            break;
+        }
+    }
+    CLOSE_SOCKET(client);
+}
+
+// Print what was served since the last report, every interval seconds
+static void report_stats(int interval) {
+    unsigned long long last_requests = 0;
+    unsigned long long last_bytes = 0;
+    auto last = std::chrono::steady_clock::now();
+    while (!shutdown_requested.load()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        auto now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now - last).count();
+        if (seconds < interval) {
+            continue;
+        }
+        unsigned long long requests = server_stats.requests.load();
+        unsigned long long bytes = server_stats.bytes_sent.load();
+        if (requests != last_requests) {
+            printf("%.0f req/s, %.2f MB/s (%llu requests, %llu pages, %llu not found, %llu errors, %llu dropped)\n",
+                   (requests - last_requests) / seconds, (bytes - last_bytes) / seconds / 1e6, requests,
+                   server_stats.pages.load(), server_stats.not_found.load(), server_stats.errors.load(),
+                   server_stats.drops.load());
+            fflush(stdout);
+        }
+        last_requests = requests;
+        last_bytes = bytes;
+        last = now;
+    }
+}
+
+static void display_help() {
+    std::cout << "Synthetic catalog server usage:" << std::endl;
+    std::cout << "  catalog_server [options]" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  -h, --help          Show this help message" << std::endl;
+    std::cout << "  --port N            Listen on port N (default: 8080)" << std::endl;
+    std::cout << "  --bind ADDRESS      Listen on ADDRESS (default: 127.0.0.1)" << std::endl;
+    std::cout << "  --books N           Book pages in the catalog (default: 1000)" << std::endl;
+    std::cout << "  --per-page N        Books per listing page (default: 20)" << std::endl;
+    std::cout << "  --categories N      Categories, each with its own listing (default: 50)" << std::endl;
+    std::cout << "  --seed N            Vary titles, prices, ratings and injected faults (default: 1)" << std::endl;
+    std::cout << "  --latency MS        Delay every response by MS milliseconds (default: 0)" << std::endl;
+    std::cout << "  --jitter MS         Add a random 0..MS milliseconds on top (default: 0)" << std::endl;
+    std::cout << "  --error-rate P      Answer a fraction P of requests 503 (default: 0)" << std::endl;
+    std::cout << "  --drop-rate P       Close the connection on a fraction P of requests (default: 0)" << std::endl;
+    std::cout << "  --robots FILE       Serve FILE as /robots.txt (default: none, a 404)" << std::endl;
+    std::cout << "  --stats-interval S  Report throughput every S seconds, 0 = never (default: 5)" << std::endl;
+    std::cout << std::endl;
+    std::cout << "Point a crawl at it with --connect-to, keeping the books.toscrape.com URLs:" << std::endl;
+    std::cout << "  catalog_server --books 100000 --latency 20 --jitter 30 --error-rate 0.01" << std::endl;
+    std::cout << "  webscraper --connect-to 127.0.0.1:8080 --rate 0 -c 64" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+    SyntheticCatalogConfig catalog_config;
+    FaultConfig faults;
+    int port = 8080;
+    std::string bind_address = "127.0.0.1";
+    int stats_interval = 5;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        try {
+            if (arg == "-h" || arg == "--help") {
+                display_help();
+                return 0;
+            } else if (arg == "--port" && i + 1 < argc) {
+                port = std::stoi(argv[++i]);
+            } else if (arg == "--bind" && i + 1 < argc) {
+                bind_address = argv[++i];
+            } else if (arg == "--books" && i + 1 < argc) {
+                catalog_config.books = (size_t)std::max(0LL, std::stoll(argv[++i]));
+            } else if (arg == "--per-page" && i + 1 < argc) {
+                catalog_config.books_per_page = (size_t)std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--categories" && i + 1 < argc) {
+                catalog_config.categories = (size_t)std::max(1, std::stoi(argv[++i]));
+            } else if (arg == "--seed" && i + 1 < argc) {
+                catalog_config.seed = faults.seed = std::stoull(argv[++i]);
+            } else if (arg == "--latency" && i + 1 < argc) {
+                faults.latency_ms = std::max(0, std::stoi(argv[++i]));
+            } else if (arg == "--jitter" && i + 1 < argc) {
+                faults.jitter_ms = std::max(0, std::stoi(argv[++i]));
+            } else if (arg == "--error-rate" && i + 1 < argc) {
+                faults.error_rate = std::min(1.0, std::max(0.0, std::stod(argv[++i])));
+            } else if (arg == "--drop-rate" && i + 1 < argc) {
+                faults.drop_rate = std::min(1.0, std::max(0.0, std::stod(argv[++i])));
+            } else if (arg == "--robots" && i + 1 < argc) {
+                std::ifstream in(argv[++i], std::ios::binary);
+                std::stringstream contents;
+                contents << in.rdbuf();
+                robots_txt = contents.str();
+                if (!in || robots_txt.empty()) {
+                    std::cerr << "Cannot read robots.txt file " << argv[i] << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--stats-interval" && i + 1 < argc) {
+                stats_interval = std::max(0, std::stoi(argv[++i]));
+            } else {
+                std::cerr << "Unknown option: " << arg << std::endl;
+                display_help();
+                return 1;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Invalid value for " << arg << ": " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    #ifdef _WIN32
+    WSADATA wsaData;
+    int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
+    if (result != 0) {
+        std::cerr << "WSAStartup failed: " << result << std::endl;
+        return 1;
+    }
+    #else
+    // A client hanging up mid-response must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+    #endif
+    signal(SIGINT, handle_signal);
+    signal(SIGTERM, handle_signal);
+
+    SOCKET listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listener == INVALID_SOCKET) {
+        std::cerr << "Error creating socket" << std::endl;
+        SOCKET_CLEANUP;
+        return 1;
+    }
+    int reuse = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+    struct sockaddr_in address;
+    ZeroMemory(&address, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons((unsigned short)port);
+    if (inet_pton(AF_INET, bind_address.c_str(), &address.sin_addr) != 1) {
+        std::cerr << "Invalid bind address: " << bind_address << std::endl;
+        CLOSE_SOCKET(listener);
+        SOCKET_CLEANUP;
+        return 1;
+    }
+    if (bind(listener, (struct sockaddr*)&address, sizeof(address)) == SOCKET_ERROR ||
+        listen(listener, SOMAXCONN) == SOCKET_ERROR) {
+        std::cerr << "Cannot listen on " << bind_address << ":" << port << std::endl;
+        CLOSE_SOCKET(listener);
+        SOCKET_CLEANUP;
+        return 1;
+    }
+
+    SyntheticCatalog catalog(catalog_config);
+    std::cout << "Serving a catalog of " << catalog_config.books << " books (" << catalog.page_count()
+              << " pages) on http://" << bind_address << ":" << port << "/" << std::endl;
+    if (faults.latency_ms > 0 || faults.jitter_ms > 0 || faults.error_rate > 0 || faults.drop_rate > 0) {
+        std::cout << "Injecting " << faults.latency_ms << "+0.." << faults.jitter_ms << " ms latency, "
+                  << faults.error_rate * 100 << "% errors, " << faults.drop_rate * 100 << "% dropped connections"
+                  << std::endl;
+    }
+    std::cout.flush();
+
+    std::thread reporter;
+    if (stats_interval > 0) {
+        reporter = std::thread(report_stats, stats_interval);
+    }
+
+    // select() with a timeout so a signal can end the accept loop
+    while (!shutdown_requested.load()) {
+        fd_set readfds;
+        FD_ZERO(&readfds);
+        FD_SET(listener, &readfds);
+        struct timeval timeout;
+        timeout.tv_sec = 1;
+        timeout.tv_usec = 0;
+        int activity = select((int)listener + 1, &readfds, NULL, NULL, &timeout);
+        if (activity <= 0) {
+            continue;
+        }
+        SOCKET client = accept(listener, NULL, NULL);
+        if (client == INVALID_SOCKET) {
+            continue;
+        }
+        int nodelay = 1;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, (const char*)&nodelay, sizeof(nodelay));
+        unsigned long long connection = server_stats.connections++;
+        std::thread(serve_connection, client, &catalog, faults, connection).detach();
+    }
+
+    CLOSE_SOCKET(listener);
+    if (reporter.joinable()) {
+        reporter.join();
+    }
+    std::cout << "Served " << server_stats.requests.load() << " requests on " << server_stats.connections.load()
+              << " connections: " << server_stats.pages.load() << " pages, " << server_stats.not_found.load()
+              << " not found, " << server_stats.errors.load() << " errors, " << server_stats.drops.load()
+              << " dropped, " << server_stats.bytes_sent.load() / 1e6 << " MB" << std::endl;
+    SOCKET_CLEANUP;
+    return 0;
+}
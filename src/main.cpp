@@ -1,16 +1,21 @@
 #include "../include/Book.h"
 #include "../include/Crawler.h"
 #include "../include/HtmlParser.h"
+#include "../include/TcpConnect.h"
+#include "../include/TlsClient.h"
+#include "../include/HttpClient.h"
+#include "../include/UrlRules.h"
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <vector>
 #include <set>
+#include <algorithm>
 
 void print_book(const Book& book) {
     std::cout << "Title: " << book.title << std::endl;
-    std::cout << "Price: " << book.price << std::endl;
-    std::cout << "Rating: " << book.rating << std::endl;
+    std::cout << "Price: " << format_price(book.price) << std::endl;
+    std::cout << "Rating: " << rating_name(book.rating) << std::endl;
     std::cout << "URL: " << book.url << std::endl;
     std::cout << "-------------------------" << std::endl;
 }
@@ -36,8 +41,8 @@ void save_to_csv(const std::vector<Book>& books, const std::string& filename) {
         }
         
         outfile << "\"" << escaped_title << "\","
-                << "\"" << book.price << "\","
-                << "\"" << book.rating << "\","
+                << "\"" << format_price(book.price) << "\","
+                << "\"" << rating_name(book.rating) << "\","
                 << "\"" << book.url << "\"\n";
     }
     
@@ -52,6 +57,27 @@ void display_help() {
     std::cout << "Options:" << std::endl;
     std::cout << "  -h, --help        Show this help message" << std::endl;
     std::cout << "  -s, --sequential  Use sequential crawling (default: queue-based)" << std::endl;
+    std::cout << "  -c, --concurrency N  Keep N page fetches in flight (queue-based only, default: 1)" << std::endl;
+    std::cout << "  -p, --pipeline N  Pipeline up to N requests per connection (default: 1, off)" << std::endl;
+    std::cout << "  --stream          Parse each page while it downloads (queue-based, one fetch at a time)" << std::endl;
+    std::cout << "  --near-duplicates BITS  Skip pages whose text fingerprint is within BITS bits of a page" << std::endl;
+    std::cout << "                    already parsed (queue-based; 3 suits most sites, default: off)" << std::endl;
+    std::cout << "  -r, --recrawl FILE  Keep ETag/Last-Modified validators in FILE; pages unchanged" << std::endl;
+    std::cout << "                    since the last crawl are not parsed again" << std::endl;
+    std::cout << "  --record FILE     Append every fetched response to the archive FILE" << std::endl;
+    std::cout << "  --replay FILE     Serve every fetch from the archive FILE (no network)" << std::endl;
+    std::cout << "  --replay-latency MS  Delay each replayed fetch by MS milliseconds (default: 0)" << std::endl;
+    std::cout << "  --rate N          Send each host at most N requests per second (default: 8, 0 = unlimited)" << std::endl;
+    std::cout << "  --burst N         Let an idle host take N requests back to back (default: 16)" << std::endl;
+    std::cout << "  --connect-timeout MS  Give up connecting to a host after MS milliseconds (default: 10000)" << std::endl;
+    std::cout << "  --https           Crawl over HTTPS, resuming TLS sessions across connections" << std::endl;
+    std::cout << "  --html-only       Read just the headers of responses that are not HTML" << std::endl;
+    std::cout << "  --max-body BYTES  Abandon response bodies larger than BYTES (default: 0, no cap)" << std::endl;
+    std::cout << "  --ca-file FILE    Also trust the certificates in FILE (PEM) for HTTPS" << std::endl;
+    std::cout << "  --connect-to HOST:PORT  Fetch every page from HOST:PORT instead (e.g. a local catalog_server)" << std::endl;
+    std::cout << "  --ignore-robots   Do not fetch robots.txt; crawl pages it disallows and ignore its Crawl-delay" << std::endl;
+    std::cout << "  --rules FILE      Decide which links to follow and which pages are listings or books" << std::endl;
+    std::cout << "                    with the rules in FILE (default: the built-in books.toscrape.com rules)" << std::endl;
     std::cout << std::endl;
     std::cout << "Arguments:" << std::endl;
     std::cout << "  max_pages         Maximum number of pages to crawl (optional)" << std::endl;
@@ -63,6 +89,13 @@ void display_help() {
     std::cout << "  webscraper 5            # Crawl maximum 5 pages using queue-based approach" << std::endl;
     std::cout << "  webscraper -s           # Crawl all available pages sequentially" << std::endl;
     std::cout << "  webscraper -s 5         # Crawl maximum 5 pages sequentially" << std::endl;
+    std::cout << "  webscraper -c 32 100    # Crawl 100 pages with 32 fetches in flight" << std::endl;
+    std::cout << "  webscraper -s -p 8      # Crawl sequentially, pipelining 8 listing pages at a time" << std::endl;
+    std::cout << "  webscraper -r crawl.db  # Recrawl, only parsing pages that changed since the last run" << std::endl;
+    std::cout << "  webscraper --record site.wsr 50   # Crawl 50 pages and archive the responses" << std::endl;
+    std::cout << "  webscraper --replay site.wsr 50   # Repeat that crawl offline from the archive" << std::endl;
+    std::cout << "  webscraper --https -c 8 50        # Crawl 50 pages over HTTPS with 8 fetches in flight" << std::endl;
+    std::cout << "  webscraper --connect-to 127.0.0.1:8080 --rate 0 -c 32   # Crawl a local catalog_server" << std::endl;
 }
 
 // Function to deduplicate books based on their URLs
@@ -96,6 +129,7 @@ int run_cli_scraper(int argc, char* argv[]) {
     const std::string start_path = "/catalogue/page-1.html";
     int max_pages = 0; // Default to crawl all pages
     bool use_queue = true; // Default to queue-based crawling
+    CrawlOptions options;
     
     // Parse command line arguments
     for (int i = 1; i < argc; ++i) {
@@ -106,6 +140,85 @@ int run_cli_scraper(int argc, char* argv[]) {
             return 0;
         } else if (arg == "-s" || arg == "--sequential") {
             use_queue = false; // Override to use sequential crawling
+        } else if ((arg == "-c" || arg == "--concurrency") && i + 1 < argc) {
+            try {
+                options.max_in_flight = std::max(1, std::stoi(argv[++i]));
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid concurrency: " << argv[i] << std::endl;
+            }
+        } else if ((arg == "-p" || arg == "--pipeline") && i + 1 < argc) {
+            try {
+                options.pipeline_depth = std::max(1, std::stoi(argv[++i]));
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid pipeline depth: " << argv[i] << std::endl;
+            }
+        } else if ((arg == "-r" || arg == "--recrawl") && i + 1 < argc) {
+            options.validator_file = argv[++i];
+        } else if (arg == "--record" && i + 1 < argc) {
+            options.record_file = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            options.replay_file = argv[++i];
+        } else if (arg == "--rate" && i + 1 < argc) {
+            try {
+                options.politeness.rate = std::max(0.0, std::stod(argv[++i]));
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid rate: " << argv[i] << std::endl;
+            }
+        } else if (arg == "--burst" && i + 1 < argc) {
+            try {
+                options.politeness.burst = std::max(1.0, std::stod(argv[++i]));
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid burst: " << argv[i] << std::endl;
+            }
+        } else if (arg == "--stream") {
+            options.stream_parse = true;
+        } else if (arg == "--near-duplicates" && i + 1 < argc) {
+            try {
+                options.near_duplicate_bits = std::min(63, std::max(0, std::stoi(argv[++i])));
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid near-duplicate distance: " << argv[i] << std::endl;
+            }
+        } else if (arg == "--connect-timeout" && i + 1 < argc) {
+            try {
+                TcpConnectConfig connect_config = tcp_connector().get_config();
+                connect_config.connect_timeout = std::chrono::milliseconds(std::max(0, std::stoi(argv[++i])));
+                tcp_connector().set_config(connect_config);
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid connect timeout: " << argv[i] << std::endl;
+            }
+        } else if (arg == "--https") {
+            options.https = true;
+        } else if (arg == "--ignore-robots") {
+            options.obey_robots = false;
+        } else if (arg == "--html-only") {
+            BodyFilter filter = http_body_filter();
+            filter.html_only = true;
+            http_set_body_filter(filter);
+        } else if (arg == "--max-body" && i + 1 < argc) {
+            try {
+                BodyFilter filter = http_body_filter();
+                filter.max_body_bytes = (size_t)std::max(0LL, std::stoll(argv[++i]));
+                http_set_body_filter(filter);
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid body size cap: " << argv[i] << std::endl;
+            }
+        } else if (arg == "--ca-file" && i + 1 < argc) {
+            TlsConfig tls_config = tls_context().get_config();
+            tls_config.ca_file = argv[++i];
+            tls_context().set_config(tls_config);
+        } else if (arg == "--connect-to" && i + 1 < argc) {
+            http_set_connect_to(argv[++i]);
+        } else if (arg == "--rules" && i + 1 < argc) {
+            if (!url_rules().load(argv[++i])) {
+                return 1;
+            }
+            std::cout << "Loaded " << url_rules().rule_count() << " URL rules from " << argv[i] << std::endl;
+        } else if (arg == "--replay-latency" && i + 1 < argc) {
+            try {
+                options.replay_latency_ms = std::max(0, std::stoi(argv[++i]));
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid replay latency: " << argv[i] << std::endl;
+            }
         } else {
             // Assume it's the max_pages value
             try {
@@ -120,6 +233,29 @@ int run_cli_scraper(int argc, char* argv[]) {
     std::cout << "Web Scraper for " << hostname << std::endl;
     std::cout << "Starting from: " << start_path << std::endl;
     std::cout << "Crawling method: " << (use_queue ? "Queue-based" : "Sequential") << std::endl;
+    if (options.https) {
+        std::cout << "Protocol: HTTPS" << (TlsContext::available() ? "" : " (unavailable in this build, using HTTP)")
+                  << std::endl;
+    }
+    if (use_queue && options.max_in_flight > 1) {
+        std::cout << "Fetches in flight: " << options.max_in_flight << std::endl;
+    }
+    if (options.pipeline_depth > 1) {
+        std::cout << "Pipeline depth: " << options.pipeline_depth << std::endl;
+    }
+    if (use_queue && options.near_duplicate_bits >= 0) {
+        std::cout << "Skipping near-duplicate pages within " << options.near_duplicate_bits << " bits" << std::endl;
+    }
+    if (!options.obey_robots) {
+        std::cout << "Ignoring robots.txt" << std::endl;
+    }
+    if (!options.validator_file.empty()) {
+        std::cout << "Validator store: " << options.validator_file << std::endl;
+    }
+    if (options.politeness.rate > 0) {
+        std::cout << "Per-host rate limit: " << options.politeness.rate << " requests/s, burst "
+                  << options.politeness.burst << std::endl;
+    }
     
     if (max_pages > 0) {
         std::cout << "Maximum pages to crawl: " << max_pages << std::endl;
@@ -128,15 +264,22 @@ int run_cli_scraper(int argc, char* argv[]) {
     }
     std::cout << "-------------------------" << std::endl;
     
+    // A recrawl only reports books on pages that changed; keep the full books.csv of earlier runs
+    bool recrawl = !options.validator_file.empty() && std::ifstream(options.validator_file).good();
+    
     // Crawl the website
     std::vector<Book> books;
     if (use_queue) {
-        books = crawl_website_queue(hostname, start_path, max_pages);
+        books = crawl_website_queue(hostname, start_path, max_pages, options);
     } else {
-        books = crawl_website(hostname, start_path, max_pages);
+        books = crawl_website(hostname, start_path, max_pages, options);
     }
     
     if (books.empty()) {
+        if (recrawl) {
+            std::cout << "No changed books since the last crawl." << std::endl;
+            return 0;
+        }
         std::cout << "No books were found." << std::endl;
         return 1;
     }
@@ -152,7 +295,7 @@ int run_cli_scraper(int argc, char* argv[]) {
     }
     
     // Save results to CSV
-    save_to_csv(books, "books.csv");
+    save_to_csv(books, recrawl ? "books_changed.csv" : "books.csv");
     
     return 0;
 }
@@ -41,6 +41,7 @@
 #include <fstream>
 #include <set>
 #include "../include/Item.h"
+#include "../include/HostScheduler.h"
 #include <cmath>  // Add this include for log function
 
 // Hide the std::log function from cmath to avoid conflicts
@@ -238,9 +239,15 @@ inline bool server_is_category_page(const std::string& url) {
 #endif // SERVER_DEFINE_URL_HELPERS
 
 // URL Queue Manager
+// Longest a GET_URL request waits for a rate-limited host before the worker is told to WAIT
+const std::chrono::milliseconds MAX_POLITENESS_WAIT(2000);
+
+// Per-host request rate and burst handed to the URL scheduler (--rate / --burst)
+HostSchedulerConfig serverPoliteness;
+
 class UrlQueueManager {
 private:
-    std::queue<std::string> urlQueue;
+    HostScheduler urlQueue;   // Pending URLs, released per host at the politeness rate
     std::set<std::string> processedUrls;
     std::set<std::string> queuedUrls;
     std::map<std::string, int> assignedUrls; // Maps URLs to worker IDs they're assigned to
@@ -253,7 +260,7 @@ private:
 
 public:
     UrlQueueManager(const std::string& host = "books.toscrape.com", const std::string& start = "https://books.toscrape.com/") 
-    : hostname(host), startUrl(start) {
+    : urlQueue(serverPoliteness), hostname(host), startUrl(start) {
         // Determine the type based on the hostname
         if (host.find("toscrape.com") != std::string::npos) {
             currentItemType = ItemType::BOOK;
@@ -308,9 +315,7 @@ public:
         }
         
         // Reset queue and processed URLs
-        while (!urlQueue.empty()) {
-            urlQueue.pop();
-        }
+        urlQueue.clear();
         queuedUrls.clear();
         processedUrls.clear();
         assignedUrls.clear();
@@ -364,7 +369,7 @@ public:
         }
         
         // Add to the queue
-        urlQueue.push(url);
+        urlQueue.push(url_host(url, hostname), url);
         queuedUrls.insert(canonical);
         
         logMessage("Added URL to queue: " + url);
@@ -394,7 +399,7 @@ public:
             }
             
             // Add to the queue
-            urlQueue.push(url);
+            urlQueue.push(url_host(url, hostname), url);
             queuedUrls.insert(canonical);
             addedCount++;
         }
@@ -406,18 +411,25 @@ public:
     }
     
     bool getNextUrl(std::string& url, int workerId = -1) {
-        std::lock_guard<std::mutex> lock(queueMutex);
-        
-        // Check if the queue is empty
-        if (urlQueue.empty()) {
-            // No URLs available in the queue
-            return false;
+        std::unique_lock<std::mutex> lock(queueMutex);
+        
+        // Take the URL of whichever host may be contacted next. If every host
+        // with pending URLs is rate-limited, hold the request until one frees up
+        // rather than sending the worker into its WAIT backoff.
+        auto deadline = std::chrono::steady_clock::now() + MAX_POLITENESS_WAIT;
+        std::string urlHost;
+        HostScheduler::Clock::duration wait;
+        while (!urlQueue.pop_ready(urlHost, url, wait)) {
+            if (wait == HostScheduler::Clock::duration::zero() ||
+                std::chrono::steady_clock::now() + wait > deadline) {
+                // No URLs available in the queue (or none soon enough)
+                return false;
+            }
+            lock.unlock();
+            std::this_thread::sleep_for(wait);
+            lock.lock();
         }
         
-        // Get the next URL from the queue
-        url = urlQueue.front();
-        urlQueue.pop();
-        
         // Log that we're getting a URL
         logMessage("Getting next URL for worker " + std::to_string(workerId) + ": " + url);
         
@@ -488,7 +500,7 @@ public:
         // Remove from assigned and readd to queue
         for (const auto& url : urlsToReassign) {
             assignedUrls.erase(url);
-            urlQueue.push(url);
+            urlQueue.push(url_host(url, hostname), url);
         }
         
         logMessage("Reassigned " + std::to_string(urlsToReassign.size()) + 
@@ -566,10 +578,9 @@ public:
                 Book book;
                 book.title = item.title;
                 book.url = item.url;
-                book.price = item.fields.count("price_original") ? 
-                            item.fields.at("price_original") : std::to_string(item.price);
-                book.rating = item.fields.count("rating_original") ? 
-                             item.fields.at("rating_original") : std::to_string(item.rating);
+                book.price = item.price;
+                book.rating = item.rating;
+                book.category = item.category;
                 collectedBooks.push_back(book);
             }
             
@@ -597,8 +608,8 @@ public:
             // Write each book
             for (const auto& book : collectedBooks) {
                 outfile << "\"" << book.title << "\",";
-                outfile << "\"" << book.price << "\",";
-                outfile << "\"" << book.rating << "\",";
+                outfile << "\"" << format_price(book.price) << "\",";
+                outfile << "\"" << rating_name(book.rating) << "\",";
                 outfile << "\"" << book.url << "\"\n";
             }
             
@@ -642,9 +653,9 @@ public:
             for (const auto& item : collectedItems) {
                 outfile << "\"" << item.typeToString() << "\",";
                 outfile << "\"" << item.title << "\",";
-                outfile << "\"" << item.price << "\",";
-                outfile << "\"" << item.rating << "\",";
-                outfile << "\"" << item.category << "\",";
+                outfile << "\"" << item.price.value() << "\",";
+                outfile << "\"" << (int)item.rating << "\",";
+                outfile << "\"" << category_name(item.category) << "\",";
                 outfile << "\"" << item.url << "\",";
                 outfile << "\"" << item.description << "\"";
                 
@@ -681,39 +692,48 @@ public:
         
         // Count items by type
         int bookCount = 0, jobCount = 0, productCount = 0, articleCount = 0, genericCount = 0;
-        double totalPrice = 0.0, bookTotalPrice = 0.0, jobTotalPrice = 0.0, productTotalPrice = 0.0;
+        // Summed in minor units, so totals are exact
+        int64_t totalMinor = 0, bookTotalMinor = 0, jobTotalMinor = 0, productTotalMinor = 0;
         int ratedItems = 0;
         double totalRating = 0.0;
-        std::set<std::string> categories;
+        std::set<CategoryId> categoryIds;
         
         for (const auto& item : collectedItems) {
+            int64_t minor = std::max<int64_t>(0, item.price.minor);
+            
             // Count by type
             switch (item.type) {
                 case ItemType::BOOK: bookCount++; 
-                    if (item.price > 0) bookTotalPrice += item.price; 
+                    bookTotalMinor += minor; 
                     break;
                 case ItemType::JOB: jobCount++; 
-                    if (item.price > 0) jobTotalPrice += item.price; 
+                    jobTotalMinor += minor; 
                     break;
                 case ItemType::PRODUCT: productCount++; 
-                    if (item.price > 0) productTotalPrice += item.price; 
+                    productTotalMinor += minor; 
                     break;
                 case ItemType::ARTICLE: articleCount++; break;
                 default: genericCount++; break;
             }
             
             // Track price and rating
-            if (item.price > 0) totalPrice += item.price;
-            if (item.rating > 0) {
-                totalRating += item.rating;
+            totalMinor += minor;
+            if (item.rating != Rating::Unknown) {
+                totalRating += (int)item.rating;
                 ratedItems++;
             }
             
             // Track categories
-            if (!item.category.empty()) {
-                categories.insert(item.category);
+            if (item.category != NO_CATEGORY) {
+                categoryIds.insert(item.category);
             }
         }
+        double totalPrice = totalMinor / 100.0, bookTotalPrice = bookTotalMinor / 100.0;
+        double jobTotalPrice = jobTotalMinor / 100.0, productTotalPrice = productTotalMinor / 100.0;
+        std::set<std::string> categories;
+        for (CategoryId id : categoryIds) {
+            categories.insert(category_name(id));
+        }
         
         // Store stats
         stats["totalItems"] = std::to_string(collectedItems.size());
@@ -772,9 +792,7 @@ public:
         std::lock_guard<std::mutex> lock(queueMutex);
         
         // Always clear the URL queue first
-        while (!urlQueue.empty()) {
-            urlQueue.pop();
-        }
+        urlQueue.clear();
         
         // Reset all collections completely
         processedUrls.clear();
@@ -806,7 +824,7 @@ public:
         }
         
         // Add to queue (it should be fresh now)
-        urlQueue.push(url);
+        urlQueue.push(url_host(url, hostname), url);
         queuedUrls.insert(canonical);
         logMessage("Added seed URL to queue: " + url);
     }
@@ -891,7 +909,7 @@ void handleClient(SOCKET clientSocket, const std::string& clientAddress, int cli
                 std::string data = message.substr(10); // Skip "PROCESSED:"
                 
                 // Parse the JSON-like data
-                // Format: {url:"...",book:{title:"...",price:"...",rating:"...",url:"..."}}
+                // Format: {url:"...",book:{title:"...",price:"...",rating:"...",url:"...",category:"..."}}
                 
                 // Extract the URL
                 size_t urlStart = data.find("url:\"") + 5;
@@ -913,16 +931,24 @@ void handleClient(SOCKET clientSocket, const std::string& clientAddress, int cli
                 
                 size_t priceStart = data.find("price:\"") + 7;
                 size_t priceEnd = data.find("\"", priceStart);
-                book.price = data.substr(priceStart, priceEnd - priceStart);
+                parse_price(std::string_view(data).substr(priceStart, priceEnd - priceStart), book.price);
                 
                 size_t ratingStart = data.find("rating:\"") + 8;
                 size_t ratingEnd = data.find("\"", ratingStart);
-                book.rating = data.substr(ratingStart, ratingEnd - ratingStart);
+                book.rating = parse_rating(std::string_view(data).substr(ratingStart, ratingEnd - ratingStart));
                 
                 size_t bookUrlStart = data.find("url:\"", ratingEnd) + 5;
                 size_t bookUrlEnd = data.find("\"", bookUrlStart);
                 book.url = data.substr(bookUrlStart, bookUrlEnd - bookUrlStart);
                 
+                // Sent by workers that read it from the book page's breadcrumb
+                size_t categoryStart = data.find("category:\"", bookUrlEnd);
+                if (categoryStart != std::string::npos) {
+                    categoryStart += 10;
+                    size_t categoryEnd = data.find("\"", categoryStart);
+                    book.category = category_id(std::string_view(data).substr(categoryStart, categoryEnd - categoryStart));
+                }
+                
                 // Add book to collection if valid
                 if (!book.title.empty()) {
                     urlQueueManager->addBook(book);
@@ -1420,7 +1446,32 @@ private:
 // Global API handler
 ApiHandler* apiHandler = nullptr;
 
-int main() {
+int main(int argc, char* argv[]) {
+    std::string seedUrl;
+    
+    // Politeness limits for the URL scheduler
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--rate" && i + 1 < argc) {
+            try {
+                serverPoliteness.rate = std::max(0.0, std::stod(argv[++i]));
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid rate" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--burst" && i + 1 < argc) {
+            try {
+                serverPoliteness.burst = std::max(1.0, std::stod(argv[++i]));
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid burst" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--seed" && i + 1 < argc) {
+            // Start URL other than the default (e.g. http://books.toscrape.com/ for a local catalog_server)
+            seedUrl = argv[++i];
+        }
+    }
+    
     #ifdef _WIN32
     // Initialize Winsock on Windows
     WSADATA wsaData;
@@ -1495,6 +1546,9 @@ int main() {
     
     // Initialize URL queue manager
     initUrlQueueManager();
+    if (!seedUrl.empty()) {
+        urlQueueManager->setSeedUrl(seedUrl);
+    }
     
     // Initialize status display
     logMessage("Starting server on port " + std::to_string(SERVER_PORT));
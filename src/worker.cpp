@@ -29,6 +29,10 @@
 #include "../include/Crawler.h"
 #include "../include/HtmlParser.h"
 #include "../include/HttpClient.h"
+#include "../include/FetchEngine.h"
+#include "../include/UrlRules.h"
+#include "../include/NearDuplicate.h"
+#include "../include/Robots.h"
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -42,6 +46,7 @@
 #include <iomanip> // For put_time
 #include <queue>
 #include <set>
+#include <map>
 
 #ifdef _WIN32
 #include <WinSock2.h>
@@ -87,16 +92,37 @@ std::mutex socketMutex;
 // Add a new atomic variable near other globals
 std::atomic<bool> mainThreadCommunicating(false);
 
+// Number of pages fetched concurrently (--concurrency); 1 keeps the one-page-at-a-time loop
+int workerConcurrency = 1;
+
+// Requests pipelined per connection when concurrency is 1 (--pipeline); 1 disables pipelining
+int workerPipelineDepth = 1;
+
+// Validator store for conditional re-fetching (--recrawl); "" crawls every page in full
+std::string workerValidatorFile;
+
+// Text fingerprints of the pages parsed so far (--near-duplicates); pages close
+// to one of them are reported with no book and no links
+bool workerSkipNearDuplicates = false;
+NearDuplicateIndex workerNearDuplicates;
+
+// Per-host request pacing: unlimited, except for hosts whose robots.txt asks
+// for a Crawl-delay (--ignore-robots turns robots.txt off altogether)
+HostScheduler workerPoliteness(HostSchedulerConfig{0.0, 1.0});
+std::mutex workerPolitenessMutex;
+
 // Forward function declarations
 std::string getBaseUrl(const std::string& hostname);
-std::string getUrlFromServer(SOCKET serverSocket);
+std::string getUrlFromServer(SOCKET serverSocket, bool waitIfEmpty = true);
 bool sendProcessedUrlToServer(SOCKET serverSocket, const std::string& url, const Book& book, const std::vector<std::string>& links);
 SOCKET connectToServer(const std::string& serverHost, int serverPort);
 void progressReporter(SOCKET serverSocket);
 bool sendProgressUpdate(SOCKET serverSocket, int count);
 bool should_stop_predicate();
 Book crawl_page(const std::string& hostname, const std::string& page_url);
-std::pair<Book, std::string> crawl_page_with_html(const std::string& hostname, const std::string& page_url);
+std::pair<Book, std::string_view> crawl_page_with_html(const std::string& hostname, const std::string& page_url,
+                                                       HttpResponse& response, bool* unchanged = nullptr,
+                                                       bool* near_duplicate = nullptr);
 
 // Function to get current timestamp as string
 std::string getTimestamp() {
@@ -125,48 +151,12 @@ SOCKET connectToServer(const std::string& serverHost, int serverPort) {
     }
     #endif
     
-    // Create socket
-    SOCKET sock = INVALID_SOCKET;
-    struct addrinfo *addrResult = NULL, *ptr = NULL, hints;
-    
-    ZeroMemory(&hints, sizeof(hints));
-    hints.ai_family = AF_INET;
-    hints.ai_socktype = SOCK_STREAM;
-    hints.ai_protocol = IPPROTO_TCP;
-    
-    // Resolve the server address and port
-    std::string portStr = std::to_string(serverPort);
-    int getaddrResult = getaddrinfo(serverHost.c_str(), portStr.c_str(), &hints, &addrResult);
-    if (getaddrResult != 0) {
-        std::cerr << "getaddrinfo failed: " << getaddrResult << std::endl;
-        SOCKET_CLEANUP;
-        return INVALID_SOCKET;
-    }
-    
-    // Attempt to connect to the first address returned by getaddrinfo
-    for(ptr = addrResult; ptr != NULL; ptr = ptr->ai_next) {
-        // Create a SOCKET for connecting to server
-        sock = socket(ptr->ai_family, ptr->ai_socktype, ptr->ai_protocol);
-        if (sock == INVALID_SOCKET) {
-            std::cerr << "Error creating socket" << std::endl;
-            freeaddrinfo(addrResult);
-            SOCKET_CLEANUP;
-            return INVALID_SOCKET;
-        }
-        
-        // Connect to server
-        if (connect(sock, ptr->ai_addr, (int)ptr->ai_addrlen) == SOCKET_ERROR) {
-            CLOSE_SOCKET(sock);
-            sock = INVALID_SOCKET;
-            continue;
-        }
-        break;
-    }
-    
-    freeaddrinfo(addrResult);
-    
+    // Resolve (IPv6 and IPv4) and race the addresses under the connect deadline,
+    // so a server with one dead address does not stall every reconnect
+    std::string connectError;
+    SOCKET sock = tcp_connector().open(serverHost, serverPort, &connectError);
     if (sock == INVALID_SOCKET) {
-        std::cerr << "Unable to connect to server!" << std::endl;
+        std::cerr << "Unable to connect to server: " << connectError << std::endl;
         SOCKET_CLEANUP;
         return INVALID_SOCKET;
     }
@@ -347,8 +337,9 @@ std::string fixMalformedUrl(const std::string& url) {
     return url;
 }
 
-// Get a URL from the server to process
-std::string getUrlFromServer(SOCKET serverSocket) {
+// Get a URL from the server to process.
+// With waitIfEmpty false a WAIT reply returns immediately (used to top up a fetch batch).
+std::string getUrlFromServer(SOCKET serverSocket, bool waitIfEmpty) {
     // Set the flag to indicate main thread is communicating
     mainThreadCommunicating.store(true);
     // Use RAII to ensure we reset the flag on function exit
@@ -426,6 +417,10 @@ std::string getUrlFromServer(SOCKET serverSocket) {
         }
         
         if (response == "WAIT") {
+            if (!waitIfEmpty) {
+                return "";
+            }
+            
             // No URLs available at the moment, wait and try again
             log("No URLs available at the moment, waiting before retry");
             
@@ -525,8 +520,8 @@ bool sendProcessedUrlToServer(SOCKET serverSocket, const std::string& url, const
     try {
         // Format the book data
         std::string bookData = "{url:\"" + url + "\",book:{title:\"" + book.title + 
-                              "\",price:\"" + book.price + "\",rating:\"" + book.rating + 
-                              "\",url:\"" + book.url + "\"}}";
+                              "\",price:\"" + format_price(book.price) + "\",rating:\"" + rating_name(book.rating) + 
+                              "\",url:\"" + book.url + "\",category:\"" + category_name(book.category) + "\"}}";
         
         // First send the PROCESSED message with book data but no links
         std::string initialMsg = "PROCESSED:" + bookData;
@@ -778,12 +773,14 @@ void progressReporter(SOCKET serverSocket) {
 }
 
 // Forward declaration for parse_book_page from HtmlParser.h
-Book parse_book_page(const std::string& html, const std::string& hostname, const std::string& url);
+Book parse_book_page(std::string_view html, const std::string& hostname, const std::string& url);
 
-// Modified crawl_page function that updates the global counter and returns both the book and HTML
-std::pair<Book, std::string> crawl_page_with_html(const std::string& hostname, const std::string& page_url) {
+// Sanitize a URL received from the server and work out which host serves it.
+// Returns false if the URL cannot be crawled.
+bool preparePageUrl(const std::string& hostname, const std::string& page_url,
+                    std::string& valid_url, std::string& effective_hostname) {
     // First, sanitize the URL to fix any issues
-    std::string valid_url = page_url;
+    valid_url = page_url;
     
     // Fix malformed URLs with domain concatenation
     if (valid_url.find("http://books.toscrape.comhttp") != std::string::npos ||
@@ -805,16 +802,11 @@ std::pair<Book, std::string> crawl_page_with_html(const std::string& hostname, c
     // Validate URL before crawling
     if (!isValidUrl(valid_url)) {
         log("Skipping invalid URL: " + page_url);
-        return {Book(), ""};
+        return false;
     }
     
-    log("Crawling page: " + valid_url);
-    
-    // Record start time
-    auto startTime = std::chrono::high_resolution_clock::now();
-    
     // Extract hostname from URL if needed
-    std::string effective_hostname = hostname;
+    effective_hostname = hostname;
     if (valid_url.find("https://") == 0 || valid_url.find("http://") == 0) {
         size_t domain_start = valid_url.find("://") + 3;
         size_t domain_end = valid_url.find('/', domain_start);
@@ -825,22 +817,11 @@ std::pair<Book, std::string> crawl_page_with_html(const std::string& hostname, c
         }
     }
     
-    // Make HTTP request to get the page content
-    std::string response;
-    try {
-        response = http_get(effective_hostname, valid_url);
-    } catch (const std::exception& e) {
-        log("Error fetching URL: " + valid_url + " - " + e.what());
-        return {Book(), ""};
-    }
-    
-    if (response.empty()) {
-        log("Empty response from URL: " + valid_url);
-        return {Book(), ""};
-    }
-    
-    std::string html = extract_body(response);
-    
+    return true;
+}
+
+// Parse a fetched page into a book, dropping books we have just seen
+Book processPageHtml(const std::string& effective_hostname, const std::string& valid_url, std::string_view html) {
     // Parse the HTML to extract book information
     Book book = parse_book_page(html, effective_hostname, valid_url);
     
@@ -898,21 +879,146 @@ std::pair<Book, std::string> crawl_page_with_html(const std::string& hostname, c
         }
     }
     
+    // Increment the processed pages counter
+    processedPages++;
+    
+    return book;
+}
+
+// A page with the same text as one already parsed under another URL (a sort
+// order, a pagination alias): its book and links have been reported already
+bool isNearDuplicatePage(const std::string& valid_url, std::string_view html) {
+    if (!workerSkipNearDuplicates) {
+        return false;
+    }
+    std::string match;
+    if (!workerNearDuplicates.check(simhash_page(html), valid_url, &match)) {
+        return false;
+    }
+    log("Near-duplicate of " + match + ", skipped parsing: " + valid_url);
+    processedPages++;
+    return true;
+}
+
+// Whether robots.txt lets this worker fetch valid_url from host. The first URL
+// of a host fetches its robots.txt and picks up its Crawl-delay.
+bool isAllowedByRobots(const std::string& host, const std::string& valid_url) {
+    bool fetched = false;
+    bool allowed = robots_cache().allowed(host, valid_url, &fetched);
+    if (fetched) {
+        const RobotsRules& rules = robots_cache().rules(host);
+        std::ostringstream summary;
+        summary << "robots.txt of " << host << ": " << rules.rule_count() << " rules";
+        if (rules.crawl_delay() > 0) {
+            summary << ", crawl delay " << rules.crawl_delay() << " s";
+        }
+        log(summary.str());
+        std::lock_guard<std::mutex> lock(workerPolitenessMutex);
+        apply_crawl_delay(workerPoliteness, host, rules);
+    }
+    if (!allowed) {
+        log("Disallowed by robots.txt: " + valid_url);
+    }
+    return allowed;
+}
+
+// Wait out host's Crawl-delay before sending it requests
+void waitForCrawlDelay(const std::string& host, int requests = 1) {
+    HostScheduler::Clock::duration wait;
+    {
+        std::lock_guard<std::mutex> lock(workerPolitenessMutex);
+        wait = workerPoliteness.reserve(host, requests);
+    }
+    std::this_thread::sleep_for(wait);
+}
+
+// Validator store key of a server-assigned URL, or "" if the URL is unusable
+std::string pageValidatorKey(const std::string& hostname, const std::string& page_url) {
+    std::string valid_url;
+    std::string effective_hostname;
+    if (!preparePageUrl(hostname, page_url, valid_url, effective_hostname)) {
+        return "";
+    }
+    return validator_key(effective_hostname, valid_url);
+}
+
+// Modified crawl_page function that updates the global counter and returns both the book and HTML.
+// The page is fetched into response and the HTML is a view of its body, so it is
+// not copied and stays valid as long as the caller keeps response.
+// A page unchanged since the last crawl (--recrawl) is not parsed: the HTML comes back
+// empty and *unchanged is set, so the caller can replay the page's known links.
+// Likewise a near-duplicate of a page already parsed (--near-duplicates) sets
+// *near_duplicate, and has no links to report. A page robots.txt disallows is
+// not fetched at all.
+std::pair<Book, std::string_view> crawl_page_with_html(const std::string& hostname, const std::string& page_url,
+                                                       HttpResponse& response, bool* unchanged,
+                                                       bool* near_duplicate) {
+    std::string valid_url;
+    std::string effective_hostname;
+    if (!preparePageUrl(hostname, page_url, valid_url, effective_hostname)) {
+        return {Book(), std::string_view()};
+    }
+    
+    if (!isAllowedByRobots(effective_hostname, valid_url)) {
+        return {Book(), std::string_view()};
+    }
+    
+    log("Crawling page: " + valid_url);
+    
+    // Record start time
+    auto startTime = std::chrono::high_resolution_clock::now();
+    
+    // Make HTTP request to get the page content
+    bool fetched = false;
+    try {
+        waitForCrawlDelay(effective_hostname);
+        fetched = http_fetch(effective_hostname, valid_url, response);
+    } catch (const std::exception& e) {
+        log("Error fetching URL: " + valid_url + " - " + e.what());
+        return {Book(), std::string_view()};
+    }
+    
+    if (!fetched) {
+        log("Empty response from URL: " + valid_url);
+        return {Book(), std::string_view()};
+    }
+    
+    if (!response.skipped.empty()) {
+        log("Skipped " + valid_url + ": " + response.skipped);
+        return {Book(), std::string_view()};
+    }
+    
+    if (response.unchanged) {
+        log("Page unchanged since last crawl: " + valid_url);
+        processedPages++;
+        if (unchanged != nullptr) {
+            *unchanged = true;
+        }
+        return {Book(), std::string_view()};
+    }
+    
+    if (isNearDuplicatePage(valid_url, response.body)) {
+        if (near_duplicate != nullptr) {
+            *near_duplicate = true;
+        }
+        return {Book(), std::string_view()};
+    }
+    
+    Book book = processPageHtml(effective_hostname, valid_url, response.body);
+    
     // Record end time and calculate processing time
     auto endTime = std::chrono::high_resolution_clock::now();
     auto processingTime = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
     
     log("Processed page: " + valid_url + " in " + std::to_string(processingTime) + "ms");
     
-    // Increment the processed pages counter
-    processedPages++;
-    
-    return {book, html};
+    return {book, response.body};
 }
 
 // Original crawl_page function for backward compatibility
 Book crawl_page(const std::string& hostname, const std::string& page_url) {
-    return crawl_page_with_html(hostname, page_url).first;
+    HttpResponse response;
+    return crawl_page_with_html(hostname, page_url, response).first;
 }
 
 // Add this function to check if a URL has been processed
@@ -967,43 +1073,193 @@ bool hasUrlBeenProcessed(const std::string& url) {
     return exists;
 }
 
-// Extract and filter links from HTML
-std::vector<std::string> find_all_links(const std::string& html, const std::string& hostname, const std::string& url) {
-    // First extract all links using the existing function
-    std::set<std::string> links = extract_all_links(html, url);
-    
-    // Filter out non-content URLs (static resources, etc.)
-    std::set<std::string> filteredLinks;
-    for (const auto& link : links) {
-        // Skip static resources and non-content URLs
-        if (link.find("/static/") != std::string::npos ||
-            link.find(".css") != std::string::npos ||
-            link.find(".js") != std::string::npos ||
-            link.find(".ico") != std::string::npos ||
-            link.find(".jpg") != std::string::npos ||
-            link.find(".png") != std::string::npos) {
+// Extract the links of a page that the URL rules accept, sorted; only the links sent on are
+// copied out of the page buffer
+std::vector<std::string> find_all_links(std::string_view html, const std::string& hostname, const std::string& url) {
+    // Reused for every page this thread parses
+    thread_local UrlBase base;
+    thread_local LinkBuffer links;
+    base.assign(url);
+    links.clear();
+    extract_all_links(html, base, links);
+    links.sort();
+    
+    std::vector<std::string> linksVector;
+    for (size_t i = 0; i < links.size(); ++i) {
+        linksVector.emplace_back(links[i]);
+    }
+    
+    // Log the number of links found
+    log("Found " + std::to_string(linksVector.size()) + " links on page " + url);
+    
+    return linksVector;
+}
+
+// Send processed URL and extracted data back to server, retrying a few times
+bool sendProcessedWithRetry(SOCKET serverSocket, const std::string& url, const Book& book,
+                            const std::vector<std::string>& links) {
+    int retries = 3;
+    bool success = false;
+    while (retries > 0 && !success && !shouldStop.load()) {
+        try {
+            success = sendProcessedUrlToServer(serverSocket, url, book, links);
+            if (!success) {
+                log("Failed to send processed URL to server, retries left: " + std::to_string(retries - 1));
+                retries--;
+                if (retries > 0) {
+                    std::this_thread::sleep_for(std::chrono::seconds(1));
+                }
+            }
+        } catch (const std::exception& e) {
+            log("Exception in sendProcessedUrlToServer: " + std::string(e.what()));
+            retries--;
+            if (retries > 0) {
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+            }
+        }
+    }
+    
+    if (!success && !shouldStop.load()) {
+        log("Failed to send processed URL after retries, will continue with next URL");
+        // Don't break, try to continue
+    }
+    return success;
+}
+
+// Fetch a batch of server-assigned URLs together.
+// With --concurrency up to workerConcurrency pages are in flight through the
+// fetch engine; otherwise (--pipeline) same-host URLs are pipelined on one
+// connection with http_get_many. Each finished page is parsed and reported
+// back to the server like the single-page path does.
+void processUrlBatch(SOCKET serverSocket, const std::string& serverHost, FetchEngine& engine, std::vector<Book>& books) {
+    struct PendingPage {
+        std::string url;           // URL as assigned by the server
+        std::string validUrl;
+        std::string effectiveHostname;
+    };
+    std::vector<PendingPage> pages;
+    int batchSize = std::max(workerConcurrency, workerPipelineDepth);
+    
+    // Collect up to batchSize URLs; only the first request waits for work
+    for (int i = 0; i < batchSize && !shouldStop.load(); ++i) {
+        std::string url = getUrlFromServer(serverSocket, i == 0);
+        if (url.empty()) {
+            break;
+        }
+        
+        if (hasUrlBeenProcessed(url)) {
+            // Acknowledge skipped duplicates straight away
+            sendProcessedWithRetry(serverSocket, url, Book(), std::vector<std::string>());
             continue;
         }
         
-        // Skip malformed URLs
-        if (link.find("http://books.toscrape.comhttp") != std::string::npos ||
-            link.find("http://books.toscrape.comhttps") != std::string::npos ||
-            link.find("mhttp") != std::string::npos ||
-            link.find("mhttps") != std::string::npos) {
+        PendingPage page;
+        page.url = url;
+        if (!preparePageUrl(serverHost, url, page.validUrl, page.effectiveHostname) ||
+            !isAllowedByRobots(page.effectiveHostname, page.validUrl)) {
+            sendProcessedWithRetry(serverSocket, url, Book(), std::vector<std::string>());
             continue;
         }
         
-        filteredLinks.insert(link);
+        log("Crawling page: " + page.validUrl);
+        pages.push_back(page);
     }
     
-    // Convert the filtered set to a vector
-    std::vector<std::string> linksVector(filteredLinks.begin(), filteredLinks.end());
+    if (pages.empty()) {
+        // Nothing to fetch right now; back off briefly
+        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        return;
+    }
     
-    // Log the number of links found
-    log("Found " + std::to_string(filteredLinks.size()) + " filtered links out of " + 
-        std::to_string(links.size()) + " total links on page " + url);
+    // Parse a fetched page and report it to the server
+    auto finishPage = [&](const PendingPage& page, bool ok, const HttpResponse& response,
+                          const std::string& error, double elapsedMs) {
+        Book book;
+        std::vector<std::string> links;
+        std::string key = validator_key(page.effectiveHostname, page.validUrl);
+        if (ok && !response.skipped.empty()) {
+            // Headers only: reported as processed with nothing found
+            log("Skipped " + page.validUrl + ": " + response.skipped);
+        } else if (ok && response.unchanged) {
+            // Nothing changed since the last crawl: report the links the page had then
+            validator_store().links(key, links);
+            processedPages++;
+            log("Page unchanged since last crawl: " + page.validUrl);
+        } else if (ok && isNearDuplicatePage(page.validUrl, response.body)) {
+            // Reported as processed with nothing found
+        } else if (ok) {
+            std::string_view html = response.body;
+            book = processPageHtml(page.effectiveHostname, page.validUrl, html);
+            try {
+                links = find_all_links(html, serverHost, page.url);
+            } catch (const std::exception& e) {
+                log("Exception in find_all_links: " + std::string(e.what()));
+            }
+            validator_store().set_links(key, links);
+            if (!book.title.empty()) {
+                books.push_back(book);
+                log("Found book: " + book.title + " (Price: " + format_price(book.price) + ", Rating: " + rating_name(book.rating) + ")");
+            }
+            log("Processed page: " + page.validUrl + " in " +
+                std::to_string((long long)elapsedMs) + "ms");
+        } else {
+            log("Failed to fetch " + page.validUrl + ": " + error);
+        }
+        
+        sendProcessedWithRetry(serverSocket, page.url, book, links);
+    };
+    
+    if (workerConcurrency <= 1) {
+        // Pipeline each host's URLs on one connection
+        std::map<std::string, std::vector<size_t>> byHost;
+        for (size_t i = 0; i < pages.size(); ++i) {
+            byHost[pages[i].effectiveHostname].push_back(i);
+        }
+        
+        for (const auto& group : byHost) {
+            std::vector<std::string> paths;
+            for (size_t index : group.second) {
+                paths.push_back(pages[index].validUrl);
+            }
+            log("Pipelining " + std::to_string(paths.size()) + " pages to " + group.first);
+            
+            waitForCrawlDelay(group.first, (int)paths.size());
+            auto startTime = std::chrono::steady_clock::now();
+            std::vector<HttpBatchResult> results = http_get_many(group.first, paths, (size_t)workerPipelineDepth);
+            std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - startTime;
+            
+            for (size_t i = 0; i < results.size() && !shouldStop.load(); ++i) {
+                finishPage(pages[group.second[i]], results[i].ok, results[i].response,
+                           "Fetch failed", elapsed.count() / (double)results.size());
+            }
+        }
+        return;
+    }
     
-    return linksVector;
+    std::map<unsigned long long, size_t> pending;
+    for (size_t i = 0; i < pages.size(); ++i) {
+        waitForCrawlDelay(pages[i].effectiveHostname);
+        pending[engine.submit(pages[i].effectiveHostname, pages[i].validUrl)] = i;
+    }
+    
+    log("Fetching " + std::to_string(pending.size()) + " pages concurrently");
+    
+    std::vector<FetchResult> results;
+    while (engine.outstanding() > 0 && !shouldStop.load()) {
+        engine.poll(100);
+        results.clear();
+        engine.take_completed(results);
+        
+        for (auto& result : results) {
+            auto it = pending.find(result.id);
+            if (it == pending.end()) {
+                continue;
+            }
+            const PendingPage& page = pages[it->second];
+            pending.erase(it);
+            finishPage(page, result.ok, result.response, result.error, result.elapsed_ms);
+        }
+    }
 }
 
 // Entry point
@@ -1011,6 +1267,9 @@ int main(int argc, char* argv[]) {
     // Default server settings
     std::string serverHost = "distributed-web-scrapper-and-crawler-c.onrender.com";
     int serverPort = 9000;
+    std::string recordFile;
+    std::string replayFile;
+    int replayLatencyMs = 0;
     
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -1024,7 +1283,100 @@ int main(int argc, char* argv[]) {
                 std::cerr << "Invalid port number" << std::endl;
                 return 1;
             }
+        } else if (arg == "--concurrency" && i + 1 < argc) {
+            try {
+                workerConcurrency = std::max(1, std::stoi(argv[++i]));
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid concurrency" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--pipeline" && i + 1 < argc) {
+            try {
+                workerPipelineDepth = std::max(1, std::stoi(argv[++i]));
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid pipeline depth" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--connect-timeout" && i + 1 < argc) {
+            try {
+                TcpConnectConfig connectConfig = tcp_connector().get_config();
+                connectConfig.connect_timeout = std::chrono::milliseconds(std::max(0, std::stoi(argv[++i])));
+                tcp_connector().set_config(connectConfig);
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid connect timeout" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--html-only") {
+            BodyFilter filter = http_body_filter();
+            filter.html_only = true;
+            http_set_body_filter(filter);
+        } else if (arg == "--max-body" && i + 1 < argc) {
+            try {
+                BodyFilter filter = http_body_filter();
+                filter.max_body_bytes = (size_t)std::max(0LL, std::stoll(argv[++i]));
+                http_set_body_filter(filter);
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid body size cap" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--ca-file" && i + 1 < argc) {
+            TlsConfig tlsConfig = tls_context().get_config();
+            tlsConfig.ca_file = argv[++i];
+            tls_context().set_config(tlsConfig);
+        } else if (arg == "--connect-to" && i + 1 < argc) {
+            http_set_connect_to(argv[++i]);
+            log("Fetching every page from " + std::string(argv[i]));
+        } else if (arg == "--recrawl" && i + 1 < argc) {
+            workerValidatorFile = argv[++i];
+        } else if (arg == "--near-duplicates" && i + 1 < argc) {
+            try {
+                NearDuplicateConfig nearDuplicateConfig;
+                nearDuplicateConfig.max_distance = std::min(63, std::max(0, std::stoi(argv[++i])));
+                workerNearDuplicates.set_config(nearDuplicateConfig);
+                workerSkipNearDuplicates = true;
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid near-duplicate distance" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--ignore-robots") {
+            robots_cache().set_enabled(false);
+            log("Ignoring robots.txt");
+        } else if (arg == "--rules" && i + 1 < argc) {
+            if (!url_rules().load(argv[++i])) {
+                return 1;
+            }
+            log("Loaded " + std::to_string(url_rules().rule_count()) + " URL rules from " + std::string(argv[i]));
+        } else if (arg == "--record" && i + 1 < argc) {
+            recordFile = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replayFile = argv[++i];
+        } else if (arg == "--replay-latency" && i + 1 < argc) {
+            try {
+                replayLatencyMs = std::max(0, std::stoi(argv[++i]));
+            } catch (const std::exception& e) {
+                std::cerr << "Invalid replay latency" << std::endl;
+                return 1;
+            }
+        }
+    }
+    
+    // Offline runs: answer every fetch from an archive, or archive what is fetched
+    if (!replayFile.empty()) {
+        if (!response_archive().start_replay(replayFile, std::chrono::milliseconds(replayLatencyMs))) {
+            return 1;
         }
+        log("Replaying " + std::to_string(http_archive_stats().entries) + " responses from " + replayFile +
+            " (" + std::to_string(replayLatencyMs) + " ms latency)");
+    } else if (!recordFile.empty()) {
+        if (!response_archive().start_recording(recordFile)) {
+            return 1;
+        }
+        log("Recording responses to " + recordFile);
+    }
+    
+    if (!workerValidatorFile.empty() && validator_store().open(workerValidatorFile)) {
+        log("Revalidating against " + workerValidatorFile + " (" +
+            std::to_string(validator_store().get_stats().entries) + " pages known)");
     }
     
     log("Connecting to server at " + serverHost + ":" + std::to_string(serverPort));
@@ -1068,6 +1420,13 @@ int main(int argc, char* argv[]) {
         startUrl = baseUrl;
         log("Set seed URL: " + startUrl);
         
+        // Fetch engine for concurrent mode; its keep-alive sockets survive across batches
+        FetchEngineConfig engineConfig;
+        engineConfig.max_in_flight = (size_t)workerConcurrency;
+        engineConfig.max_connections_per_host = (size_t)workerConcurrency;
+        engineConfig.request_timeout = std::chrono::seconds(60);
+        FetchEngine engine(engineConfig);
+        
         // Main loop - get URLs from server and process them
         while (!shouldStop.load()) {
             // Add a heartbeat log to track activity
@@ -1075,10 +1434,66 @@ int main(int argc, char* argv[]) {
             auto now = std::chrono::steady_clock::now();
             if (std::chrono::duration_cast<std::chrono::seconds>(now - lastHeartbeat).count() >= 60) {
                 log("Worker heartbeat - still running, processed " + std::to_string(processedPages.load()) + " pages");
+                ConnectionPoolStats poolStats = http_pool_stats();
+                log("Connection pool: " + std::to_string(poolStats.hits) + " hits, " +
+                    std::to_string(poolStats.misses) + " misses, " +
+                    std::to_string(poolStats.reconnects) + " reconnects");
+                DnsCacheStats dnsStats = http_dns_stats();
+                log("DNS cache: " + std::to_string(dnsStats.hits) + " hits, " +
+                    std::to_string(dnsStats.misses) + " misses, " +
+                    std::to_string(dnsStats.failures) + " failures");
+                TcpConnectStats connectStats = http_connect_stats();
+                log("Connect: " + std::to_string(connectStats.connects) + " connected, " +
+                    std::to_string(connectStats.fallbacks) + " via a fallback address, " +
+                    std::to_string(connectStats.timeouts) + " timed out, " +
+                    std::to_string(connectStats.failures) + " failed");
+                TlsStats tlsStats = http_tls_stats();
+                if (tlsStats.handshakes > 0 || tlsStats.failures > 0) {
+                    log("TLS: " + std::to_string(tlsStats.handshakes) + " handshakes, " +
+                        std::to_string(tlsStats.resumed) + " resumed, " +
+                        std::to_string(tlsStats.failures) + " failed");
+                }
+                TransferStats transferStats = http_transfer_stats();
+                log("Transfer: " + std::to_string(transferStats.encoded_bytes) + " body bytes received, " +
+                    std::to_string(transferStats.decoded_bytes) + " after decoding (" +
+                    std::to_string(transferStats.decoded_responses) + " of " +
+                    std::to_string(transferStats.responses) + " responses compressed)");
+                if (transferStats.skipped_bodies > 0) {
+                    log("Content filter: " + std::to_string(transferStats.skipped_bodies) +
+                        " bodies skipped after their headers");
+                }
+                if (workerSkipNearDuplicates) {
+                    NearDuplicateStats nearDuplicateStats = workerNearDuplicates.get_stats();
+                    log("Near-duplicates: " + std::to_string(nearDuplicateStats.near_duplicates) + " of " +
+                        std::to_string(nearDuplicateStats.pages) + " pages fingerprinted");
+                }
+                if (robots_cache().enabled()) {
+                    RobotsStats robotsStats = robots_cache().get_stats();
+                    log("Robots.txt: " + std::to_string(robotsStats.hosts) + " hosts, " +
+                        std::to_string(robotsStats.disallowed) + " URLs disallowed");
+                }
+                if (!workerValidatorFile.empty()) {
+                    ValidatorStoreStats validatorStats = http_validator_stats();
+                    log("Revalidation: " + std::to_string(validatorStats.not_modified) + " not modified, " +
+                        std::to_string(validatorStats.hash_matches) + " unchanged bodies of " +
+                        std::to_string(validatorStats.conditional_requests) + " conditional requests");
+                    validator_store().save();
+                }
+                if (response_archive().mode() != ArchiveMode::Off) {
+                    ResponseArchiveStats archiveStats = http_archive_stats();
+                    log("Archive: " + std::to_string(archiveStats.recorded) + " recorded, " +
+                        std::to_string(archiveStats.replayed) + " replayed, " +
+                        std::to_string(archiveStats.replay_misses) + " not recorded");
+                }
                 lastHeartbeat = now;
             }
             
             try {
+                if (workerConcurrency > 1 || workerPipelineDepth > 1) {
+                    processUrlBatch(serverSocket, serverHost, engine, books);
+                    continue;
+                }
+                
                 // Request a URL from the server
                 std::string url = getUrlFromServer(serverSocket);
                 
@@ -1117,10 +1532,13 @@ int main(int argc, char* argv[]) {
                 
                 // Crawl the page with timeout protection
                 Book book;
-                std::string html;
+                HttpResponse response;      // Owns the bytes html points at
+                std::string_view html;
+                bool unchanged = false;
+                bool nearDuplicate = false;
                 std::thread crawlThread([&]() {
                     try {
-                        auto result = crawl_page_with_html(serverHost, url);
+                        auto result = crawl_page_with_html(serverHost, url, response, &unchanged, &nearDuplicate);
                         book = result.first;
                         html = result.second;
                     } catch (const std::exception& e) {
@@ -1162,7 +1580,12 @@ int main(int argc, char* argv[]) {
                 
                 // Even if HTML is empty, we need to send an acknowledgment
                 std::vector<std::string> links;
-                if (!html.empty()) {
+                if (unchanged) {
+                    // Not parsed; the links it had on the last crawl still stand
+                    validator_store().links(pageValidatorKey(serverHost, url), links);
+                } else if (nearDuplicate) {
+                    // Its text, and so its links, were reported with the page it duplicates
+                } else if (!html.empty()) {
                     try {
                         // Extract links from the HTML
                         links = find_all_links(html, serverHost, url);
@@ -1170,43 +1593,20 @@ int main(int argc, char* argv[]) {
                         log("Exception in find_all_links: " + std::string(e.what()));
                         // Continue with empty links
                     }
+                    validator_store().set_links(pageValidatorKey(serverHost, url), links);
                     
                     // Process the book if valid
                     if (!book.title.empty()) {
                         // Add the book to our local collection
                         books.push_back(book);
-                        log("Found book: " + book.title + " (Price: " + book.price + ", Rating: " + book.rating + ")");
+                        log("Found book: " + book.title + " (Price: " + format_price(book.price) + ", Rating: " + rating_name(book.rating) + ")");
                     }
                 } else {
                     log("Empty HTML response for URL: " + url + ", skipping link extraction");
                 }
                 
                 // Send processed URL and extracted data back to server with retry logic
-                int retries = 3;
-                bool success = false;
-                while (retries > 0 && !success && !shouldStop.load()) {
-                    try {
-                        success = sendProcessedUrlToServer(serverSocket, url, book, links);
-                        if (!success) {
-                            log("Failed to send processed URL to server, retries left: " + std::to_string(retries - 1));
-                            retries--;
-                            if (retries > 0) {
-                                std::this_thread::sleep_for(std::chrono::seconds(1));
-                            }
-                        }
-                    } catch (const std::exception& e) {
-                        log("Exception in sendProcessedUrlToServer: " + std::string(e.what()));
-                        retries--;
-                        if (retries > 0) {
-                            std::this_thread::sleep_for(std::chrono::seconds(1));
-                        }
-                    }
-                }
-                
-                if (!success && !shouldStop.load()) {
-                    log("Failed to send processed URL after retries, will continue with next URL");
-                    // Don't break, try to continue
-                }
+                sendProcessedWithRetry(serverSocket, url, book, links);
                 
                 // Limit memory usage by processed URLs
                 {
@@ -1234,6 +1634,9 @@ int main(int argc, char* argv[]) {
         auto totalTime = std::chrono::duration_cast<std::chrono::seconds>(endTime - startTime).count();
         
         log("Worker finished. Total execution time: " + std::to_string(totalTime) + " seconds");
+        if (!workerValidatorFile.empty()) {
+            validator_store().save();
+        }
         
         // Wait for reporter thread to finish
         if (reporterThread.joinable()) {